@@ -199,7 +199,11 @@ bool VgmstreamPlugin::play(const char *filename, VFSFile &file) {
     set_stream_bitrate(rate);
     open_audio(FMT_S16_LE, vgmstream->sample_rate, vgmstream->channels);
 
-    int fade_samples = vgmstream_cfg.fade_length * vgmstream->sample_rate;
+    // fade is applied while rendering
+    if (!vgmstream_cfg.loop_forever)
+        vgmstream_set_play_config(vgmstream, vgmstream_cfg.loop_count,
+                vgmstream_cfg.fade_length, vgmstream_cfg.fade_delay);
+
     while (!check_stop()) {
         int toget = max_buffer_samples;
 
@@ -218,22 +222,6 @@ bool VgmstreamPlugin::play(const char *filename, VFSFile &file) {
 
         render_vgmstream(buffer, toget, vgmstream);
 
-        if (vgmstream->loop_flag && fade_samples > 0 &&
-                !vgmstream_cfg.loop_forever) {
-            int samples_into_fade =
-                    current_sample_pos - (stream_samples_amount - fade_samples);
-            if (samples_into_fade + toget > 0) {
-                for (int j = 0; j < toget; j++, samples_into_fade++) {
-                    if (samples_into_fade > 0) {
-                        double fadedness =
-                                (double)(fade_samples - samples_into_fade) / fade_samples;
-                        for (int k = 0; k < vgmstream->channels; k++)
-                            buffer[j * vgmstream->channels + k] *= fadedness;
-                    }
-                }
-            }
-        }
-
         write_audio(buffer, toget * sizeof(short) * vgmstream->channels);
         current_sample_pos += toget;
     }
@@ -309,6 +309,9 @@ static int play_vgmstream(const char *filename, struct params *par) {
 
     total_samples = get_vgmstream_play_samples(loop_count, par->fade_time, par->fade_delay, vgms);
 
+    /* fade-out is applied while rendering */
+    vgmstream_set_play_config(vgms, loop_count, par->fade_time, par->fade_delay);
+
     {
         double total = (double)total_samples / vgms->sample_rate;
         time_total_min = (int)total / 60;
@@ -346,17 +349,8 @@ static int play_vgmstream(const char *filename, struct params *par) {
         swap_samples_le(buffer, vgms->channels * buffer_used_samples);
 #endif
 
-        if (vgms->loop_flag && fade_time_samples > 0 && s >= fade_start) {
-            /* Got to do the fade-out ourselves :p */
-            int64_t b;
-            for (b = 0; b < buffer_used_samples; b++) {
-                double factor = 1.0 - (double)(s + b - fade_start) / fade_time_samples;
-                int c;
-                for (c = 0; c < vgms->channels; c++)
-                    buffer[vgms->channels * b + c] *= factor;
-            }
+        if (vgms->loop_flag && fade_time_samples > 0 && s >= fade_start)
             suffix = " (fading)";
-        }
 
         if (verbose && !out_filename) {
             double played = (double)s / vgms->sample_rate;
@@ -6,9 +6,14 @@
 #ifdef WIN32
 #include <io.h>
 #include <fcntl.h>
+#include <windows.h>
+#include <process.h>
 #else
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
 #endif
+#include <errno.h>
 
 #ifndef STDOUT_FILENO
 #define STDOUT_FILENO 1
@@ -22,17 +27,20 @@
 #endif
 
 #define BUFFER_SAMPLES 0x8000
+#define MAX_JOBS 64
+#define MAX_OUTPUTS 8
+#define OUTPUT_BUFFER_SIZE 0x100000
 
 /* getopt globals (the horror...) */
 extern char * optarg;
 extern int optind, opterr, optopt;
 
 
-static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_count, int32_t sample_rate, int channels, int smpl_chunk, int32_t loop_start, int32_t loop_end);
+static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_count, int32_t sample_rate, int channels, int is_float, int smpl_chunk, int32_t loop_start, int32_t loop_end);
 
 static void usage(const char * name) {
     fprintf(stderr,"vgmstream CLI decoder " VERSION " " __DATE__ "\n"
-            "Usage: %s [-o outfile.wav] [options] infile\n"
+            "Usage: %s [-o outfile.wav] [options] infile [infile2 ...]\n"
             "Options:\n"
             "    -o outfile.wav: name of output .wav file, default infile.wav\n"
             "    -l loop count: loop count, default 2.0\n"
@@ -46,6 +54,8 @@ static void usage(const char * name) {
             "    -m: print metadata only, don't decode\n"
             "    -L: append a smpl chunk and create a looping wav\n"
             "    -2 N: only output the Nth (first is 0) set of stereo channels\n"
+            "    -k list[:file.wav]: only output channels in list (first is 0, ex. 0,1 or 2-5), to file if given\n"
+            "       (repeat with files to write several channel sets from one decode)\n"
             "    -p: output to stdout (for piping into another program)\n"
             "    -P: output to stdout even if stdout is a terminal\n"
             "    -c: loop forever (continuously) to stdout\n"
@@ -54,11 +64,23 @@ static void usage(const char * name) {
             "    -b: decode and print batch variable commands\n"
             "    -r: output a second file after resetting (for testing)\n"
             "    -t file: print if tags are found in file\n"
+            "    -M: read files through memory mapping (where supported)\n"
+            "    -S: decode all subsongs, to infile#N.wav\n"
+            "    -j N: decode N files/subsongs at once (in parallel)\n"
+            "    -w: output 32-bit float .wav (decodes without 16-bit clipping when possible)\n"
+            "    -R rate: resample output to rate (in Hz)\n"
+            "    -T N: decode layers of layered files on N threads\n"
+            "    -C N: keep decoded loop in memory to skip decoding repeats (1: first pass, 2: first repeat)\n"
+            "    -K N: search keys of encrypted files (without keyfile) on N threads\n"
+            "    -Q file: remember keys found by searching in file, to reuse for the same file or folder\n"
+            "    -I file: load seek index (saved decoder state, for players) from file, update it while decoding and save it\n"
             , name);
 }
 
 
 typedef struct {
+    char ** infilenames;
+    int infilenames_count;
     char * infilename;
     char * outfilename;
     char * tag_filename;
@@ -73,8 +95,20 @@ typedef struct {
     int print_oggenc;
     int print_batchvar;
     int test_reset;
+    int use_mmap;
+    int all_subsongs;
+    int jobs;
+    int write_float;
+    int output_rate;
+    int layer_threads;
+    int loop_cache;
+    int key_threads;
+    char * key_cache_filename;
+    char * seek_index_filename;
     int write_lwav;
     int only_stereo;
+    char * channel_lists[MAX_OUTPUTS];
+    int channel_lists_count;
     int stream_index;
     double loop_count;
     double fade_time;
@@ -84,6 +118,7 @@ typedef struct {
     /* not quite config but eh */
     int lwav_loop_start;
     int lwav_loop_end;
+    VGMSTREAM_BANK * bank; /* already detected file (-S) */
 } cli_config;
 
 
@@ -94,12 +129,15 @@ static int parse_config(cli_config *cfg, int argc, char ** argv) {
     cfg->only_stereo = -1;
     cfg->loop_count = 2.0;
     cfg->fade_time = 10.0;
+    cfg->jobs = 1;
+    cfg->layer_threads = 1;
+    cfg->key_threads = 1;
 
     /* don't let getopt print errors to stdout automatically */
     opterr = 0;
 
     /* read config */
-    while ((opt = getopt(argc, argv, "o:l:f:d:ipPcmxeLEFrgb2:s:t:")) != -1) {
+    while ((opt = getopt(argc, argv, "o:l:f:d:ipPcmxeLEFrgb2:k:s:t:MSj:wR:T:C:K:Q:I:")) != -1) {
         switch (opt) {
             case 'o':
                 cfg->outfilename = optarg;
@@ -153,6 +191,13 @@ static int parse_config(cli_config *cfg, int argc, char ** argv) {
             case '2':
                 cfg->only_stereo = atoi(optarg);
                 break;
+            case 'k':
+                if (cfg->channel_lists_count == MAX_OUTPUTS) {
+                    fprintf(stderr, "-k can be used up to %i times\n", MAX_OUTPUTS);
+                    goto fail;
+                }
+                cfg->channel_lists[cfg->channel_lists_count++] = optarg;
+                break;
             case 'F':
                 cfg->ignore_fade = 1;
                 break;
@@ -162,6 +207,36 @@ static int parse_config(cli_config *cfg, int argc, char ** argv) {
             case 't':
                 cfg->tag_filename= optarg;
                 break;
+            case 'M':
+                cfg->use_mmap = 1;
+                break;
+            case 'S':
+                cfg->all_subsongs = 1;
+                break;
+            case 'j':
+                cfg->jobs = atoi(optarg);
+                break;
+            case 'w':
+                cfg->write_float = 1;
+                break;
+            case 'R':
+                cfg->output_rate = atoi(optarg);
+                break;
+            case 'T':
+                cfg->layer_threads = atoi(optarg);
+                break;
+            case 'C':
+                cfg->loop_cache = atoi(optarg);
+                break;
+            case 'K':
+                cfg->key_threads = atoi(optarg);
+                break;
+            case 'Q':
+                cfg->key_cache_filename = optarg;
+                break;
+            case 'I':
+                cfg->seek_index_filename = optarg;
+                break;
             case '?':
                 fprintf(stderr, "Unknown option -%c found\n", optopt);
                 goto fail;
@@ -171,12 +246,14 @@ static int parse_config(cli_config *cfg, int argc, char ** argv) {
         }
     }
 
-    /* filename goes last */
-    if (optind != argc - 1) {
+    /* filenames go last */
+    if (optind > argc - 1) {
         usage(argv[0]);
         goto fail;
     }
-    cfg->infilename = argv[optind];
+    cfg->infilenames = &argv[optind];
+    cfg->infilenames_count = argc - optind;
+    cfg->infilename = cfg->infilenames[0];
 
 
     return 1;
@@ -184,7 +261,51 @@ fail:
     return 0;
 }
 
+/* parses a -k value, "list[:file]" with channels like 0,1,4-5, setting file to NULL if missing (0 if not valid) */
+static int parse_channel_list(const char * arg, int * channel_list, int * channel_count, const char ** filename) {
+    const char * p = arg;
+    char * end;
+    int count = 0;
+
+    while (1) {
+        int first, last;
+
+        first = last = (int)strtol(p, &end, 10);
+        if (end == p || first < 0)
+            return 0;
+        p = end;
+        if (*p == '-') {
+            last = (int)strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first)
+                return 0;
+            p = end;
+        }
+
+        for (; first <= last; first++) {
+            if (count == VGMSTREAM_MAX_CHANNELS)
+                return 0;
+            channel_list[count++] = first;
+        }
+
+        if (*p != ',')
+            break;
+        p++;
+    }
+
+    if (*p == ':' && p[1] != '\0')
+        *filename = p + 1;
+    else if (*p == '\0')
+        *filename = NULL;
+    else
+        return 0;
+
+    *channel_count = count;
+    return 1;
+}
+
 static int validate_config(cli_config *cfg) {
+    int i, main_lists = 0;
+
     if (cfg->play_sdtout && (!cfg->play_wreckless && isatty(STDOUT_FILENO))) {
         fprintf(stderr,"Are you sure you want to output wave data to the terminal?\nIf so use -P instead of -p.\n");
         goto fail;
@@ -209,6 +330,58 @@ static int validate_config(cli_config *cfg) {
         fprintf(stderr,"either -p or -o, make up your mind\n");
         goto fail;
     }
+    if ((cfg->infilenames_count > 1 || cfg->all_subsongs) && (cfg->play_sdtout || cfg->outfilename || cfg->test_reset || cfg->seek_index_filename)) {
+        fprintf(stderr,"-o/-p/-r/-I can't be used with multiple files or -S\n");
+        goto fail;
+    }
+    if (cfg->all_subsongs && cfg->stream_index) {
+        fprintf(stderr,"-S and -s are incompatible\n");
+        goto fail;
+    }
+    if (cfg->write_float && (cfg->print_adxencd || cfg->print_oggenc)) {
+        fprintf(stderr,"-w can't be used with -x/-g\n");
+        goto fail;
+    }
+    if (cfg->output_rate && (cfg->output_rate < 300 || cfg->output_rate > 192000)) {
+        fprintf(stderr,"-R must be between 300 and 192000\n");
+        goto fail;
+    }
+    if (cfg->layer_threads < 1 || cfg->layer_threads > MAX_JOBS) {
+        fprintf(stderr,"-T must be between 1 and %i\n", MAX_JOBS);
+        goto fail;
+    }
+    if (cfg->key_threads < 1 || cfg->key_threads > MAX_JOBS) {
+        fprintf(stderr,"-K must be between 1 and %i\n", MAX_JOBS);
+        goto fail;
+    }
+    if (cfg->loop_cache < 0 || cfg->loop_cache > 2) {
+        fprintf(stderr,"-C must be 1 or 2\n");
+        goto fail;
+    }
+    if (cfg->jobs < 1 || cfg->jobs > MAX_JOBS) {
+        fprintf(stderr,"-j must be between 1 and %i\n", MAX_JOBS);
+        goto fail;
+    }
+    for (i = 0; i < cfg->channel_lists_count; i++) {
+        int channel_list[VGMSTREAM_MAX_CHANNELS], channel_count;
+        const char * filename;
+
+        if (!parse_channel_list(cfg->channel_lists[i], channel_list, &channel_count, &filename)) {
+            fprintf(stderr,"-k has a bad channel list: %s\n", cfg->channel_lists[i]);
+            goto fail;
+        }
+        if (!filename) {
+            main_lists++;
+        }
+        else if (cfg->infilenames_count > 1 || cfg->all_subsongs) {
+            fprintf(stderr,"-k with a file can't be used with multiple files or -S\n");
+            goto fail;
+        }
+    }
+    if (main_lists > 1 || (main_lists && cfg->only_stereo != -1)) {
+        fprintf(stderr,"-k without a file can only be used once, and not with -2\n");
+        goto fail;
+    }
 
     return 1;
 fail:
@@ -310,237 +483,509 @@ static void apply_config(VGMSTREAM * vgmstream, cli_config *cfg) {
         cfg->lwav_loop_end = vgmstream->loop_end_sample;
         vgmstream_force_loop(vgmstream, 0, 0,0);
     }
+
+    if (cfg->layer_threads > 1) {
+        vgmstream_set_layer_threads(vgmstream, cfg->layer_threads, 0);
+    }
+
+    /* kept through resets (-r) */
+    if (cfg->loop_cache && !vgmstream->loop_cache) {
+        vgmstream_set_loop_cache(vgmstream, cfg->loop_cache == 2 ? loop_cache_first_repeat : loop_cache_first_pass, 0);
+    }
+
+    /* resample last (play samples and loop points are converted to the new rate) */
+    if (cfg->output_rate) {
+        vgmstream_set_output_rate(vgmstream, cfg->output_rate, resample_best);
+        if (cfg->write_lwav) {
+            int output_rate = vgmstream_get_output_rate(vgmstream);
+            cfg->lwav_loop_start = (int)((int64_t)cfg->lwav_loop_start * output_rate / vgmstream->sample_rate);
+            cfg->lwav_loop_end = (int)((int64_t)cfg->lwav_loop_end * output_rate / vgmstream->sample_rate);
+        }
+    }
+
+    /* fade out while rendering (after loops and output rate are final) */
+    if (!cfg->play_forever) {
+        vgmstream_set_play_config(vgmstream, cfg->loop_count, cfg->fade_time, cfg->fade_delay);
+    }
 }
 
-void apply_fade(sample * buf, VGMSTREAM * vgmstream, int to_get, int i, int len_samples, int fade_samples) {
-    if (vgmstream->loop_flag && fade_samples > 0) {
-        int samples_into_fade = i - (len_samples - fade_samples);
-        if (samples_into_fade + to_get > 0) {
-            int j, k;
-            for (j = 0; j < to_get; j++, samples_into_fade++) {
-                if (samples_into_fade > 0) {
-                    double fadedness = (double)(fade_samples - samples_into_fade) / fade_samples;
-                    for (k = 0; k < vgmstream->channels; k++) {
-                        buf[j*vgmstream->channels+k] = (sample)buf[j*vgmstream->channels+k]*fadedness;
-                    }
-                }
+/* ************************************************************ */
+
+/* .wav output, written from its own big buffer straight to the file descriptor (bypassing stdio),
+ * so channel subsets are extracted into the buffer and writes are large */
+typedef struct {
+    const char * filename;  /* NULL = stdout */
+    FILE * file;
+    int fd;
+    int channels;           /* written per frame */
+    int channel_list[VGMSTREAM_MAX_CHANNELS]; /* stream channels to write */
+    int channel_count;      /* 0 = all */
+    uint8_t * buf;
+    size_t buf_used;
+    int failed;
+} cli_output;
+
+/* prepares the main output (all channels, or -2/-k list without file) plus -k outputs with a file */
+static int setup_outputs(cli_config *cfg, VGMSTREAM *vgmstream, cli_output *outputs, int *outputs_count) {
+    int i, ch, count = 1;
+
+    memset(outputs, 0, (MAX_OUTPUTS + 1) * sizeof(cli_output));
+    outputs[0].fd = -1;
+
+    if (cfg->only_stereo != -1) {
+        outputs[0].channel_list[0] = cfg->only_stereo*2 + 0;
+        outputs[0].channel_list[1] = cfg->only_stereo*2 + 1;
+        outputs[0].channel_count = 2;
+    }
+
+    for (i = 0; i < cfg->channel_lists_count; i++) {
+        cli_output *out;
+        const char * filename;
+        int channel_list[VGMSTREAM_MAX_CHANNELS], channel_count;
+
+        parse_channel_list(cfg->channel_lists[i], channel_list, &channel_count, &filename); /* validated */
+
+        out = filename ? &outputs[count++] : &outputs[0];
+        out->filename = filename;
+        out->fd = -1;
+        memcpy(out->channel_list, channel_list, channel_count * sizeof(int));
+        out->channel_count = channel_count;
+    }
+
+    for (i = 0; i < count; i++) {
+        cli_output *out = &outputs[i];
+
+        for (ch = 0; ch < out->channel_count; ch++) {
+            if (out->channel_list[ch] >= vgmstream->channels) {
+                fprintf(stderr,"channel %i not found (stream has %i channels)\n", out->channel_list[ch], vgmstream->channels);
+                return 0;
             }
         }
+        out->channels = out->channel_count ? out->channel_count : vgmstream->channels;
     }
+
+    *outputs_count = count;
+    return 1;
 }
 
-/* ************************************************************ */
+static int output_open(cli_output *out, const char *filename) {
+    out->file = filename ? fopen(filename,"wb") : stdout;
+    if (!out->file) {
+        fprintf(stderr,"failed to open %s for output\n",filename);
+        return 0;
+    }
+    fflush(out->file); /* written by fd from now on */
+    out->fd = fileno(out->file);
 
-int main(int argc, char ** argv) {
-    VGMSTREAM * vgmstream = NULL;
-    FILE * outfile = NULL;
-    char outfilename_temp[PATH_LIMIT];
+    out->buf = malloc(OUTPUT_BUFFER_SIZE);
+    if (!out->buf) {
+        fprintf(stderr,"failed allocating output buffer\n");
+        return 0;
+    }
+    out->buf_used = 0;
+    out->failed = 0;
+    return 1;
+}
 
-    sample * buf = NULL;
-    int32_t len_samples;
-    int32_t fade_samples;
-    int i, j;
+/* writes the buffer then data (may be NULL) to the file, handling partial writes */
+static void output_commit(cli_output *out, const uint8_t *data, size_t data_size) {
+#ifndef WIN32
+    struct iovec iov[2];
+    int iov_count = 0, iov_done = 0;
 
-    cli_config cfg = {0};
-    int res;
+    if (out->buf_used) {
+        iov[iov_count].iov_base = out->buf;
+        iov[iov_count].iov_len = out->buf_used;
+        iov_count++;
+    }
+    if (data_size) {
+        iov[iov_count].iov_base = (void *)data;
+        iov[iov_count].iov_len = data_size;
+        iov_count++;
+    }
 
+    /* both in one call, rather than copying data to the buffer first */
+    while (iov_done < iov_count && !out->failed) {
+        ssize_t bytes = writev(out->fd, iov + iov_done, iov_count - iov_done);
+        if (bytes < 0) {
+            if (errno != EINTR)
+                out->failed = 1;
+            continue;
+        }
 
-    /* read args */
-    res = parse_config(&cfg, argc, argv);
-    if (!res) goto fail;
+        while (iov_done < iov_count && (size_t)bytes >= iov[iov_done].iov_len) {
+            bytes -= iov[iov_done].iov_len;
+            iov_done++;
+        }
+        if (iov_done < iov_count) {
+            iov[iov_done].iov_base = (uint8_t *)iov[iov_done].iov_base + bytes;
+            iov[iov_done].iov_len -= bytes;
+        }
+    }
+#else
+    const uint8_t *parts[2];
+    size_t sizes[2];
+    int i;
 
-#ifdef WIN32
-    /* make stdout output work with windows */
-    if (cfg.play_sdtout) {
-        _setmode(fileno(stdout),_O_BINARY);
+    parts[0] = out->buf;
+    sizes[0] = out->buf_used;
+    parts[1] = data;
+    sizes[1] = data_size;
+
+    for (i = 0; i < 2 && !out->failed; i++) {
+        while (sizes[i] > 0) {
+            int bytes = _write(out->fd, parts[i], sizes[i] > 0x40000000 ? 0x40000000 : (unsigned int)sizes[i]);
+            if (bytes <= 0) {
+                out->failed = 1;
+                break;
+            }
+            parts[i] += bytes;
+            sizes[i] -= bytes;
+        }
     }
 #endif
 
-    res = validate_config(&cfg);
-    if (!res) goto fail;
+    out->buf_used = 0;
+}
+
+static void output_write(cli_output *out, const void *data, size_t data_size) {
+    if (out->buf_used + data_size > OUTPUT_BUFFER_SIZE) {
+        output_commit(out, data, data_size);
+        return;
+    }
+
+    memcpy(out->buf + out->buf_used, data, data_size);
+    out->buf_used += data_size;
+}
+
+/* writes LE samples of all stream channels, extracting this output's channels into the buffer if needed */
+static void output_samples(cli_output *out, const void *buf, int channels, int samples, int is_float) {
+    size_t sample_size = is_float ? sizeof(float) : sizeof(sample);
+    size_t frame_size = out->channels * sample_size;
+
+    if (!out->channel_count) {
+        output_write(out, buf, samples * frame_size);
+        return;
+    }
+
+    while (samples > 0) {
+        int frames = (int)((OUTPUT_BUFFER_SIZE - out->buf_used) / frame_size);
+        void *dst = out->buf + out->buf_used;
+
+        if (frames == 0) {
+            output_commit(out, NULL, 0);
+            continue;
+        }
+        if (frames > samples)
+            frames = samples;
+
+        if (is_float) {
+            select_channels_f32(dst, buf, channels, out->channel_list, out->channel_count, frames);
+            buf = (const float *)buf + frames * channels;
+        }
+        else {
+            select_channels(dst, buf, channels, out->channel_list, out->channel_count, frames);
+            buf = (const sample *)buf + frames * channels;
+        }
+
+        out->buf_used += frames * frame_size;
+        samples -= frames;
+    }
+}
+
+/* slap on a .wav header */
+static void output_header(cli_output *out, cli_config *cfg, VGMSTREAM *vgmstream, int32_t len_samples) {
+    uint8_t wav_buf[0x100];
+    size_t bytes_done;
+
+    bytes_done = make_wav_header(wav_buf,0x100,
+            len_samples, vgmstream_get_output_rate(vgmstream), out->channels, cfg->write_float,
+            cfg->write_lwav, cfg->lwav_loop_start, cfg->lwav_loop_end);
+
+    output_write(out, wav_buf, bytes_done);
+}
+
+/* flushes and closes the file (stdout is kept open), returns 0 if some write failed */
+static int output_close(cli_output *out) {
+    int ok = 1;
+
+    if (!out->file)
+        return 1;
+
+    if (out->buf) {
+        output_commit(out, NULL, 0);
+    }
+    if (out->failed) {
+        fprintf(stderr,"failed writing %s\n", out->filename ? out->filename : "stdout");
+        ok = 0;
+    }
+
+    if (out->file != stdout) {
+        fclose(out->file);
+    }
+    free(out->buf);
+    out->file = NULL;
+    out->buf = NULL;
+    return ok;
+}
+
+/* renders to_get samples into buf (float or 16-bit, per config) and writes them to all outputs */
+static void render_and_write(cli_config *cfg, VGMSTREAM *vgmstream, cli_output *outputs, int outputs_count, void *buf, int to_get) {
+    int i;
+
+    /* write PC endian */
+    if (cfg->write_float) {
+        render_vgmstream_f32(buf,to_get,vgmstream);
+        swap_samples_le_f32(buf,vgmstream->channels*to_get);
+    }
+    else {
+        render_vgmstream(buf,to_get,vgmstream);
+        swap_samples_le(buf,vgmstream->channels*to_get);
+    }
+
+    for (i = 0; i < outputs_count; i++) {
+        output_samples(&outputs[i], buf, vgmstream->channels, to_get, cfg->write_float);
+
+        /* don't hold piped audio */
+        if (outputs[i].file == stdout)
+            output_commit(&outputs[i], NULL, 0);
+    }
+}
+
+/* ************************************************************ */
+
+/* minimal threads for parallel jobs */
+#ifdef WIN32
+typedef CRITICAL_SECTION cli_mutex;
+typedef HANDLE cli_thread;
+#define CLI_THREAD_FUNC unsigned __stdcall
+#define CLI_THREAD_RETURN 0
+
+static void cli_mutex_init(cli_mutex *mutex) { InitializeCriticalSection(mutex); }
+static void cli_mutex_free(cli_mutex *mutex) { DeleteCriticalSection(mutex); }
+static void cli_lock(cli_mutex *mutex) { EnterCriticalSection(mutex); }
+static void cli_unlock(cli_mutex *mutex) { LeaveCriticalSection(mutex); }
+static int cli_thread_start(cli_thread *thread, unsigned (__stdcall *func)(void*), void *arg) {
+    *thread = (HANDLE)_beginthreadex(NULL, 0, func, arg, 0, NULL);
+    return *thread != 0;
+}
+static void cli_thread_join(cli_thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+typedef pthread_mutex_t cli_mutex;
+typedef pthread_t cli_thread;
+#define CLI_THREAD_FUNC void*
+#define CLI_THREAD_RETURN NULL
+
+static void cli_mutex_init(cli_mutex *mutex) { pthread_mutex_init(mutex, NULL); }
+static void cli_mutex_free(cli_mutex *mutex) { pthread_mutex_destroy(mutex); }
+static void cli_lock(cli_mutex *mutex) { pthread_mutex_lock(mutex); }
+static void cli_unlock(cli_mutex *mutex) { pthread_mutex_unlock(mutex); }
+static int cli_thread_start(cli_thread *thread, void* (*func)(void*), void *arg) {
+    return pthread_create(thread, NULL, func, arg) == 0;
+}
+static void cli_thread_join(cli_thread thread) {
+    pthread_join(thread, NULL);
+}
+#endif
+
+/* so info from parallel jobs isn't mixed */
+static cli_mutex print_mutex;
+
+
+/* decodes cfg->infilename (subsong cfg->stream_index) to cfg->outfilename, returns 0 on error */
+static int convert_file(cli_config *cfg) {
+    VGMSTREAM * vgmstream = NULL;
+    cli_output outputs[MAX_OUTPUTS + 1];
+    int outputs_count = 0;
+    char outfilename_temp[PATH_LIMIT];
+
+    void * buf = NULL; /* sample or float, per config */
+    int32_t len_samples;
+    int i, res;
 
 
     /* open streamfile and pass subsong */
     {
         //s = init_vgmstream(infilename);
-        STREAMFILE *streamFile = open_stdio_streamfile(cfg.infilename);
+        STREAMFILE *streamFile = cfg->use_mmap ?
+                open_mmap_streamfile(cfg->infilename) :
+                open_stdio_streamfile(cfg->infilename);
         if (!streamFile) {
-            fprintf(stderr,"file %s not found\n",cfg.infilename);
+            fprintf(stderr,"file %s not found\n",cfg->infilename);
             goto fail;
         }
 
-        streamFile->stream_index = cfg.stream_index;
-        vgmstream = init_vgmstream_from_STREAMFILE(streamFile);
+        if (cfg->bank) {
+            vgmstream = init_vgmstream_bank_subsong(cfg->bank, streamFile, cfg->stream_index);
+        }
+        else {
+            streamFile->stream_index = cfg->stream_index;
+            vgmstream = init_vgmstream_from_STREAMFILE(streamFile);
+        }
         close_streamfile(streamFile);
 
         if (!vgmstream) {
-            fprintf(stderr,"failed opening %s\n",cfg.infilename);
+            fprintf(stderr,"failed opening %s\n",cfg->infilename);
             goto fail;
         }
     }
 
 
     /* modify the VGMSTREAM if needed */
-    apply_config(vgmstream, &cfg);
+    apply_config(vgmstream, cfg);
 
-    if (cfg.play_forever && (!vgmstream->loop_flag || vgmstream->loop_target > 0)) {
+    if (cfg->play_forever && (!vgmstream->loop_flag || vgmstream->loop_target > 0)) {
         fprintf(stderr,"I could play a nonlooped track forever, but it wouldn't end well.");
         goto fail;
     }
 
-
-    /* prepare output */
-    if (cfg.play_sdtout) {
-        outfile = stdout;
+    /* start from a saved index if it matches, so decoding only adds new points (kept through resets) */
+    if (cfg->seek_index_filename) {
+        STREAMFILE *indexFile = open_stdio_streamfile(cfg->seek_index_filename);
+        if (!indexFile || !vgmstream_load_seek_index(vgmstream, indexFile)) {
+            vgmstream_enable_seek_index(vgmstream, 0);
+        }
+        close_streamfile(indexFile);
     }
-    else if (!cfg.print_metaonly) {
-        if (!cfg.outfilename) {
+
+
+    /* prepare outputs */
+    if (!setup_outputs(cfg, vgmstream, outputs, &outputs_count))
+        goto fail;
+
+    if (!cfg->print_metaonly) {
+        if (!cfg->play_sdtout && !cfg->outfilename) {
             /* note that outfilename_temp must persist outside this block, hence the external array */
-            strcpy(outfilename_temp, cfg.infilename);
+            strcpy(outfilename_temp, cfg->infilename);
             strcat(outfilename_temp, ".wav");
-            cfg.outfilename = outfilename_temp;
+            cfg->outfilename = outfilename_temp;
         }
+        outputs[0].filename = cfg->play_sdtout ? NULL : cfg->outfilename;
 
-        outfile = fopen(cfg.outfilename,"wb");
-        if (!outfile) {
-            fprintf(stderr,"failed to open %s for output\n",cfg.outfilename);
-            goto fail;
+        for (i = 0; i < outputs_count; i++) {
+            if (!output_open(&outputs[i], outputs[i].filename))
+                goto fail;
         }
     }
 
 
     /* print file info (or batch commands, depending on config) */
-    print_info(vgmstream, &cfg);
+    cli_lock(&print_mutex);
+    print_info(vgmstream, cfg);
 
     /* print tags info */
-    if (cfg.tag_filename) {
+    if (cfg->tag_filename) {
         VGMSTREAM_TAGS tag;
 
-        STREAMFILE *tagFile = open_stdio_streamfile(cfg.tag_filename);
+        STREAMFILE *tagFile = open_stdio_streamfile(cfg->tag_filename);
         if (!tagFile) {
-            fprintf(stderr,"tag file %s not found\n",cfg.tag_filename);
+            fprintf(stderr,"tag file %s not found\n",cfg->tag_filename);
+            cli_unlock(&print_mutex);
             goto fail;
         }
 
         printf("tags:\n");
-        vgmstream_tags_reset(&tag, cfg.infilename);
+        vgmstream_tags_reset(&tag, cfg->infilename);
         while ( vgmstream_tags_next_tag(&tag, tagFile)) {
             printf("- '%s'='%s'\n", tag.key, tag.val);
         }
 
         close_streamfile(tagFile);
     }
+    cli_unlock(&print_mutex);
 
     /* prints done */
-    if (cfg.print_metaonly) {
-        if (!cfg.play_sdtout)
-            fclose(outfile);
+    if (cfg->print_metaonly) {
         close_vgmstream(vgmstream);
-        return EXIT_SUCCESS;
+        return 1;
     }
 
 
     /* get final play config */
-    len_samples = get_vgmstream_play_samples(cfg.loop_count,cfg.fade_time,cfg.fade_delay,vgmstream);
-    fade_samples = (int32_t)(cfg.fade_time < 0 ? 0 : cfg.fade_time * vgmstream->sample_rate);
+    len_samples = get_vgmstream_play_samples(cfg->loop_count,cfg->fade_time,cfg->fade_delay,vgmstream);
 
-    if (!cfg.play_sdtout && !cfg.print_adxencd && !cfg.print_oggenc && !cfg.print_batchvar) {
-        printf("samples to play: %d (%.4lf seconds)\n", len_samples, (double)len_samples / vgmstream->sample_rate);
+    if (!cfg->play_sdtout && !cfg->print_adxencd && !cfg->print_oggenc && !cfg->print_batchvar) {
+        cli_lock(&print_mutex);
+        printf("samples to play: %d (%.4lf seconds)\n", len_samples, (double)len_samples / vgmstream_get_output_rate(vgmstream));
+        cli_unlock(&print_mutex);
     }
 
 
     /* last init */
-    buf = malloc(BUFFER_SAMPLES*sizeof(sample)*vgmstream->channels);
+    buf = malloc(BUFFER_SAMPLES*(cfg->write_float ? sizeof(float) : sizeof(sample))*vgmstream->channels);
     if (!buf) {
         fprintf(stderr,"failed allocating output buffer\n");
         goto fail;;
     }
 
-    /* slap on a .wav header */
-    {
-        uint8_t wav_buf[0x100];
-        int channels = (cfg.only_stereo != -1) ? 2 : vgmstream->channels;
-        size_t bytes_done;
-
-        bytes_done = make_wav_header(wav_buf,0x100,
-                len_samples, vgmstream->sample_rate, channels,
-                cfg.write_lwav, cfg.lwav_loop_start, cfg.lwav_loop_end);
-
-        fwrite(wav_buf,sizeof(uint8_t),bytes_done,outfile);
+    for (i = 0; i < outputs_count; i++) {
+        output_header(&outputs[i], cfg, vgmstream, len_samples);
     }
 
 
     /* decode forever */
-    while (cfg.play_forever) {
+    while (cfg->play_forever) {
         int to_get = BUFFER_SAMPLES;
 
-        render_vgmstream(buf,to_get,vgmstream);
-
-        swap_samples_le(buf,vgmstream->channels*to_get); /* write PC endian */
-        if (cfg.only_stereo != -1) {
-            for (j = 0; j < to_get; j++) {
-                fwrite(buf+j*vgmstream->channels+(cfg.only_stereo*2),sizeof(sample),2,outfile);
-            }
-        } else {
-            fwrite(buf,sizeof(sample)*vgmstream->channels,to_get,outfile);
-        }
+        render_and_write(cfg, vgmstream, outputs, outputs_count, buf, to_get);
     }
 
 
-    /* decode */
+    /* decode (all outputs at once) */
     for (i = 0; i < len_samples; i += BUFFER_SAMPLES) {
         int to_get = BUFFER_SAMPLES;
         if (i + BUFFER_SAMPLES > len_samples)
             to_get = len_samples - i;
 
-        render_vgmstream(buf,to_get,vgmstream);
+        render_and_write(cfg, vgmstream, outputs, outputs_count, buf, to_get);
+    }
 
-        apply_fade(buf, vgmstream, to_get, i, len_samples, fade_samples);
+    if (cfg->seek_index_filename && !vgmstream_save_seek_index(vgmstream, cfg->seek_index_filename)) {
+        fprintf(stderr,"seek index not saved to %s (not supported by this codec/layout)\n", cfg->seek_index_filename);
+    }
 
-        swap_samples_le(buf,vgmstream->channels*to_get); /* write PC endian */
-        if (cfg.only_stereo != -1) {
-            for (j = 0; j < to_get; j++) {
-                fwrite(buf+j*vgmstream->channels+(cfg.only_stereo*2),sizeof(sample),2,outfile);
-            }
-        } else {
-            fwrite(buf,sizeof(sample)*vgmstream->channels,to_get,outfile);
-        }
+    res = 1;
+    for (i = 0; i < outputs_count; i++) {
+        if (!output_close(&outputs[i]))
+            res = 0;
     }
+    if (!res)
+        goto fail;
 
-    fclose(outfile);
-    outfile = NULL;
+    if (cfg->loop_cache && !cfg->play_sdtout && !cfg->print_adxencd && !cfg->print_oggenc && !cfg->print_batchvar) {
+        VGMSTREAM_LOOP_CACHE_STATS stats;
+        double sample_rate = vgmstream->sample_rate;
+
+        vgmstream_get_loop_cache_stats(vgmstream, &stats);
+        cli_lock(&print_mutex);
+        if (stats.active)
+            printf("loop cache: %.4lf seconds from memory, %.4lf decoded (%u bytes)\n",
+                    stats.samples_served / sample_rate, stats.samples_decoded / sample_rate, (unsigned int)stats.size);
+        else
+            printf("loop cache: not used (no loop, or too big)\n");
+        cli_unlock(&print_mutex);
+    }
 
 
-    /* try again with (for testing reset_vgmstream, simulates a seek to 0) */
-    if (cfg.test_reset) {
+    /* try again with (for testing reset_vgmstream, simulates a seek to 0), main output only */
+    if (cfg->test_reset) {
         char outfilename_temp[PATH_LIMIT];
-        strcpy(outfilename_temp, cfg.outfilename);
+        strcpy(outfilename_temp, cfg->outfilename);
         strcat(outfilename_temp, ".reset.wav");
 
-        outfile = fopen(outfilename_temp,"wb");
-        if (!outfile) {
-            fprintf(stderr,"failed to open %s for output\n",outfilename_temp);
+        outputs[0].filename = outfilename_temp;
+        if (!output_open(&outputs[0], outputs[0].filename))
             goto fail;
-        }
 
         reset_vgmstream(vgmstream);
 
         /* vgmstream manipulations are undone by reset */
-        apply_config(vgmstream, &cfg);
-
+        apply_config(vgmstream, cfg);
 
-        /* slap on a .wav header */
-        {
-            uint8_t wav_buf[0x100];
-            int channels = (cfg.only_stereo != -1) ? 2 : vgmstream->channels;
-            size_t bytes_done;
-
-            bytes_done = make_wav_header(wav_buf,0x100,
-                    len_samples, vgmstream->sample_rate, channels,
-                    cfg.write_lwav, cfg.lwav_loop_start, cfg.lwav_loop_end);
-
-            fwrite(wav_buf,sizeof(uint8_t),bytes_done,outfile);
-        }
+        output_header(&outputs[0], cfg, vgmstream, len_samples);
 
         /* decode */
         for (i = 0; i < len_samples; i += BUFFER_SAMPLES) {
@@ -548,37 +993,224 @@ int main(int argc, char ** argv) {
             if (i + BUFFER_SAMPLES > len_samples)
                 to_get = len_samples - i;
 
-            render_vgmstream(buf,to_get,vgmstream);
-
-            apply_fade(buf, vgmstream, to_get, i, len_samples, fade_samples);
-
-            swap_samples_le(buf,vgmstream->channels*to_get); /* write PC endian */
-            if (cfg.only_stereo != -1) {
-                for (j = 0; j < to_get; j++) {
-                    fwrite(buf+j*vgmstream->channels+(cfg.only_stereo*2),sizeof(sample),2,outfile);
-                }
-            } else {
-                fwrite(buf,sizeof(sample)*vgmstream->channels,to_get,outfile);
-            }
+            render_and_write(cfg, vgmstream, outputs, 1, buf, to_get);
         }
-        fclose(outfile);
-        outfile = NULL;
+
+        if (!output_close(&outputs[0]))
+            goto fail;
     }
 
     close_vgmstream(vgmstream);
     free(buf);
 
-    return EXIT_SUCCESS;
+    return 1;
 
 fail:
-    if (!cfg.play_sdtout)
-    {
-        if (outfile != NULL)
-        {
-            fclose(outfile);
-        }
+    for (i = 0; i < outputs_count; i++) {
+        output_close(&outputs[i]);
     }
     close_vgmstream(vgmstream);
+    free(buf);
+    return 0;
+}
+
+
+typedef struct {
+    char * infilename;
+    char outfilename[PATH_LIMIT]; /* empty = default */
+    int stream_index;
+    VGMSTREAM_BANK * bank; /* shared by all subsongs of a file */
+} cli_job;
+
+typedef struct {
+    cli_config * cfg;
+    cli_job * jobs;
+    int jobs_count;
+    VGMSTREAM_BANK ** banks;
+    int banks_count;
+    int next_job;
+    int errors;
+    cli_mutex mutex;
+} cli_pool;
+
+static CLI_THREAD_FUNC cli_worker(void *arg) {
+    cli_pool *pool = arg;
+
+    while (1) {
+        cli_config job_cfg;
+        cli_job *job;
+        int res;
+
+        cli_lock(&pool->mutex);
+        job = pool->next_job < pool->jobs_count ? &pool->jobs[pool->next_job++] : NULL;
+        cli_unlock(&pool->mutex);
+        if (!job) break;
+
+        /* each job gets its own config, as it's modified per file */
+        job_cfg = *pool->cfg;
+        job_cfg.infilename = job->infilename;
+        job_cfg.outfilename = job->outfilename[0] ? job->outfilename : NULL;
+        job_cfg.stream_index = job->stream_index;
+        job_cfg.bank = job->bank;
+
+        res = convert_file(&job_cfg);
+        if (!res) {
+            cli_lock(&pool->mutex);
+            pool->errors++;
+            cli_unlock(&pool->mutex);
+        }
+    }
+
+    return CLI_THREAD_RETURN;
+}
+
+/* makes one job per file, or per subsong with -S (detecting each file once) */
+static int make_jobs(cli_config *cfg, cli_pool *pool) {
+    cli_job *jobs = NULL;
+    int jobs_count = 0, jobs_max = 0;
+    int f, subsong;
+
+    if (cfg->all_subsongs) {
+        pool->banks = calloc(cfg->infilenames_count, sizeof(VGMSTREAM_BANK*));
+        if (!pool->banks) goto fail;
+        pool->banks_count = cfg->infilenames_count;
+    }
+
+    for (f = 0; f < cfg->infilenames_count; f++) {
+        char *infilename = cfg->infilenames[f];
+        VGMSTREAM_BANK *bank = NULL;
+        int subsongs = 1;
+
+        if (cfg->all_subsongs) {
+            STREAMFILE *streamFile = open_stdio_streamfile(infilename);
+
+            if (streamFile) {
+                bank = init_vgmstream_bank(streamFile);
+                close_streamfile(streamFile);
+            }
+            if (!bank) {
+                fprintf(stderr,"failed opening %s\n",infilename);
+                continue;
+            }
+            pool->banks[f] = bank;
+            subsongs = bank->subsongs;
+        }
+
+        for (subsong = 1; subsong <= subsongs; subsong++) {
+            cli_job *job;
+
+            if (jobs_count == jobs_max) {
+                cli_job *new_jobs;
+                jobs_max = jobs_max ? jobs_max * 2 : 64;
+                new_jobs = realloc(jobs, jobs_max * sizeof(cli_job));
+                if (!new_jobs) goto fail;
+                jobs = new_jobs;
+            }
+
+            job = &jobs[jobs_count];
+            job->infilename = infilename;
+            job->stream_index = cfg->stream_index;
+            job->outfilename[0] = '\0';
+            job->bank = bank;
+            if (subsongs > 1) {
+                job->stream_index = subsong;
+                snprintf(job->outfilename, PATH_LIMIT, "%s#%i.wav", infilename, subsong);
+            }
+            jobs_count++;
+        }
+    }
+
+    pool->jobs = jobs;
+    pool->jobs_count = jobs_count;
+    return 1;
+fail:
+    free(jobs);
+    return 0;
+}
+
+static void free_jobs(cli_pool *pool) {
+    int i;
+
+    for (i = 0; i < pool->banks_count; i++) {
+        close_vgmstream_bank(pool->banks[i]);
+    }
+    free(pool->banks);
+    free(pool->jobs);
+}
+
+/* decodes all files/subsongs with N workers, returns number of errors */
+static int convert_files(cli_config *cfg) {
+    cli_pool pool = {0};
+    cli_thread threads[MAX_JOBS];
+    int i, threads_count = 0;
+
+    if (!make_jobs(cfg, &pool)) {
+        fprintf(stderr,"failed making jobs\n");
+        free_jobs(&pool);
+        return 1;
+    }
+    if (pool.jobs_count == 0) {
+        free_jobs(&pool);
+        return 1;
+    }
+
+    pool.cfg = cfg;
+    cli_mutex_init(&pool.mutex);
+
+    for (i = 0; i < cfg->jobs - 1 && i < pool.jobs_count - 1; i++) {
+        if (!cli_thread_start(&threads[threads_count], cli_worker, &pool))
+            break;
+        threads_count++;
+    }
+
+    cli_worker(&pool); /* main thread works too */
+
+    for (i = 0; i < threads_count; i++) {
+        cli_thread_join(threads[i]);
+    }
+
+    cli_mutex_free(&pool.mutex);
+    free_jobs(&pool);
+
+    return pool.errors;
+}
+
+int main(int argc, char ** argv) {
+    cli_config cfg = {0};
+    int res;
+
+
+    /* read args */
+    res = parse_config(&cfg, argc, argv);
+    if (!res) goto fail;
+
+#ifdef WIN32
+    /* make stdout output work with windows */
+    if (cfg.play_sdtout) {
+        _setmode(fileno(stdout),_O_BINARY);
+    }
+#endif
+
+    res = validate_config(&cfg);
+    if (!res) goto fail;
+
+    cli_mutex_init(&print_mutex);
+
+    if (cfg.key_threads > 1 || cfg.key_cache_filename) {
+        vgmstream_set_key_search(cfg.key_threads, cfg.key_cache_filename);
+    }
+
+    if (cfg.infilenames_count == 1 && !cfg.all_subsongs) {
+        res = convert_file(&cfg);
+    }
+    else {
+        res = (convert_files(&cfg) == 0);
+    }
+
+    cli_mutex_free(&print_mutex);
+
+    return res ? EXIT_SUCCESS : EXIT_FAILURE;
+fail:
     return EXIT_FAILURE;
 }
 
@@ -605,10 +1237,11 @@ static void make_smpl_chunk(uint8_t * buf, int32_t loop_start, int32_t loop_end)
 }
 
 /* make a RIFF header for .wav */
-static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_count, int32_t sample_rate, int channels, int smpl_chunk, int32_t loop_start, int32_t loop_end) {
+static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_count, int32_t sample_rate, int channels, int is_float, int smpl_chunk, int32_t loop_start, int32_t loop_end) {
     size_t data_size, header_size;
+    size_t sample_size = is_float ? sizeof(float) : sizeof(sample);
 
-    data_size = sample_count*channels*sizeof(sample);
+    data_size = sample_count*channels*sample_size;
     header_size = 0x2c;
     if (smpl_chunk && loop_end)
         header_size += 0x3c+ 0x08;
@@ -623,12 +1256,12 @@ static size_t make_wav_header(uint8_t * buf, size_t buf_size, int32_t sample_cou
 
     memcpy(buf+0x0c, "fmt ", 4); /* WAVE fmt chunk */
     put_32bitLE(buf+0x10, 0x10); /* size of WAVE fmt chunk */
-    put_16bitLE(buf+0x14, 1); /* compression code 1=PCM */
+    put_16bitLE(buf+0x14, is_float ? 3 : 1); /* compression code 1=PCM, 3=IEEE float */
     put_16bitLE(buf+0x16, channels); /* channel count */
     put_32bitLE(buf+0x18, sample_rate); /* sample rate */
-    put_32bitLE(buf+0x1c, sample_rate*channels*sizeof(sample)); /* bytes per second */
-    put_16bitLE(buf+0x20, (int16_t)(channels*sizeof(sample))); /* block align */
-    put_16bitLE(buf+0x22, sizeof(sample)*8); /* significant bits per sample */
+    put_32bitLE(buf+0x1c, sample_rate*channels*sample_size); /* bytes per second */
+    put_16bitLE(buf+0x20, (int16_t)(channels*sample_size)); /* block align */
+    put_16bitLE(buf+0x22, sample_size*8); /* significant bits per sample */
 
     if (smpl_chunk && loop_end) {
         make_smpl_chunk(buf+0x24, loop_start, loop_end);
@@ -26,6 +26,17 @@
 #include <stdlib.h>
 #include <memory.h>
 
+/* SIMD for the IMDCT and 16-bit conversion, chosen at compile time (same results as the scalar code) */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HCA_SSE2
+#define HCA_REVERSE_PS(v)  _mm_shuffle_ps(v, v, _MM_SHUFFLE(0,1,2,3))
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(VGM_USE_NEON) /* opt-in until tested on ARM hardware */
+#include <arm_neon.h>
+#define HCA_NEON
+#define HCA_REVERSE_PS(v)  vcombine_f32(vget_high_f32(vrev64q_f32(v)), vget_low_f32(vrev64q_f32(v)))
+#endif
+
 #define HCA_MASK  0x7F7F7F7F /* chunk obfuscation when the HCA is encrypted with key */
 #define HCA_SUBFRAMES_PER_FRAME  8
 #define HCA_SAMPLES_PER_SUBFRAME  128
@@ -282,6 +293,64 @@ int clHCA_getInfo(clHCA *hca, clHCA_stInfo *info) {
     return 0;
 }
 
+#if defined(HCA_SSE2) || defined(HCA_NEON)
+/* converts 8 samples of each channel at a time (subframes are a multiple of 8), then interleaves them */
+void clHCA_ReadSamples16(clHCA *hca, signed short *samples) {
+    unsigned int channels = hca->channels;
+    unsigned int i, k;
+
+    for (i = 0; i < HCA_SAMPLES_PER_FRAME; i += 8) {
+        for (k = 0; k < channels; k++) {
+            const float *wave = &hca->channel[k].wave[i / HCA_SAMPLES_PER_SUBFRAME][i % HCA_SAMPLES_PER_SUBFRAME];
+#if defined(HCA_SSE2)
+            /* clamp (NaN passes through min/max as the second operand), then truncate and saturate 1.0 */
+            const __m128 one = _mm_set1_ps(1.0f), neg_one = _mm_set1_ps(-1.0f), scale = _mm_set1_ps(32768.0f);
+            __m128i s0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_max_ps(neg_one, _mm_min_ps(one, _mm_loadu_ps(wave + 0))), scale));
+            __m128i s1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_max_ps(neg_one, _mm_min_ps(one, _mm_loadu_ps(wave + 4))), scale));
+            __m128i v = _mm_packs_epi32(s0, s1);
+            signed short temp[8];
+            unsigned int j;
+
+            if (channels == 1) {
+                _mm_storeu_si128((__m128i*)(samples + i), v);
+                continue;
+            }
+            if (channels == 2) {
+                __m128i v1;
+                const float *wave1 = &hca->channel[1].wave[i / HCA_SAMPLES_PER_SUBFRAME][i % HCA_SAMPLES_PER_SUBFRAME];
+                s0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_max_ps(neg_one, _mm_min_ps(one, _mm_loadu_ps(wave1 + 0))), scale));
+                s1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_max_ps(neg_one, _mm_min_ps(one, _mm_loadu_ps(wave1 + 4))), scale));
+                v1 = _mm_packs_epi32(s0, s1);
+                _mm_storeu_si128((__m128i*)(samples + i*2 + 0), _mm_unpacklo_epi16(v, v1));
+                _mm_storeu_si128((__m128i*)(samples + i*2 + 8), _mm_unpackhi_epi16(v, v1));
+                break;
+            }
+            _mm_storeu_si128((__m128i*)temp, v);
+#else
+            /* NaN converts to 0 here, so it's made -1.0 first (as the scalar code on x86) */
+            const float32x4_t one = vdupq_n_f32(1.0f), neg_one = vdupq_n_f32(-1.0f);
+            float32x4_t f0 = vld1q_f32(wave + 0), f1 = vld1q_f32(wave + 4);
+            int16x8_t v;
+            signed short temp[8];
+            unsigned int j;
+
+            f0 = vmaxq_f32(vminq_f32(vbslq_f32(vceqq_f32(f0, f0), f0, neg_one), one), neg_one);
+            f1 = vmaxq_f32(vminq_f32(vbslq_f32(vceqq_f32(f1, f1), f1, neg_one), one), neg_one);
+            v = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(vmulq_n_f32(f0, 32768.0f))), vqmovn_s32(vcvtq_s32_f32(vmulq_n_f32(f1, 32768.0f))));
+
+            if (channels == 1) {
+                vst1q_s16(samples + i, v);
+                continue;
+            }
+            vst1q_s16(temp, v);
+#endif
+            for (j = 0; j < 8; j++) {
+                samples[(i + j)*channels + k] = temp[j];
+            }
+        }
+    }
+}
+#else
 void clHCA_ReadSamples16(clHCA *hca, signed short *samples) {
     const float scale = 32768.0f;
     float f;
@@ -306,6 +375,19 @@ void clHCA_ReadSamples16(clHCA *hca, signed short *samples) {
         }
     }
 }
+#endif
+
+void clHCA_ReadSamplesF32(clHCA *hca, float *samples) {
+    unsigned int i, j, k;
+
+    for (i = 0; i < HCA_SUBFRAMES_PER_FRAME; i++) {
+        for (j = 0; j < HCA_SAMPLES_PER_SUBFRAME; j++) {
+            for (k = 0; k < hca->channels; k++) {
+                *samples++ = hca->channel[k].wave[i][j];
+            }
+        }
+    }
+}
 
 
 //--------------------------------------------------
@@ -1575,7 +1657,30 @@ static void decoder5_run_imdct(stChannel *ch, int subframe) {
             float *d2 = &temp2a[count2a];
 
             for (j = 0; j < count1a; j++) {
-                for (k = 0; k < count2a; k++) {
+                k = 0;
+#if defined(HCA_SSE2)
+                for (; k + 4 <= count2a; k += 4) {
+                    __m128 x0 = _mm_loadu_ps(temp1a + 0);
+                    __m128 x1 = _mm_loadu_ps(temp1a + 4);
+                    __m128 a = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2,0,2,0));
+                    __m128 b = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3,1,3,1));
+                    _mm_storeu_ps(d1, _mm_add_ps(b, a));
+                    _mm_storeu_ps(d2, _mm_sub_ps(a, b));
+                    temp1a += 8;
+                    d1 += 4;
+                    d2 += 4;
+                }
+#elif defined(HCA_NEON)
+                for (; k + 4 <= count2a; k += 4) {
+                    float32x4x2_t x = vld2q_f32(temp1a);
+                    vst1q_f32(d1, vaddq_f32(x.val[1], x.val[0]));
+                    vst1q_f32(d2, vsubq_f32(x.val[0], x.val[1]));
+                    temp1a += 8;
+                    d1 += 4;
+                    d2 += 4;
+                }
+#endif
+                for (; k < count2a; k++) {
                     float a = *(temp1a++);
                     float b = *(temp1a++);
                     *(d1++) = b + a;
@@ -1606,7 +1711,41 @@ static void decoder5_run_imdct(stChannel *ch, int subframe) {
             const float *s2 = &temp1b[count2b];
 
             for (j = 0; j < count1b; j++) {
-                for (k = 0; k < count2b; k++) {
+                k = 0;
+#if defined(HCA_SSE2)
+                for (; k + 4 <= count2b; k += 4) {
+                    __m128 a = _mm_loadu_ps(s1);
+                    __m128 b = _mm_loadu_ps(s2);
+                    __m128 sin = _mm_loadu_ps(sin_table);
+                    __m128 cos = _mm_loadu_ps(cos_table);
+                    __m128 r2 = _mm_add_ps(_mm_mul_ps(a, cos), _mm_mul_ps(b, sin));
+                    _mm_storeu_ps(d1, _mm_sub_ps(_mm_mul_ps(a, sin), _mm_mul_ps(b, cos)));
+                    _mm_storeu_ps(d2 - 3, HCA_REVERSE_PS(r2));
+                    s1 += 4;
+                    s2 += 4;
+                    sin_table += 4;
+                    cos_table += 4;
+                    d1 += 4;
+                    d2 -= 4;
+                }
+#elif defined(HCA_NEON)
+                for (; k + 4 <= count2b; k += 4) {
+                    float32x4_t a = vld1q_f32(s1);
+                    float32x4_t b = vld1q_f32(s2);
+                    float32x4_t sin = vld1q_f32(sin_table);
+                    float32x4_t cos = vld1q_f32(cos_table);
+                    float32x4_t r2 = vaddq_f32(vmulq_f32(a, cos), vmulq_f32(b, sin));
+                    vst1q_f32(d1, vsubq_f32(vmulq_f32(a, sin), vmulq_f32(b, cos)));
+                    vst1q_f32(d2 - 3, HCA_REVERSE_PS(r2));
+                    s1 += 4;
+                    s2 += 4;
+                    sin_table += 4;
+                    cos_table += 4;
+                    d1 += 4;
+                    d2 -= 4;
+                }
+#endif
+                for (; k < count2b; k++) {
                     float a = *(s1++);
                     float b = *(s2++);
                     float sin = *(sin_table++);
@@ -1636,14 +1775,43 @@ static void decoder5_run_imdct(stChannel *ch, int subframe) {
 
     /* update output/imdct */
     {
-        unsigned int i;
-
-        for (i = 0; i < half; i++) {
+        unsigned int i = 0;
+
+        /* (half is a multiple of 4, so vectors do all samples) */
+#if defined(HCA_SSE2)
+        for (; i + 4 <= half; i += 4) {
+            __m128 prev0 = _mm_loadu_ps(&ch->imdct_previous[i]);
+            __m128 prev1 = _mm_loadu_ps(&ch->imdct_previous[i + half]);
+            __m128 dct_r0 = HCA_REVERSE_PS(_mm_loadu_ps(&ch->dct[size - 4 - i]));
+            __m128 dct_r1 = HCA_REVERSE_PS(_mm_loadu_ps(&ch->dct[half - 4 - i]));
+            __m128 win_r0 = HCA_REVERSE_PS(_mm_loadu_ps(&decode5_imdct_window[size - 4 - i]));
+            __m128 win_r1 = HCA_REVERSE_PS(_mm_loadu_ps(&decode5_imdct_window[half - 4 - i]));
+            _mm_storeu_ps(&ch->wave[subframe][i], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&decode5_imdct_window[i]), _mm_loadu_ps(&ch->dct[i + half])), prev0));
+            _mm_storeu_ps(&ch->wave[subframe][i + half], _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(&decode5_imdct_window[i + half]), dct_r0), prev1));
+            _mm_storeu_ps(&ch->imdct_previous[i], _mm_mul_ps(win_r0, dct_r1));
+            _mm_storeu_ps(&ch->imdct_previous[i + half], _mm_mul_ps(win_r1, _mm_loadu_ps(&ch->dct[i])));
+        }
+#elif defined(HCA_NEON)
+        for (; i + 4 <= half; i += 4) {
+            float32x4_t prev0 = vld1q_f32(&ch->imdct_previous[i]);
+            float32x4_t prev1 = vld1q_f32(&ch->imdct_previous[i + half]);
+            float32x4_t dct_r0 = HCA_REVERSE_PS(vld1q_f32(&ch->dct[size - 4 - i]));
+            float32x4_t dct_r1 = HCA_REVERSE_PS(vld1q_f32(&ch->dct[half - 4 - i]));
+            float32x4_t win_r0 = HCA_REVERSE_PS(vld1q_f32(&decode5_imdct_window[size - 4 - i]));
+            float32x4_t win_r1 = HCA_REVERSE_PS(vld1q_f32(&decode5_imdct_window[half - 4 - i]));
+            vst1q_f32(&ch->wave[subframe][i], vaddq_f32(vmulq_f32(vld1q_f32(&decode5_imdct_window[i]), vld1q_f32(&ch->dct[i + half])), prev0));
+            vst1q_f32(&ch->wave[subframe][i + half], vsubq_f32(vmulq_f32(vld1q_f32(&decode5_imdct_window[i + half]), dct_r0), prev1));
+            vst1q_f32(&ch->imdct_previous[i], vmulq_f32(win_r0, dct_r1));
+            vst1q_f32(&ch->imdct_previous[i + half], vmulq_f32(win_r1, vld1q_f32(&ch->dct[i])));
+        }
+#else
+        for (; i < half; i++) {
             ch->wave[subframe][i] = decode5_imdct_window[i] * ch->dct[i + half] + ch->imdct_previous[i];
             ch->wave[subframe][i + half] = decode5_imdct_window[i + half] * ch->dct[size - 1 - i] - ch->imdct_previous[i + half];
             ch->imdct_previous[i] = decode5_imdct_window[size - 1 - i] * ch->dct[half - i - 1];
             ch->imdct_previous[i + half] = decode5_imdct_window[half - i - 1] * ch->dct[i];
         }
+#endif
 #if 0
         /* over-optimized IMDCT (for reference), barely noticeable even when decoding hundred of files */
         const float *imdct_window = decode5_imdct_window;
@@ -49,7 +49,6 @@ input_vgmstream::input_vgmstream() {
     decode_pos_ms = 0;
     decode_pos_samples = 0;
     stream_length_samples = 0;
-    fade_samples = 0;
     seek_pos_samples = 0;
 
     fade_seconds = 10.0f;
@@ -225,6 +224,12 @@ void input_vgmstream::decode_initialize(t_uint32 p_subsong, unsigned p_flags, ab
         setup_vgmstream(p_abort);
     }
 
+    // fade is applied while rendering (unless looping forever)
+    if (vgmstream) {
+        bool loop_okay = config.song_play_forever && vgmstream->loop_flag && !config.song_ignore_loop && !force_ignore_loop;
+        vgmstream_set_play_config(vgmstream, config.song_loop_count, loop_okay ? 0.0 : config.song_fade_time, config.song_fade_delay);
+    }
+
     decode_seek( 0, p_abort );
 };
 
@@ -251,23 +256,6 @@ bool input_vgmstream::decode_run(audio_chunk & p_chunk,abort_callback & p_abort)
 
         render_vgmstream(sample_buffer,samples_to_do,vgmstream);
 
-        /* fade! */
-        if (vgmstream->loop_flag && fade_samples > 0 && !loop_okay) {
-            int samples_into_fade = decode_pos_samples - (stream_length_samples - fade_samples);
-            if (samples_into_fade + samples_to_do > 0) {
-                int j,k;
-                for (j=0;j<samples_to_do;j++,samples_into_fade++) {
-                    if (samples_into_fade > 0) {
-                        double fadedness = (double)(fade_samples-samples_into_fade)/fade_samples;
-                        for (k=0;k<vgmstream->channels;k++) {
-                            sample_buffer[j*vgmstream->channels+k] =
-                                (short)(sample_buffer[j*vgmstream->channels+k]*fadedness);
-                        }
-                    }
-                }
-            }
-        }
-
         /* downmix enabled (foobar refuses to do more than 8 channels) */
         if (downmix_channels > 0 && downmix_channels < vgmstream->channels) {
             short temp_buffer[SAMPLE_BUFFER_SIZE];
@@ -310,48 +298,14 @@ bool input_vgmstream::decode_run(audio_chunk & p_chunk,abort_callback & p_abort)
 
 void input_vgmstream::decode_seek(double p_seconds,abort_callback & p_abort) {
     seek_pos_samples = (int) audio_math::time_to_samples(p_seconds, vgmstream->sample_rate);
-    int max_buffer_samples = sizeof(sample_buffer)/sizeof(sample_buffer[0])/vgmstream->channels;
     bool loop_okay = config.song_play_forever && vgmstream->loop_flag && !config.song_ignore_loop && !force_ignore_loop;
 
-    int corrected_pos_samples = seek_pos_samples;
-
-    // adjust for correct position within loop
-    if(vgmstream->loop_flag && (vgmstream->loop_end_sample - vgmstream->loop_start_sample) && seek_pos_samples >= vgmstream->loop_end_sample) {
-        corrected_pos_samples -= vgmstream->loop_start_sample;
-        corrected_pos_samples %= (vgmstream->loop_end_sample - vgmstream->loop_start_sample);
-        corrected_pos_samples += vgmstream->loop_start_sample;
-    }
-
-    // Allow for delta seeks forward, by up to the total length of the stream, if the delta is less than the corrected offset
-    if(decode_pos_samples > corrected_pos_samples && decode_pos_samples <= seek_pos_samples &&
-       (seek_pos_samples - decode_pos_samples) < stream_length_samples) {
-        if (corrected_pos_samples > (seek_pos_samples - decode_pos_samples))
-            corrected_pos_samples = seek_pos_samples;
-    }
-
-    // Reset of backwards seek
-    else if(corrected_pos_samples < decode_pos_samples) {
-        reset_vgmstream(vgmstream);
-        apply_config(vgmstream, &config); /* config is undone by reset */
-
-        decode_pos_samples = 0;
-    }
-
     // seeking overrun = bad
-    if(corrected_pos_samples > stream_length_samples) corrected_pos_samples = stream_length_samples;
+    if(seek_pos_samples > stream_length_samples && !loop_okay) seek_pos_samples = stream_length_samples;
 
-    while(decode_pos_samples<corrected_pos_samples) {
-        int seek_samples = max_buffer_samples;
-        if((decode_pos_samples+max_buffer_samples>=stream_length_samples) && !loop_okay)
-            seek_samples=stream_length_samples-seek_pos_samples;
-        if(decode_pos_samples+max_buffer_samples>seek_pos_samples)
-            seek_samples=seek_pos_samples-decode_pos_samples;
-
-        decode_pos_samples+=seek_samples;
-        render_vgmstream(sample_buffer,seek_samples,vgmstream);
-    }
+    // handles loops and resets as needed (config is kept)
+    seek_vgmstream(vgmstream, seek_pos_samples);
 
-    // remove seek loop correction from counter so file ends correctly
     decode_pos_samples=seek_pos_samples;
 
     decode_pos_ms=decode_pos_samples*1000LL/vgmstream->sample_rate;
@@ -431,7 +385,6 @@ void input_vgmstream::setup_vgmstream(abort_callback & p_abort) {
     decode_pos_samples = 0;
     paused = 0;
     stream_length_samples = get_vgmstream_play_samples(config.song_loop_count,config.song_fade_time,config.song_fade_delay,vgmstream);
-    fade_samples = (int)(config.song_fade_time * vgmstream->sample_rate);
 }
 
 void input_vgmstream::get_subsong_info(t_uint32 p_subsong, pfc::string_base & title, int *length_in_ms, int *total_samples, int *loop_start, int *loop_end, int *sample_rate, int *channels, int *bitrate, pfc::string_base & description, abort_callback & p_abort) {
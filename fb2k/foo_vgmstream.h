@@ -61,7 +61,6 @@ class input_vgmstream : public input_stubs {
         int decode_pos_ms;
         int decode_pos_samples;
         int stream_length_samples;
-        int fade_samples;
         int seek_pos_samples;
         short sample_buffer[SAMPLE_BUFFER_SIZE];
 
@@ -25,6 +25,7 @@
 #include <string.h>
 
 #include "acm_decoder_libacm.h" //"libacm.h"//vgmstream mod
+#include "../util.h" //vgmstream mod
 
 #define ACM_BUFLEN	(64*1024)
 
@@ -172,13 +173,12 @@ static const int map_3bit[] = { -4, -3, -2, -1, +1, +2, +3, +4 };
 static int mul_3x3[3*3*3];
 static int mul_3x5[5*5*5]; 
 static int mul_2x11[11*11];
-static int tables_generated;
+static vgm_once_t tables_once;
 
+/* call through vgm_once, as may be done from multiple threads */
 static void generate_tables(void)
 {
 	int x1, x2, x3;
-	if (tables_generated)
-		return;
 	for (x3 = 0; x3 < 3; x3++)
 		for (x2 = 0; x2 < 3; x2++)
 			for (x1 = 0; x1 < 3; x1++)
@@ -192,8 +192,6 @@ static void generate_tables(void)
 	for (x2 = 0; x2 < 11; x2++)
 		for (x1 = 0; x1 < 11; x1++)
 			mul_2x11[x1 + x2*11] = x1 + (x2 << 4);
-
-	tables_generated = 1;
 }
 
 /* IOW: (r * acm->subblock_len) + c */
@@ -827,7 +825,7 @@ int acm_open_decoder(ACMStream **res, void *arg, acm_io_callbacks io_cb, int for
 
 	memset(acm->wrapbuf, 0, acm->wrapbuf_len * sizeof(int));
 
-	generate_tables();
+	vgm_once(&tables_once, generate_tables);
 
 	*res = acm;
 	return ACM_OK;
@@ -1018,31 +1018,34 @@ size_t atrac3plus_bytes_to_samples(size_t bytes, int full_block_align) {
 /* ******************************************** */
 
 
+/* Bits are handled a whole word at a time: the (up to 5) bytes that hold the value are loaded into
+ * a 64-bit accumulator, then the value is shifted/masked out (or merged in and the bytes stored back).
+ * The struct stays stateless (b_off is the only position) so callers may still move b_off freely. */
+
 /* Read bits (max 32) from buf and update the bit offset. Vorbis packs values in LSB order and byte by byte.
  * (ex. from 2 bytes 00100111 00000001 we can could read 4b=0111 and 6b=010010, 6b=remainder (second value is split into the 2nd byte) */
 static int r_bits_vorbis(vgm_bitstream * ib, int num_bits, uint32_t * value) {
-    off_t off, pos;
-    int i, bit_buf, bit_val;
+    uint64_t acc = 0;
+    off_t off;
+    int i, pos, bytes;
     if (num_bits == 0) return 1;
     if (num_bits > 32 || num_bits < 0 || ib->b_off + num_bits > ib->bufsize*8) goto fail;
 
-    *value = 0; /* set all bits to 0 */
     off = ib->b_off / 8; /* byte offset */
     pos = ib->b_off % 8; /* bit sub-offset */
-    for (i = 0; i < num_bits; i++) {
-        bit_buf = (1U << pos) & 0xFF;   /* bit check for buf */
-        bit_val = (1U << i);            /* bit to set in value */
-
-        if (ib->buf[off] & bit_buf)     /* is bit in buf set? */
-            *value |= bit_val;          /* set bit */
+    if (pos + num_bits <= 8) { /* inside one byte (flags and such) */
+        *value = (ib->buf[off] >> pos) & (0xFFU >> (8 - num_bits));
+        ib->b_off += num_bits;
+        return 1;
+    }
 
-        pos++;                          /* new byte starts */
-        if (pos%8 == 0) {
-            pos = 0;
-            off++;
-        }
+    bytes = (pos + num_bits + 7) / 8;
+    for (i = 0; i < bytes; i++) {
+        acc |= (uint64_t)ib->buf[off + i] << (8*i);
     }
 
+    *value = (uint32_t)((acc >> pos) & (0xFFFFFFFFU >> (32 - num_bits)));
+
     ib->b_off += num_bits;
     return 1;
 fail:
@@ -1052,28 +1055,32 @@ fail:
 /* Write bits (max 32) to buf and update the bit offset. Vorbis packs values in LSB order and byte by byte.
  * (ex. writing 1101011010 from b_off 2 we get 01101011 00001101 (value split, and 11 in the first byte skipped)*/
 static int w_bits_vorbis(vgm_bitstream * ob, int num_bits, uint32_t value) {
-    off_t off, pos;
-    int i, bit_val, bit_buf;
+    uint64_t acc = 0, mask;
+    uint8_t byte_mask;
+    off_t off;
+    int i, pos, bytes;
     if (num_bits == 0) return 1;
     if (num_bits > 32 || num_bits < 0 || ob->b_off + num_bits > ob->bufsize*8) goto fail;
 
-
     off = ob->b_off / 8; /* byte offset */
     pos = ob->b_off % 8; /* bit sub-offset */
-    for (i = 0; i < num_bits; i++) {
-        bit_val = (1U << i);            /* bit check for value */
-        bit_buf = (1U << pos) & 0xFF;   /* bit to set in buf */
-
-        if (value & bit_val)            /* is bit in val set? */
-            ob->buf[off] |= bit_buf;    /* set bit */
-        else
-            ob->buf[off] &= ~bit_buf;   /* unset bit */
-
-        pos++;                          /* new byte starts */
-        if (pos%8 == 0) {
-            pos = 0;
-            off++;
-        }
+    if (pos + num_bits <= 8) { /* inside one byte */
+        byte_mask = (0xFFU >> (8 - num_bits)) << pos;
+        ob->buf[off] = (ob->buf[off] & ~byte_mask) | ((value << pos) & byte_mask);
+        ob->b_off += num_bits;
+        return 1;
+    }
+
+    bytes = (pos + num_bits + 7) / 8;
+    for (i = 0; i < bytes; i++) {
+        acc |= (uint64_t)ob->buf[off + i] << (8*i);
+    }
+
+    mask = (uint64_t)(0xFFFFFFFFU >> (32 - num_bits)) << pos;
+    acc = (acc & ~mask) | (((uint64_t)value << pos) & mask);
+
+    for (i = 0; i < bytes; i++) {
+        ob->buf[off + i] = (uint8_t)(acc >> (8*i));
     }
 
     ob->b_off += num_bits;
@@ -1085,28 +1092,27 @@ fail:
 
 /* Read bits (max 32) from buf and update the bit offset. Order is BE (MSF). */
 static int r_bits_msf(vgm_bitstream * ib, int num_bits, uint32_t * value) {
-    off_t off, pos;
-    int i, bit_buf, bit_val;
+    uint64_t acc = 0;
+    off_t off;
+    int i, pos, bytes;
     if (num_bits == 0) return 1;
     if (num_bits > 32 || num_bits < 0 || ib->b_off + num_bits > ib->bufsize*8) goto fail;
 
-    *value = 0; /* set all bits to 0 */
     off = ib->b_off / 8; /* byte offset */
     pos = ib->b_off % 8; /* bit sub-offset */
-    for (i = 0; i < num_bits; i++) {
-        bit_buf = (1U << (8-1-pos)) & 0xFF;   /* bit check for buf */
-        bit_val = (1U << (num_bits-1-i));     /* bit to set in value */
-
-        if (ib->buf[off] & bit_buf)         /* is bit in buf set? */
-            *value |= bit_val;              /* set bit */
+    if (pos + num_bits <= 8) { /* inside one byte */
+        *value = (ib->buf[off] >> (8 - pos - num_bits)) & (0xFFU >> (8 - num_bits));
+        ib->b_off += num_bits;
+        return 1;
+    }
 
-        pos++;
-        if (pos%8 == 0) {                   /* new byte starts */
-            pos = 0;
-            off++;
-        }
+    bytes = (pos + num_bits + 7) / 8;
+    for (i = 0; i < bytes; i++) {
+        acc = (acc << 8) | ib->buf[off + i];
     }
 
+    *value = (uint32_t)((acc >> (8*bytes - pos - num_bits)) & (0xFFFFFFFFU >> (32 - num_bits)));
+
     ib->b_off += num_bits;
     return 1;
 fail:
@@ -1115,28 +1121,35 @@ fail:
 
 /* Write bits (max 32) to buf and update the bit offset. Order is BE (MSF). */
 static int w_bits_msf(vgm_bitstream * ob, int num_bits, uint32_t value) {
-    off_t off, pos;
-    int i, bit_val, bit_buf;
+    uint64_t acc = 0, mask;
+    uint8_t byte_mask;
+    off_t off;
+    int i, pos, bytes, shift;
     if (num_bits == 0) return 1;
     if (num_bits > 32 || num_bits < 0 || ob->b_off + num_bits > ob->bufsize*8) goto fail;
 
-
     off = ob->b_off / 8; /* byte offset */
     pos = ob->b_off % 8; /* bit sub-offset */
-    for (i = 0; i < num_bits; i++) {
-        bit_val = (1U << (num_bits-1-i));     /* bit check for value */
-        bit_buf = (1U << (8-1-pos)) & 0xFF;   /* bit to set in buf */
-
-        if (value & bit_val)                /* is bit in val set? */
-            ob->buf[off] |= bit_buf;        /* set bit */
-        else
-            ob->buf[off] &= ~bit_buf;       /* unset bit */
-
-        pos++;
-        if (pos%8 == 0) {                   /* new byte starts */
-            pos = 0;
-            off++;
-        }
+    if (pos + num_bits <= 8) { /* inside one byte */
+        shift = 8 - pos - num_bits;
+        byte_mask = (0xFFU >> (8 - num_bits)) << shift;
+        ob->buf[off] = (ob->buf[off] & ~byte_mask) | ((value << shift) & byte_mask);
+        ob->b_off += num_bits;
+        return 1;
+    }
+
+    bytes = (pos + num_bits + 7) / 8;
+    for (i = 0; i < bytes; i++) {
+        acc = (acc << 8) | ob->buf[off + i];
+    }
+
+    shift = 8*bytes - pos - num_bits;
+    mask = (uint64_t)(0xFFFFFFFFU >> (32 - num_bits)) << shift;
+    acc = (acc & ~mask) | (((uint64_t)value << shift) & mask);
+
+    for (i = bytes - 1; i >= 0; i--) {
+        ob->buf[off + i] = (uint8_t)acc;
+        acc >>= 8;
     }
 
     ob->b_off += num_bits;
@@ -7,25 +7,18 @@
 #define FFMPEG_DEFAULT_IO_BUFFER_SIZE 128 * 1024
 
 
-static volatile int g_ffmpeg_initialized = 0;
+static vgm_once_t g_ffmpeg_once;
 
 
 /* ******************************************** */
 /* INTERNAL UTILS                               */
 /* ******************************************** */
 
-/* Global FFmpeg init */
-static void g_init_ffmpeg() {
-    if (g_ffmpeg_initialized == 1) {
-        while (g_ffmpeg_initialized < 2); /* active wait for lack of a better way */
-    }
-    else if (g_ffmpeg_initialized == 0) {
-        g_ffmpeg_initialized = 1;
-        av_log_set_flags(AV_LOG_SKIP_REPEATED);
-        av_log_set_level(AV_LOG_ERROR);
-        //av_register_all(); /* not needed in newer versions */
-        g_ffmpeg_initialized = 2;
-    }
+/* Global FFmpeg init (call through vgm_once) */
+static void g_init_ffmpeg(void) {
+    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+    av_log_set_level(AV_LOG_ERROR);
+    //av_register_all(); /* not needed in newer versions */
 }
 
 /* converts codec's samples (can be in any format, ex. Ogg's float32) to PCM16 */
@@ -53,9 +46,15 @@ static void convert_audio_pcm16(sample *outbuf, const uint8_t *inbuf, int fullSa
                 }
             }
             else {
-                float *s32 = (float *)inbuf;
+                f32_to_samples(outbuf, (const float *)inbuf, fullSampleCount, F32_TO_SAMPLES_TRUNC);
+            }
+            break;
+        }
+        case 64: {
+            if (floatingPoint) {
+                double *s64 = (double *)inbuf;
                 for (s = 0; s < fullSampleCount; s++) {
-                    float sample = *s32++;
+                    double sample = *s64++;
                     int s16 = (int)(sample * 32768.0f);
                     if ((unsigned)(s16 + 0x8000) & 0xFFFF0000) {
                         s16 = (s16 >> 31) ^ 0x7FFF;
@@ -65,16 +64,43 @@ static void convert_audio_pcm16(sample *outbuf, const uint8_t *inbuf, int fullSa
             }
             break;
         }
+    }
+}
+
+/* converts codec's samples to float (-1.0..1.0, unclipped) */
+static void convert_audio_f32(float *outbuf, const uint8_t *inbuf, int fullSampleCount, int bitsPerSample, int floatingPoint) {
+    int s;
+    switch (bitsPerSample) {
+        case 8: {
+            for (s = 0; s < fullSampleCount; s++) {
+                *outbuf++ = ((int)(*(inbuf++))-0x80) / 128.0f;
+            }
+            break;
+        }
+        case 16: {
+            int16_t *s16 = (int16_t *)inbuf;
+            for (s = 0; s < fullSampleCount; s++) {
+                *outbuf++ = *(s16++) / 32768.0f;
+            }
+            break;
+        }
+        case 32: {
+            if (!floatingPoint) {
+                int32_t *s32 = (int32_t *)inbuf;
+                for (s = 0; s < fullSampleCount; s++) {
+                    *outbuf++ = (float)(*(s32++) / 2147483648.0);
+                }
+            }
+            else {
+                memcpy(outbuf, inbuf, fullSampleCount * sizeof(float));
+            }
+            break;
+        }
         case 64: {
             if (floatingPoint) {
                 double *s64 = (double *)inbuf;
                 for (s = 0; s < fullSampleCount; s++) {
-                    double sample = *s64++;
-                    int s16 = (int)(sample * 32768.0f);
-                    if ((unsigned)(s16 + 0x8000) & 0xFFFF0000) {
-                        s16 = (s16 >> 31) ^ 0x7FFF;
-                    }
-                    *outbuf++ = s16;
+                    *outbuf++ = (float)*s64++;
                 }
             }
             break;
@@ -297,7 +323,7 @@ ffmpeg_codec_data * init_ffmpeg_header_offset_subsong(STREAMFILE *streamFile, ui
 
 
     /* basic setup */
-    g_init_ffmpeg();
+    vgm_once(&g_ffmpeg_once, g_init_ffmpeg);
 
     data = ( ffmpeg_codec_data * ) calloc(1, sizeof(ffmpeg_codec_data));
     if (!data) return NULL;
@@ -494,8 +520,8 @@ fail:
     return NULL;
 }
 
-/* decode samples of any kind of FFmpeg format */
-void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do, int channels) {
+/* decode samples of any kind of FFmpeg format, to outbuf or to outbuf_f32 if set */
+static void decode_ffmpeg_internal(VGMSTREAM *vgmstream, sample * outbuf, float * outbuf_f32, int32_t samples_to_do, int channels) {
     ffmpeg_codec_data *data = vgmstream->codec_data;
     int samplesReadNow;
     //todo use either channels / data->channels / codecCtx->channels
@@ -518,7 +544,10 @@ void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do,
     /* ignore once file is done (but not at endOfStream as FFmpeg can still output samples until endOfAudio) */
     if (/*endOfStream ||*/ endOfAudio) {
         VGM_LOG("FFMPEG: decode after end of audio\n");
-        memset(outbuf, 0, samples_to_do * channels * sizeof(sample));
+        if (outbuf_f32)
+            memset(outbuf_f32, 0, samples_to_do * channels * sizeof(float));
+        else
+            memset(outbuf, 0, samples_to_do * channels * sizeof(sample));
         return;
     }
 
@@ -653,14 +682,20 @@ void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do,
 
 
 end:
-    /* convert native sample format into PCM16 outbuf */
+    /* convert native sample format into PCM16/float outbuf */
     samplesReadNow = bytesRead / (bytesPerSample * channels);
-    convert_audio_pcm16(outbuf, data->sampleBuffer, samplesReadNow * channels, data->bitsPerSample, data->floatingPoint);
+    if (outbuf_f32)
+        convert_audio_f32(outbuf_f32, data->sampleBuffer, samplesReadNow * channels, data->bitsPerSample, data->floatingPoint);
+    else
+        convert_audio_pcm16(outbuf, data->sampleBuffer, samplesReadNow * channels, data->bitsPerSample, data->floatingPoint);
 
     /* clean buffer when requested more samples than possible */
     if (endOfAudio && samplesReadNow < samples_to_do) {
         VGM_LOG("FFMPEG: decode after end of audio %i samples\n", (samples_to_do - samplesReadNow));
-        memset(outbuf + (samplesReadNow * channels), 0, (samples_to_do - samplesReadNow) * channels * sizeof(sample));
+        if (outbuf_f32)
+            memset(outbuf_f32 + (samplesReadNow * channels), 0, (samples_to_do - samplesReadNow) * channels * sizeof(float));
+        else
+            memset(outbuf + (samplesReadNow * channels), 0, (samples_to_do - samplesReadNow) * channels * sizeof(sample));
     }
 
     /* copy state back */
@@ -670,6 +705,14 @@ end:
     data->bytesConsumedFromDecodedFrame = bytesConsumedFromDecodedFrame;
 }
 
+void decode_ffmpeg(VGMSTREAM *vgmstream, sample * outbuf, int32_t samples_to_do, int channels) {
+    decode_ffmpeg_internal(vgmstream, outbuf, NULL, samples_to_do, channels);
+}
+
+void decode_ffmpeg_f32(VGMSTREAM *vgmstream, float * outbuf, int32_t samples_to_do, int channels) {
+    decode_ffmpeg_internal(vgmstream, NULL, outbuf, samples_to_do, channels);
+}
+
 
 /* ******************************************** */
 /* UTILS                                        */
@@ -38,6 +38,9 @@ hca_codec_data * init_hca(STREAMFILE *streamFile) {
     data->sample_buffer = malloc(sizeof(signed short) * data->info.channelCount * data->info.samplesPerBlock);
     if (!data->sample_buffer) goto fail;
 
+    data->sample_buffer_f32 = malloc(sizeof(float) * data->info.channelCount * data->info.samplesPerBlock);
+    if (!data->sample_buffer_f32) goto fail;
+
     /* load streamfile for reads */
     get_streamfile_name(streamFile,filename, sizeof(filename));
     data->streamfile = open_streamfile(streamFile,filename);
@@ -53,7 +56,8 @@ fail:
     return NULL;
 }
 
-void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
+/* decodes to outbuf, or to outbuf_f32 if set; blocks are extracted to each format only when needed */
+static void decode_hca_internal(hca_codec_data * data, sample * outbuf, float * outbuf_f32, int32_t samples_to_do) {
 	int samples_done = 0;
     const unsigned int channels = data->info.channelCount;
     const unsigned int blockSize = data->info.blockSize;
@@ -75,9 +79,24 @@ void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
                 if (samples_to_get > samples_to_do - samples_done)
                     samples_to_get = samples_to_do - samples_done;
 
-                memcpy(outbuf + samples_done*channels,
-                       data->sample_buffer + data->samples_consumed*channels,
-                       samples_to_get*channels * sizeof(sample));
+                if (outbuf_f32) {
+                    if (!data->sample_buffer_f32_ready) {
+                        clHCA_ReadSamplesF32(data->handle, data->sample_buffer_f32);
+                        data->sample_buffer_f32_ready = 1;
+                    }
+                    memcpy(outbuf_f32 + samples_done*channels,
+                           data->sample_buffer_f32 + data->samples_consumed*channels,
+                           samples_to_get*channels * sizeof(float));
+                }
+                else {
+                    if (!data->sample_buffer_ready) {
+                        clHCA_ReadSamples16(data->handle, data->sample_buffer);
+                        data->sample_buffer_ready = 1;
+                    }
+                    memcpy(outbuf + samples_done*channels,
+                           data->sample_buffer + data->samples_consumed*channels,
+                           samples_to_get*channels * sizeof(sample));
+                }
                 samples_done += samples_to_get;
             }
 
@@ -92,7 +111,10 @@ void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
 
             /* EOF/error */
             if (data->current_block >= data->info.blockCount) {
-                memset(outbuf, 0, (samples_to_do - samples_done) * channels * sizeof(sample));
+                if (outbuf_f32)
+                    memset(outbuf_f32, 0, (samples_to_do - samples_done) * channels * sizeof(float));
+                else if (outbuf)
+                    memset(outbuf, 0, (samples_to_do - samples_done) * channels * sizeof(sample));
                 break;
             }
 
@@ -110,8 +132,9 @@ void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
                 break;
             }
 
-            /* extract samples */
-            clHCA_ReadSamples16(data->handle, data->sample_buffer);
+            /* samples are extracted when consumed, as the handle keeps the last decoded block */
+            data->sample_buffer_ready = 0;
+            data->sample_buffer_f32_ready = 0;
 
             data->current_block++;
             data->samples_consumed = 0;
@@ -120,6 +143,14 @@ void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
     }
 }
 
+void decode_hca(hca_codec_data * data, sample * outbuf, int32_t samples_to_do) {
+    decode_hca_internal(data, outbuf, NULL, samples_to_do);
+}
+
+void decode_hca_f32(hca_codec_data * data, float * outbuf, int32_t samples_to_do) {
+    decode_hca_internal(data, NULL, outbuf, samples_to_do);
+}
+
 void reset_hca(hca_codec_data * data) {
     if (!data) return;
 
@@ -139,6 +170,24 @@ void loop_hca(hca_codec_data * data) {
     data->samples_to_discard = data->info.loopStartDelay;
 }
 
+void seek_hca(hca_codec_data * data, int32_t num_sample) {
+    int32_t seek_sample, seek_block, back_blocks;
+    if (!data) return;
+
+    /* find block with the sample (including encoder delay), and discard up to it */
+    seek_sample = data->info.encoderDelay + num_sample;
+    seek_block = seek_sample / data->info.samplesPerBlock;
+
+    /* decoded blocks overlap, so start one block before to get the same PCM as a full decode */
+    back_blocks = (seek_block > 0) ? 1 : 0;
+
+    clHCA_DecodeReset(data->handle);
+    data->current_block = seek_block - back_blocks;
+    data->samples_filled = 0;
+    data->samples_consumed = 0;
+    data->samples_to_discard = (seek_sample % data->info.samplesPerBlock) + back_blocks * data->info.samplesPerBlock;
+}
+
 void free_hca(hca_codec_data * data) {
     if (!data) return;
 
@@ -147,6 +196,7 @@ void free_hca(hca_codec_data * data) {
     free(data->handle);
     free(data->data_buffer);
     free(data->sample_buffer);
+    free(data->sample_buffer_f32);
     free(data);
 }
 
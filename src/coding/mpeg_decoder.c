@@ -179,6 +179,14 @@ fail:
 }
 
 
+static vgm_once_t g_mpg123_once;
+static int g_mpg123_init_result;
+
+/* Global mpg123 init (not thread-safe by itself, call through vgm_once) */
+static void g_init_mpg123(void) {
+    g_mpg123_init_result = mpg123_init();
+}
+
 static mpg123_handle * init_mpg123_handle() {
     mpg123_handle *m = NULL;
     int rc;
@@ -187,7 +195,8 @@ static mpg123_handle * init_mpg123_handle() {
     m = mpg123_new(NULL,&rc);
     if (rc == MPG123_NOT_INITIALIZED) {
         /* inits the library if needed */
-        if (mpg123_init() != MPG123_OK)
+        vgm_once(&g_mpg123_once, g_init_mpg123);
+        if (g_mpg123_init_result != MPG123_OK)
             goto fail;
         m = mpg123_new(NULL,&rc);
         if (rc != MPG123_OK) goto fail;
@@ -1,13 +1,12 @@
 #include "coding.h"
 #include "../util.h"
 
-void decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
-    int i=first_sample;
+/* decode one frame (or part of it) from memory rather than a file */
+static void decode_ngc_dsp_frame(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, const uint8_t * frame) {
+    int i;
     int32_t sample_count;
 
-    int framesin = first_sample/14;
-
-    int8_t header = read_8bit(framesin*8+stream->offset,stream->streamfile);
+    int8_t header = frame[0];
     int32_t scale = 1 << (header & 0xf);
     int coef_index = (header >> 4) & 0xf;
     int32_t hist1 = stream->adpcm_history1_16;
@@ -18,7 +17,7 @@ void decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
     first_sample = first_sample%14;
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int sample_byte = read_8bit(framesin*8+stream->offset+1+i/2,stream->streamfile);
+        int sample_byte = frame[1 + i/2];
 
         outbuf[sample_count] = clamp16((
                  (((i&1?
@@ -36,58 +35,60 @@ void decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
     stream->adpcm_history2_16 = hist2;
 }
 
-/* read from memory rather than a file */
-static void decode_ngc_dsp_subint_internal(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, uint8_t * mem) {
-    int i=first_sample;
-    int32_t sample_count;
+/* get size bytes at offset, where missing bytes past EOF read as 0xFF (same as read_8bit) */
+static const uint8_t * get_frame(uint8_t * buf, off_t offset, size_t size, STREAMFILE * streamfile) {
+    const uint8_t * frame = borrow_streamfile(buf, offset, size, streamfile);
+    if (frame)
+        return frame;
 
-    int8_t header = mem[0];
-    int32_t scale = 1 << (header & 0xf);
-    int coef_index = (header >> 4) & 0xf;
-    int32_t hist1 = stream->adpcm_history1_16;
-    int32_t hist2 = stream->adpcm_history2_16;
-    int coef1 = stream->adpcm_coef[coef_index*2];
-    int coef2 = stream->adpcm_coef[coef_index*2+1];
-
-    first_sample = first_sample%14;
-
-    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int sample_byte = mem[1 + i/2];
+    memset(buf, 0xFF, size);
+    read_streamfile(buf, offset, size, streamfile);
+    return buf;
+}
 
-        outbuf[sample_count] = clamp16((
-                 (((i&1?
-                    get_low_nibble_signed(sample_byte):
-                    get_high_nibble_signed(sample_byte)
-                   ) * scale)<<11) + 1024 +
-                 (coef1 * hist1 + coef2 * hist2))>>11
-                );
+void decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    uint8_t frame_buf[0x08];
+    const uint8_t * frame;
+    int framesin = first_sample/14;
 
-        hist2 = hist1;
-        hist1 = outbuf[sample_count];
-    }
+    /* whole frame at once (usually a pointer to the STREAMFILE's buffer) */
+    frame = get_frame(frame_buf, framesin*0x08 + stream->offset, 0x08, stream->streamfile);
 
-    stream->adpcm_history1_16 = hist1;
-    stream->adpcm_history2_16 = hist2;
+    decode_ngc_dsp_frame(stream, outbuf, channelspacing, first_sample, samples_to_do, frame);
 }
 
 /* decode DSP with byte-interleaved frames (ex. 0x08: 1122112211221122) */
 void decode_ngc_dsp_subint(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel, int interleave) {
+    uint8_t block_buf[0x08*16];
     uint8_t sample_data[0x08];
+    const uint8_t * block;
+    size_t block_size = 0x08*channelspacing;
     int i;
 
     int framesin = first_sample/14;
 
-    for (i=0; i < 0x08; i++) {
-        /* base + current frame + subint section + subint byte + channel adjust */
-        sample_data[i] = read_8bit(
-                stream->offset
-                + framesin*(0x08*channelspacing)
-                + i/interleave * interleave * channelspacing
-                + i%interleave
-                + interleave * channel, stream->streamfile);
+    if (block_size <= sizeof(block_buf)) {
+        /* get all channel's frames at once and deinterleave from memory */
+        block = get_frame(block_buf, stream->offset + framesin*block_size, block_size, stream->streamfile);
+
+        for (i=0; i < 0x08; i++) {
+            /* subint section + subint byte + channel adjust */
+            sample_data[i] = block[i/interleave * interleave * channelspacing + i%interleave + interleave * channel];
+        }
+    }
+    else {
+        for (i=0; i < 0x08; i++) {
+            /* base + current frame + subint section + subint byte + channel adjust */
+            sample_data[i] = read_8bit(
+                    stream->offset
+                    + framesin*(0x08*channelspacing)
+                    + i/interleave * interleave * channelspacing
+                    + i%interleave
+                    + interleave * channel, stream->streamfile);
+        }
     }
 
-    decode_ngc_dsp_subint_internal(stream, outbuf, channelspacing, first_sample, samples_to_do, sample_data);
+    decode_ngc_dsp_frame(stream, outbuf, channelspacing, first_sample, samples_to_do, sample_data);
 }
 
 
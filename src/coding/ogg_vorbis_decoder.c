@@ -20,6 +20,27 @@ void decode_ogg_vorbis(ogg_vorbis_codec_data * data, sample * outbuf, int32_t sa
     swap_samples_le(outbuf, samples_to_do*channels);
 }
 
+void decode_ogg_vorbis_f32(ogg_vorbis_codec_data * data, float * outbuf, int32_t samples_to_do, int channels) {
+    int samples_done = 0;
+    OggVorbis_File *ogg_vorbis_file = &data->ogg_vorbis_file;
+
+    do {
+        float **pcm;
+        int ch, s;
+        long rc = ov_read_float(ogg_vorbis_file, &pcm, samples_to_do - samples_done, &data->bitstream);
+        if (rc <= 0) return;
+
+        /* planar to interleaved */
+        for (ch = 0; ch < channels; ch++) {
+            float *out = outbuf + samples_done*channels + ch;
+            for (s = 0; s < rc; s++) {
+                out[s*channels] = pcm[ch][s];
+            }
+        }
+        samples_done += rc;
+    } while (samples_done < samples_to_do);
+}
+
 
 void reset_ogg_vorbis(VGMSTREAM *vgmstream) {
     OggVorbis_File *ogg_vorbis_file;
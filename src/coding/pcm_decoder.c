@@ -20,6 +20,64 @@ void decode_pcm16be(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
     }
 }
 
+/* planar PCM16 from memory when possible (same as read_16bitXX otherwise) */
+static void decode_pcm16_planar(VGMSTREAMCHANNEL * stream, sample * outbuf, int32_t first_sample, int32_t samples_to_do, int big_endian) {
+    const uint8_t * data = NULL;
+    int i;
+
+    if (stream->streamfile->borrow)
+        data = stream->streamfile->borrow(stream->streamfile, stream->offset + first_sample*2, samples_to_do*2);
+
+    if (!data) {
+        if (big_endian)
+            decode_pcm16be(stream, outbuf, 1, first_sample, samples_to_do);
+        else
+            decode_pcm16le(stream, outbuf, 1, first_sample, samples_to_do);
+        return;
+    }
+
+    if (big_endian) {
+        for (i = 0; i < samples_to_do; i++) {
+            outbuf[i] = get_16bitBE((uint8_t*)data + i*2);
+        }
+    }
+    else {
+        for (i = 0; i < samples_to_do; i++) {
+            outbuf[i] = get_16bitLE((uint8_t*)data + i*2);
+        }
+    }
+}
+
+void decode_pcm16_mch(VGMSTREAM * vgmstream, sample * outbuf, int32_t first_sample, int32_t samples_to_do, int big_endian) {
+    sample planar[DECODE_MCH_SAMPLES];
+    int ch, channels = vgmstream->channels;
+    int32_t chunk = DECODE_MCH_SAMPLES / channels;
+
+    /* without borrowed reads planar decoding only adds the interleave pass */
+    if (!vgmstream->ch[0].streamfile->borrow) {
+        for (ch = 0; ch < channels; ch++) {
+            if (big_endian)
+                decode_pcm16be(&vgmstream->ch[ch], outbuf + ch, channels, first_sample, samples_to_do);
+            else
+                decode_pcm16le(&vgmstream->ch[ch], outbuf + ch, channels, first_sample, samples_to_do);
+        }
+        return;
+    }
+
+    while (samples_to_do > 0) {
+        int32_t samples = samples_to_do > chunk ? chunk : samples_to_do;
+
+        for (ch = 0; ch < channels; ch++) {
+            decode_pcm16_planar(&vgmstream->ch[ch], planar + ch*samples, first_sample, samples, big_endian);
+        }
+        interleave_samples(outbuf, planar, channels, samples);
+
+        outbuf += samples*channels;
+        first_sample += samples;
+        samples_to_do -= samples;
+    }
+}
+
 void decode_pcm16_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int big_endian) {
     int i, sample_count;
     int16_t (*read_16bit)(off_t,STREAMFILE*) = big_endian ? read_16bitBE : read_16bitLE;
@@ -93,7 +151,7 @@ static int expand_ulaw(uint8_t ulawbyte) {
 
 #if 0   // the above follows Sun's implementation, but this works too
     {
-        static int exp_lut[8] = {0,132,396,924,1980,4092,8316,16764}; /* precalcs from bias */
+        static const int exp_lut[8] = {0,132,396,924,1980,4092,8316,16764}; /* precalcs from bias */
         new_sample = exp_lut[segment] + (quantization << (segment + 3));
         if (sign != 0) new_sample = -new_sample;
     }
@@ -42,8 +42,21 @@ static const int ps_adpcm_coefs_i[5][2] = {
  * may use int math in software, etc). There are inaudible rounding diffs between implementations.
  */
 
+/* get size bytes at offset, where missing bytes past EOF read as 0xFF (same as read_8bit) */
+static const uint8_t * get_frame(uint8_t * buf, off_t offset, size_t size, STREAMFILE * streamfile) {
+    const uint8_t * frame = borrow_streamfile(buf, offset, size, streamfile);
+    if (frame)
+        return frame;
+
+    memset(buf, 0xFF, size);
+    read_streamfile(buf, offset, size, streamfile);
+    return buf;
+}
+
 /* standard PS-ADPCM (float math version) */
 void decode_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int is_badflags) {
+    uint8_t frame_buf[0x10];
+    const uint8_t * frame;
     off_t frame_offset;
     int i, frames_in, sample_count = 0;
     size_t bytes_per_frame, samples_per_frame;
@@ -57,11 +70,12 @@ void decode_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing,
     frames_in = first_sample / samples_per_frame;
     first_sample = first_sample % samples_per_frame;
 
-    /* parse frame header */
+    /* parse frame header (whole frame at once, usually a pointer to the STREAMFILE's buffer) */
     frame_offset = stream->offset + bytes_per_frame*frames_in;
-    coef_index   = ((uint8_t)read_8bit(frame_offset+0x00,stream->streamfile) >> 4) & 0xf;
-    shift_factor = ((uint8_t)read_8bit(frame_offset+0x00,stream->streamfile) >> 0) & 0xf;
-    flag = (uint8_t)read_8bit(frame_offset+0x01,stream->streamfile); /* only lower nibble needed */
+    frame = get_frame(frame_buf, frame_offset, bytes_per_frame, stream->streamfile);
+    coef_index   = (frame[0x00] >> 4) & 0xf;
+    shift_factor = (frame[0x00] >> 0) & 0xf;
+    flag = frame[0x01]; /* only lower nibble needed */
 
     VGM_ASSERT_ONCE(coef_index > 5 || shift_factor > 12, "PS-ADPCM: incorrect coefs/shift at %"PRIx64"\n", (off64_t)frame_offset);
     if (coef_index > 5) /* needed by inFamous (PS3) (maybe it's supposed to use more filters?) */
@@ -78,7 +92,7 @@ void decode_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing,
         int32_t new_sample = 0;
 
         if (flag < 0x07) { /* with flag 0x07 decoded sample must be 0 */
-            uint8_t nibbles = (uint8_t)read_8bit(frame_offset+0x02+i/2,stream->streamfile);
+            uint8_t nibbles = frame[0x02+i/2];
 
             new_sample = i&1 ? /* low nibble first */
                     (nibbles >> 4) & 0x0f :
@@ -105,6 +119,8 @@ void decode_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing,
  *
  * Uses int math to decode, which seems more likely (based on FF XI PC's code in Moogle Toolbox). */
 void decode_psx_configurable(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int frame_size) {
+    uint8_t frame_buf[0x100];
+    const uint8_t * frame;
     off_t frame_offset;
     int i, frames_in, sample_count = 0;
     size_t bytes_per_frame, samples_per_frame;
@@ -118,10 +134,16 @@ void decode_psx_configurable(VGMSTREAMCHANNEL * stream, sample * outbuf, int cha
     frames_in = first_sample / samples_per_frame;
     first_sample = first_sample % samples_per_frame;
 
-    /* parse frame header */
+    if (bytes_per_frame > sizeof(frame_buf)) {
+        VGM_LOG("PS-ADPCM: frame size %x too big\n", (uint32_t)bytes_per_frame); /* not seen, usual sizes are under 0x30 */
+        return;
+    }
+
+    /* parse frame header (whole frame at once) */
     frame_offset = stream->offset + bytes_per_frame*frames_in;
-    coef_index   = ((uint8_t)read_8bit(frame_offset+0x00,stream->streamfile) >> 4) & 0xf;
-    shift_factor = ((uint8_t)read_8bit(frame_offset+0x00,stream->streamfile) >> 0) & 0xf;
+    frame = get_frame(frame_buf, frame_offset, bytes_per_frame, stream->streamfile);
+    coef_index   = (frame[0x00] >> 4) & 0xf;
+    shift_factor = (frame[0x00] >> 0) & 0xf;
 
     VGM_ASSERT_ONCE(coef_index > 5 || shift_factor > 12, "PS-ADPCM: incorrect coefs/shift at %"PRIx64"\n", (off64_t)frame_offset);
     if (coef_index > 5) /* needed by Afrika (PS3) (maybe it's supposed to use more filters?) */
@@ -132,7 +154,7 @@ void decode_psx_configurable(VGMSTREAMCHANNEL * stream, sample * outbuf, int cha
     /* decode nibbles */
     for (i = first_sample; i < first_sample + samples_to_do; i++) {
         int32_t new_sample = 0;
-        uint8_t nibbles = (uint8_t)read_8bit(frame_offset+0x01+i/2,stream->streamfile);
+        uint8_t nibbles = frame[0x01+i/2];
 
         new_sample = i&1 ? /* low nibble first */
                 (nibbles >> 4) & 0x0f :
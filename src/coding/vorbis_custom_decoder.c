@@ -8,6 +8,8 @@
 #define VORBIS_DEFAULT_BUFFER_SIZE 0x8000 /* should be at least the size of the setup header, ~0x2000 */
 
 static void pcm_convert_float_to_16(vorbis_custom_codec_data * data, sample * outbuf, int samples_to_do, float ** pcm);
+static void pcm_convert_float_to_f32(vorbis_custom_codec_data * data, float * outbuf, int samples_to_do, float ** pcm);
+static void pcm_convert_float_to_planar(vorbis_custom_codec_data * data, sample ** outbuf, int samples_done, int samples_to_do, float ** pcm);
 
 /**
  * Inits a vorbis stream of some custom variety.
@@ -74,8 +76,8 @@ fail:
     return NULL;
 }
 
-/* Decodes Vorbis packets into a libvorbis sample buffer, and copies them to outbuf */
-void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t samples_to_do, int channels) {
+/* Decodes Vorbis packets into a libvorbis sample buffer, and copies them to outbuf (or outbuf_f32/outbuf_planar if set) */
+static void decode_vorbis_custom_internal(VGMSTREAM * vgmstream, sample * outbuf, float * outbuf_f32, sample ** outbuf_planar, int32_t samples_to_do, int channels) {
     VGMSTREAMCHANNEL *stream = &vgmstream->ch[0];
     vorbis_custom_codec_data * data = vgmstream->codec_data;
     size_t stream_size =  get_streamfile_size(stream->streamfile);
@@ -86,8 +88,7 @@ void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t sample
 
         /* extra EOF check for edge cases */
         if (stream->offset >= stream_size) {
-            memset(outbuf + samples_done * channels, 0, (samples_to_do - samples_done) * sizeof(sample) * channels);
-            break;
+            goto decode_silence;
         }
 
 
@@ -112,7 +113,12 @@ void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t sample
                 /* get max samples and convert from Vorbis float pcm to 16bit pcm */
                 if (samples_to_get > samples_to_do - samples_done)
                     samples_to_get = samples_to_do - samples_done;
-                pcm_convert_float_to_16(data, outbuf + samples_done * channels, samples_to_get, pcm);
+                if (outbuf_f32)
+                    pcm_convert_float_to_f32(data, outbuf_f32 + samples_done * channels, samples_to_get, pcm);
+                else if (outbuf_planar)
+                    pcm_convert_float_to_planar(data, outbuf_planar, samples_done, samples_to_get, pcm);
+                else
+                    pcm_convert_float_to_16(data, outbuf + samples_done * channels, samples_to_get, pcm);
                 samples_done += samples_to_get;
             }
 
@@ -163,24 +169,58 @@ void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t sample
 decode_fail:
     /* on error just put some 0 samples */
     VGM_LOG("VORBIS: decode fail at %"PRIx64", missing %i samples\n", (off64_t)stream->offset, (samples_to_do - samples_done));
-    memset(outbuf + samples_done * channels, 0, (samples_to_do - samples_done) * channels * sizeof(sample));
+decode_silence:
+    if (outbuf_f32) {
+        memset(outbuf_f32 + samples_done * channels, 0, (samples_to_do - samples_done) * channels * sizeof(float));
+    }
+    else if (outbuf_planar) {
+        int ch;
+        for (ch = 0; ch < channels; ch++) {
+            memset(outbuf_planar[ch] + samples_done, 0, (samples_to_do - samples_done) * sizeof(sample));
+        }
+    }
+    else {
+        memset(outbuf + samples_done * channels, 0, (samples_to_do - samples_done) * channels * sizeof(sample));
+    }
+}
+
+void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t samples_to_do, int channels) {
+    decode_vorbis_custom_internal(vgmstream, outbuf, NULL, NULL, samples_to_do, channels);
+}
+
+void decode_vorbis_custom_f32(VGMSTREAM * vgmstream, float * outbuf, int32_t samples_to_do, int channels) {
+    decode_vorbis_custom_internal(vgmstream, NULL, outbuf, NULL, samples_to_do, channels);
+}
+
+void decode_vorbis_custom_planar(VGMSTREAM * vgmstream, sample ** outbuf, int32_t samples_to_do, int channels) {
+    decode_vorbis_custom_internal(vgmstream, NULL, NULL, outbuf, samples_to_do, channels);
 }
 
 /* converts from internal Vorbis format to standard PCM (mostly from Xiph's decoder_example.c) */
 static void pcm_convert_float_to_16(vorbis_custom_codec_data * data, sample * outbuf, int samples_to_do, float ** pcm) {
-    int i,j;
-
     /* convert float PCM (multichannel float array, with pcm[0]=ch0, pcm[1]=ch1, pcm[2]=ch0, etc)
      * to 16 bit signed PCM ints (host order) and interleave + fix clipping */
+    f32_interleave_to_samples(outbuf, (const float * const *)pcm, data->vi.channels, samples_to_do, F32_TO_SAMPLES_ROUND);
+}
+
+/* same but without interleaving, as Vorbis PCM is already planar */
+static void pcm_convert_float_to_planar(vorbis_custom_codec_data * data, sample ** outbuf, int samples_done, int samples_to_do, float ** pcm) {
+    int i;
+
+    for (i = 0; i < data->vi.channels; i++) {
+        f32_to_samples(outbuf[i] + samples_done, pcm[i], samples_to_do, F32_TO_SAMPLES_ROUND);
+    }
+}
+
+/* same but just interleaving the float PCM */
+static void pcm_convert_float_to_f32(vorbis_custom_codec_data * data, float * outbuf, int samples_to_do, float ** pcm) {
+    int i,j;
+
     for (i = 0; i < data->vi.channels; i++) {
-        sample *ptr = outbuf + i;
+        float *ptr = outbuf + i;
         float *mono = pcm[i];
         for (j = 0; j < samples_to_do; j++) {
-            int val = (int)floor(mono[j] * 32767.f + .5f);
-            if (val > 32767) val = 32767;
-            if (val < -32768) val = -32768;
-
-            *ptr = val;
+            *ptr = mono[j];
             ptr += data->vi.channels;
         }
     }
@@ -188,6 +228,145 @@ static void pcm_convert_float_to_16(vorbis_custom_codec_data * data, sample * ou
 
 /* ********************************************** */
 
+/* Rebuilding setups (Wwise codebooks) is slow and banks tend to use the same few setups in all
+ * subsongs, so rebuilt packets (plus Wwise mode info) are kept around process-wide. */
+#define VORBIS_SETUP_CACHE_MAX 32
+
+typedef struct {
+    uint32_t hash;
+    vorbis_custom_t type;
+    int setup_type;
+    int channels;
+    int blocksize_0_exp;
+    int blocksize_1_exp;
+    uint8_t *raw;
+    size_t raw_size;
+
+    uint8_t *packet;
+    size_t packet_size;
+    uint8_t mode_blockflag[64+1];
+    int mode_bits;
+} vorbis_setup_cache_entry;
+
+static vorbis_setup_cache_entry setup_cache[VORBIS_SETUP_CACHE_MAX];
+static int setup_cache_count;
+static int setup_cache_next; /* oldest entry, replaced when full */
+static vgm_once_t setup_cache_once;
+static vgm_mutex *setup_cache_mutex;
+
+static void setup_cache_init(void) {
+    setup_cache_mutex = vgm_mutex_init();
+}
+
+/* takes the cache mutex, 0 if not possible (cache can't be used then) */
+static int setup_cache_lock(void) {
+    vgm_once(&setup_cache_once, setup_cache_init);
+    if (!setup_cache_mutex)
+        return 0;
+    vgm_mutex_lock(setup_cache_mutex);
+    return 1;
+}
+
+static uint32_t setup_cache_hash(const vorbis_custom_setup_key *key) {
+    uint32_t hash = 0x811C9DC5; /* FNV-1a */
+    size_t i;
+
+    hash = (hash ^ (uint32_t)key->type) * 0x01000193;
+    hash = (hash ^ (uint32_t)key->setup_type) * 0x01000193;
+    hash = (hash ^ (uint32_t)key->channels) * 0x01000193;
+    hash = (hash ^ (uint32_t)(key->blocksize_0_exp << 8 | key->blocksize_1_exp)) * 0x01000193;
+    for (i = 0; i < key->raw_size; i++) {
+        hash = (hash ^ key->raw[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+static int setup_cache_find(const vorbis_custom_setup_key *key, uint32_t hash) {
+    int i;
+
+    for (i = 0; i < setup_cache_count; i++) {
+        vorbis_setup_cache_entry *entry = &setup_cache[i];
+        if (entry->hash == hash && entry->type == key->type && entry->setup_type == key->setup_type
+                && entry->channels == key->channels && entry->blocksize_0_exp == key->blocksize_0_exp
+                && entry->blocksize_1_exp == key->blocksize_1_exp
+                && entry->raw_size == key->raw_size && memcmp(entry->raw, key->raw, key->raw_size) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/* copies a cached setup packet to data's buffer (ready for vorbis_synthesis_headerin), returns 0 if not found */
+int vorbis_custom_setup_cache_load(const vorbis_custom_setup_key *key, vorbis_custom_codec_data *data) {
+    uint32_t hash = setup_cache_hash(key);
+    int index, ok = 0;
+
+    if (!setup_cache_lock())
+        return 0;
+    index = setup_cache_find(key, hash);
+    if (index >= 0 && setup_cache[index].packet_size <= data->buffer_size) {
+        vorbis_setup_cache_entry *entry = &setup_cache[index];
+        memcpy(data->buffer, entry->packet, entry->packet_size);
+        data->op.bytes = entry->packet_size;
+        memcpy(data->mode_blockflag, entry->mode_blockflag, sizeof(entry->mode_blockflag));
+        data->mode_bits = entry->mode_bits;
+        ok = 1;
+    }
+    vgm_mutex_unlock(setup_cache_mutex);
+
+    return ok;
+}
+
+/* stores the setup packet currently in data's buffer */
+void vorbis_custom_setup_cache_save(const vorbis_custom_setup_key *key, vorbis_custom_codec_data *data) {
+    vorbis_setup_cache_entry new_entry = {0};
+    vorbis_setup_cache_entry old_entry = {0};
+    uint32_t hash = setup_cache_hash(key);
+
+    /* prepare outside the lock */
+    new_entry.hash = hash;
+    new_entry.type = key->type;
+    new_entry.setup_type = key->setup_type;
+    new_entry.channels = key->channels;
+    new_entry.blocksize_0_exp = key->blocksize_0_exp;
+    new_entry.blocksize_1_exp = key->blocksize_1_exp;
+    new_entry.raw_size = key->raw_size;
+    new_entry.packet_size = data->op.bytes;
+    new_entry.mode_bits = data->mode_bits;
+    memcpy(new_entry.mode_blockflag, data->mode_blockflag, sizeof(new_entry.mode_blockflag));
+
+    new_entry.packet = malloc(new_entry.packet_size);
+    new_entry.raw = malloc(key->raw_size ? key->raw_size : 1);
+    if (!new_entry.packet || !new_entry.raw) goto fail;
+    memcpy(new_entry.packet, data->buffer, new_entry.packet_size);
+    if (key->raw_size)
+        memcpy(new_entry.raw, key->raw, key->raw_size);
+
+    if (!setup_cache_lock())
+        goto fail;
+    if (setup_cache_find(key, hash) >= 0) {
+        old_entry = new_entry; /* another thread saved it first */
+    }
+    else if (setup_cache_count < VORBIS_SETUP_CACHE_MAX) {
+        setup_cache[setup_cache_count] = new_entry;
+        setup_cache_count++;
+    }
+    else {
+        old_entry = setup_cache[setup_cache_next];
+        setup_cache[setup_cache_next] = new_entry;
+        setup_cache_next = (setup_cache_next + 1) % VORBIS_SETUP_CACHE_MAX;
+    }
+    vgm_mutex_unlock(setup_cache_mutex);
+
+    free(old_entry.packet);
+    free(old_entry.raw);
+    return;
+fail:
+    free(new_entry.packet);
+    free(new_entry.raw);
+}
+
+/* ********************************************** */
+
 void free_vorbis_custom(vorbis_custom_codec_data * data) {
     if (!data)
         return;
@@ -17,6 +17,20 @@ int vorbis_custom_parse_packet_wwise(VGMSTREAMCHANNEL *stream, vorbis_custom_cod
 int vorbis_custom_parse_packet_ogl(VGMSTREAMCHANNEL *stream, vorbis_custom_codec_data *data);
 int vorbis_custom_parse_packet_sk(VGMSTREAMCHANNEL *stream, vorbis_custom_codec_data *data);
 int vorbis_custom_parse_packet_vid1(VGMSTREAMCHANNEL *stream, vorbis_custom_codec_data *data);
+
+/* identifies a setup packet, to reuse it when rebuilt before */
+typedef struct {
+    vorbis_custom_t type;
+    int setup_type;
+    int channels;
+    int blocksize_0_exp;
+    int blocksize_1_exp;
+    const uint8_t *raw;     /* original setup data, if any (not copied) */
+    size_t raw_size;
+} vorbis_custom_setup_key;
+
+int vorbis_custom_setup_cache_load(const vorbis_custom_setup_key *key, vorbis_custom_codec_data *data);
+void vorbis_custom_setup_cache_save(const vorbis_custom_setup_key *key, vorbis_custom_codec_data *data);
 #endif/* VGM_USE_VORBIS */
 
 #endif/*_VORBIS_CUSTOM_DECODER_H_ */
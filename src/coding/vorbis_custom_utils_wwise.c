@@ -23,11 +23,11 @@ static int ww2ogg_generate_vorbis_packet(vgm_bitstream * ow, vgm_bitstream * iw,
 static int ww2ogg_generate_vorbis_setup(vgm_bitstream * ow, vgm_bitstream * iw, vorbis_custom_codec_data * data, int channels, size_t packet_size, STREAMFILE *streamFile);
 static int ww2ogg_codebook_library_copy(vgm_bitstream * ow, vgm_bitstream * iw);
 static int ww2ogg_codebook_library_rebuild(vgm_bitstream * ow, vgm_bitstream * iw, size_t cb_size, STREAMFILE *streamFile);
-static int ww2ogg_codebook_library_rebuild_by_id(vgm_bitstream * ow, uint32_t codebook_id, wwise_setup_t setup_type, STREAMFILE *streamFile);
+static int ww2ogg_codebook_library_rebuild_by_id(vgm_bitstream * ow, uint32_t codebook_id, vorbis_custom_codec_data * data, STREAMFILE *streamFile);
 static int ww2ogg_tremor_ilog(unsigned int v);
 static unsigned int ww2ogg_tremor_book_maptype1_quantvals(unsigned int entries, unsigned int dimensions);
 
-static int load_wvc(uint8_t * ibuf, size_t ibufsize, uint32_t codebook_id, wwise_setup_t setup_type, STREAMFILE *streamFile);
+static int load_wvc(uint8_t * ibuf, size_t ibufsize, uint32_t codebook_id, vorbis_custom_codec_data * data, STREAMFILE *streamFile);
 static int load_wvc_file(uint8_t * buf, size_t bufsize, uint32_t codebook_id, STREAMFILE *streamFile);
 static int load_wvc_array(uint8_t * buf, size_t bufsize, uint32_t codebook_id, wwise_setup_t setup_type);
 
@@ -85,9 +85,40 @@ int vorbis_custom_setup_init_wwise(STREAMFILE *streamFile, off_t start_offset, v
         if (!data->op.bytes) goto fail;
         if (vorbis_synthesis_headerin(&data->vi, &data->vc, &data->op) !=0 ) goto fail; /* parse comment header */
 
-        /* rebuild setup packet */
-        data->op.bytes = rebuild_setup(data->buffer, data->buffer_size, streamFile, start_offset, data, cfg.big_endian, cfg.channels);
-        if (!data->op.bytes) goto fail;
+        /* rebuild setup packet, or reuse the same setup rebuilt before (keyed by the original data) */
+        {
+            vorbis_custom_setup_key key = {0};
+            size_t raw_size = 0x8000; /* arbitrary max size of a setup packet, as rebuild_setup */
+            uint8_t * raw = NULL;
+            int granulepos, ok;
+
+            header_size = get_packet_header(streamFile, start_offset, cfg.header_type, &granulepos, &packet_size, cfg.big_endian);
+            if (!header_size || packet_size > raw_size) goto fail;
+            raw = malloc(packet_size);
+            if (!raw) goto fail;
+            if (read_streamfile(raw, start_offset+header_size, packet_size, streamFile) != packet_size) {
+                free(raw);
+                goto fail;
+            }
+
+            key.type = VORBIS_WWISE;
+            key.setup_type = cfg.setup_type;
+            key.channels = cfg.channels;
+            key.blocksize_0_exp = cfg.blocksize_0_exp;
+            key.blocksize_1_exp = cfg.blocksize_1_exp;
+            key.raw = raw;
+            key.raw_size = packet_size;
+
+            ok = vorbis_custom_setup_cache_load(&key, data);
+            if (!ok) {
+                data->op.bytes = rebuild_setup(data->buffer, data->buffer_size, streamFile, start_offset, data, cfg.big_endian, cfg.channels);
+                ok = data->op.bytes != 0;
+                if (ok && !data->setup_external)
+                    vorbis_custom_setup_cache_save(&key, data);
+            }
+            free(raw);
+            if (!ok) goto fail;
+        }
         if (vorbis_synthesis_headerin(&data->vi, &data->vc, &data->op) != 0) goto fail; /* parse setup header */
     }
 
@@ -437,7 +468,7 @@ static int ww2ogg_generate_vorbis_setup(vgm_bitstream * ow, vgm_bitstream * iw,
 
             r_bits(iw, 10,&codebook_id);
 
-            rc = ww2ogg_codebook_library_rebuild_by_id(ow, codebook_id, data->config.setup_type, streamFile);
+            rc = ww2ogg_codebook_library_rebuild_by_id(ow, codebook_id, data, streamFile);
             if (!rc) goto fail;
         }
     }
@@ -1028,13 +1059,13 @@ fail:
 }
 
 /* rebuilds an external Wwise codebook referenced by id to a Vorbis codebook */
-static int ww2ogg_codebook_library_rebuild_by_id(vgm_bitstream * ow, uint32_t codebook_id, wwise_setup_t setup_type, STREAMFILE *streamFile) {
+static int ww2ogg_codebook_library_rebuild_by_id(vgm_bitstream * ow, uint32_t codebook_id, vorbis_custom_codec_data * data, STREAMFILE *streamFile) {
     size_t ibufsize = 0x8000; /* arbitrary max size of a codebook */
     uint8_t ibuf[0x8000]; /* Wwise codebook buffer */
     size_t cb_size;
     vgm_bitstream iw;
 
-    cb_size = load_wvc(ibuf,ibufsize, codebook_id, setup_type, streamFile);
+    cb_size = load_wvc(ibuf,ibufsize, codebook_id, data, streamFile);
     if (cb_size == 0) goto fail;
 
     iw.buf = ibuf;
@@ -1089,18 +1120,20 @@ static unsigned int ww2ogg_tremor_book_maptype1_quantvals(unsigned int entries,
 /* **************************************************************************** */
 
 /* loads an external Wwise Vorbis Codebooks file (wvc) referenced by ID and returns size */
-static int load_wvc(uint8_t * ibuf, size_t ibufsize, uint32_t codebook_id, wwise_setup_t setup_type, STREAMFILE *streamFile) {
+static int load_wvc(uint8_t * ibuf, size_t ibufsize, uint32_t codebook_id, vorbis_custom_codec_data * data, STREAMFILE *streamFile) {
     size_t bytes;
 
     /* try to locate from the precompiled list */
-    bytes = load_wvc_array(ibuf, ibufsize, codebook_id, setup_type);
+    bytes = load_wvc_array(ibuf, ibufsize, codebook_id, data->config.setup_type);
     if (bytes)
         return bytes;
 
     /* try to load from external file (ignoring type, just use file if found) */
     bytes = load_wvc_file(ibuf, ibufsize, codebook_id, streamFile);
-    if (bytes)
+    if (bytes) {
+        data->setup_external = 1; /* depends on the file, so the setup isn't cached */
         return bytes;
+    }
 
     /* not found */
     VGM_LOG("Wwise Vorbis: codebook_id %04x not found\n", codebook_id);
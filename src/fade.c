@@ -0,0 +1,125 @@
+#include "vgmstream.h"
+
+/* Play config: fades out looped streams after N loops (plus a delay) while rendering, then renders silence.
+ *
+ * Applied over the final output (after resampling, float conversion and such), so positions are output samples
+ * and match get_vgmstream_play_samples. Renders before the fade are left untouched, so it costs nothing until
+ * the end of the song. The gain ramp is the one frontends used to apply by themselves. */
+
+typedef struct {
+    int32_t fade_start;     /* output sample where gain starts to go down */
+    int32_t fade_samples;   /* 0 if disabled after being set (still tracks position) */
+    int32_t position;       /* current output sample */
+} fade_t;
+
+
+static void fade_apply(fade_t * fd, VGMSTREAM * vgmstream, sample * buffer, int32_t start, int32_t samples, int32_t fade_pos) {
+    int channels = vgmstream->channels;
+    int ch;
+
+    if (vgmstream->f32_buffer) {
+        fade_channels_f32(vgmstream->f32_buffer + start * channels, channels, samples, fade_pos, fd->fade_samples);
+    }
+    else if (vgmstream->planar_buffer) {
+        for (ch = 0; ch < channels; ch++) {
+            fade_channels(vgmstream->planar_buffer[ch] + start, 1, samples, fade_pos, fd->fade_samples);
+        }
+    }
+    else {
+        fade_channels(buffer + start * channels, channels, samples, fade_pos, fd->fade_samples);
+    }
+}
+
+static void fade_silence(VGMSTREAM * vgmstream, sample * buffer, int32_t start, int32_t samples) {
+    int channels = vgmstream->channels;
+    int ch;
+
+    if (vgmstream->f32_buffer) {
+        memset(vgmstream->f32_buffer + start * channels, 0, samples * channels * sizeof(float));
+    }
+    else if (vgmstream->planar_buffer) {
+        for (ch = 0; ch < channels; ch++) {
+            memset(vgmstream->planar_buffer[ch] + start, 0, samples * sizeof(sample));
+        }
+    }
+    else {
+        memset(buffer + start * channels, 0, samples * channels * sizeof(sample));
+    }
+}
+
+void render_vgmstream_faded(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    fade_t * fd = vgmstream->fade;
+    int32_t position = fd->position;
+    int32_t fade_end = fd->fade_start + fd->fade_samples;
+    int32_t start, end;
+
+    vgmstream->fade = NULL;
+    render_vgmstream(buffer, sample_count, vgmstream);
+    vgmstream->fade = fd;
+
+    fd->position += sample_count;
+    if (fd->fade_samples <= 0 || fd->position <= fd->fade_start)
+        return;
+
+    /* gain ramp over the part inside the fade, silence after it */
+    start = position < fd->fade_start ? fd->fade_start - position : 0;
+    end = position + sample_count > fade_end ? fade_end - position : sample_count;
+    if (end < start)
+        end = start;
+
+    if (end > start)
+        fade_apply(fd, vgmstream, buffer, start, end - start, position + start - fd->fade_start);
+    if (sample_count > end)
+        fade_silence(vgmstream, buffer, end, sample_count - end);
+}
+
+void seek_vgmstream_faded(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    fade_t * fd = vgmstream->fade;
+
+    vgmstream->fade = NULL;
+    seek_vgmstream(vgmstream, seek_sample);
+    vgmstream->fade = fd;
+
+    fd->position = seek_sample;
+}
+
+void reset_fade(void * fade) {
+    fade_t * fd = fade;
+
+    fd->position = 0;
+}
+
+void free_fade(void * fade) {
+    free(fade);
+}
+
+int vgmstream_set_play_config(VGMSTREAM * vgmstream, double loop_count, double fade_seconds, double fade_delay_seconds) {
+    fade_t * fd;
+    int32_t play_samples = 0, fade_samples = 0;
+
+    if (!vgmstream)
+        return 0;
+    if (loop_count < 0.0 || fade_delay_seconds < 0.0)
+        return 0;
+
+    /* nothing to fade (also when playing the stream end after a loop target) */
+    if (vgmstream->loop_flag && fade_seconds > 0.0 && !(vgmstream->loop_target && vgmstream->loop_target == (int)loop_count)) {
+        play_samples = get_vgmstream_play_samples(loop_count, fade_seconds, fade_delay_seconds, vgmstream);
+        fade_samples = (int32_t)(fade_seconds * vgmstream_get_output_rate(vgmstream));
+    }
+
+    fd = vgmstream->fade;
+    if (!fd) {
+        if (fade_samples <= 0)
+            return 1;
+
+        /* starts from the beginning, while changing config later keeps the current position */
+        fd = calloc(1, sizeof(fade_t));
+        if (!fd) return 0;
+        vgmstream->fade = fd;
+    }
+
+    fd->fade_samples = fade_samples > 0 ? fade_samples : 0;
+    fd->fade_start = fade_samples > 0 ? play_samples - fade_samples : 0;
+    return 1;
+}
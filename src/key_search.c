@@ -0,0 +1,383 @@
+#include "vgmstream.h"
+
+/* Key search: encrypted formats without a keyfile test known keys until one works, which for some formats
+ * (FSB: a whole init per key) can take a while.
+ *
+ * Keys are tested over threads, each one pulling the next key in list order, and keys after one that can't be
+ * beaten aren't tested. As all keys before it are, results can be checked in list order and the chosen key is
+ * the same as testing one by one.
+ *
+ * Found keys may be remembered in a small text file (one "kind f|d id key" line each, hex), per file (hash of
+ * size and start) and per folder (hash of the path), so later files from the same game try that key first.
+ * Files are appended while there is room, and rewritten with the newest half when full. */
+
+#define KEY_CACHE_MAX_ENTRIES   512
+#define KEY_CACHE_KIND_MAX      8
+#define KEY_CACHE_KEY_MAX       0x100
+#define KEY_CACHE_HASH_SIZE     0x1000  /* file bytes hashed (header and some data) */
+#define KEY_CACHE_LINE_MAX      (KEY_CACHE_KIND_MAX + 3 + 16 + 1 + KEY_CACHE_KEY_MAX*2 + 2)
+
+typedef struct {
+    char kind[KEY_CACHE_KIND_MAX];
+    char type;          /* 'f': file, 'd': folder */
+    uint64_t id;
+    uint8_t key[KEY_CACHE_KEY_MAX];
+    size_t key_size;
+} key_cache_entry;
+
+/* process-wide config and cache (the cache mutex sleeps, as it's held during file I/O) */
+static vgm_lock_t key_search_lock;
+static int key_search_threads = 1;
+static vgm_once_t key_cache_once;
+static vgm_mutex * key_cache_mutex;
+static char * key_cache_filename;
+static int key_cache_loaded;
+static key_cache_entry * key_cache;
+static int key_cache_count;
+
+
+/* ************************************************************************* */
+
+typedef struct {
+    int (*test_key)(void *, int, int);
+    void * arg;
+    int stop_score;
+    int * scores;
+
+    vgm_lock_t lock;
+    int next_key;
+    int stop_key;       /* first key scoring stop_score so far */
+} key_search_job;
+
+static void key_search_worker(void * arg, int worker) {
+    key_search_job * job = arg;
+    int key_id, score, done;
+
+    while (1) {
+        vgm_lock(&job->lock);
+        key_id = job->next_key;
+        done = key_id >= job->stop_key;
+        if (!done)
+            job->next_key++;
+        vgm_unlock(&job->lock);
+
+        if (done)
+            break;
+
+        score = job->test_key(job->arg, worker, key_id);
+        job->scores[key_id] = score;
+
+        if (score == job->stop_score) {
+            vgm_lock(&job->lock);
+            if (key_id < job->stop_key)
+                job->stop_key = key_id;
+            vgm_unlock(&job->lock);
+        }
+    }
+}
+
+int key_search_get_workers(int keys) {
+    int threads;
+
+    vgm_lock(&key_search_lock);
+    threads = key_search_threads;
+    vgm_unlock(&key_search_lock);
+
+    if (threads > keys)
+        threads = keys;
+    if (threads < 1)
+        threads = 1;
+    return threads;
+}
+
+void key_search_run(int (*test_key)(void *, int, int), void * arg, int workers, int keys, int stop_score, int * scores) {
+    key_search_job job = {0};
+    vgm_pool * pool = NULL;
+    int i;
+
+    for (i = 0; i < keys; i++) {
+        scores[i] = -1;
+    }
+
+    job.test_key = test_key;
+    job.arg = arg;
+    job.stop_score = stop_score;
+    job.scores = scores;
+    job.next_key = 0;
+    job.stop_key = keys;
+
+    if (workers > 1)
+        pool = vgm_pool_init(workers);
+
+    if (pool) {
+        vgm_pool_run(pool, key_search_worker, &job, workers);
+        vgm_pool_free(pool);
+    }
+    else {
+        /* all keys from the first worker (its state is always set up) */
+        key_search_worker(&job, 0);
+    }
+}
+
+
+/* ************************************************************************* */
+
+static void key_cache_init(void) {
+    key_cache_mutex = vgm_mutex_init();
+}
+
+/* takes the cache mutex, 0 if not possible (cache can't be used then) */
+static int key_cache_lock(void) {
+    vgm_once(&key_cache_once, key_cache_init);
+    if (!key_cache_mutex)
+        return 0;
+    vgm_mutex_lock(key_cache_mutex);
+    return 1;
+}
+
+static uint64_t key_cache_hash(uint64_t hash, const uint8_t * buf, size_t size) {
+    size_t i;
+
+    for (i = 0; i < size; i++) { /* FNV-1a */
+        hash ^= buf[i];
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+static uint64_t key_cache_get_id(STREAMFILE * sf, char type) {
+    uint64_t hash = 0xCBF29CE484222325;
+
+    if (type == 'd') {
+        char path[PATH_LIMIT];
+
+        get_streamfile_path(sf, path, sizeof(path));
+        hash = key_cache_hash(hash, (const uint8_t *)path, strlen(path));
+    }
+    else {
+        uint8_t buf[KEY_CACHE_HASH_SIZE];
+        size_t bytes;
+
+        put_32bitLE(buf+0x00, (int32_t)get_streamfile_size(sf));
+        hash = key_cache_hash(hash, buf, 0x04);
+        bytes = read_streamfile(buf, 0x00, sizeof(buf), sf);
+        hash = key_cache_hash(hash, buf, bytes);
+    }
+
+    return hash;
+}
+
+static int key_cache_parse_hex(const char * str, uint8_t * buf, size_t buf_size) {
+    size_t len = strlen(str);
+    size_t i;
+
+    if (len == 0 || len % 2 || len / 2 > buf_size)
+        return 0;
+
+    for (i = 0; i < len; i++) {
+        int c = str[i], val;
+        if (c >= '0' && c <= '9')       val = c - '0';
+        else if (c >= 'a' && c <= 'f')  val = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')  val = c - 'A' + 10;
+        else return 0;
+
+        if (i % 2)
+            buf[i / 2] |= val;
+        else
+            buf[i / 2] = val << 4;
+    }
+    return len / 2;
+}
+
+static void key_cache_print_entry(FILE * file, key_cache_entry * entry) {
+    size_t i;
+
+    fprintf(file, "%s %c %08x%08x ", entry->kind, entry->type, (uint32_t)(entry->id >> 32), (uint32_t)entry->id);
+    for (i = 0; i < entry->key_size; i++) {
+        fprintf(file, "%02x", entry->key[i]);
+    }
+    fprintf(file, "\n");
+}
+
+/* reads the cache file once (mutex must be taken), bad lines are ignored */
+static void key_cache_load_file(void) {
+    char line[KEY_CACHE_LINE_MAX];
+    char kind[KEY_CACHE_LINE_MAX], type[KEY_CACHE_LINE_MAX], id[KEY_CACHE_LINE_MAX], key[KEY_CACHE_LINE_MAX];
+    FILE * file;
+
+    if (key_cache_loaded)
+        return;
+    key_cache_loaded = 1;
+
+    if (!key_cache) {
+        key_cache = malloc(KEY_CACHE_MAX_ENTRIES * sizeof(key_cache_entry));
+        if (!key_cache) return;
+    }
+    key_cache_count = 0;
+
+    file = fopen(key_cache_filename, "r");
+    if (!file)
+        return;
+
+    while (fgets(line, sizeof(line), file)) {
+        key_cache_entry entry;
+        uint8_t id_buf[0x08];
+
+        if (sscanf(line, "%s %s %s %s", kind, type, id, key) != 4)
+            continue;
+        if (strlen(kind) >= KEY_CACHE_KIND_MAX || (strcmp(type, "f") != 0 && strcmp(type, "d") != 0))
+            continue;
+        if (strlen(id) != 16 || !key_cache_parse_hex(id, id_buf, sizeof(id_buf)))
+            continue;
+        entry.key_size = key_cache_parse_hex(key, entry.key, sizeof(entry.key));
+        if (!entry.key_size)
+            continue;
+        strcpy(entry.kind, kind);
+        entry.type = type[0];
+        entry.id = (uint64_t)get_64bitBE(id_buf);
+
+        /* keep the newest entries */
+        if (key_cache_count == KEY_CACHE_MAX_ENTRIES) {
+            memmove(key_cache, key_cache + 1, (KEY_CACHE_MAX_ENTRIES - 1) * sizeof(key_cache_entry));
+            key_cache_count--;
+        }
+        key_cache[key_cache_count] = entry;
+        key_cache_count++;
+    }
+
+    fclose(file);
+}
+
+static key_cache_entry * key_cache_find(const char * kind, char type, uint64_t id) {
+    int i;
+
+    for (i = key_cache_count - 1; i >= 0; i--) { /* newest first */
+        key_cache_entry * entry = &key_cache[i];
+        if (entry->type == type && entry->id == id && strcmp(entry->kind, kind) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+size_t key_cache_load(STREAMFILE * sf, const char * kind, uint8_t * key, size_t key_max) {
+    key_cache_entry * entry = NULL;
+    uint64_t file_id, path_id;
+    size_t key_size = 0;
+
+    if (!key_cache_lock())
+        return 0;
+    if (!key_cache_filename) {
+        vgm_mutex_unlock(key_cache_mutex);
+        return 0;
+    }
+    vgm_mutex_unlock(key_cache_mutex);
+
+    /* reads outside the mutex, as the file may be slow */
+    file_id = key_cache_get_id(sf, 'f');
+    path_id = key_cache_get_id(sf, 'd');
+
+    vgm_mutex_lock(key_cache_mutex);
+    if (key_cache_filename) {
+        key_cache_load_file();
+
+        entry = key_cache_find(kind, 'f', file_id);
+        if (!entry)
+            entry = key_cache_find(kind, 'd', path_id);
+        if (entry && entry->key_size <= key_max) {
+            memcpy(key, entry->key, entry->key_size);
+            key_size = entry->key_size;
+        }
+    }
+    vgm_mutex_unlock(key_cache_mutex);
+
+    return key_size;
+}
+
+void key_cache_save(STREAMFILE * sf, const char * kind, const uint8_t * key, size_t key_size) {
+    key_cache_entry new_entries[2];
+    FILE * file = NULL;
+    int i;
+
+    if (strlen(kind) >= KEY_CACHE_KIND_MAX || key_size == 0 || key_size > KEY_CACHE_KEY_MAX)
+        return;
+
+    if (!key_cache_lock())
+        return;
+    if (!key_cache_filename) {
+        vgm_mutex_unlock(key_cache_mutex);
+        return;
+    }
+    vgm_mutex_unlock(key_cache_mutex);
+
+    for (i = 0; i < 2; i++) {
+        key_cache_entry * entry = &new_entries[i];
+        strcpy(entry->kind, kind);
+        entry->type = (i == 0) ? 'f' : 'd';
+        entry->id = key_cache_get_id(sf, entry->type);
+        memcpy(entry->key, key, key_size);
+        entry->key_size = key_size;
+    }
+
+    vgm_mutex_lock(key_cache_mutex);
+    if (!key_cache_filename)
+        goto done;
+    key_cache_load_file();
+    if (!key_cache)
+        goto done;
+
+    if (key_cache_count + 2 > KEY_CACHE_MAX_ENTRIES) {
+        /* full: drop the oldest half and rewrite */
+        int keep = KEY_CACHE_MAX_ENTRIES / 2 - 2;
+        memmove(key_cache, key_cache + key_cache_count - keep, keep * sizeof(key_cache_entry));
+        key_cache_count = keep;
+        memcpy(key_cache + key_cache_count, new_entries, sizeof(new_entries));
+        key_cache_count += 2;
+
+        file = fopen(key_cache_filename, "w");
+        if (!file) goto done;
+        for (i = 0; i < key_cache_count; i++) {
+            key_cache_print_entry(file, &key_cache[i]);
+        }
+    }
+    else {
+        memcpy(key_cache + key_cache_count, new_entries, sizeof(new_entries));
+        key_cache_count += 2;
+
+        file = fopen(key_cache_filename, "a");
+        if (!file) goto done;
+        for (i = 0; i < 2; i++) {
+            key_cache_print_entry(file, &new_entries[i]);
+        }
+    }
+
+done:
+    if (file) fclose(file);
+    vgm_mutex_unlock(key_cache_mutex);
+}
+
+void vgmstream_set_key_search(int threads, const char * cache_filename) {
+    char * filename = NULL;
+
+    if (cache_filename && cache_filename[0] != '\0') {
+        filename = malloc(strlen(cache_filename) + 1);
+        if (filename) strcpy(filename, cache_filename);
+    }
+
+    vgm_lock(&key_search_lock);
+    key_search_threads = threads < 1 ? 1 : threads;
+    vgm_unlock(&key_search_lock);
+
+    if (!key_cache_lock()) {
+        free(filename);
+        return;
+    }
+    free(key_cache_filename);
+    key_cache_filename = filename;
+    key_cache_loaded = 0;
+    key_cache_count = 0;
+    if (!filename) {
+        free(key_cache);
+        key_cache = NULL;
+    }
+    vgm_mutex_unlock(key_cache_mutex);
+}
@@ -55,6 +55,8 @@ void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM *
         samples_to_do = vgmstream_samples_to_do(samples_this_block, samples_per_frame, vgmstream);
         if (samples_to_do > sample_count - samples_written)
             samples_to_do = sample_count - samples_written;
+        if (vgmstream->seek_index)
+            samples_to_do = seek_index_samples_to_do(vgmstream, samples_to_do);
 
         if (samples_to_do > 0) {
             /* samples_this_block = 0 is allowed (empty block, do nothing then move to next block) */
@@ -85,6 +87,8 @@ void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM *
             vgmstream->samples_into_block = 0;
         }
 
+        if (vgmstream->seek_index)
+            seek_index_record(vgmstream);
     }
 }
 
@@ -23,7 +23,9 @@ void render_vgmstream_flat(sample * buffer, int32_t sample_count, VGMSTREAM * vg
         samples_to_do = vgmstream_samples_to_do(samples_this_block, samples_per_frame, vgmstream);
         if (samples_to_do > sample_count - samples_written)
             samples_to_do = sample_count - samples_written;
-        
+        if (vgmstream->seek_index)
+            samples_to_do = seek_index_samples_to_do(vgmstream, samples_to_do);
+
         if (samples_to_do == 0) {
             VGM_LOG("layout_flat: wrong samples_to_do found\n");
             memset(buffer + samples_written*vgmstream->channels, 0, (sample_count - samples_written) * vgmstream->channels * sizeof(sample));
@@ -35,5 +37,8 @@ void render_vgmstream_flat(sample * buffer, int32_t sample_count, VGMSTREAM * vg
         samples_written += samples_to_do;
         vgmstream->current_sample += samples_to_do;
         vgmstream->samples_into_block += samples_to_do;
+
+        if (vgmstream->seek_index)
+            seek_index_record(vgmstream);
     }
 }
@@ -46,6 +46,8 @@ void render_vgmstream_interleave(sample * buffer, int32_t sample_count, VGMSTREA
         samples_to_do = vgmstream_samples_to_do(samples_this_block, samples_per_frame, vgmstream);
         if (samples_to_do > sample_count - samples_written)
             samples_to_do = sample_count - samples_written;
+        if (vgmstream->seek_index)
+            samples_to_do = seek_index_samples_to_do(vgmstream, samples_to_do);
 
         if (samples_to_do == 0) { /* happens when interleave is not set */
             VGM_LOG("layout_interleave: wrong samples_to_do found\n");
@@ -89,5 +91,7 @@ void render_vgmstream_interleave(sample * buffer, int32_t sample_count, VGMSTREA
             vgmstream->samples_into_block = 0;
         }
 
+        if (vgmstream->seek_index)
+            seek_index_record(vgmstream);
     }
 }
@@ -5,6 +5,10 @@
 /* NOTE: if loop settings change the layered vgmstreams must be notified (preferably using vgmstream_force_loop) */
 #define LAYER_BUF_SIZE 512
 #define LAYER_MAX_CHANNELS 6 /* at least 2, but let's be generous */
+#define LAYER_PARALLEL_BUF_SIZE 0x1000 /* bigger chunks so threads sync less often */
+#define LAYER_PARALLEL_MAX_BUF_SIZE 0x40000
+
+static void render_layered_parallel(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
 
 /* Decodes samples for layered streams.
  * Similar to interleave layout, but decodec samples are mixed from complete vgmstreams, each
@@ -13,8 +17,12 @@
 void render_vgmstream_layered(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
     int samples_written = 0;
     layered_layout_data *data = vgmstream->layout_data;
-    sample interleave_buf[LAYER_BUF_SIZE*LAYER_MAX_CHANNELS];
+    sample * layer_planar[VGMSTREAM_MAX_CHANNELS];
 
+    if (data->pool) {
+        render_layered_parallel(buffer, sample_count, vgmstream);
+        return;
+    }
 
     while (samples_written < sample_count) {
         int samples_to_do = LAYER_BUF_SIZE;
@@ -24,23 +32,43 @@ void render_vgmstream_layered(sample * buffer, int32_t sample_count, VGMSTREAM *
             samples_to_do = sample_count - samples_written;
 
         for (layer = 0; layer < data->layer_count; layer++) {
-            int s, layer_ch;
             int layer_channels = data->layers[layer]->channels;
 
             /* each layer will handle its own looping internally */
 
-            render_vgmstream(interleave_buf, samples_to_do, data->layers[layer]);
+            if (vgmstream->planar_buffer) {
+                /* rendering to planar: layers write to their channels' buffers directly */
+                int layer_ch;
+                for (layer_ch = 0; layer_ch < layer_channels; layer_ch++) {
+                    layer_planar[layer_ch] = vgmstream->planar_buffer[ch + layer_ch] + samples_written;
+                }
 
-            /* mix layer samples to main samples */
-            for (layer_ch = 0; layer_ch < layer_channels; layer_ch++) {
-                for (s = 0; s < samples_to_do; s++) {
-                    size_t layer_sample = s*layer_channels + layer_ch;
-                    size_t buffer_sample = (samples_written+s)*vgmstream->channels + ch;
+                data->layers[layer]->planar_buffer = layer_planar;
+                render_vgmstream(data->buffer, samples_to_do, data->layers[layer]);
+                data->layers[layer]->planar_buffer = NULL;
 
-                    buffer[buffer_sample] = interleave_buf[layer_sample];
-                }
-                ch++;
+                ch += layer_channels;
+                continue;
             }
+
+            if (vgmstream->f32_buffer) {
+                /* rendering to float: layers output float, 16-bit buffers are ignored */
+                data->layers[layer]->f32_buffer = data->buffer_f32;
+                render_vgmstream(data->buffer, samples_to_do, data->layers[layer]);
+                data->layers[layer]->f32_buffer = NULL;
+
+                copy_channels_f32(vgmstream->f32_buffer + samples_written*vgmstream->channels, vgmstream->channels, ch,
+                        data->buffer_f32, layer_channels, samples_to_do);
+                ch += layer_channels;
+                continue;
+            }
+
+            render_vgmstream(data->buffer, samples_to_do, data->layers[layer]);
+
+            /* mix layer samples to main samples */
+            copy_channels(buffer + samples_written*vgmstream->channels, vgmstream->channels, ch,
+                    data->buffer, layer_channels, samples_to_do);
+            ch += layer_channels;
         }
 
         samples_written += samples_to_do;
@@ -49,6 +77,164 @@ void render_vgmstream_layered(sample * buffer, int32_t sample_count, VGMSTREAM *
     }
 }
 
+/* decodes the current chunk of one layer (called from the pool's threads) */
+static void render_layer_chunk(void * arg, int layer) {
+    VGMSTREAM * vgmstream = arg;
+    layered_layout_data *data = vgmstream->layout_data;
+    VGMSTREAM * layer_vgmstream = data->layers[layer];
+    int i, ch = 0;
+
+    if (vgmstream->planar_buffer) {
+        for (i = 0; i < layer; i++) {
+            ch += data->layers[i]->channels;
+        }
+        layer_vgmstream->planar_buffer = &data->chunk_planar[ch];
+    }
+    else if (vgmstream->f32_buffer) {
+        layer_vgmstream->f32_buffer = data->layer_buffers_f32[layer];
+    }
+
+    render_vgmstream(data->layer_buffers[layer], data->chunk_samples, layer_vgmstream);
+
+    layer_vgmstream->planar_buffer = NULL;
+    layer_vgmstream->f32_buffer = NULL;
+}
+
+/* Same as the above, but all layers decode a (bigger) chunk at once, then are mixed in order.
+ * Layers are independent vgmstreams, so the only shared state is the output. */
+static void render_layered_parallel(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    int samples_written = 0;
+    layered_layout_data *data = vgmstream->layout_data;
+
+    while (samples_written < sample_count) {
+        int samples_to_do = data->chunk_size;
+        int layer, ch = 0;
+
+        if (samples_to_do > sample_count - samples_written)
+            samples_to_do = sample_count - samples_written;
+
+        if (vgmstream->planar_buffer) {
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                data->chunk_planar[ch] = vgmstream->planar_buffer[ch] + samples_written;
+            }
+        }
+
+        data->chunk_samples = samples_to_do;
+        vgm_pool_run(data->pool, render_layer_chunk, vgmstream, data->layer_count);
+
+        /* planar layers already wrote to their channels */
+        if (!vgmstream->planar_buffer) {
+            ch = 0;
+            for (layer = 0; layer < data->layer_count; layer++) {
+                int layer_channels = data->layers[layer]->channels;
+
+                if (vgmstream->f32_buffer) {
+                    copy_channels_f32(vgmstream->f32_buffer + samples_written*vgmstream->channels, vgmstream->channels, ch,
+                            data->layer_buffers_f32[layer], layer_channels, samples_to_do);
+                }
+                else {
+                    copy_channels(buffer + samples_written*vgmstream->channels, vgmstream->channels, ch,
+                            data->layer_buffers[layer], layer_channels, samples_to_do);
+                }
+                ch += layer_channels;
+            }
+        }
+
+        samples_written += samples_to_do;
+        vgmstream->current_sample = data->layers[0]->current_sample;
+    }
+}
+
+static void free_layered_parallel(layered_layout_data *data) {
+    int i;
+
+    vgm_pool_free(data->pool);
+    data->pool = NULL;
+
+    for (i = 0; i < data->layer_count; i++) {
+        if (data->layer_buffers) free(data->layer_buffers[i]);
+        if (data->layer_buffers_f32) free(data->layer_buffers_f32[i]);
+    }
+    free(data->layer_buffers);
+    free(data->layer_buffers_f32);
+    data->layer_buffers = NULL;
+    data->layer_buffers_f32 = NULL;
+}
+
+/* layers decoding at once can't read from the same STREAMFILE (normally each layer opens its own) */
+static int layers_share_streamfiles(layered_layout_data *data) {
+    int i, j, ch, ch2;
+
+    for (i = 0; i < data->layer_count; i++) {
+        for (ch = 0; ch < data->layers[i]->channels; ch++) {
+            STREAMFILE *sf = data->layers[i]->ch[ch].streamfile;
+            if (!sf) continue;
+
+            for (j = i + 1; j < data->layer_count; j++) {
+                for (ch2 = 0; ch2 < data->layers[j]->channels; ch2++) {
+                    if (data->layers[j]->ch[ch2].streamfile == sf)
+                        return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int vgmstream_set_layer_threads(VGMSTREAM * vgmstream, int threads, int32_t buffer_samples) {
+    layered_layout_data *data;
+    int i, channels = 0;
+
+    /* only the main layout: nested layers (or layers in segments) would multiply the threads */
+    if (!vgmstream || vgmstream->layout_type != layout_layered)
+        return 0;
+    data = vgmstream->layout_data;
+
+    free_layered_parallel(data);
+
+    if (threads > data->layer_count)
+        threads = data->layer_count;
+    if (threads <= 1 || data->layer_count <= 1)
+        return 1; /* sequential */
+
+    if (buffer_samples <= 0)
+        buffer_samples = LAYER_PARALLEL_BUF_SIZE;
+    if (buffer_samples > LAYER_PARALLEL_MAX_BUF_SIZE)
+        goto fail;
+
+    for (i = 0; i < data->layer_count; i++) {
+        channels += data->layers[i]->channels;
+    }
+    if (channels > VGMSTREAM_MAX_CHANNELS)
+        goto fail;
+
+    if (layers_share_streamfiles(data)) {
+        VGM_LOG("layered layout: layers share streamfiles, can't decode in parallel\n");
+        goto fail;
+    }
+
+    data->layer_buffers = calloc(data->layer_count, sizeof(sample*));
+    data->layer_buffers_f32 = calloc(data->layer_count, sizeof(float*));
+    if (!data->layer_buffers || !data->layer_buffers_f32) goto fail;
+
+    for (i = 0; i < data->layer_count; i++) {
+        size_t layer_samples = buffer_samples * data->layers[i]->channels;
+        data->layer_buffers[i] = malloc(layer_samples * sizeof(sample));
+        data->layer_buffers_f32[i] = malloc(layer_samples * sizeof(float));
+        if (!data->layer_buffers[i] || !data->layer_buffers_f32[i]) goto fail;
+    }
+
+    data->pool = vgm_pool_init(threads);
+    if (!data->pool) goto fail;
+
+    data->chunk_size = buffer_samples;
+    return 1;
+fail:
+    free_layered_parallel(data);
+    return 0;
+}
+
 
 layered_layout_data* init_layout_layered(int layer_count) {
     layered_layout_data *data = NULL;
@@ -71,7 +257,7 @@ fail:
 }
 
 int setup_layout_layered(layered_layout_data* data) {
-    int i;
+    int i, max_channels = 0;
 
     /* setup each VGMSTREAM (roughly equivalent to vgmstream.c's init_vgmstream_internal stuff) */
     for (i = 0; i < data->layer_count; i++) {
@@ -83,6 +269,8 @@ int setup_layout_layered(layered_layout_data* data) {
 
         if (data->layers[i]->channels > LAYER_MAX_CHANNELS)
             goto fail;
+        if (data->layers[i]->channels > max_channels)
+            max_channels = data->layers[i]->channels;
 
         if (i > 0) {
             /* a bit weird, but no matter */
@@ -103,6 +291,14 @@ int setup_layout_layered(layered_layout_data* data) {
         memcpy(data->layers[i]->start_vgmstream,data->layers[i],sizeof(VGMSTREAM));
     }
 
+    /* layer buffers (allocated here rather than on the stack during render) */
+    free(data->buffer);
+    free(data->buffer_f32);
+    data->buffer = malloc(LAYER_BUF_SIZE * max_channels * sizeof(sample));
+    data->buffer_f32 = malloc(LAYER_BUF_SIZE * max_channels * sizeof(float));
+    if (!data->buffer || !data->buffer_f32)
+        goto fail;
+
     return 1;
 fail:
     return 0; /* caller is expected to free */
@@ -120,6 +316,9 @@ void free_layout_layered(layered_layout_data *data) {
         }
         free(data->layers);
     }
+    free_layered_parallel(data);
+    free(data->buffer);
+    free(data->buffer_f32);
     free(data);
 }
 
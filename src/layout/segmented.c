@@ -2,12 +2,130 @@
 #include "../vgmstream.h"
 
 
+#define SEGMENT_LOOKAHEAD 0x200 /* samples decoded from the next segment before it starts */
+
+
+/* Finds the segment where loop start falls, and how far into it */
+static int find_loop_segment(VGMSTREAM * vgmstream, int32_t * p_samples_skip) {
+    segmented_layout_data *data = vgmstream->layout_data;
+    int loop_segment = 0;
+    int32_t samples = 0;
+
+    while (loop_segment < data->segment_count) {
+        int32_t segment_samples = data->segments[loop_segment]->num_samples;
+        if (vgmstream->loop_start_sample >= samples && vgmstream->loop_start_sample < samples + segment_samples) {
+            *p_samples_skip = vgmstream->loop_start_sample - samples;
+            return loop_segment; /* loop_start falls within loop_segment's samples */
+        }
+        samples += segment_samples;
+        loop_segment++;
+    }
+
+    VGM_LOG("segmented_layout: can't find loop segment\n");
+    *p_samples_skip = 0;
+    return 0;
+}
+
+/* Starts playing a segment from some sample, using the lookahead if it was prepared for it
+ * (seeking to a sample inside the segment decodes it from the start, so its cost isn't bounded) */
+static void change_segment(VGMSTREAM * vgmstream, int segment, int32_t samples_skip) {
+    segmented_layout_data *data = vgmstream->layout_data;
+
+    data->lookahead_samples = 0;
+    if (data->next_ready && data->next_segment == segment && data->next_samples_skip == samples_skip
+            && data->next_is_f32 == (vgmstream->f32_buffer != NULL)) {
+        data->lookahead_samples = data->next_samples;
+        data->lookahead_offset = 0;
+    }
+    else if (samples_skip > 0) {
+        seek_vgmstream(data->segments[segment], samples_skip);
+    }
+    else {
+        reset_vgmstream(data->segments[segment]);
+    }
+
+    data->next_ready = 0;
+    data->current_segment = segment;
+    vgmstream->samples_into_block = samples_skip;
+}
+
+/* Resets and decodes a bit of the segment after the current one, if the change would happen during the next
+ * render (assuming the same size), so that render doesn't pay for resetting/priming the decoder. This render
+ * pays instead (sample_count + reset + lookahead): the worst case per call is the same, the work just moves
+ * off the call with the segment change. */
+static void prepare_next_segment(VGMSTREAM * vgmstream, int32_t sample_count) {
+    segmented_layout_data *data = vgmstream->layout_data;
+    VGMSTREAM * next;
+    int segment = data->current_segment + 1;
+    int32_t samples_skip = 0, samples_left;
+
+    if (data->next_ready || data->lookahead_samples > 0)
+        return;
+
+    samples_left = data->segments[data->current_segment]->num_samples - vgmstream->samples_into_block;
+
+    /* loop end comes first (and will loop) */
+    if (vgmstream->loop_flag && vgmstream->loop_end_sample - vgmstream->current_sample <= samples_left &&
+            !(vgmstream->loop_target && vgmstream->loop_target == vgmstream->loop_count + 1)) {
+        samples_left = vgmstream->loop_end_sample - vgmstream->current_sample;
+        segment = find_loop_segment(vgmstream, &samples_skip);
+    }
+
+    if (samples_left > sample_count)
+        return;
+    if (segment >= data->segment_count || segment == data->current_segment)
+        return; /* stream end, or would reset the playing segment */
+
+    next = data->segments[segment];
+    if (samples_skip > 0)
+        seek_vgmstream(next, samples_skip);
+    else
+        reset_vgmstream(next);
+
+    data->next_samples = next->num_samples - samples_skip;
+    if (data->next_samples > SEGMENT_LOOKAHEAD)
+        data->next_samples = SEGMENT_LOOKAHEAD;
+    data->next_is_f32 = (vgmstream->f32_buffer != NULL);
+
+    /* planar renders take 16-bit lookahead (same samples) */
+    next->f32_buffer = data->next_is_f32 ? data->lookahead_f32 : NULL;
+    render_vgmstream(data->lookahead, data->next_samples, next);
+    next->f32_buffer = NULL;
+
+    data->next_segment = segment;
+    data->next_samples_skip = samples_skip;
+    data->next_ready = 1;
+}
+
+/* Copies samples decoded ahead of time to the current output */
+static void copy_lookahead(VGMSTREAM * vgmstream, sample * buffer, int32_t samples_written, int32_t samples_to_do) {
+    segmented_layout_data *data = vgmstream->layout_data;
+    int channels = vgmstream->channels;
+
+    if (vgmstream->f32_buffer) {
+        memcpy(vgmstream->f32_buffer + samples_written * channels, data->lookahead_f32 + data->lookahead_offset * channels,
+                samples_to_do * channels * sizeof(float));
+    }
+    else if (vgmstream->planar_buffer) {
+        split_channels(vgmstream->planar_buffer, samples_written, data->lookahead + data->lookahead_offset * channels,
+                channels, samples_to_do);
+    }
+    else {
+        memcpy(buffer + samples_written * channels, data->lookahead + data->lookahead_offset * channels,
+                samples_to_do * channels * sizeof(sample));
+    }
+
+    data->lookahead_offset += samples_to_do;
+    data->lookahead_samples -= samples_to_do;
+}
+
 /* Decodes samples for segmented streams.
  * Chains together sequential vgmstreams, for data divided into separate sections or files
  * (like one part for intro and other for loop segments, which may even use different codecs). */
 void render_vgmstream_segmented(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
     int samples_written = 0;
     segmented_layout_data *data = vgmstream->layout_data;
+    sample * segment_planar[VGMSTREAM_MAX_CHANNELS];
 
 
     while (samples_written < sample_count) {
@@ -16,29 +134,11 @@ void render_vgmstream_segmented(sample * buffer, int32_t sample_count, VGMSTREAM
 
 
         if (vgmstream->loop_flag && vgmstream_do_loop(vgmstream)) {
-            /* handle looping, finding loop segment */
-            int loop_segment = 0, samples = 0, loop_samples_skip = 0;
-            while (samples < vgmstream->num_samples) {
-                int32_t segment_samples = data->segments[loop_segment]->num_samples;
-                if (vgmstream->loop_start_sample >= samples && vgmstream->loop_start_sample < samples + segment_samples) {
-                    loop_samples_skip = vgmstream->loop_start_sample - samples;
-                    break; /* loop_start falls within loop_segment's samples */
-                }
-                samples += segment_samples;
-                loop_segment++;
-            }
-            if (loop_segment == data->segment_count) {
-                VGM_LOG("segmented_layout: can't find loop segment\n");
-                loop_segment = 0;
-            }
-            if (loop_samples_skip > 0) {
-                VGM_LOG("segmented_layout: loop starts after %i samples\n", loop_samples_skip);
-                //todo skip/fix, but probably won't happen
-            }
+            /* handle looping, finding loop segment (loop start may fall anywhere in it) */
+            int32_t loop_samples_skip;
+            int loop_segment = find_loop_segment(vgmstream, &loop_samples_skip);
 
-            data->current_segment = loop_segment;
-            reset_vgmstream(data->segments[data->current_segment]);
-            vgmstream->samples_into_block = 0;
+            change_segment(vgmstream, loop_segment, loop_samples_skip);
             continue;
         }
 
@@ -48,21 +148,47 @@ void render_vgmstream_segmented(sample * buffer, int32_t sample_count, VGMSTREAM
 
         /* detect segment change and restart */
         if (samples_to_do == 0) {
-            data->current_segment++;
-            reset_vgmstream(data->segments[data->current_segment]);
-            vgmstream->samples_into_block = 0;
+            change_segment(vgmstream, data->current_segment + 1, 0);
             continue;
         }
 
-        render_vgmstream(&buffer[samples_written*data->segments[data->current_segment]->channels],
-                samples_to_do,data->segments[data->current_segment]);
+        if (data->lookahead_samples > 0 && data->next_is_f32 != (vgmstream->f32_buffer != NULL)) {
+            /* rendering to another format than the lookahead (unusual): resume decoding after the used part */
+            seek_vgmstream(data->segments[data->current_segment], vgmstream->samples_into_block);
+            data->lookahead_samples = 0;
+        }
+
+        if (data->lookahead_samples > 0) {
+            if (samples_to_do > data->lookahead_samples)
+                samples_to_do = data->lookahead_samples;
+            copy_lookahead(vgmstream, buffer, samples_written, samples_to_do);
+        }
+        else {
+            /* when rendering to float/planar each segment writes its part directly (may use a different codec) */
+            if (vgmstream->f32_buffer)
+                data->segments[data->current_segment]->f32_buffer = &vgmstream->f32_buffer[samples_written*vgmstream->channels];
+            if (vgmstream->planar_buffer) {
+                int ch;
+                for (ch = 0; ch < vgmstream->channels; ch++) {
+                    segment_planar[ch] = vgmstream->planar_buffer[ch] + samples_written;
+                }
+                data->segments[data->current_segment]->planar_buffer = segment_planar;
+            }
+
+            render_vgmstream(&buffer[samples_written*data->segments[data->current_segment]->channels],
+                    samples_to_do,data->segments[data->current_segment]);
+
+            data->segments[data->current_segment]->f32_buffer = NULL;
+            data->segments[data->current_segment]->planar_buffer = NULL;
+        }
 
         samples_written += samples_to_do;
         vgmstream->current_sample += samples_to_do;
         vgmstream->samples_into_block += samples_to_do;
     }
-}
 
+    prepare_next_segment(vgmstream, sample_count);
+}
 
 segmented_layout_data* init_layout_segmented(int segment_count) {
     segmented_layout_data *data = NULL;
@@ -121,6 +247,13 @@ int setup_layout_segmented(segmented_layout_data* data) {
         memcpy(data->segments[i]->start_vgmstream,data->segments[i],sizeof(VGMSTREAM));
     }
 
+    /* lookahead buffers (allocated here rather than during render) */
+    free(data->lookahead);
+    free(data->lookahead_f32);
+    data->lookahead = malloc(SEGMENT_LOOKAHEAD * data->segments[0]->channels * sizeof(sample));
+    data->lookahead_f32 = malloc(SEGMENT_LOOKAHEAD * data->segments[0]->channels * sizeof(float));
+    if (!data->lookahead || !data->lookahead_f32)
+        goto fail;
 
     return 1;
 fail:
@@ -139,17 +272,18 @@ void free_layout_segmented(segmented_layout_data *data) {
         }
         free(data->segments);
     }
+    free(data->lookahead);
+    free(data->lookahead_f32);
     free(data);
 }
 
 void reset_layout_segmented(segmented_layout_data *data) {
-    int i;
-
     if (!data)
         return;
 
+    /* other segments are reset when changing to them */
     data->current_segment = 0;
-    for (i = 0; i < data->segment_count; i++) {
-        reset_vgmstream(data->segments[i]);
-    }
+    data->next_ready = 0;
+    data->lookahead_samples = 0;
+    reset_vgmstream(data->segments[0]);
 }
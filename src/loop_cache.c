@@ -0,0 +1,316 @@
+#include "vgmstream.h"
+
+/* Loop cache: keeps one decoded pass of the loop in memory, so later loops are copied rather than decoded.
+ *
+ * The kept pass is captured while rendering, in order from loop start (decodes are split at loop end, so the
+ * position of each chunk is known). Once complete, any render that would start a new loop (VGMSTREAM waiting
+ * at loop end) is served from memory instead. Meanwhile the decoder stays at loop end and only loop_count
+ * advances, as vgmstream_do_loop would, so decoding can resume at any loop boundary (last loop before a loop
+ * target, another output format) or be synced mid-loop by decoding up to the current position. */
+
+#define LOOP_CACHE_DEFAULT_SIZE (64*1024*1024)
+
+typedef struct {
+    loop_cache_policy_t policy;
+    int channels;
+    int32_t loop_start;
+    int32_t loop_end;
+    int capture_looped; /* keep a pass that starts by looping, rather than one coming from the intro */
+
+    void * buf;         /* loop samples * channels, in either format (NULL if the loop doesn't fit) */
+    size_t buf_size;
+    int can_f32;        /* buf fits float samples */
+    int is_f32;         /* format of the kept samples */
+    int32_t filled;     /* samples kept from loop start */
+    int32_t offset;     /* position in the loop being served from memory (0 if none) */
+
+    int64_t samples_served;
+    int64_t samples_decoded;
+} loop_cache_t;
+
+
+/* loop points may change after setting the cache (vgmstream_force_loop and such), making it useless */
+static int loop_cache_is_usable(loop_cache_t * lc, VGMSTREAM * vgmstream) {
+    return lc->buf &&
+            lc->loop_start == vgmstream->loop_start_sample &&
+            lc->loop_end == vgmstream->loop_end_sample &&
+            lc->channels == vgmstream->channels;
+}
+
+static int loop_cache_can_serve(loop_cache_t * lc, VGMSTREAM * vgmstream) {
+    int is_f32 = vgmstream->f32_buffer != NULL;
+
+    if (lc->filled < lc->loop_end - lc->loop_start || lc->is_f32 != is_f32)
+        return 0;
+    if (lc->offset > 0)
+        return 1;
+
+    /* next render would loop (unless it's the last loop and continues to the end instead) */
+    if (!vgmstream->loop_flag || vgmstream->current_sample != lc->loop_end)
+        return 0;
+    if (vgmstream->loop_target && vgmstream->loop_target == vgmstream->loop_count + 1)
+        return 0;
+    return 1;
+}
+
+static void loop_cache_serve(loop_cache_t * lc, VGMSTREAM * vgmstream, sample * buffer, int32_t samples_done, int32_t samples_to_do) {
+    int channels = lc->channels;
+
+    if (vgmstream->f32_buffer) {
+        float * buf = lc->buf;
+        memcpy(vgmstream->f32_buffer + samples_done * channels, buf + lc->offset * channels, samples_to_do * channels * sizeof(float));
+    }
+    else if (vgmstream->planar_buffer) {
+        sample * buf = lc->buf;
+        split_channels(vgmstream->planar_buffer, samples_done, buf + lc->offset * channels, channels, samples_to_do);
+    }
+    else {
+        sample * buf = lc->buf;
+        memcpy(buffer + samples_done * channels, buf + lc->offset * channels, samples_to_do * channels * sizeof(sample));
+    }
+
+    lc->offset += samples_to_do;
+    if (lc->offset == lc->loop_end - lc->loop_start) {
+        lc->offset = 0;
+        vgmstream->loop_count++;
+    }
+    vgmstream->play_sample += samples_to_do;
+    lc->samples_served += samples_to_do;
+}
+
+/* keeps the part of the last rendered chunk that continues the current capture */
+static void loop_cache_capture(loop_cache_t * lc, VGMSTREAM * vgmstream, sample * buffer, float * f32_buffer, sample ** planar_buffer, int32_t samples, int from_loop) {
+    int32_t end = vgmstream->current_sample;
+    int32_t start = end - samples;
+    int32_t skip = 0, pos;
+    int is_f32 = f32_buffer != NULL;
+    int channels = lc->channels;
+    int ch, s;
+
+    if (lc->filled == lc->loop_end - lc->loop_start)
+        return;
+    if (is_f32 && !lc->can_f32)
+        return;
+    if (start < 0 || end <= lc->loop_start || end > lc->loop_end)
+        return;
+
+    if (start < lc->loop_start) {
+        skip = lc->loop_start - start;
+        start = lc->loop_start;
+    }
+
+    pos = start - lc->loop_start;
+    if (pos == 0) {
+        /* (re)start capturing at loop start if it's the wanted pass, in this pass' format */
+        lc->filled = 0;
+        lc->is_f32 = is_f32;
+        if (from_loop != lc->capture_looped)
+            return;
+    }
+    else if (pos != lc->filled || is_f32 != lc->is_f32) {
+        /* gap (seeked into the loop) or format change: wait for a pass from loop start */
+        lc->filled = 0;
+        return;
+    }
+
+    samples -= skip;
+    if (is_f32) {
+        float * buf = lc->buf;
+        memcpy(buf + pos * channels, f32_buffer + skip * channels, samples * channels * sizeof(float));
+    }
+    else if (planar_buffer) {
+        sample * buf = (sample *)lc->buf + pos * channels;
+        for (ch = 0; ch < channels; ch++) {
+            for (s = 0; s < samples; s++) {
+                buf[s * channels + ch] = planar_buffer[ch][skip + s];
+            }
+        }
+    }
+    else {
+        sample * buf = lc->buf;
+        memcpy(buf + pos * channels, buffer + skip * channels, samples * channels * sizeof(sample));
+    }
+    lc->filled += samples;
+}
+
+void render_vgmstream_loop_cached(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    loop_cache_t * lc = vgmstream->loop_cache;
+    float * f32_buffer = vgmstream->f32_buffer;
+    sample ** planar_buffer = vgmstream->planar_buffer;
+    sample * planar_chunk[VGMSTREAM_MAX_CHANNELS];
+    int channels = vgmstream->channels;
+    int32_t loop_length = lc->loop_end - lc->loop_start;
+    int32_t samples_done = 0;
+    int ch;
+
+    /* the stream below decodes normally */
+    vgmstream->loop_cache = NULL;
+
+    if (!loop_cache_is_usable(lc, vgmstream)) {
+        render_vgmstream(buffer, sample_count, vgmstream);
+        lc->samples_decoded += sample_count;
+        vgmstream->loop_cache = lc;
+        return;
+    }
+
+    while (samples_done < sample_count) {
+        int32_t samples_to_do = sample_count - samples_done;
+
+        if (lc->offset > 0 && !loop_cache_can_serve(lc, vgmstream)) {
+            /* output format changed mid-loop: decode up to the current position */
+            int32_t play_sample = vgmstream->play_sample;
+            vgmstream->play_sample -= lc->offset;
+            lc->offset = 0;
+
+            vgmstream->f32_buffer = NULL;
+            vgmstream->planar_buffer = NULL;
+            seek_vgmstream(vgmstream, play_sample);
+            vgmstream->f32_buffer = f32_buffer;
+            vgmstream->planar_buffer = planar_buffer;
+        }
+
+        if (loop_cache_can_serve(lc, vgmstream)) {
+            if (samples_to_do > loop_length - lc->offset)
+                samples_to_do = loop_length - lc->offset;
+
+            loop_cache_serve(lc, vgmstream, buffer, samples_done, samples_to_do);
+        }
+        else {
+            /* starting by looping (seeks may also reach loop start from the intro with any loop_count) */
+            int from_loop = vgmstream->loop_flag && vgmstream->current_sample == lc->loop_end;
+
+            /* decode up to loop end at most, so the position of every chunk is known */
+            if (vgmstream->loop_flag) {
+                int32_t samples_left = vgmstream->current_sample < lc->loop_end ?
+                        lc->loop_end - vgmstream->current_sample : loop_length;
+                if (samples_to_do > samples_left)
+                    samples_to_do = samples_left;
+            }
+
+            if (f32_buffer)
+                vgmstream->f32_buffer = f32_buffer + samples_done * channels;
+            if (planar_buffer) {
+                for (ch = 0; ch < channels; ch++) {
+                    planar_chunk[ch] = planar_buffer[ch] + samples_done;
+                }
+                vgmstream->planar_buffer = planar_chunk;
+            }
+
+            render_vgmstream(buffer + samples_done * channels, samples_to_do, vgmstream);
+            loop_cache_capture(lc, vgmstream, buffer + samples_done * channels, vgmstream->f32_buffer, vgmstream->planar_buffer, samples_to_do, from_loop);
+
+            vgmstream->f32_buffer = f32_buffer;
+            vgmstream->planar_buffer = planar_buffer;
+            lc->samples_decoded += samples_to_do;
+        }
+
+        samples_done += samples_to_do;
+    }
+
+    vgmstream->loop_cache = lc;
+}
+
+int32_t loop_cache_get_samples_left(VGMSTREAM * vgmstream) {
+    loop_cache_t * lc = vgmstream->loop_cache;
+
+    if (!lc || !loop_cache_is_usable(lc, vgmstream) || !loop_cache_can_serve(lc, vgmstream))
+        return 0;
+    return lc->loop_end - lc->loop_start - lc->offset;
+}
+
+void sync_loop_cache(VGMSTREAM * vgmstream) {
+    loop_cache_t * lc = vgmstream->loop_cache;
+
+    /* the decoder is still at the loop end, where serving started */
+    vgmstream->play_sample -= lc->offset;
+    lc->offset = 0;
+}
+
+void reset_loop_cache(void * loop_cache) {
+    loop_cache_t * lc = loop_cache;
+
+    /* kept samples are still good */
+    lc->offset = 0;
+}
+
+void free_loop_cache(void * loop_cache) {
+    loop_cache_t * lc = loop_cache;
+
+    if (!lc)
+        return;
+    free(lc->buf);
+    free(lc);
+}
+
+int vgmstream_set_loop_cache(VGMSTREAM * vgmstream, loop_cache_policy_t policy, size_t max_size) {
+    loop_cache_t * lc = NULL;
+    size_t samples_size;
+
+    if (!vgmstream)
+        return 0;
+
+    if (vgmstream->loop_cache)
+        sync_loop_cache(vgmstream);
+    free_loop_cache(vgmstream->loop_cache);
+    vgmstream->loop_cache = NULL;
+
+    if (policy == loop_cache_off)
+        return 1;
+    if (policy != loop_cache_first_pass && policy != loop_cache_first_repeat)
+        goto fail;
+
+    /* layers loop by themselves */
+    if (!vgmstream->loop_flag || vgmstream->layout_type == layout_layered)
+        goto fail;
+    if (vgmstream->loop_end_sample <= vgmstream->loop_start_sample)
+        goto fail;
+
+    if (max_size == 0)
+        max_size = LOOP_CACHE_DEFAULT_SIZE;
+
+    lc = calloc(1, sizeof(loop_cache_t));
+    if (!lc) goto fail;
+
+    lc->policy = policy;
+    lc->channels = vgmstream->channels;
+    lc->loop_start = vgmstream->loop_start_sample;
+    lc->loop_end = vgmstream->loop_end_sample;
+    lc->capture_looped = (policy == loop_cache_first_repeat);
+
+    /* float if possible, otherwise only 16-bit output is kept; too big stays set (for stats) but decodes */
+    samples_size = (size_t)(lc->loop_end - lc->loop_start) * lc->channels;
+    if (samples_size * sizeof(float) <= max_size) {
+        lc->buf_size = samples_size * sizeof(float);
+        lc->can_f32 = 1;
+    }
+    else if (samples_size * sizeof(sample) <= max_size) {
+        lc->buf_size = samples_size * sizeof(sample);
+    }
+
+    if (lc->buf_size) {
+        lc->buf = malloc(lc->buf_size);
+        if (!lc->buf) goto fail;
+    }
+
+    vgmstream->loop_cache = lc;
+    return lc->buf != NULL;
+fail:
+    free_loop_cache(lc);
+    return 0;
+}
+
+void vgmstream_get_loop_cache_stats(VGMSTREAM * vgmstream, VGMSTREAM_LOOP_CACHE_STATS * stats) {
+    loop_cache_t * lc;
+
+    memset(stats, 0, sizeof(VGMSTREAM_LOOP_CACHE_STATS));
+    if (!vgmstream || !vgmstream->loop_cache)
+        return;
+    lc = vgmstream->loop_cache;
+
+    stats->policy = lc->policy;
+    stats->active = lc->buf != NULL;
+    stats->complete = lc->buf != NULL && lc->filled == lc->loop_end - lc->loop_start;
+    stats->size = lc->buf_size;
+    stats->samples_served = lc->samples_served;
+    stats->samples_decoded = lc->samples_decoded;
+}
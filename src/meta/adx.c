@@ -245,10 +245,29 @@ fail:
 }
 
 
+/* return 1 if the key decrypts the scales of the tested frames into expected values */
+static int test_adx_key(const uint16_t * prescales, int bruteframe, const uint16_t * scales, int scales_to_do, int keymask, uint16_t xor, uint16_t mul, uint16_t add) {
+    int i;
+
+    /* test vs prescales while xor looks valid */
+    for (i = 0; i < bruteframe && ((prescales[i] & keymask) == (xor & keymask) || prescales[i] == 0); i++) {
+        xor = xor * mul + add;
+    }
+    if (i != bruteframe)
+        return 0;
+
+    /* test vs scales while xor looks valid */
+    for (i = 0; i < scales_to_do && (scales[i] & keymask) == (xor & keymask); i++) {
+        xor = xor * mul + add;
+    }
+    return i == scales_to_do;
+}
+
 /* return 0 if not found, 1 if found and set parameters */
 static int find_adx_key(STREAMFILE *streamFile, uint8_t type, uint16_t *xor_start, uint16_t *xor_mult, uint16_t *xor_add) {
     uint16_t * scales = NULL;
     uint16_t * prescales = NULL;
+    const char * kind = (type == 8) ? "adx8" : "adx9";
     int bruteframe = 0, bruteframe_count = -1;
     int startoff, endoff;
     int i, rc = 0;
@@ -349,6 +368,26 @@ static int find_adx_key(STREAMFILE *streamFile, uint8_t type, uint16_t *xor_star
             keymask = 0x1000;
         }
 
+        /* key found before for this file or folder, if still good */
+        {
+            uint8_t keybuf[6];
+
+            if (key_cache_load(streamFile, kind, keybuf, sizeof(keybuf)) == 6) {
+                uint16_t xor = get_16bitBE(keybuf+0);
+                uint16_t mul = get_16bitBE(keybuf+2);
+                uint16_t add = get_16bitBE(keybuf+4);
+
+                if (test_adx_key(prescales, bruteframe, scales, scales_to_do, keymask, xor, mul, add)) {
+                    *xor_start = xor;
+                    *xor_mult = mul;
+                    *xor_add = add;
+
+                    rc = 1;
+                    goto find_key_cleanup;
+                }
+            }
+        }
+
         /* try all keys until one decrypts correctly vs expected values */
         for (key_id = 0; key_id < keycount; key_id++) {
             uint16_t key_xor, key_mul, key_add;
@@ -399,24 +438,20 @@ static int find_adx_key(STREAMFILE *streamFile, uint8_t type, uint16_t *xor_star
 #endif
 
 
-            /* test vs prescales while xor looks valid */
-            for (i = 0; i < bruteframe && ((prescales[i] & keymask) == (xor & keymask) || prescales[i] == 0); i++) {
-                xor = xor * mul + add;
-            }
-            if (i == bruteframe) {
-                /* test vs scales while xor looks valid */
-                for (i = 0; i < scales_to_do && (scales[i] & keymask) == (xor & keymask); i++) {
-                    xor = xor * mul + add;
-                }
-                /* key is good */
-                if (i == scales_to_do) {
-                    *xor_start = key_xor;
-                    *xor_mult = key_mul;
-                    *xor_add = key_add;
+            if (test_adx_key(prescales, bruteframe, scales, scales_to_do, keymask, xor, mul, add)) {
+                uint8_t keybuf[6];
 
-                    rc = 1;
-                    goto find_key_cleanup;
-                }
+                *xor_start = key_xor;
+                *xor_mult = key_mul;
+                *xor_add = key_add;
+
+                put_16bitBE(keybuf+0, key_xor);
+                put_16bitBE(keybuf+2, key_mul);
+                put_16bitBE(keybuf+4, key_add);
+                key_cache_save(streamFile, kind, keybuf, sizeof(keybuf));
+
+                rc = 1;
+                goto find_key_cleanup;
             }
         }
     }
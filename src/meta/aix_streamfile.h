@@ -150,6 +150,7 @@ static STREAMFILE *open_aix_impl(AIXSTREAMFILE *streamfile,const char * const fi
     streamfile->sf.get_name = (void*)get_name_aix;
     streamfile->sf.open = (void*)open_aix_impl;
     streamfile->sf.close = (void*)close_aix;
+    streamfile->sf.borrow = NULL; /* blocked data isn't contiguous */
 
     streamfile->real_file = file;
     streamfile->current_physical_offset = start_offset;
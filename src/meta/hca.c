@@ -2,7 +2,7 @@
 #include "hca_keys.h"
 #include "../coding/coding.h"
 
-static void find_hca_key(hca_codec_data * hca_data, unsigned long long * out_keycode);
+static void find_hca_key(hca_codec_data * hca_data, STREAMFILE *streamFile, unsigned long long * out_keycode);
 
 VGMSTREAM * init_vgmstream_hca(STREAMFILE *streamFile) {
     VGMSTREAM * vgmstream = NULL;
@@ -34,7 +34,7 @@ VGMSTREAM * init_vgmstream_hca(STREAMFILE *streamFile) {
             keycode = key * ( ((uint64_t)sub << 16u) | ((uint16_t)~sub + 2u) );
         }
         else {
-            find_hca_key(hca_data, &keycode);
+            find_hca_key(hca_data, streamFile, &keycode);
         }
 
         clHCA_SetKey(hca_data->handle, keycode); //maybe should be done through hca_decoder.c?
@@ -72,17 +72,20 @@ fail:
 }
 
 
-static inline void test_key(hca_codec_data * hca_data, uint64_t key, uint16_t subkey, int *best_score, uint64_t *best_keycode) {
-    int score;
+typedef struct {
+    hca_codec_data ** datas;    /* per worker */
+    uint64_t * keys;
+} hca_key_search;
 
-    if (subkey) {
-        key = key * ( ((uint64_t)subkey << 16u) | ((uint16_t)~subkey + 2u) );
-    }
+static int test_key_worker(void * arg, int worker, int key_id) {
+    hca_key_search * ks = arg;
+    return test_hca_key(ks->datas[worker], (unsigned long long)ks->keys[key_id]);
+}
 
-    score = test_hca_key(hca_data, (unsigned long long)key);
+static inline void update_best_key(int score, uint64_t key, int *best_score, uint64_t *best_keycode) {
 
-    //;VGM_LOG("HCA: test key=%08x%08x, subkey=%04x, score=%i\n",
-    //        (uint32_t)((key >> 32) & 0xFFFFFFFF), (uint32_t)(key & 0xFFFFFFFF), subkey, score);
+    //;VGM_LOG("HCA: test key=%08x%08x, score=%i\n",
+    //        (uint32_t)((key >> 32) & 0xFFFFFFFF), (uint32_t)(key & 0xFFFFFFFF), score);
 
     /* wrong key */
     if (score < 0)
@@ -96,14 +99,39 @@ static inline void test_key(hca_codec_data * hca_data, uint64_t key, uint16_t su
 }
 
 /* Try to find the decryption key from a list. */
-static void find_hca_key(hca_codec_data * hca_data, unsigned long long * out_keycode) {
+static void find_hca_key(hca_codec_data * hca_data, STREAMFILE *streamFile, unsigned long long * out_keycode) {
     const size_t keys_length = sizeof(hcakey_list) / sizeof(hcakey_info);
+    hca_key_search ks = {0};
+    uint64_t best_keycode = 0xCC55463930DBE1AB; /* defaults to PSO2 key, most common */
     int best_score = -1;
+    int * scores = NULL;
+    int keys_count = 0, workers = 0;
     int i,j;
 
-    *out_keycode = 0xCC55463930DBE1AB; /* defaults to PSO2 key, most common */
+    /* key found before for this file or folder, if still good (only a sure score, as
+     * folder keys may be wrong for some files and the search would find a better one) */
+    {
+        uint8_t keybuf[0x08];
+
+        if (key_cache_load(streamFile, "hca", keybuf, sizeof(keybuf)) == 0x08) {
+            uint64_t key = (uint64_t)get_64bitBE(keybuf);
+            if (test_hca_key(hca_data, (unsigned long long)key) == 1) {
+                *out_keycode = key;
+                return;
+            }
+        }
+    }
 
-    /* find a candidate key */
+    /* final keys (seed keys with each subkey) in list order */
+    for (i = 0; i < keys_length; i++) {
+        keys_count += hcakey_list[i].subkeys_size > 0 ? hcakey_list[i].subkeys_size : 1;
+    }
+
+    ks.keys = malloc(keys_count * sizeof(uint64_t));
+    scores = malloc(keys_count * sizeof(int));
+    if (!ks.keys || !scores) goto done;
+
+    keys_count = 0;
     for (i = 0; i < keys_length; i++) {
         uint64_t key = hcakey_list[i].key;
         size_t subkeys_size = hcakey_list[i].subkeys_size;
@@ -111,22 +139,59 @@ static void find_hca_key(hca_codec_data * hca_data, unsigned long long * out_key
 
         if (subkeys_size > 0) {
             for (j = 0; j < subkeys_size; j++) {
-                test_key(hca_data, key, subkeys[j], &best_score, out_keycode);
-                if (best_score == 1) /* best possible score */
-                    goto done;
+                uint16_t subkey = subkeys[j];
+                ks.keys[keys_count++] = key * ( ((uint64_t)subkey << 16u) | ((uint16_t)~subkey + 2u) );
             }
         }
         else {
-            test_key(hca_data, key, 0, &best_score, out_keycode);
-            if (best_score == 1) /* best possible score */
-                goto done;
+            ks.keys[keys_count++] = key;
         }
     }
 
+    /* each worker needs its own handle and reads */
+    workers = key_search_get_workers(keys_count);
+    ks.datas = calloc(workers, sizeof(hca_codec_data *));
+    if (!ks.datas) goto done;
+
+    ks.datas[0] = hca_data;
+    for (i = 1; i < workers; i++) {
+        ks.datas[i] = init_hca(streamFile);
+        if (!ks.datas[i]) break;
+    }
+    workers = i;
+
+    /* find a candidate key (first with the best possible score 1, or else the best one) */
+    key_search_run(test_key_worker, &ks, workers, keys_count, 1, scores);
+
+    for (i = 0; i < keys_count; i++) {
+        update_best_key(scores[i], ks.keys[i], &best_score, &best_keycode);
+        if (best_score == 1) /* best possible score */
+            break;
+    }
+
+    /* only sure keys are kept (score 0 may be any key over silence) */
+    if (best_score == 1) {
+        uint8_t keybuf[0x08];
+        put_32bitBE(keybuf+0x00, (int32_t)(best_keycode >> 32));
+        put_32bitBE(keybuf+0x04, (int32_t)(best_keycode >>  0));
+        key_cache_save(streamFile, "hca", keybuf, sizeof(keybuf));
+    }
+
 done:
+    *out_keycode = best_keycode;
+
     //;VGM_LOG("HCA: best key=%08x%08x (score=%i)\n",
     //        (uint32_t)((*out_keycode >> 32) & 0xFFFFFFFF), (uint32_t)(*out_keycode & 0xFFFFFFFF), best_score);
 
     VGM_ASSERT(best_score > 1, "HCA: best key=%08x%08x (score=%i)\n",
             (uint32_t)((*out_keycode >> 32) & 0xFFFFFFFF), (uint32_t)(*out_keycode & 0xFFFFFFFF), best_score);
+
+    if (ks.datas) {
+        for (i = 1; i < workers; i++) {
+            free_hca(ks.datas[i]);
+        }
+    }
+    free(ks.datas);
+    free(ks.keys);
+    free(scores);
 }
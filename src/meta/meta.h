@@ -188,10 +188,14 @@ VGMSTREAM * init_vgmstream_fsb(STREAMFILE * streamFile);
 VGMSTREAM * init_vgmstream_fsb4_wav(STREAMFILE * streamFile);
 
 VGMSTREAM * init_vgmstream_fsb5(STREAMFILE * streamFile);
+void * parse_fsb5_bank(STREAMFILE * streamFile, VGMSTREAM_BANK_ENTRY * directory, int subsongs);
+VGMSTREAM * init_vgmstream_fsb5_bank(STREAMFILE * streamFile, void * bank_data);
 
 VGMSTREAM * init_vgmstream_rwx(STREAMFILE * streamFile);
 
 VGMSTREAM * init_vgmstream_xwb(STREAMFILE * streamFile);
+void * parse_xwb_bank(STREAMFILE * streamFile, VGMSTREAM_BANK_ENTRY * directory, int subsongs);
+VGMSTREAM * init_vgmstream_xwb_bank(STREAMFILE * streamFile, void * bank_data);
 
 VGMSTREAM * init_vgmstream_ps2_xa30(STREAMFILE * streamFile);
 
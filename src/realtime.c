@@ -0,0 +1,117 @@
+#include "vgmstream.h"
+
+/* Real-time rendering: a thin layer over render_vgmstream that bounds work per call and uses a caller
+ * buffer for float/planar renders (that otherwise go through a stack buffer in chunks).
+ * Setup that may allocate (layout buffers, codec buffers) is done when opening the VGMSTREAM, so codecs
+ * with state in the VGMSTREAM or preallocated codec_data don't touch the heap while rendering. */
+
+/* codecs known to decode into buffers allocated on init (others use external libs that may allocate) */
+static int realtime_is_safe(VGMSTREAM * vgmstream) {
+    int i;
+
+    switch (vgmstream->layout_type) {
+        case layout_segmented: {
+            segmented_layout_data *data = vgmstream->layout_data;
+            for (i = 0; i < data->segment_count; i++) {
+                if (!realtime_is_safe(data->segments[i]))
+                    return 0;
+            }
+            return 1;
+        }
+
+        case layout_layered: {
+            layered_layout_data *data = vgmstream->layout_data;
+            for (i = 0; i < data->layer_count; i++) {
+                if (!realtime_is_safe(data->layers[i]))
+                    return 0;
+            }
+            return 1;
+        }
+
+        case layout_aix: {
+            aix_codec_data *data = vgmstream->codec_data;
+            for (i = 0; i < data->segment_count * data->stream_count; i++) {
+                if (!realtime_is_safe(data->adxs[i]))
+                    return 0;
+            }
+            return 1;
+        }
+
+        default:
+            break;
+    }
+
+    if (!vgmstream->codec_data)
+        return 1;
+
+    switch (vgmstream->coding_type) {
+        case coding_CRI_HCA:
+        case coding_ACM:
+        case coding_NWA:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+size_t vgmstream_realtime_get_scratch_size(VGMSTREAM * vgmstream, int32_t max_samples) {
+    if (!vgmstream || max_samples <= 0)
+        return 0;
+    return max_samples * vgmstream->channels * sizeof(sample);
+}
+
+int vgmstream_realtime_open(VGMSTREAM_REALTIME * rt, VGMSTREAM * vgmstream, int32_t max_samples, void * scratch, size_t scratch_size) {
+    if (!rt || !vgmstream || max_samples <= 0)
+        goto fail;
+    if (!scratch || scratch_size < vgmstream_realtime_get_scratch_size(vgmstream, max_samples))
+        goto fail;
+
+    rt->vgmstream = vgmstream;
+    rt->max_samples = max_samples;
+    rt->is_safe = realtime_is_safe(vgmstream);
+    rt->scratch = scratch;
+    return 1;
+fail:
+    return 0;
+}
+
+/* renders with the seek index detached, as recording points may need to grow it */
+static int32_t realtime_render(VGMSTREAM_REALTIME * rt, sample * buffer, int32_t sample_count) {
+    VGMSTREAM * vgmstream = rt->vgmstream;
+    void * seek_index = vgmstream->seek_index;
+
+    if (sample_count > rt->max_samples)
+        sample_count = rt->max_samples;
+    if (sample_count <= 0)
+        return 0;
+
+    vgmstream->seek_index = NULL;
+    render_vgmstream(buffer, sample_count, vgmstream);
+    vgmstream->seek_index = seek_index;
+
+    return sample_count;
+}
+
+int32_t vgmstream_realtime_render(VGMSTREAM_REALTIME * rt, sample * buffer, int32_t sample_count) {
+    return realtime_render(rt, buffer, sample_count);
+}
+
+int32_t vgmstream_realtime_render_f32(VGMSTREAM_REALTIME * rt, float * buffer, int32_t sample_count) {
+    int32_t samples_done;
+
+    rt->vgmstream->f32_buffer = buffer;
+    samples_done = realtime_render(rt, rt->scratch, sample_count);
+    rt->vgmstream->f32_buffer = NULL;
+
+    return samples_done;
+}
+
+int32_t vgmstream_realtime_render_planar(VGMSTREAM_REALTIME * rt, sample ** buffer, int32_t sample_count) {
+    int32_t samples_done;
+
+    rt->vgmstream->planar_buffer = buffer;
+    samples_done = realtime_render(rt, rt->scratch, sample_count);
+    rt->vgmstream->planar_buffer = NULL;
+
+    return samples_done;
+}
@@ -0,0 +1,405 @@
+#ifdef _MSC_VER
+#define _USE_MATH_DEFINES
+#endif
+#include <math.h>
+#include "vgmstream.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_NEON
+#endif
+
+/* Resampler: polyphase windowed-sinc (Kaiser) filter applied while rendering.
+ *
+ * The stream is rendered to float in blocks into per-channel lines, and each output sample is the dot product of
+ * a line's window with the filter phase for its fractional position. When the output rate (divided by the GCD of
+ * both rates) fits in the phase table each position has an exact phase, otherwise the two closest are interpolated.
+ * When downsampling the cutoff is lowered and the filter lengthened accordingly, to avoid aliasing.
+ *
+ * Positions given to render/seek are at output rate; the VGMSTREAM keeps working at its own rate below. */
+
+#define RESAMPLER_BLOCK     0x400   /* input samples rendered per fill */
+#define RESAMPLER_MAX_RATIO 8       /* max filter lengthening when downsampling */
+
+typedef struct {
+    int half_taps;
+    int max_phases;
+    double beta;        /* Kaiser window (stopband attenuation) */
+    double rolloff;     /* cutoff vs Nyquist (transition band) */
+} resampler_preset_t;
+
+static const resampler_preset_t resampler_presets[] = {
+        {  4,   64, 5.0, 0.85 }, /* fast */
+        {  8,  256, 7.0, 0.90 }, /* normal */
+        { 16,  512, 9.0, 0.94 }, /* best */
+};
+
+typedef struct {
+    int input_rate;     /* reduced by GCD */
+    int output_rate;    /* reduced by GCD */
+    int channels;
+
+    int taps;
+    int phases;
+    int interpolate;    /* phases don't match output positions */
+    float * table;      /* (phases + 1) * taps */
+    float * coefs;      /* interpolated phase */
+
+    float * lines;      /* per channel, line_size each */
+    int line_size;
+    int filled;         /* samples in lines (line_size is enough for a window + a block) */
+    int pos;            /* first sample of the current window */
+    int frac;           /* position between pos and pos+1, in output_rate units */
+
+    float * decode_f32; /* RESAMPLER_BLOCK samples rendered at once */
+    sample * decode_buf;
+} resampler_t;
+
+
+static int resampler_gcd(int a, int b) {
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* modified Bessel function of the first kind (order 0), for the Kaiser window */
+static double resampler_bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    int k;
+
+    for (k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+/* phase p of P is the filter for an output sample at pos + p/P (window starts half_taps - 1 samples before it) */
+static void resampler_make_table(resampler_t * rs, int half_taps, double cutoff, double beta) {
+    double i0_beta = resampler_bessel_i0(beta);
+    int p, k;
+
+    for (p = 0; p <= rs->phases; p++) {
+        float * row = rs->table + p * rs->taps;
+        double sum = 0.0;
+
+        for (k = 0; k < rs->taps; k++) {
+            double d = (double)p / rs->phases + half_taps - 1 - k; /* distance to the output position */
+            double x = d / half_taps;
+            double h = (d == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * d) / (M_PI * d);
+            double w = (x <= -1.0 || x >= 1.0) ? 0.0 : resampler_bessel_i0(beta * sqrt(1.0 - x * x)) / i0_beta;
+
+            row[k] = (float)(h * w);
+            sum += row[k];
+        }
+
+        /* unity gain for every phase, so there is no ripple on DC */
+        for (k = 0; k < rs->taps; k++) {
+            row[k] = (float)(row[k] / sum);
+        }
+    }
+}
+
+static float resampler_dot(const float * coefs, const float * x, int taps) {
+    int i = 0;
+    float sum = 0.0f;
+
+#if defined(RESAMPLER_SSE2)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= taps; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(coefs + i + 0), _mm_loadu_ps(x + i + 0)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(coefs + i + 4), _mm_loadu_ps(x + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 0x55));
+    sum = _mm_cvtss_f32(acc0);
+#elif defined(RESAMPLER_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x2_t acc;
+    for (; i + 8 <= taps; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(coefs + i + 0), vld1q_f32(x + i + 0));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(coefs + i + 4), vld1q_f32(x + i + 4));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+    acc = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    sum = vget_lane_f32(vpadd_f32(acc, acc), 0);
+#endif
+
+    for (; i < taps; i++) {
+        sum += coefs[i] * x[i];
+    }
+    return sum;
+}
+
+static sample resampler_clamp(float v) {
+    float s = v * 32768.0f;
+    if (s >= 32767.0f)
+        return 32767;
+    if (s <= -32768.0f)
+        return -32768;
+    return (sample)(s >= 0.0f ? s + 0.5f : s - 0.5f);
+}
+
+/* silence before the stream start, so the first window is centered on sample 0 */
+static void resampler_clear(resampler_t * rs, int skip) {
+    int ch;
+    int zeros = rs->taps / 2 - 1 - skip;
+    if (zeros < 0) zeros = 0;
+
+    for (ch = 0; ch < rs->channels; ch++) {
+        memset(rs->lines + ch * rs->line_size, 0, zeros * sizeof(float));
+    }
+    rs->filled = zeros;
+    rs->pos = 0;
+    rs->frac = 0;
+}
+
+/* samples that can be rendered before the stream end (the filter reads ahead, but not all layouts can go past it) */
+static int32_t resampler_get_samples_left(VGMSTREAM * vgmstream) {
+    if (vgmstream->loop_flag) {
+        int32_t cached_samples = loop_cache_get_samples_left(vgmstream); /* decoder waits at loop end meanwhile */
+        if (cached_samples > 0)
+            return cached_samples;
+        if (vgmstream->current_sample < vgmstream->loop_end_sample)
+            return vgmstream->loop_end_sample - vgmstream->current_sample;
+        return 1; /* loops on next render (or continues to the end with a loop target) */
+    }
+    return vgmstream->num_samples - vgmstream->current_sample;
+}
+
+/* render to decode_f32 (through the float path, so float codecs aren't rounded), silence after the stream end */
+static void resampler_render(resampler_t * rs, VGMSTREAM * vgmstream, int samples_to_do) {
+    int samples_done = 0;
+
+    while (samples_done < samples_to_do) {
+        int32_t samples_left = resampler_get_samples_left(vgmstream);
+        int samples = samples_to_do - samples_done;
+
+        if (samples_left <= 0) {
+            memset(rs->decode_f32 + samples_done * rs->channels, 0, samples * rs->channels * sizeof(float));
+            break;
+        }
+        if (samples > samples_left)
+            samples = samples_left;
+
+        vgmstream->f32_buffer = rs->decode_f32 + samples_done * rs->channels;
+        render_vgmstream(rs->decode_buf, samples, vgmstream);
+        vgmstream->f32_buffer = NULL;
+
+        samples_done += samples;
+    }
+}
+
+/* drop used samples and render a new block */
+static void resampler_fill(resampler_t * rs, VGMSTREAM * vgmstream) {
+    int ch, s, samples_to_do = RESAMPLER_BLOCK;
+
+    if (rs->pos >= rs->filled) {
+        /* big downsampling steps may skip past the lines */
+        rs->pos -= rs->filled;
+        rs->filled = 0;
+        while (rs->pos > 0) {
+            int samples_to_skip = rs->pos > RESAMPLER_BLOCK ? RESAMPLER_BLOCK : rs->pos;
+            resampler_render(rs, vgmstream, samples_to_skip);
+            rs->pos -= samples_to_skip;
+        }
+    }
+    else if (rs->pos > 0) {
+        for (ch = 0; ch < rs->channels; ch++) {
+            float * line = rs->lines + ch * rs->line_size;
+            memmove(line, line + rs->pos, (rs->filled - rs->pos) * sizeof(float));
+        }
+        rs->filled -= rs->pos;
+        rs->pos = 0;
+    }
+
+    resampler_render(rs, vgmstream, samples_to_do);
+
+    for (ch = 0; ch < rs->channels; ch++) {
+        float * line = rs->lines + ch * rs->line_size + rs->filled;
+        for (s = 0; s < samples_to_do; s++) {
+            line[s] = rs->decode_f32[s * rs->channels + ch];
+        }
+    }
+    rs->filled += samples_to_do;
+}
+
+static const float * resampler_get_coefs(resampler_t * rs) {
+    int k;
+    int64_t phase_pos;
+    int phase;
+    float f;
+    const float * row_a, * row_b;
+
+    if (!rs->interpolate)
+        return rs->table + rs->frac * rs->taps;
+
+    phase_pos = (int64_t)rs->frac * rs->phases;
+    phase = (int)(phase_pos / rs->output_rate);
+    f = (float)(phase_pos % rs->output_rate) / rs->output_rate;
+    row_a = rs->table + phase * rs->taps;
+    row_b = row_a + rs->taps;
+
+    for (k = 0; k < rs->taps; k++) {
+        rs->coefs[k] = row_a[k] + (row_b[k] - row_a[k]) * f;
+    }
+    return rs->coefs;
+}
+
+void render_vgmstream_resampled(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    resampler_t * rs = vgmstream->resampler;
+    float * f32_buffer = vgmstream->f32_buffer;
+    sample ** planar_buffer = vgmstream->planar_buffer;
+    int channels = rs->channels;
+    int32_t s;
+    int ch;
+
+    /* the stream below renders at its own rate to the lines */
+    vgmstream->resampler = NULL;
+    vgmstream->planar_buffer = NULL;
+
+    for (s = 0; s < sample_count; s++) {
+        const float * coefs;
+
+        if (rs->pos + rs->taps > rs->filled)
+            resampler_fill(rs, vgmstream);
+
+        coefs = resampler_get_coefs(rs);
+        for (ch = 0; ch < channels; ch++) {
+            float v = resampler_dot(coefs, rs->lines + ch * rs->line_size + rs->pos, rs->taps);
+
+            if (f32_buffer)
+                f32_buffer[s * channels + ch] = v;
+            else if (planar_buffer)
+                planar_buffer[ch][s] = resampler_clamp(v);
+            else
+                buffer[s * channels + ch] = resampler_clamp(v);
+        }
+
+        rs->frac += rs->input_rate;
+        rs->pos += rs->frac / rs->output_rate;
+        rs->frac = rs->frac % rs->output_rate;
+    }
+
+    vgmstream->resampler = rs;
+    vgmstream->f32_buffer = f32_buffer;
+    vgmstream->planar_buffer = planar_buffer;
+}
+
+void seek_vgmstream_resampled(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    resampler_t * rs = vgmstream->resampler;
+    int64_t position = (int64_t)seek_sample * rs->input_rate;
+    int32_t input_sample = (int32_t)(position / rs->output_rate);
+    int preroll = rs->taps / 2 - 1;
+
+    if (preroll > input_sample)
+        preroll = input_sample;
+
+    /* seek the stream a window before, so the filter has past samples */
+    vgmstream->resampler = NULL;
+    seek_vgmstream(vgmstream, input_sample - preroll);
+    vgmstream->resampler = rs;
+
+    resampler_clear(rs, preroll);
+    rs->frac = (int)(position % rs->output_rate);
+}
+
+void reset_resampler(void * resampler) {
+    resampler_clear(resampler, 0);
+}
+
+void free_resampler(void * resampler) {
+    resampler_t * rs = resampler;
+    if (!rs) return;
+
+    free(rs->table);
+    free(rs->coefs);
+    free(rs->lines);
+    free(rs->decode_f32);
+    free(rs->decode_buf);
+    free(rs);
+}
+
+int vgmstream_set_output_rate(VGMSTREAM * vgmstream, int output_rate, resample_t quality) {
+    resampler_t * rs = NULL;
+    const resampler_preset_t * preset;
+    int gcd, half_taps;
+    double cutoff;
+
+    if (!vgmstream)
+        goto fail;
+
+    free_resampler(vgmstream->resampler);
+    vgmstream->resampler = NULL;
+
+    if (output_rate <= 0 || output_rate == vgmstream->sample_rate)
+        return 1; /* disabled */
+    if (output_rate < 300 || output_rate > 192000)
+        goto fail;
+    if (quality < resample_fast || quality > resample_best)
+        quality = resample_normal;
+    preset = &resampler_presets[quality];
+
+    rs = calloc(1, sizeof(resampler_t));
+    if (!rs) goto fail;
+
+    gcd = resampler_gcd(vgmstream->sample_rate, output_rate);
+    rs->input_rate = vgmstream->sample_rate / gcd;
+    rs->output_rate = output_rate / gcd;
+    rs->channels = vgmstream->channels;
+
+    /* downsampling: lower cutoff to the output's Nyquist, and lengthen the filter to keep the transition band */
+    half_taps = preset->half_taps;
+    cutoff = 0.5 * preset->rolloff;
+    if (output_rate < vgmstream->sample_rate) {
+        double ratio = (double)vgmstream->sample_rate / output_rate;
+        if (ratio > RESAMPLER_MAX_RATIO)
+            ratio = RESAMPLER_MAX_RATIO;
+        half_taps = ((int)ceil(half_taps * ratio) + 1) / 2 * 2; /* taps multiple of 4 for SIMD */
+        cutoff = cutoff * output_rate / vgmstream->sample_rate;
+    }
+    rs->taps = half_taps * 2;
+
+    rs->interpolate = rs->output_rate > preset->max_phases;
+    rs->phases = rs->interpolate ? preset->max_phases : rs->output_rate;
+
+    rs->table = malloc((rs->phases + 1) * rs->taps * sizeof(float));
+    rs->coefs = malloc(rs->taps * sizeof(float));
+    rs->line_size = rs->taps + RESAMPLER_BLOCK;
+    rs->lines = malloc(rs->channels * rs->line_size * sizeof(float));
+    rs->decode_f32 = malloc(rs->channels * RESAMPLER_BLOCK * sizeof(float));
+    rs->decode_buf = malloc(rs->channels * RESAMPLER_BLOCK * sizeof(sample));
+    if (!rs->table || !rs->coefs || !rs->lines || !rs->decode_f32 || !rs->decode_buf)
+        goto fail;
+
+    resampler_make_table(rs, half_taps, cutoff, preset->beta);
+    resampler_clear(rs, 0);
+
+    vgmstream->resampler = rs;
+    return 1;
+fail:
+    free_resampler(rs);
+    return 0;
+}
+
+int vgmstream_get_output_rate(VGMSTREAM * vgmstream) {
+    resampler_t * rs = vgmstream->resampler;
+    int gcd;
+
+    if (!rs)
+        return vgmstream->sample_rate;
+    gcd = vgmstream->sample_rate / rs->input_rate;
+    return rs->output_rate * gcd;
+}
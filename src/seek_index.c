@@ -0,0 +1,463 @@
+#include "vgmstream.h"
+
+/* Seek index: decoder state (channels and layout/block state) saved every N samples while rendering,
+ * so codecs that depend on previous samples (ADPCM history and such) can seek by restoring the closest
+ * point and decoding up to N samples, rather than decoding from the start.
+ *
+ * Points are separated into first pass (start to stream end) and loop pass (loop start to loop end after
+ * looping at least once), as some formats keep history when looping and decode slightly differently.
+ *
+ * Only usable with codecs/layouts whose state lives in the VGMSTREAM itself (no codec_data/layout_data). */
+
+#define SEEK_INDEX_DEFAULT_INTERVAL  0x2000  /* samples */
+#define SEEK_INDEX_ID                0x56475349 /* "VGSI" */
+#define SEEK_INDEX_VERSION           2
+#define SEEK_INDEX_HEADER_SIZE       0x20
+#define SEEK_INDEX_POINT_SIZE        0x30
+#define SEEK_INDEX_CHANNEL_SIZE      0x68
+
+typedef struct {
+    int32_t current_sample;
+    int loop_pass;
+
+    int32_t samples_into_block;
+    off_t current_block_offset;
+    size_t current_block_size;
+    size_t current_block_samples;
+    off_t next_block_offset;
+    size_t full_block_size;
+    int32_t ws_output_size;
+    int codec_config;
+
+    VGMSTREAMCHANNEL * ch;
+} seek_point_t;
+
+typedef struct {
+    int32_t interval;
+
+    seek_point_t * points;
+    int points_count;
+    int points_max;
+} seek_index_t;
+
+
+int seek_index_is_usable(VGMSTREAM * vgmstream) {
+    if (!vgmstream->seek_index)
+        return 0;
+    if (vgmstream->codec_data || vgmstream->layout_data)
+        return 0;
+    if (vgmstream->layout_type == layout_aix ||
+        vgmstream->layout_type == layout_segmented ||
+        vgmstream->layout_type == layout_layered)
+        return 0;
+    return 1;
+}
+
+static int seek_index_is_loop_pass(VGMSTREAM * vgmstream, int32_t sample) {
+    return vgmstream->loop_count > 0 &&
+            sample >= vgmstream->loop_start_sample &&
+            sample < vgmstream->loop_end_sample;
+}
+
+/* points are sorted by pass then sample */
+static int seek_index_compare(const seek_point_t * point, int loop_pass, int32_t sample) {
+    if (point->loop_pass != loop_pass)
+        return point->loop_pass - loop_pass;
+    return point->current_sample - sample;
+}
+
+/* adds an empty point (keeping the order), or returns NULL if one for that pass/interval exists already */
+static seek_point_t * seek_index_add_point(seek_index_t * index, int channels, int loop_pass, int32_t sample) {
+    seek_point_t * point;
+    int pos;
+
+    pos = index->points_count;
+    while (pos > 0 && seek_index_compare(&index->points[pos-1], loop_pass, sample) > 0) {
+        pos--;
+    }
+
+    if (pos > 0) {
+        seek_point_t * prev = &index->points[pos-1];
+        if (prev->loop_pass == loop_pass && prev->current_sample / index->interval == sample / index->interval)
+            return NULL;
+    }
+    if (pos < index->points_count) {
+        seek_point_t * next = &index->points[pos];
+        if (next->loop_pass == loop_pass && next->current_sample / index->interval == sample / index->interval)
+            return NULL;
+    }
+
+    if (index->points_count == index->points_max) {
+        int points_max = index->points_max ? index->points_max * 2 : 0x100;
+        seek_point_t * points = realloc(index->points, points_max * sizeof(seek_point_t));
+        if (!points) return NULL;
+
+        index->points = points;
+        index->points_max = points_max;
+    }
+
+    point = &index->points[pos];
+    memmove(point + 1, point, (index->points_count - pos) * sizeof(seek_point_t));
+    memset(point, 0, sizeof(seek_point_t));
+
+    point->ch = calloc(channels, sizeof(VGMSTREAMCHANNEL));
+    if (!point->ch) {
+        memmove(point, point + 1, (index->points_count - pos) * sizeof(seek_point_t));
+        return NULL;
+    }
+    point->current_sample = sample;
+    point->loop_pass = loop_pass;
+
+    index->points_count++;
+    return point;
+}
+
+static void seek_index_save_state(seek_point_t * point, VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * ch) {
+    point->samples_into_block = vgmstream->samples_into_block;
+    point->current_block_offset = vgmstream->current_block_offset;
+    point->current_block_size = vgmstream->current_block_size;
+    point->current_block_samples = vgmstream->current_block_samples;
+    point->next_block_offset = vgmstream->next_block_offset;
+    point->full_block_size = vgmstream->full_block_size;
+    point->ws_output_size = vgmstream->ws_output_size;
+    point->codec_config = vgmstream->codec_config;
+    memcpy(point->ch, ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+}
+
+void free_seek_index(void * seek_index) {
+    seek_index_t * index = seek_index;
+    int i;
+
+    if (!index) return;
+
+    for (i = 0; i < index->points_count; i++) {
+        free(index->points[i].ch);
+    }
+    free(index->points);
+    free(index);
+}
+
+int vgmstream_enable_seek_index(VGMSTREAM * vgmstream, int32_t interval) {
+    VGMSTREAM * start_vgmstream;
+    seek_index_t * index;
+    seek_point_t * point;
+
+    if (!vgmstream) return 0;
+    if (vgmstream->seek_index)
+        return 1;
+    if (interval <= 0)
+        interval = SEEK_INDEX_DEFAULT_INTERVAL;
+
+    index = calloc(1, sizeof(seek_index_t));
+    if (!index) goto fail;
+    index->interval = interval;
+
+    /* first point is the stream start, so there is always something to restore */
+    start_vgmstream = vgmstream->start_vgmstream;
+    point = seek_index_add_point(index, vgmstream->channels, 0, start_vgmstream->current_sample);
+    if (!point) goto fail;
+    seek_index_save_state(point, start_vgmstream, vgmstream->start_ch);
+
+    /* set in the start copy too, as resets restore it */
+    vgmstream->seek_index = index;
+    start_vgmstream->seek_index = index;
+
+    if (!seek_index_is_usable(vgmstream)) {
+        VGM_LOG("SEEK INDEX: not usable with this codec/layout\n");
+    }
+    return 1;
+
+fail:
+    free_seek_index(index);
+    return 0;
+}
+
+/* limits samples to decode so layouts stop at the next interval boundary, where points are recorded */
+int32_t seek_index_samples_to_do(VGMSTREAM * vgmstream, int32_t samples_to_do) {
+    int32_t interval, samples_left;
+
+    if (!seek_index_is_usable(vgmstream))
+        return samples_to_do;
+
+    interval = ((seek_index_t *)vgmstream->seek_index)->interval;
+    samples_left = interval - vgmstream->current_sample % interval;
+    return samples_to_do > samples_left ? samples_left : samples_to_do;
+}
+
+/* called by layouts after decoding (and moving to the next block, if needed) */
+void seek_index_record(VGMSTREAM * vgmstream) {
+    seek_index_t * index = vgmstream->seek_index;
+    seek_point_t * point;
+    int loop_pass;
+
+    if (!seek_index_is_usable(vgmstream))
+        return;
+    if (vgmstream->current_sample % index->interval != 0)
+        return;
+
+    loop_pass = seek_index_is_loop_pass(vgmstream, vgmstream->current_sample);
+    point = seek_index_add_point(index, vgmstream->channels, loop_pass, vgmstream->current_sample);
+    if (!point) return;
+
+    seek_index_save_state(point, vgmstream, vgmstream->ch);
+}
+
+int32_t seek_index_restore(VGMSTREAM * vgmstream, int32_t seek_sample, int loop_pass) {
+    seek_index_t * index = vgmstream->seek_index;
+    seek_point_t * best = NULL;
+    int i;
+
+    for (i = 0; i < index->points_count; i++) {
+        seek_point_t * point = &index->points[i];
+        if (point->loop_pass != loop_pass || point->current_sample > seek_sample)
+            continue;
+        best = point;
+    }
+    if (!best) /* no loop pass point yet (first pass always has the start point) */
+        return -1;
+
+    vgmstream->current_sample = best->current_sample;
+    vgmstream->samples_into_block = best->samples_into_block;
+    vgmstream->current_block_offset = best->current_block_offset;
+    vgmstream->current_block_size = best->current_block_size;
+    vgmstream->current_block_samples = best->current_block_samples;
+    vgmstream->next_block_offset = best->next_block_offset;
+    vgmstream->full_block_size = best->full_block_size;
+    vgmstream->ws_output_size = best->ws_output_size;
+    vgmstream->codec_config = best->codec_config;
+    memcpy(vgmstream->ch, best->ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+
+    return best->current_sample;
+}
+
+static void seek_index_render(VGMSTREAM * vgmstream, int32_t samples) {
+    sample buf[0x2000];
+    int32_t max_samples = sizeof(buf) / sizeof(sample) / vgmstream->channels;
+
+    while (samples > 0) {
+        int32_t samples_to_do = samples > max_samples ? max_samples : samples;
+        render_vgmstream(buf, samples_to_do, vgmstream);
+        samples -= samples_to_do;
+    }
+}
+
+void vgmstream_build_seek_index(VGMSTREAM * vgmstream) {
+    int loop_flag;
+
+    if (!vgmstream || !seek_index_is_usable(vgmstream))
+        return;
+
+    /* first pass, up to the stream end */
+    seek_vgmstream(vgmstream, 0);
+    loop_flag = vgmstream->loop_flag;
+    vgmstream->loop_flag = 0;
+    seek_index_render(vgmstream, vgmstream->num_samples);
+    vgmstream->loop_flag = loop_flag;
+
+    /* loop pass */
+    if (loop_flag) {
+        seek_vgmstream(vgmstream, 0);
+        seek_index_render(vgmstream, vgmstream->loop_end_sample * 2 - vgmstream->loop_start_sample);
+    }
+
+    seek_vgmstream(vgmstream, 0);
+}
+
+
+/* Sidecar format (little endian):
+ * - header: id, version, channels, num_samples, coding_type, layout_type, interval, points count
+ * - per point: samples/block state, then per channel: offsets and decoder state
+ * Values that are set on init (coefs, streamfiles, etc) are taken from the stream's start state.
+ * Offsets are stored as 64-bit. */
+
+static void seek_index_put_channel(uint8_t * buf, VGMSTREAMCHANNEL * ch) {
+    int i;
+
+    put_64bitLE(buf+0x00, ch->offset);
+    put_64bitLE(buf+0x08, ch->frame_header_offset);
+    put_32bitLE(buf+0x10, ch->samples_left_in_frame);
+    for (i = 0; i < 16; i++) {
+        put_16bitLE(buf+0x14 + i*0x02, ch->adpcm_coef[i]);
+    }
+    put_32bitLE(buf+0x34, ch->adpcm_history1_32);
+    put_32bitLE(buf+0x38, ch->adpcm_history2_32);
+    put_32bitLE(buf+0x3c, ch->adpcm_history3_32);
+    put_32bitLE(buf+0x40, ch->adpcm_history4_32);
+    memcpy(buf+0x44, &ch->adpcm_history1_double, 0x08); /* native, but this is just a cache */
+    memcpy(buf+0x4c, &ch->adpcm_history2_double, 0x08);
+    put_32bitLE(buf+0x54, ch->adpcm_step_index);
+    put_32bitLE(buf+0x58, ch->adpcm_scale);
+    put_32bitLE(buf+0x5c, ch->adx_channels);
+    put_16bitLE(buf+0x60, ch->adx_xor);
+    put_16bitLE(buf+0x62, ch->adx_mult);
+    put_16bitLE(buf+0x64, ch->adx_add);
+    memset(buf+0x66, 0, SEEK_INDEX_CHANNEL_SIZE - 0x66);
+}
+
+static void seek_index_get_channel(uint8_t * buf, VGMSTREAMCHANNEL * ch) {
+    int i;
+
+    ch->offset = get_64bitLE(buf+0x00);
+    ch->frame_header_offset = get_64bitLE(buf+0x08);
+    ch->samples_left_in_frame = get_32bitLE(buf+0x10);
+    for (i = 0; i < 16; i++) {
+        ch->adpcm_coef[i] = get_16bitLE(buf+0x14 + i*0x02);
+    }
+    ch->adpcm_history1_32 = get_32bitLE(buf+0x34);
+    ch->adpcm_history2_32 = get_32bitLE(buf+0x38);
+    ch->adpcm_history3_32 = get_32bitLE(buf+0x3c);
+    ch->adpcm_history4_32 = get_32bitLE(buf+0x40);
+    memcpy(&ch->adpcm_history1_double, buf+0x44, 0x08);
+    memcpy(&ch->adpcm_history2_double, buf+0x4c, 0x08);
+    ch->adpcm_step_index = get_32bitLE(buf+0x54);
+    ch->adpcm_scale = get_32bitLE(buf+0x58);
+    ch->adx_channels = get_32bitLE(buf+0x5c);
+    ch->adx_xor = get_16bitLE(buf+0x60);
+    ch->adx_mult = get_16bitLE(buf+0x62);
+    ch->adx_add = get_16bitLE(buf+0x64);
+}
+
+/* codec state that can't be saved to a file */
+static int seek_index_is_saveable(VGMSTREAM * vgmstream) {
+    return vgmstream->coding_type != coding_G721;
+}
+
+int vgmstream_save_seek_index(VGMSTREAM * vgmstream, const char * filename) {
+    seek_index_t * index;
+    uint8_t * buf = NULL;
+    size_t point_size;
+    FILE * outfile = NULL;
+    int i, ch;
+
+    if (!vgmstream || !seek_index_is_usable(vgmstream) || !seek_index_is_saveable(vgmstream))
+        goto fail;
+    index = vgmstream->seek_index;
+
+    point_size = SEEK_INDEX_POINT_SIZE + SEEK_INDEX_CHANNEL_SIZE * vgmstream->channels;
+    buf = malloc(point_size > SEEK_INDEX_HEADER_SIZE ? point_size : SEEK_INDEX_HEADER_SIZE);
+    if (!buf) goto fail;
+
+    outfile = fopen(filename, "wb");
+    if (!outfile) goto fail;
+
+    put_32bitBE(buf+0x00, SEEK_INDEX_ID);
+    put_32bitLE(buf+0x04, SEEK_INDEX_VERSION);
+    put_32bitLE(buf+0x08, vgmstream->channels);
+    put_32bitLE(buf+0x0c, vgmstream->num_samples);
+    put_32bitLE(buf+0x10, vgmstream->coding_type);
+    put_32bitLE(buf+0x14, vgmstream->layout_type);
+    put_32bitLE(buf+0x18, index->interval);
+    put_32bitLE(buf+0x1c, index->points_count);
+    if (fwrite(buf, 1, SEEK_INDEX_HEADER_SIZE, outfile) != SEEK_INDEX_HEADER_SIZE)
+        goto fail;
+
+    for (i = 0; i < index->points_count; i++) {
+        seek_point_t * point = &index->points[i];
+
+        put_32bitLE(buf+0x00, point->current_sample);
+        put_32bitLE(buf+0x04, point->loop_pass);
+        put_32bitLE(buf+0x08, point->samples_into_block);
+        put_64bitLE(buf+0x0c, point->current_block_offset);
+        put_32bitLE(buf+0x14, (int32_t)point->current_block_size);
+        put_32bitLE(buf+0x18, (int32_t)point->current_block_samples);
+        put_64bitLE(buf+0x1c, point->next_block_offset);
+        put_32bitLE(buf+0x24, (int32_t)point->full_block_size);
+        put_32bitLE(buf+0x28, point->ws_output_size);
+        put_32bitLE(buf+0x2c, point->codec_config);
+        for (ch = 0; ch < vgmstream->channels; ch++) {
+            seek_index_put_channel(buf + SEEK_INDEX_POINT_SIZE + SEEK_INDEX_CHANNEL_SIZE*ch, &point->ch[ch]);
+        }
+
+        if (fwrite(buf, 1, point_size, outfile) != point_size)
+            goto fail;
+    }
+
+    fclose(outfile);
+    free(buf);
+    return 1;
+
+fail:
+    if (outfile) fclose(outfile);
+    free(buf);
+    return 0;
+}
+
+int vgmstream_load_seek_index(VGMSTREAM * vgmstream, STREAMFILE *streamFile) {
+    seek_index_t * index;
+    uint8_t * buf = NULL;
+    size_t point_size;
+    off_t offset;
+    int32_t interval, points_count;
+    int i, ch;
+
+    if (!vgmstream || !streamFile || !seek_index_is_saveable(vgmstream))
+        goto fail;
+
+    /* must match the current stream */
+    if (read_32bitBE(0x00,streamFile) != SEEK_INDEX_ID ||
+        read_32bitLE(0x04,streamFile) != SEEK_INDEX_VERSION ||
+        read_32bitLE(0x08,streamFile) != vgmstream->channels ||
+        read_32bitLE(0x0c,streamFile) != vgmstream->num_samples ||
+        read_32bitLE(0x10,streamFile) != vgmstream->coding_type ||
+        read_32bitLE(0x14,streamFile) != vgmstream->layout_type)
+        goto fail;
+    interval = read_32bitLE(0x18,streamFile);
+    points_count = read_32bitLE(0x1c,streamFile);
+    if (interval <= 0 || points_count <= 0)
+        goto fail;
+
+    point_size = SEEK_INDEX_POINT_SIZE + SEEK_INDEX_CHANNEL_SIZE * vgmstream->channels;
+    if (SEEK_INDEX_HEADER_SIZE + point_size * points_count != get_streamfile_size(streamFile))
+        goto fail;
+
+    /* replace current index */
+    free_seek_index(vgmstream->seek_index);
+    vgmstream->seek_index = NULL;
+    ((VGMSTREAM *)vgmstream->start_vgmstream)->seek_index = NULL;
+    if (!vgmstream_enable_seek_index(vgmstream, interval))
+        goto fail;
+    index = vgmstream->seek_index;
+
+    buf = malloc(point_size);
+    if (!buf) goto fail;
+
+    offset = SEEK_INDEX_HEADER_SIZE;
+    for (i = 0; i < points_count; i++) {
+        seek_point_t * point;
+        int32_t sample;
+        int loop_pass;
+
+        if (read_streamfile(buf, offset, point_size, streamFile) != point_size)
+            goto fail;
+        offset += point_size;
+
+        sample = get_32bitLE(buf+0x00);
+        loop_pass = get_32bitLE(buf+0x04);
+        if (sample < 0 || sample > vgmstream->num_samples)
+            goto fail;
+
+        point = seek_index_add_point(index, vgmstream->channels, loop_pass != 0, sample);
+        if (!point) continue; /* start point or repeated */
+
+        point->samples_into_block = get_32bitLE(buf+0x08);
+        point->current_block_offset = get_64bitLE(buf+0x0c);
+        point->current_block_size = get_32bitLE(buf+0x14);
+        point->current_block_samples = get_32bitLE(buf+0x18);
+        point->next_block_offset = get_64bitLE(buf+0x1c);
+        point->full_block_size = get_32bitLE(buf+0x24);
+        point->ws_output_size = get_32bitLE(buf+0x28);
+        point->codec_config = get_32bitLE(buf+0x2c);
+
+        memcpy(point->ch, vgmstream->start_ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+        for (ch = 0; ch < vgmstream->channels; ch++) {
+            seek_index_get_channel(buf + SEEK_INDEX_POINT_SIZE + SEEK_INDEX_CHANNEL_SIZE*ch, &point->ch[ch]);
+        }
+    }
+
+    free(buf);
+    return 1;
+
+fail:
+    free(buf);
+    return 0;
+}
@@ -1,6 +1,12 @@
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#if !defined(_WIN32) && !defined(WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#define STREAMFILE_USE_MMAP
+#endif
 #include "streamfile.h"
 #include "util.h"
 #include "vgmstream.h"
@@ -23,6 +29,33 @@ typedef struct {
 static STREAMFILE * open_stdio_streamfile_buffer(const char * const filename, size_t buffersize);
 static STREAMFILE * open_stdio_streamfile_buffer_by_file(FILE *infile,const char * const filename, size_t buffersize);
 
+/* positions the FILE at offset, returns 0 on error */
+static int seek_stdio(STDIOSTREAMFILE *streamfile, off_t offset) {
+    if (fseeko(streamfile->infile,offset,SEEK_SET)) {
+        return 0; /* this shouldn't happen in our code */
+    }
+
+#ifdef _MSC_VER
+    /* Workaround a bug that appears when compiling with MSVC (later versions).
+     * This bug is deterministic and seemingly appears randomly after seeking.
+     * It results in fread returning data from the wrong area of the file.
+     * HPS is one format that is almost always affected by this. */
+    fseek(streamfile->infile, ftell(streamfile->infile), SEEK_SET);
+#endif
+    return 1;
+}
+
+/* refills the buffer at offset, returns 0 on error */
+static int refill_stdio(STDIOSTREAMFILE *streamfile, off_t offset) {
+    if (!seek_stdio(streamfile, offset))
+        return 0;
+
+    /* fill the buffer (offset now is beyond buffer_offset) */
+    streamfile->buffer_offset = offset;
+    streamfile->validsize = fread(streamfile->buffer,sizeof(uint8_t),streamfile->buffersize,streamfile->infile);
+    return 1;
+}
+
 static size_t read_stdio(STDIOSTREAMFILE *streamfile,uint8_t * dest, off_t offset, size_t length) {
     size_t length_read_total = 0;
 
@@ -57,22 +90,18 @@ static size_t read_stdio(STDIOSTREAMFILE *streamfile,uint8_t * dest, off_t offse
             break;
         }
 
-        /* position to new offset */
-        if (fseeko(streamfile->infile,offset,SEEK_SET)) {
-            break; /* this shouldn't happen in our code */
+        /* big reads go straight to dest, as the buffer would only add a copy (ex. cache pages) */
+        if (length >= streamfile->buffersize) {
+            if (!seek_stdio(streamfile, offset))
+                break;
+            length_to_read = fread(dest,sizeof(uint8_t),length,streamfile->infile);
+            offset += length_to_read;
+            length_read_total += length_to_read;
+            break;
         }
 
-#ifdef _MSC_VER
-        /* Workaround a bug that appears when compiling with MSVC (later versions).
-         * This bug is deterministic and seemingly appears randomly after seeking.
-         * It results in fread returning data from the wrong area of the file.
-         * HPS is one format that is almost always affected by this. */
-        fseek(streamfile->infile, ftell(streamfile->infile), SEEK_SET);
-#endif
-
-        /* fill the buffer (offset now is beyond buffer_offset) */
-        streamfile->buffer_offset = offset;
-        streamfile->validsize = fread(streamfile->buffer,sizeof(uint8_t),streamfile->buffersize,streamfile->infile);
+        if (!refill_stdio(streamfile, offset))
+            break;
 
         /* decide how much must be read this time */
         if (length > streamfile->buffersize)
@@ -99,6 +128,21 @@ static size_t read_stdio(STDIOSTREAMFILE *streamfile,uint8_t * dest, off_t offse
     streamfile->offset = offset; /* last fread offset */
     return length_read_total;
 }
+static const uint8_t * borrow_stdio(STDIOSTREAMFILE *streamfile, off_t offset, size_t length) {
+    if (!streamfile || length <= 0 || offset < 0 || length > streamfile->buffersize)
+        return NULL;
+
+    /* refill if not fully in the buffer */
+    if (offset < streamfile->buffer_offset || offset + length > streamfile->buffer_offset + streamfile->validsize) {
+        if (offset + length > streamfile->filesize)
+            return NULL;
+        if (!refill_stdio(streamfile, offset) || streamfile->validsize < length)
+            return NULL;
+    }
+
+    streamfile->offset = offset + length;
+    return streamfile->buffer + (offset - streamfile->buffer_offset);
+}
 static size_t get_size_stdio(STDIOSTREAMFILE * streamfile) {
     return streamfile->filesize;
 }
@@ -157,6 +201,7 @@ static STREAMFILE * open_stdio_streamfile_buffer_by_file(FILE *infile,const char
     streamfile->sf.get_name = (void*)get_name_stdio;
     streamfile->sf.open = (void*)open_stdio;
     streamfile->sf.close = (void*)close_stdio;
+    streamfile->sf.borrow = (void*)borrow_stdio;
 
     streamfile->infile = infile;
     streamfile->buffersize = buffersize;
@@ -211,6 +256,113 @@ STREAMFILE * open_stdio_streamfile_by_file(FILE * file, const char * filename) {
 
 /* **************************************************** */
 
+#ifdef STREAMFILE_USE_MMAP
+/* a STREAMFILE that maps the whole file in memory, so reads are just copies */
+typedef struct {
+    STREAMFILE sf;          /* callbacks */
+
+    uint8_t * data;         /* mapped file */
+    size_t filesize;        /* mapped file size */
+    off_t offset;           /* last read offset (info) */
+    char name[PATH_LIMIT];  /* file filename */
+} MMAP_STREAMFILE;
+
+static size_t mmap_read(MMAP_STREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    if (!streamfile || !dest || length <= 0 || offset < 0)
+        return 0;
+
+    /* ignore requests at EOF */
+    if (offset >= streamfile->filesize) {
+        VGM_ASSERT_ONCE(offset > streamfile->filesize, "MMAP: reading over filesize 0x%x @ 0x%"PRIx64" + 0x%x\n", streamfile->filesize, (off64_t)offset, length);
+        return 0;
+    }
+
+    if (length > streamfile->filesize - offset)
+        length = streamfile->filesize - offset;
+
+    memcpy(dest, streamfile->data + offset, length);
+    streamfile->offset = offset + length;
+    return length;
+}
+static const uint8_t * mmap_borrow(MMAP_STREAMFILE *streamfile, off_t offset, size_t length) {
+    if (!streamfile || length <= 0 || offset < 0 || offset + length > streamfile->filesize)
+        return NULL;
+
+    streamfile->offset = offset + length;
+    return streamfile->data + offset;
+}
+static size_t mmap_get_size(MMAP_STREAMFILE * streamfile) {
+    return streamfile->filesize;
+}
+static off_t mmap_get_offset(MMAP_STREAMFILE * streamfile) {
+    return streamfile->offset;
+}
+static void mmap_get_name(MMAP_STREAMFILE *streamfile, char *buffer, size_t length) {
+    strncpy(buffer,streamfile->name,length);
+    buffer[length-1]='\0';
+}
+static STREAMFILE *mmap_open(MMAP_STREAMFILE *streamfile, const char * const filename, size_t buffersize) {
+    if (!filename)
+        return NULL;
+    return open_mmap_streamfile(filename);
+}
+static void mmap_close(MMAP_STREAMFILE *streamfile) {
+    munmap(streamfile->data, streamfile->filesize);
+    free(streamfile);
+}
+
+STREAMFILE * open_mmap_streamfile(const char * filename) {
+    MMAP_STREAMFILE * streamfile = NULL;
+    struct stat st;
+    void * data = MAP_FAILED;
+    int fd = -1;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    /* empty or huge files can't be mapped (not an error, just use standard IO) */
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (uint64_t)st.st_size > (size_t)-1)
+        goto fallback;
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+        goto fallback;
+    close(fd); /* mapping stays valid */
+    fd = -1;
+
+    streamfile = calloc(1,sizeof(MMAP_STREAMFILE));
+    if (!streamfile) goto fail;
+
+    streamfile->sf.read = (void*)mmap_read;
+    streamfile->sf.get_size = (void*)mmap_get_size;
+    streamfile->sf.get_offset = (void*)mmap_get_offset;
+    streamfile->sf.get_name = (void*)mmap_get_name;
+    streamfile->sf.open = (void*)mmap_open;
+    streamfile->sf.close = (void*)mmap_close;
+    streamfile->sf.borrow = (void*)mmap_borrow;
+
+    streamfile->data = data;
+    streamfile->filesize = st.st_size;
+    strncpy(streamfile->name,filename,sizeof(streamfile->name));
+    streamfile->name[sizeof(streamfile->name)-1] = '\0';
+
+    return &streamfile->sf;
+
+fallback:
+    close(fd);
+    return open_stdio_streamfile(filename);
+fail:
+    if (data != MAP_FAILED) munmap(data, st.st_size);
+    return NULL;
+}
+#else
+STREAMFILE * open_mmap_streamfile(const char * filename) {
+    return open_stdio_streamfile(filename);
+}
+#endif
+
+/* **************************************************** */
+
 typedef struct {
     STREAMFILE sf;
 
@@ -287,6 +439,24 @@ static size_t buffer_read(BUFFER_STREAMFILE *streamfile, uint8_t * dest, off_t o
     streamfile->offset = offset; /* last fread offset */
     return length_read_total;
 }
+static const uint8_t * buffer_borrow(BUFFER_STREAMFILE *streamfile, off_t offset, size_t length) {
+    if (!streamfile || length <= 0 || offset < 0 || length > streamfile->buffersize)
+        return NULL;
+
+    /* refill if not fully in the buffer */
+    if (offset < streamfile->buffer_offset || offset + length > streamfile->buffer_offset + streamfile->validsize) {
+        if (offset + length > streamfile->filesize)
+            return NULL;
+
+        streamfile->buffer_offset = offset;
+        streamfile->validsize = streamfile->inner_sf->read(streamfile->inner_sf, streamfile->buffer, streamfile->buffer_offset, streamfile->buffersize);
+        if (streamfile->validsize < length)
+            return NULL;
+    }
+
+    streamfile->offset = offset + length;
+    return streamfile->buffer + (offset - streamfile->buffer_offset);
+}
 static size_t buffer_get_size(BUFFER_STREAMFILE * streamfile) {
     return streamfile->filesize; /* cache */
 }
@@ -328,6 +498,7 @@ STREAMFILE *open_buffer_streamfile(STREAMFILE *streamfile, size_t buffer_size) {
     this_sf->sf.get_name = (void*)buffer_get_name;
     this_sf->sf.open = (void*)buffer_open;
     this_sf->sf.close = (void*)buffer_close;
+    this_sf->sf.borrow = (void*)buffer_borrow;
     this_sf->sf.stream_index = streamfile->stream_index;
 
     this_sf->inner_sf = streamfile;
@@ -344,6 +515,505 @@ fail:
 
 /* **************************************************** */
 
+/* pages shared by all CACHE_STREAMFILEs opened from the first one */
+typedef struct {
+    off_t offset;           /* file offset of the page's data (-1 = unused) */
+    size_t validsize;       /* less than a page at EOF */
+    uint32_t last_use;      /* for LRU */
+} CACHE_PAGE;
+
+typedef struct {
+    STREAMFILE *inner_sf;
+    int refs;               /* open handles */
+    size_t filesize;
+    uint8_t * pool;         /* pages_count * CACHE_PAGE_SIZE */
+    CACHE_PAGE * pages;
+    int pages_count;
+    uint32_t use_count;
+} CACHE_POOL;
+
+typedef struct {
+    STREAMFILE sf;
+
+    CACHE_POOL *cache;
+    off_t offset;           /* last read offset (info) */
+    int last_page;          /* likely page for the next read */
+} CACHE_STREAMFILE;
+
+#define CACHE_PAGE_SIZE STREAMFILE_CACHE_PAGE_SIZE
+#define CACHE_DEFAULT_PAGES 16
+
+
+/* returns the index of the page with offset (loading it over the least recently used one if needed), or -1 */
+static int cache_get_page(CACHE_STREAMFILE *streamfile, off_t page_offset) {
+    CACHE_POOL *cache = streamfile->cache;
+    CACHE_PAGE *page;
+    int i, lru = 0;
+
+    if (cache->pages[streamfile->last_page].offset != page_offset) {
+        for (i = 0; i < cache->pages_count; i++) {
+            if (cache->pages[i].offset == page_offset)
+                break;
+            if (cache->pages[i].last_use < cache->pages[lru].last_use)
+                lru = i;
+        }
+
+        if (i == cache->pages_count) {
+            page = &cache->pages[lru];
+            page->offset = page_offset;
+            page->validsize = cache->inner_sf->read(cache->inner_sf, cache->pool + lru * CACHE_PAGE_SIZE, page_offset, CACHE_PAGE_SIZE);
+            if (page->validsize == 0) {
+                page->offset = -1;
+                page->last_use = 0;
+                return -1;
+            }
+            i = lru;
+        }
+
+        streamfile->last_page = i;
+    }
+
+    cache->use_count++;
+    cache->pages[streamfile->last_page].last_use = cache->use_count;
+    return streamfile->last_page;
+}
+
+static size_t cache_read(CACHE_STREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    CACHE_POOL *cache;
+    size_t length_read_total = 0;
+
+    if (!streamfile || !dest || length <= 0 || offset < 0)
+        return 0;
+    cache = streamfile->cache;
+
+    while (length > 0) {
+        off_t page_offset = offset - (offset % CACHE_PAGE_SIZE);
+        size_t offset_into_page = offset - page_offset;
+        size_t length_to_read;
+        int index;
+
+        /* ignore requests at EOF */
+        if (offset >= cache->filesize)
+            break;
+
+        index = cache_get_page(streamfile, page_offset);
+        if (index < 0 || cache->pages[index].validsize <= offset_into_page)
+            break;
+
+        length_to_read = cache->pages[index].validsize - offset_into_page;
+        if (length_to_read > length)
+            length_to_read = length;
+
+        memcpy(dest, cache->pool + index * CACHE_PAGE_SIZE + offset_into_page, length_to_read);
+        offset += length_to_read;
+        length_read_total += length_to_read;
+        length -= length_to_read;
+        dest += length_to_read;
+    }
+
+    streamfile->offset = offset;
+    return length_read_total;
+}
+static const uint8_t * cache_borrow(CACHE_STREAMFILE *streamfile, off_t offset, size_t length) {
+    CACHE_POOL *cache = streamfile->cache;
+    off_t page_offset = offset - (offset % CACHE_PAGE_SIZE);
+    size_t offset_into_page = offset - page_offset;
+    int index;
+
+    /* only within a page (otherwise the caller reads, that copies) */
+    if (length <= 0 || offset < 0 || offset_into_page + length > CACHE_PAGE_SIZE)
+        return NULL;
+
+    index = cache_get_page(streamfile, page_offset);
+    if (index < 0 || cache->pages[index].validsize < offset_into_page + length)
+        return NULL;
+
+    streamfile->offset = offset + length;
+    return cache->pool + index * CACHE_PAGE_SIZE + offset_into_page;
+}
+static size_t cache_get_size(CACHE_STREAMFILE * streamfile) {
+    return streamfile->cache->filesize; /* cache */
+}
+static off_t cache_get_offset(CACHE_STREAMFILE * streamfile) {
+    return streamfile->offset; /* cache */
+}
+static void cache_get_name(CACHE_STREAMFILE *streamfile, char *buffer, size_t length) {
+    streamfile->cache->inner_sf->get_name(streamfile->cache->inner_sf, buffer, length); /* default */
+}
+static STREAMFILE *cache_open(CACHE_STREAMFILE *streamfile, const char * const filename, size_t buffersize) {
+    CACHE_POOL *cache = streamfile->cache;
+    CACHE_STREAMFILE *this_sf = NULL;
+    char original_filename[PATH_LIMIT];
+
+    /* other files are opened normally */
+    cache->inner_sf->get_name(cache->inner_sf, original_filename, PATH_LIMIT);
+    if (!filename || strcmp(filename, original_filename) != 0)
+        return cache->inner_sf->open(cache->inner_sf, filename, buffersize);
+
+    /* same file: new handle over the same pages */
+    this_sf = malloc(sizeof(CACHE_STREAMFILE));
+    if (!this_sf) return NULL;
+    memcpy(this_sf, streamfile, sizeof(CACHE_STREAMFILE));
+    this_sf->offset = 0;
+    cache->refs++;
+
+    return &this_sf->sf;
+}
+static void cache_close(CACHE_STREAMFILE *streamfile) {
+    CACHE_POOL *cache = streamfile->cache;
+
+    cache->refs--;
+    if (cache->refs == 0) {
+        cache->inner_sf->close(cache->inner_sf);
+        free(cache->pool);
+        free(cache->pages);
+        free(cache);
+    }
+    free(streamfile);
+}
+
+STREAMFILE *open_cache_streamfile(STREAMFILE *streamfile, int pages_count) {
+    CACHE_STREAMFILE *this_sf = NULL;
+    CACHE_POOL *cache = NULL;
+    int i;
+
+    if (!streamfile) goto fail;
+
+    if (pages_count <= 0)
+        pages_count = CACHE_DEFAULT_PAGES;
+
+    cache = calloc(1,sizeof(CACHE_POOL));
+    if (!cache) goto fail;
+
+    cache->pages_count = pages_count;
+    cache->pool = malloc(pages_count * CACHE_PAGE_SIZE);
+    if (!cache->pool) goto fail;
+    cache->pages = calloc(pages_count, sizeof(CACHE_PAGE));
+    if (!cache->pages) goto fail;
+    for (i = 0; i < pages_count; i++) {
+        cache->pages[i].offset = -1;
+    }
+
+    this_sf = calloc(1,sizeof(CACHE_STREAMFILE));
+    if (!this_sf) goto fail;
+
+    /* set callbacks and internals */
+    this_sf->sf.read = (void*)cache_read;
+    this_sf->sf.get_size = (void*)cache_get_size;
+    this_sf->sf.get_offset = (void*)cache_get_offset;
+    this_sf->sf.get_name = (void*)cache_get_name;
+    this_sf->sf.open = (void*)cache_open;
+    this_sf->sf.close = (void*)cache_close;
+    this_sf->sf.borrow = (void*)cache_borrow;
+    this_sf->sf.stream_index = streamfile->stream_index;
+
+    this_sf->cache = cache;
+    cache->inner_sf = streamfile;
+    cache->refs = 1;
+    cache->filesize = streamfile->get_size(streamfile);
+
+    return &this_sf->sf;
+
+fail:
+    if (cache) {
+        free(cache->pool);
+        free(cache->pages);
+    }
+    free(cache);
+    free(this_sf);
+    return NULL;
+}
+
+/* **************************************************** */
+
+/* buffered reads like BUFFER_STREAMFILE, but when reads are sequential the next window is loaded
+ * by a background thread into a second buffer (swapped in once reads get there) */
+typedef enum { PREFETCH_IDLE, PREFETCH_PENDING, PREFETCH_READY } prefetch_state_t;
+
+typedef struct {
+    uint8_t * buffer;
+    off_t offset;           /* buffer data start */
+    size_t validsize;       /* current buffer size */
+} PREFETCH_BUFFER;
+
+typedef struct {
+    STREAMFILE sf;
+
+    STREAMFILE *inner_sf;   /* only read by the thread while a prefetch is pending */
+    off_t offset;           /* last read offset (info) */
+    size_t buffersize;      /* max buffer size */
+    size_t filesize;        /* buffered file size */
+    off_t last_start;       /* previous read, to detect sequential access */
+    off_t last_end;
+
+    PREFETCH_BUFFER current;    /* used by reads */
+    PREFETCH_BUFFER next;       /* filled by the thread */
+    prefetch_state_t state;
+    int quit;
+
+    vgm_mutex *mutex;
+    vgm_cond *cond;
+    vgm_thread *thread;     /* NULL = works like a regular buffer */
+
+    prefetch_streamfile_stats stats;
+} PREFETCH_STREAMFILE;
+
+
+static void prefetch_thread(void *arg) {
+    PREFETCH_STREAMFILE *streamfile = arg;
+
+    vgm_mutex_lock(streamfile->mutex);
+    while (1) {
+        off_t offset;
+        size_t bytes;
+
+        while (streamfile->state != PREFETCH_PENDING && !streamfile->quit) {
+            vgm_cond_wait(streamfile->cond, streamfile->mutex);
+        }
+        if (streamfile->quit)
+            break;
+
+        offset = streamfile->next.offset;
+        vgm_mutex_unlock(streamfile->mutex);
+
+        bytes = streamfile->inner_sf->read(streamfile->inner_sf, streamfile->next.buffer, offset, streamfile->buffersize);
+
+        vgm_mutex_lock(streamfile->mutex);
+        streamfile->next.validsize = bytes;
+        streamfile->state = PREFETCH_READY;
+        streamfile->stats.prefetches++;
+        streamfile->stats.bytes_prefetched += bytes;
+        vgm_cond_broadcast(streamfile->cond);
+    }
+    vgm_mutex_unlock(streamfile->mutex);
+}
+
+/* loads the window at offset into the current buffer, from the prefetched one if possible; returns 1 if not blocked on IO */
+static int prefetch_load(PREFETCH_STREAMFILE *streamfile, off_t offset) {
+    int hit = 0;
+
+    if (streamfile->thread) {
+        vgm_mutex_lock(streamfile->mutex);
+        /* the inner streamfile can't be used until the thread is done (most likely with our data anyway) */
+        while (streamfile->state == PREFETCH_PENDING) {
+            vgm_cond_wait(streamfile->cond, streamfile->mutex);
+        }
+        if (streamfile->state == PREFETCH_READY && offset >= streamfile->next.offset
+                && offset < streamfile->next.offset + streamfile->next.validsize) {
+            PREFETCH_BUFFER temp = streamfile->current;
+            streamfile->current = streamfile->next;
+            streamfile->next = temp;
+            hit = 1;
+        }
+        streamfile->state = PREFETCH_IDLE;
+        vgm_mutex_unlock(streamfile->mutex);
+    }
+
+    if (!hit) {
+        streamfile->current.offset = offset;
+        streamfile->current.validsize = streamfile->inner_sf->read(streamfile->inner_sf, streamfile->current.buffer, offset, streamfile->buffersize);
+    }
+    return hit;
+}
+
+/* asks the thread for the window after the current one */
+static void prefetch_request(PREFETCH_STREAMFILE *streamfile) {
+    off_t next_offset = streamfile->current.offset + streamfile->current.validsize;
+
+    if (!streamfile->thread || streamfile->current.validsize == 0 || next_offset >= streamfile->filesize)
+        return;
+
+    vgm_mutex_lock(streamfile->mutex);
+    if (streamfile->state == PREFETCH_IDLE || (streamfile->state == PREFETCH_READY && streamfile->next.offset != next_offset)) {
+        streamfile->next.offset = next_offset;
+        streamfile->state = PREFETCH_PENDING;
+        vgm_cond_broadcast(streamfile->cond);
+    }
+    vgm_mutex_unlock(streamfile->mutex);
+}
+
+/* updates stats and requests the next window if reads go forward */
+static void prefetch_update(PREFETCH_STREAMFILE *streamfile, off_t offset, size_t length, int blocked) {
+    int is_sequential = offset >= streamfile->last_start && offset <= streamfile->last_end;
+
+    if (blocked)
+        streamfile->stats.misses++;
+    else
+        streamfile->stats.hits++;
+
+    streamfile->last_start = offset;
+    streamfile->last_end = offset + length;
+
+    if (is_sequential)
+        prefetch_request(streamfile);
+}
+
+static size_t prefetch_read(PREFETCH_STREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    size_t length_read_total = 0;
+    off_t start_offset = offset;
+    int blocked = 0;
+
+    if (!streamfile || !dest || length <= 0 || offset < 0)
+        return 0;
+
+    while (length > 0) {
+        size_t length_to_read;
+        off_t offset_into_buffer;
+
+        /* ignore requests at EOF */
+        if (offset >= streamfile->filesize)
+            break;
+
+        if (offset < streamfile->current.offset || offset >= streamfile->current.offset + streamfile->current.validsize) {
+            if (!prefetch_load(streamfile, offset))
+                blocked = 1;
+            if (streamfile->current.validsize == 0)
+                break;
+        }
+
+        offset_into_buffer = offset - streamfile->current.offset;
+        length_to_read = streamfile->current.validsize - offset_into_buffer;
+        if (length_to_read > length)
+            length_to_read = length;
+
+        memcpy(dest, streamfile->current.buffer + offset_into_buffer, length_to_read);
+        offset += length_to_read;
+        length_read_total += length_to_read;
+        length -= length_to_read;
+        dest += length_to_read;
+
+        /* give up on partial reads (EOF) */
+        if (streamfile->current.validsize < streamfile->buffersize && offset >= streamfile->current.offset + streamfile->current.validsize)
+            break;
+    }
+
+    prefetch_update(streamfile, start_offset, length_read_total, blocked);
+
+    streamfile->offset = offset; /* last fread offset */
+    return length_read_total;
+}
+static const uint8_t * prefetch_borrow(PREFETCH_STREAMFILE *streamfile, off_t offset, size_t length) {
+    int blocked = 0;
+
+    if (!streamfile || length <= 0 || offset < 0 || length > streamfile->buffersize)
+        return NULL;
+
+    /* reload if not fully in the buffer */
+    if (offset < streamfile->current.offset || offset + length > streamfile->current.offset + streamfile->current.validsize) {
+        if (offset + length > streamfile->filesize)
+            return NULL;
+
+        if (!prefetch_load(streamfile, offset))
+            blocked = 1;
+
+        /* prefetched window may start before offset and not have all data (no pending prefetch at this point) */
+        if (offset + length > streamfile->current.offset + streamfile->current.validsize) {
+            streamfile->current.offset = offset;
+            streamfile->current.validsize = streamfile->inner_sf->read(streamfile->inner_sf, streamfile->current.buffer, offset, streamfile->buffersize);
+            blocked = 1;
+            if (streamfile->current.validsize < length)
+                return NULL;
+        }
+    }
+
+    prefetch_update(streamfile, offset, length, blocked);
+
+    streamfile->offset = offset + length;
+    return streamfile->current.buffer + (offset - streamfile->current.offset);
+}
+static size_t prefetch_get_size(PREFETCH_STREAMFILE * streamfile) {
+    return streamfile->filesize; /* cache */
+}
+static off_t prefetch_get_offset(PREFETCH_STREAMFILE * streamfile) {
+    return streamfile->offset; /* cache */
+}
+static void prefetch_get_name(PREFETCH_STREAMFILE *streamfile, char *buffer, size_t length) {
+    streamfile->inner_sf->get_name(streamfile->inner_sf, buffer, length); /* default */
+}
+static STREAMFILE *prefetch_open(PREFETCH_STREAMFILE *streamfile, const char * const filename, size_t buffersize) {
+    STREAMFILE *new_inner_sf = streamfile->inner_sf->open(streamfile->inner_sf,filename,buffersize);
+    return open_prefetch_streamfile(new_inner_sf, streamfile->buffersize);
+}
+static void prefetch_close(PREFETCH_STREAMFILE *streamfile) {
+    if (streamfile->thread) {
+        vgm_mutex_lock(streamfile->mutex);
+        streamfile->quit = 1;
+        vgm_cond_broadcast(streamfile->cond);
+        vgm_mutex_unlock(streamfile->mutex);
+        vgm_thread_join(streamfile->thread);
+    }
+    vgm_cond_free(streamfile->cond);
+    vgm_mutex_free(streamfile->mutex);
+
+    streamfile->inner_sf->close(streamfile->inner_sf);
+    free(streamfile->current.buffer);
+    free(streamfile->next.buffer);
+    free(streamfile);
+}
+
+STREAMFILE *open_prefetch_streamfile(STREAMFILE *streamfile, size_t buffer_size) {
+    PREFETCH_STREAMFILE *this_sf = NULL;
+
+    if (!streamfile) goto fail;
+
+    this_sf = calloc(1,sizeof(PREFETCH_STREAMFILE));
+    if (!this_sf) goto fail;
+
+    this_sf->buffersize = buffer_size;
+    if (this_sf->buffersize == 0)
+        this_sf->buffersize = STREAMFILE_DEFAULT_BUFFER_SIZE;
+
+    this_sf->current.buffer = calloc(this_sf->buffersize,1);
+    this_sf->next.buffer = calloc(this_sf->buffersize,1);
+    if (!this_sf->current.buffer || !this_sf->next.buffer) goto fail;
+
+    /* set callbacks and internals */
+    this_sf->sf.read = (void*)prefetch_read;
+    this_sf->sf.get_size = (void*)prefetch_get_size;
+    this_sf->sf.get_offset = (void*)prefetch_get_offset;
+    this_sf->sf.get_name = (void*)prefetch_get_name;
+    this_sf->sf.open = (void*)prefetch_open;
+    this_sf->sf.close = (void*)prefetch_close;
+    this_sf->sf.borrow = (void*)prefetch_borrow;
+    this_sf->sf.stream_index = streamfile->stream_index;
+
+    this_sf->inner_sf = streamfile;
+
+    this_sf->filesize = streamfile->get_size(streamfile);
+    this_sf->last_start = -1;
+    this_sf->last_end = -1;
+
+    /* without a thread it still works as a buffered streamfile */
+    this_sf->mutex = vgm_mutex_init();
+    this_sf->cond = vgm_cond_init();
+    if (this_sf->mutex && this_sf->cond)
+        this_sf->thread = vgm_thread_start(prefetch_thread, this_sf);
+
+    return &this_sf->sf;
+
+fail:
+    if (this_sf) {
+        free(this_sf->current.buffer);
+        free(this_sf->next.buffer);
+    }
+    free(this_sf);
+    return NULL;
+}
+
+int get_prefetch_streamfile_stats(STREAMFILE *streamfile, prefetch_streamfile_stats *stats) {
+    PREFETCH_STREAMFILE *this_sf = (PREFETCH_STREAMFILE *)streamfile;
+
+    if (!streamfile || streamfile->read != (void*)prefetch_read)
+        return 0;
+
+    if (this_sf->thread) vgm_mutex_lock(this_sf->mutex);
+    *stats = this_sf->stats;
+    if (this_sf->thread) vgm_mutex_unlock(this_sf->mutex);
+    return 1;
+}
+
+/* **************************************************** */
+
 //todo stream_index: copy? pass? funtion? external?
 //todo use realnames on reopen? simplify?
 //todo use safe string ops, this ain't easy
@@ -357,6 +1027,9 @@ typedef struct {
 static size_t wrap_read(WRAP_STREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
     return streamfile->inner_sf->read(streamfile->inner_sf, dest, offset, length); /* default */
 }
+static const uint8_t * wrap_borrow(WRAP_STREAMFILE *streamfile, off_t offset, size_t length) {
+    return streamfile->inner_sf->borrow(streamfile->inner_sf, offset, length); /* default */
+}
 static size_t wrap_get_size(WRAP_STREAMFILE * streamfile) {
     return streamfile->inner_sf->get_size(streamfile->inner_sf); /* default */
 }
@@ -389,6 +1062,7 @@ STREAMFILE *open_wrap_streamfile(STREAMFILE *streamfile) {
     this_sf->sf.get_name = (void*)wrap_get_name;
     this_sf->sf.open = (void*)wrap_open;
     this_sf->sf.close = (void*)wrap_close;
+    this_sf->sf.borrow = streamfile->borrow ? (void*)wrap_borrow : NULL;
     this_sf->sf.stream_index = streamfile->stream_index;
 
     this_sf->inner_sf = streamfile;
@@ -411,6 +1085,11 @@ static size_t clamp_read(CLAMP_STREAMFILE *streamfile, uint8_t *dest, off_t offs
     size_t clamp_length = length > (streamfile->size - offset) ? (streamfile->size - offset) : length;
     return streamfile->inner_sf->read(streamfile->inner_sf, dest, inner_offset, clamp_length);
 }
+static const uint8_t * clamp_borrow(CLAMP_STREAMFILE *streamfile, off_t offset, size_t length) {
+    if (offset < 0 || offset + length > streamfile->size)
+        return NULL;
+    return streamfile->inner_sf->borrow(streamfile->inner_sf, streamfile->start + offset, length);
+}
 static size_t clamp_get_size(CLAMP_STREAMFILE *streamfile) {
     return streamfile->size;
 }
@@ -455,6 +1134,7 @@ STREAMFILE *open_clamp_streamfile(STREAMFILE *streamfile, off_t start, size_t si
     this_sf->sf.get_name = (void*)clamp_get_name;
     this_sf->sf.open = (void*)clamp_open;
     this_sf->sf.close = (void*)clamp_close;
+    this_sf->sf.borrow = streamfile->borrow ? (void*)clamp_borrow : NULL;
     this_sf->sf.stream_index = streamfile->stream_index;
 
     this_sf->inner_sf = streamfile;
@@ -550,6 +1230,9 @@ typedef struct {
 static size_t fakename_read(FAKENAME_STREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
     return streamfile->inner_sf->read(streamfile->inner_sf, dest, offset, length); /* default */
 }
+static const uint8_t * fakename_borrow(FAKENAME_STREAMFILE *streamfile, off_t offset, size_t length) {
+    return streamfile->inner_sf->borrow(streamfile->inner_sf, offset, length); /* default */
+}
 static size_t fakename_get_size(FAKENAME_STREAMFILE * streamfile) {
     return streamfile->inner_sf->get_size(streamfile->inner_sf); /* default */
 }
@@ -594,6 +1277,7 @@ STREAMFILE *open_fakename_streamfile(STREAMFILE *streamfile, const char * fakena
     this_sf->sf.get_name = (void*)fakename_get_name;
     this_sf->sf.open = (void*)fakename_open;
     this_sf->sf.close = (void*)fakename_close;
+    this_sf->sf.borrow = streamfile->borrow ? (void*)fakename_borrow : NULL;
     this_sf->sf.stream_index = streamfile->stream_index;
 
     this_sf->inner_sf = streamfile;
@@ -663,6 +1347,31 @@ static size_t multifile_read(MULTIFILE_STREAMFILE *streamfile, uint8_t * dest, o
     streamfile->offset = offset + done;
     return done;
 }
+static const uint8_t * multifile_borrow(MULTIFILE_STREAMFILE *streamfile, off_t offset, size_t length) {
+    int i;
+    off_t segment_offset = 0;
+
+    /* only if fully inside one segment */
+    for (i = 0; i < streamfile->inner_sfs_size; i++) {
+        size_t segment_size = streamfile->sizes[i];
+        if (offset >= segment_offset && offset < segment_offset + segment_size) {
+            STREAMFILE *inner_sf = streamfile->inner_sfs[i];
+            const uint8_t *data;
+
+            if (!inner_sf->borrow || offset + length > segment_offset + segment_size)
+                return NULL;
+
+            data = inner_sf->borrow(inner_sf, offset - segment_offset, length);
+            if (data)
+                streamfile->offset = offset + length;
+            return data;
+        }
+
+        segment_offset += segment_size;
+    }
+
+    return NULL;
+}
 static size_t multifile_get_size(MULTIFILE_STREAMFILE *streamfile) {
     return streamfile->size;
 }
@@ -739,6 +1448,7 @@ STREAMFILE *open_multifile_streamfile(STREAMFILE **streamfiles, size_t streamfil
     this_sf->sf.get_name = (void*)multifile_get_name;
     this_sf->sf.open = (void*)multifile_open;
     this_sf->sf.close = (void*)multifile_close;
+    this_sf->sf.borrow = (void*)multifile_borrow;
     this_sf->sf.stream_index = streamfiles[0]->stream_index;
 
     this_sf->inner_sfs_size = streamfiles_size;
@@ -766,6 +1476,92 @@ fail:
 
 /* **************************************************** */
 
+#define PROBE_EXTS_SIZE 0x1000
+
+typedef struct {
+    STREAMFILE sf;
+
+    char exts[PROBE_EXTS_SIZE]; /* extensions passed to check_extensions (comma-separated) */
+    int exts_checked;           /* check_extensions was called */
+    int exts_overflow;          /* too many extensions to record */
+    int accessed;               /* used for anything other than check_extensions */
+} PROBE_STREAMFILE;
+
+static size_t probe_read(PROBE_STREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    streamfile->accessed = 1;
+    return 0;
+}
+static size_t probe_get_size(PROBE_STREAMFILE * streamfile) {
+    streamfile->accessed = 1;
+    return 0;
+}
+static off_t probe_get_offset(PROBE_STREAMFILE * streamfile) {
+    streamfile->accessed = 1;
+    return 0;
+}
+static void probe_get_name(PROBE_STREAMFILE *streamfile, char *buffer, size_t length) {
+    streamfile->accessed = 1;
+    if (length > 0)
+        buffer[0] = '\0';
+}
+static STREAMFILE *probe_open(PROBE_STREAMFILE *streamfile, const char * const filename, size_t buffersize) {
+    streamfile->accessed = 1;
+    return NULL;
+}
+static void probe_close(PROBE_STREAMFILE *streamfile) {
+    free(streamfile);
+}
+
+static void probe_add_extensions(PROBE_STREAMFILE *streamfile, const char * cmp_exts) {
+    size_t exts_len = strlen(streamfile->exts);
+
+    streamfile->exts_checked = 1;
+    if (exts_len + 1 + strlen(cmp_exts) + 1 > PROBE_EXTS_SIZE) {
+        streamfile->exts_overflow = 1;
+        return;
+    }
+
+    if (exts_len > 0)
+        strcat(streamfile->exts, ",");
+    strcat(streamfile->exts, cmp_exts);
+}
+
+STREAMFILE *open_probe_streamfile(void) {
+    PROBE_STREAMFILE *this_sf;
+
+    this_sf = calloc(1,sizeof(PROBE_STREAMFILE));
+    if (!this_sf) return NULL;
+
+    /* set callbacks and internals */
+    this_sf->sf.read = (void*)probe_read;
+    this_sf->sf.get_size = (void*)probe_get_size;
+    this_sf->sf.get_offset = (void*)probe_get_offset;
+    this_sf->sf.get_name = (void*)probe_get_name;
+    this_sf->sf.open = (void*)probe_open;
+    this_sf->sf.close = (void*)probe_close;
+    this_sf->sf.stream_index = 0;
+
+    return &this_sf->sf;
+}
+
+int get_probe_streamfile_extensions(STREAMFILE *streamFile, char * buf, size_t buf_size) {
+    PROBE_STREAMFILE *this_sf = (PROBE_STREAMFILE*)streamFile;
+
+    if (!streamFile || streamFile->read != (void*)probe_read)
+        return 0;
+
+    /* extensions are only meaningful when they were the first and only thing checked */
+    if (!this_sf->exts_checked || this_sf->exts_overflow || this_sf->accessed)
+        return 0;
+    if (strlen(this_sf->exts) + 1 > buf_size)
+        return 0;
+
+    strcpy(buf, this_sf->exts);
+    return 1;
+}
+
+/* **************************************************** */
+
 STREAMFILE * open_streamfile(STREAMFILE *streamFile, const char * pathname) {
     return streamFile->open(streamFile,pathname,STREAMFILE_DEFAULT_BUFFER_SIZE);
 }
@@ -978,6 +1774,12 @@ int check_extensions(STREAMFILE *streamFile, const char * cmp_exts) {
     const char * ststr_res = NULL;
     size_t ext_len, cmp_len;
 
+    /* probes only record what would be checked (never matches) */
+    if (streamFile->read == (void*)probe_read) {
+        probe_add_extensions((PROBE_STREAMFILE*)streamFile, cmp_exts);
+        return 0;
+    }
+
     streamFile->get_name(streamFile,filename,sizeof(filename));
     ext = filename_extension(filename);
     ext_len = strlen(ext);
@@ -46,6 +46,8 @@
 #endif
 
 #define STREAMFILE_DEFAULT_BUFFER_SIZE 0x8000
+#define STREAMFILE_CACHE_PAGE_SIZE 0x2000
+#define STREAMFILE_CACHE_BASE_BUFFER_SIZE 0x400 /* file under a cache, that reads whole pages */
 
 #ifndef DIR_SEPARATOR
 #if defined (_WIN32) || defined (WIN32)
@@ -66,6 +68,8 @@ typedef struct _STREAMFILE {
     void (*get_name)(struct _STREAMFILE *,char *name,size_t length);
     struct _STREAMFILE * (*open)(struct _STREAMFILE *,const char * const filename,size_t buffersize);
     void (*close)(struct _STREAMFILE *);
+    /* optional: pointer to length bytes at offset, valid until the next call to the STREAMFILE (NULL if not possible) */
+    const uint8_t * (*borrow)(struct _STREAMFILE *, off_t offset, size_t length);
 
 
     /* Substream selection for files with subsongs. Manually used in metas if supported.
@@ -81,11 +85,37 @@ STREAMFILE *open_stdio_streamfile(const char * filename);
 /* Opens a standard STREAMFILE from a pre-opened FILE. */
 STREAMFILE *open_stdio_streamfile_by_file(FILE * file, const char * filename);
 
+/* Opens a STREAMFILE that maps the whole file in memory (POSIX only), so random reads are cheap.
+ * Falls back to a standard STREAMFILE when the file can't be mapped. */
+STREAMFILE *open_mmap_streamfile(const char * filename);
+
 /* Opens a STREAMFILE that does buffered IO.
  * Can be used when the underlying IO may be slow (like when using custom IO).
  * Buffer size is optional. */
 STREAMFILE *open_buffer_streamfile(STREAMFILE *streamfile, size_t buffer_size);
 
+/* Opens a STREAMFILE that does buffered IO like open_buffer_streamfile, and when reads are sequential
+ * a background thread loads the next buffer ahead of time (double buffering), so slow IO (ex. network)
+ * doesn't block decoding as often. Works as a regular buffered STREAMFILE if threads can't be used.
+ * Buffer size is optional. */
+STREAMFILE *open_prefetch_streamfile(STREAMFILE *streamfile, size_t buffer_size);
+
+typedef struct {
+    uint64_t hits;              /* reads done without waiting for IO */
+    uint64_t misses;            /* reads that had to wait for the underlying streamfile */
+    uint64_t prefetches;        /* buffers loaded in the background */
+    uint64_t bytes_prefetched;
+} prefetch_streamfile_stats;
+
+/* Copies the stats of a prefetch STREAMFILE. Returns 0 if the STREAMFILE isn't one. */
+int get_prefetch_streamfile_stats(STREAMFILE *streamfile, prefetch_streamfile_stats *stats);
+
+/* Opens a STREAMFILE that reads through a pool of pages (LRU, 0 = default count). Opening the same
+ * filename from it returns handles sharing the same pages, so multiple channels can read the same file
+ * with a single underlying streamfile. The pages are freed once all handles are closed.
+ * Handles aren't thread-safe, and borrowed data is only valid until the next call to any of them. */
+STREAMFILE *open_cache_streamfile(STREAMFILE *streamfile, int pages_count);
+
 /* Opens a STREAMFILE that doesn't close the underlying streamfile.
  * Calls to open won't wrap the new SF (assumes it needs to be closed).
  * Can be used in metas to test custom IO without closing the external SF. */
@@ -111,6 +141,14 @@ STREAMFILE *open_fakename_streamfile(STREAMFILE *streamfile, const char * fakena
  * The first streamfile is used to get names, stream index and so on. */
 STREAMFILE *open_multifile_streamfile(STREAMFILE **streamfiles, size_t streamfiles_size);
 
+/* Opens a STREAMFILE with no data that records calls to check_extensions made over it (which always fail).
+ * Can be passed to a meta's init function to find out which extensions it accepts. */
+STREAMFILE *open_probe_streamfile(void);
+
+/* Copies the extensions checked over a probe STREAMFILE (comma-separated, may repeat).
+ * Returns 0 if the probe was used for anything else (meaning extensions aren't a hard requirement). */
+int get_probe_streamfile_extensions(STREAMFILE *streamFile, char * buf, size_t buf_size);
+
 /* Opens a STREAMFILE from a (path)+filename.
  * Just a wrapper, to avoid having to access the STREAMFILE's callbacks directly. */
 STREAMFILE * open_streamfile(STREAMFILE *streamFile, const char * pathname);
@@ -135,6 +173,19 @@ static inline size_t read_streamfile(uint8_t * dest, off_t offset, size_t length
     return streamfile->read(streamfile,dest,offset,length);
 }
 
+/* Get a pointer to length bytes at offset without copying when possible (ex. from the STREAMFILE's buffer),
+ * otherwise reads into buf (must be length bytes). The data is only valid until the next STREAMFILE call.
+ * Returns NULL on failure (ex. reading past EOF). */
+static inline const uint8_t * borrow_streamfile(uint8_t * buf, off_t offset, size_t length, STREAMFILE * streamfile) {
+    if (streamfile->borrow) {
+        const uint8_t * data = streamfile->borrow(streamfile,offset,length);
+        if (data) return data;
+    }
+    if (read_streamfile(buf,offset,length,streamfile) != length)
+        return NULL;
+    return buf;
+}
+
 /* return file size */
 static inline size_t get_streamfile_size(STREAMFILE * streamfile) {
     return streamfile->get_size(streamfile);
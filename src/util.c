@@ -1,7 +1,37 @@
+#include <stdlib.h>
 #include <string.h>
 #include "util.h"
 #include "streamtypes.h"
 
+/* SIMD for sample kernels, chosen at compile time (always has a scalar fallback) */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTIL_SSE2
+#endif
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define UTIL_SSSE3
+#endif
+/* NEON paths are opt-in (-DVGM_USE_NEON) until tested on ARM hardware, scalar code is used otherwise */
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(VGM_USE_NEON)
+#include <arm_neon.h>
+#define UTIL_NEON
+#endif
+
+/* atomics for one-time init and locks (full barriers) */
+#if defined(_WIN32) || defined(WIN32)
+#include <windows.h>
+#define UTIL_ATOMIC_CAS(ptr, old_val, new_val)  InterlockedCompareExchange((LONG volatile *)(ptr), (new_val), (old_val))
+#define UTIL_YIELD()  Sleep(0)
+#else
+#include <sched.h>
+#ifndef VGM_NO_THREADS
+#include <pthread.h>
+#endif
+#define UTIL_ATOMIC_CAS(ptr, old_val, new_val)  __sync_val_compare_and_swap((ptr), (old_val), (new_val))
+#define UTIL_YIELD()  sched_yield()
+#endif
+
 const char * filename_extension(const char * pathname) {
     const char * filename;
     const char * extension;
@@ -84,6 +114,11 @@ void put_32bitLE(uint8_t * buf, int32_t i) {
     buf[3] = (uint8_t)((i >> 24) & 0xFF);
 }
 
+void put_64bitLE(uint8_t * buf, int64_t i) {
+    put_32bitLE(buf+0x00, (int32_t)(i & 0xFFFFFFFF));
+    put_32bitLE(buf+0x04, (int32_t)(i >> 32));
+}
+
 void put_16bitBE(uint8_t * buf, int16_t i) {
     buf[0] = i >> 8;
     buf[1] = (i & 0xFF);
@@ -96,8 +131,17 @@ void put_32bitBE(uint8_t * buf, int32_t i) {
     buf[3] = (uint8_t)(i & 0xFF);
 }
 
+static int util_is_little_endian(void) {
+    const uint16_t test = 0x0001;
+    return *(const uint8_t *)&test == 0x01;
+}
+
 void swap_samples_le(sample *buf, int count) {
     int i;
+
+    if (util_is_little_endian())
+        return; /* already in order */
+
     for (i=0;i<count;i++) {
         uint8_t b0 = buf[i]&0xff;
         uint8_t b1 = buf[i]>>8;
@@ -107,6 +151,975 @@ void swap_samples_le(sample *buf, int count) {
     }
 }
 
+void swap_samples_le_f32(float *buf, int count) {
+    int i;
+
+    if (util_is_little_endian())
+        return;
+
+    for (i = 0; i < count; i++) {
+        uint32_t bits;
+        memcpy(&bits, &buf[i], 4);
+        put_32bitLE((uint8_t*)&buf[i], (int32_t)bits);
+    }
+}
+
+void interleave_samples(sample *outbuf, const sample *planar, int channels, int samples_per_channel) {
+    int ch, s = 0;
+
+    /* common cases */
+    if (channels == 1) {
+        memcpy(outbuf, planar, samples_per_channel*sizeof(sample));
+        return;
+    }
+    if (channels == 2) {
+        const sample *ch0 = planar, *ch1 = planar + samples_per_channel;
+#if defined(UTIL_SSE2)
+        for (; s + 8 <= samples_per_channel; s += 8) {
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(ch0 + s));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(ch1 + s));
+            _mm_storeu_si128((__m128i*)(outbuf + s*2 + 0), _mm_unpacklo_epi16(v0, v1));
+            _mm_storeu_si128((__m128i*)(outbuf + s*2 + 8), _mm_unpackhi_epi16(v0, v1));
+        }
+#elif defined(UTIL_NEON)
+        for (; s + 8 <= samples_per_channel; s += 8) {
+            int16x8x2_t v;
+            v.val[0] = vld1q_s16(ch0 + s);
+            v.val[1] = vld1q_s16(ch1 + s);
+            vst2q_s16(outbuf + s*2, v);
+        }
+#endif
+        for (; s < samples_per_channel; s++) {
+            outbuf[s*2+0] = ch0[s];
+            outbuf[s*2+1] = ch1[s];
+        }
+        return;
+    }
+
+    for (s = 0; s < samples_per_channel; s++) {
+        for (ch = 0; ch < channels; ch++) {
+            outbuf[s*channels + ch] = planar[ch*samples_per_channel + s];
+        }
+    }
+}
+
+static void deinterleave_stereo(sample *ch0, sample *ch1, const sample *inbuf, int samples) {
+    int s = 0;
+
+#if defined(UTIL_SSE2)
+    for (; s + 8 <= samples; s += 8) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(inbuf + s*2 + 0));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(inbuf + s*2 + 8));
+        /* sign-extend even/odd samples to 32b (so packs doesn't saturate) then pack back */
+        __m128i e0 = _mm_srai_epi32(_mm_slli_epi32(v0, 16), 16);
+        __m128i e1 = _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16);
+        __m128i o0 = _mm_srai_epi32(v0, 16);
+        __m128i o1 = _mm_srai_epi32(v1, 16);
+        _mm_storeu_si128((__m128i*)(ch0 + s), _mm_packs_epi32(e0, e1));
+        _mm_storeu_si128((__m128i*)(ch1 + s), _mm_packs_epi32(o0, o1));
+    }
+#elif defined(UTIL_NEON)
+    for (; s + 8 <= samples; s += 8) {
+        int16x8x2_t v = vld2q_s16(inbuf + s*2);
+        vst1q_s16(ch0 + s, v.val[0]);
+        vst1q_s16(ch1 + s, v.val[1]);
+    }
+#endif
+    for (; s < samples; s++) {
+        ch0[s] = inbuf[s*2+0];
+        ch1[s] = inbuf[s*2+1];
+    }
+}
+
+void copy_channels(sample *outbuf, int out_channels, int out_start, const sample *inbuf, int in_channels, int samples) {
+    int ch, s;
+    sample *out = outbuf + out_start;
+
+    if (in_channels == out_channels) {
+        memcpy(out, inbuf, samples*in_channels*sizeof(sample));
+        return;
+    }
+    if (in_channels == 1) {
+        for (s = 0; s < samples; s++) {
+            out[s*out_channels] = inbuf[s];
+        }
+        return;
+    }
+    if (in_channels == 2) {
+        for (s = 0; s < samples; s++) {
+            out[s*out_channels + 0] = inbuf[s*2 + 0];
+            out[s*out_channels + 1] = inbuf[s*2 + 1];
+        }
+        return;
+    }
+
+    for (s = 0; s < samples; s++) {
+        for (ch = 0; ch < in_channels; ch++) {
+            out[s*out_channels + ch] = inbuf[s*in_channels + ch];
+        }
+    }
+}
+
+void remap_channels(sample *buf, int channels, int samples, const int *mapping, int mapping_count) {
+    sample frame[UTIL_MAX_REMAP_CHANNELS];
+    int ch, s = 0;
+
+    if (mapping_count > channels || mapping_count > UTIL_MAX_REMAP_CHANNELS)
+        return;
+
+#if defined(UTIL_SSSE3)
+    /* shuffle whole frames inside a vector */
+    if (mapping_count == channels && (channels == 2 || channels == 4 || channels == 8)) {
+        uint8_t control[16];
+        __m128i shuffle;
+        int i;
+
+        for (i = 0; i < 8; i++) {
+            int src = (i / channels) * channels + mapping[i % channels];
+            control[i*2 + 0] = (uint8_t)(src*2 + 0);
+            control[i*2 + 1] = (uint8_t)(src*2 + 1);
+        }
+        shuffle = _mm_loadu_si128((const __m128i*)control);
+
+        for (; s + 8 <= samples*channels; s += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(buf + s));
+            _mm_storeu_si128((__m128i*)(buf + s), _mm_shuffle_epi8(v, shuffle));
+        }
+        s = s / channels; /* continue with remaining frames */
+    }
+#endif
+
+    for (; s < samples; s++) {
+        sample *in = buf + s*channels;
+        memcpy(frame, in, mapping_count*sizeof(sample));
+        for (ch = 0; ch < mapping_count; ch++) {
+            in[ch] = frame[mapping[ch]];
+        }
+    }
+}
+
+void mask_channels(sample *buf, int channels, int samples, uint32_t channel_mask) {
+    int ch, i = 0;
+    int total = samples*channels;
+
+#if defined(UTIL_SSE2) || defined(UTIL_NEON)
+    /* a pattern of 8 frames, so vectors always start at the same pattern points */
+    if (channels <= 32) {
+        sample pattern[32*8];
+        int pattern_size = channels*8;
+        int p = 0;
+
+        for (i = 0; i < pattern_size; i++) {
+            ch = i % channels;
+            pattern[i] = ((channel_mask >> ch) & 1) ? -1 : 0;
+        }
+
+        for (i = 0; i + 8 <= total; i += 8) {
+#if defined(UTIL_SSE2)
+            __m128i v = _mm_loadu_si128((const __m128i*)(buf + i));
+            __m128i m = _mm_loadu_si128((const __m128i*)(pattern + p));
+            _mm_storeu_si128((__m128i*)(buf + i), _mm_and_si128(v, m));
+#else
+            vst1q_s16(buf + i, vandq_s16(vld1q_s16(buf + i), vld1q_s16(pattern + p)));
+#endif
+            p += 8;
+            if (p == pattern_size)
+                p = 0;
+        }
+    }
+#endif
+
+    for (; i < total; i++) {
+        ch = i % channels;
+        if (ch < 32 && ((channel_mask >> ch) & 1))
+            continue;
+        buf[i] = 0;
+    }
+}
+
+void split_channels(sample **outbufs, int out_start, const sample *inbuf, int channels, int samples) {
+    int ch, s;
+
+    if (channels == 1) {
+        memcpy(outbufs[0] + out_start, inbuf, samples*sizeof(sample));
+        return;
+    }
+    if (channels == 2) {
+        deinterleave_stereo(outbufs[0] + out_start, outbufs[1] + out_start, inbuf, samples);
+        return;
+    }
+
+    for (ch = 0; ch < channels; ch++) {
+        sample *out = outbufs[ch] + out_start;
+        for (s = 0; s < samples; s++) {
+            out[s] = inbuf[s*channels + ch];
+        }
+    }
+}
+
+void samples_to_f32(float *outbuf, const sample *inbuf, int count) {
+    int i = 0;
+
+#if defined(UTIL_SSE2)
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(inbuf + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); /* sign extend */
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(outbuf + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(outbuf + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(UTIL_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(inbuf + i);
+        vst1q_f32(outbuf + i + 0, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.0f / 32768.0f));
+        vst1q_f32(outbuf + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.0f / 32768.0f));
+    }
+#endif
+
+    for (; i < count; i++) {
+        outbuf[i] = inbuf[i] * (1.0f / 32768.0f);
+    }
+}
+
+/* float to 16-bit, saturating; NaN becomes -32768 (as x86's float to int) */
+static inline sample f32_to_sample(float f, f32_to_samples_t mode) {
+    int val;
+
+    if (mode == F32_TO_SAMPLES_ROUND) {
+        float y = f * 32767.0f + 0.5f;
+        if (y > 32768.0f)           y = 32768.0f;
+        else if (!(y >= -32769.0f)) y = -32769.0f;
+        val = (int)y;
+        if ((float)val > y) /* floor */
+            val--;
+        if (val < -32768) val = -32768;
+    }
+    else {
+        if (f > 1.0f)               f = 1.0f;
+        else if (!(f >= -1.0f))     f = -1.0f;
+        val = (int)(f * 32768.0f);
+    }
+
+    if (val > 32767) val = 32767;
+    return val;
+}
+
+#if defined(UTIL_SSE2)
+static inline __m128i f32_to_samples_x8(const float *inbuf, f32_to_samples_t mode) {
+    __m128 v0 = _mm_loadu_ps(inbuf + 0);
+    __m128 v1 = _mm_loadu_ps(inbuf + 4);
+    __m128i i0, i1;
+
+    /* min/max return the second operand on NaN, so NaN goes through and converts to 0x80000000 */
+    if (mode == F32_TO_SAMPLES_ROUND) {
+        const __m128 hi = _mm_set1_ps(32768.0f), lo = _mm_set1_ps(-32769.0f);
+        v0 = _mm_max_ps(lo, _mm_min_ps(hi, _mm_add_ps(_mm_mul_ps(v0, _mm_set1_ps(32767.0f)), _mm_set1_ps(0.5f))));
+        v1 = _mm_max_ps(lo, _mm_min_ps(hi, _mm_add_ps(_mm_mul_ps(v1, _mm_set1_ps(32767.0f)), _mm_set1_ps(0.5f))));
+        i0 = _mm_cvttps_epi32(v0);
+        i1 = _mm_cvttps_epi32(v1);
+        /* floor: truncated values over the original go down by one (mask is -1) */
+        i0 = _mm_add_epi32(i0, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i0), v0)));
+        i1 = _mm_add_epi32(i1, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i1), v1)));
+    }
+    else {
+        const __m128 hi = _mm_set1_ps(1.0f), lo = _mm_set1_ps(-1.0f);
+        i0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_max_ps(lo, _mm_min_ps(hi, v0)), _mm_set1_ps(32768.0f)));
+        i1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_max_ps(lo, _mm_min_ps(hi, v1)), _mm_set1_ps(32768.0f)));
+    }
+
+    return _mm_packs_epi32(i0, i1);
+}
+#elif defined(UTIL_NEON)
+static inline int16x8_t f32_to_samples_x8(const float *inbuf, f32_to_samples_t mode) {
+    float32x4_t v0 = vld1q_f32(inbuf + 0);
+    float32x4_t v1 = vld1q_f32(inbuf + 4);
+    int32x4_t i0, i1;
+
+    /* NaN converts to 0 here, so it's replaced first */
+    if (mode == F32_TO_SAMPLES_ROUND) {
+        const float32x4_t hi = vdupq_n_f32(32768.0f), lo = vdupq_n_f32(-32769.0f);
+        v0 = vaddq_f32(vmulq_n_f32(v0, 32767.0f), vdupq_n_f32(0.5f));
+        v1 = vaddq_f32(vmulq_n_f32(v1, 32767.0f), vdupq_n_f32(0.5f));
+        v0 = vmaxq_f32(vminq_f32(vbslq_f32(vceqq_f32(v0, v0), v0, lo), hi), lo);
+        v1 = vmaxq_f32(vminq_f32(vbslq_f32(vceqq_f32(v1, v1), v1, lo), hi), lo);
+        i0 = vcvtq_s32_f32(v0);
+        i1 = vcvtq_s32_f32(v1);
+        i0 = vaddq_s32(i0, vreinterpretq_s32_u32(vcgtq_f32(vcvtq_f32_s32(i0), v0)));
+        i1 = vaddq_s32(i1, vreinterpretq_s32_u32(vcgtq_f32(vcvtq_f32_s32(i1), v1)));
+    }
+    else {
+        const float32x4_t hi = vdupq_n_f32(1.0f), lo = vdupq_n_f32(-1.0f);
+        v0 = vmaxq_f32(vminq_f32(vbslq_f32(vceqq_f32(v0, v0), v0, lo), hi), lo);
+        v1 = vmaxq_f32(vminq_f32(vbslq_f32(vceqq_f32(v1, v1), v1, lo), hi), lo);
+        i0 = vcvtq_s32_f32(vmulq_n_f32(v0, 32768.0f));
+        i1 = vcvtq_s32_f32(vmulq_n_f32(v1, 32768.0f));
+    }
+
+    return vcombine_s16(vqmovn_s32(i0), vqmovn_s32(i1));
+}
+#endif
+
+void f32_to_samples(sample *outbuf, const float *inbuf, int count, f32_to_samples_t mode) {
+    int i = 0;
+
+#if defined(UTIL_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128((__m128i*)(outbuf + i), f32_to_samples_x8(inbuf + i, mode));
+    }
+#elif defined(UTIL_NEON)
+    for (; i + 8 <= count; i += 8) {
+        vst1q_s16(outbuf + i, f32_to_samples_x8(inbuf + i, mode));
+    }
+#endif
+
+    for (; i < count; i++) {
+        outbuf[i] = f32_to_sample(inbuf[i], mode);
+    }
+}
+
+void f32_interleave_to_samples(sample *outbuf, const float * const *inbufs, int channels, int samples, f32_to_samples_t mode) {
+    sample temp[256];
+    int ch, s = 0, i;
+
+    if (channels == 1) {
+        f32_to_samples(outbuf, inbufs[0], samples, mode);
+        return;
+    }
+    if (channels == 2) {
+        const float *ch0 = inbufs[0], *ch1 = inbufs[1];
+#if defined(UTIL_SSE2)
+        for (; s + 8 <= samples; s += 8) {
+            __m128i v0 = f32_to_samples_x8(ch0 + s, mode);
+            __m128i v1 = f32_to_samples_x8(ch1 + s, mode);
+            _mm_storeu_si128((__m128i*)(outbuf + s*2 + 0), _mm_unpacklo_epi16(v0, v1));
+            _mm_storeu_si128((__m128i*)(outbuf + s*2 + 8), _mm_unpackhi_epi16(v0, v1));
+        }
+#elif defined(UTIL_NEON)
+        for (; s + 8 <= samples; s += 8) {
+            int16x8x2_t v;
+            v.val[0] = f32_to_samples_x8(ch0 + s, mode);
+            v.val[1] = f32_to_samples_x8(ch1 + s, mode);
+            vst2q_s16(outbuf + s*2, v);
+        }
+#endif
+        for (; s < samples; s++) {
+            outbuf[s*2+0] = f32_to_sample(ch0[s], mode);
+            outbuf[s*2+1] = f32_to_sample(ch1[s], mode);
+        }
+        return;
+    }
+
+    /* convert each channel's chunk at once, then spread it */
+    for (; s < samples; s += 256) {
+        int chunk = samples - s < 256 ? samples - s : 256;
+        for (ch = 0; ch < channels; ch++) {
+            f32_to_samples(temp, inbufs[ch] + s, chunk, mode);
+            for (i = 0; i < chunk; i++) {
+                outbuf[(s + i)*channels + ch] = temp[i];
+            }
+        }
+    }
+}
+
+void copy_channels_f32(float *outbuf, int out_channels, int out_start, const float *inbuf, int in_channels, int samples) {
+    int ch, s;
+    float *out = outbuf + out_start;
+
+    if (in_channels == out_channels) {
+        memcpy(out, inbuf, samples*in_channels*sizeof(float));
+        return;
+    }
+
+    for (s = 0; s < samples; s++) {
+        for (ch = 0; ch < in_channels; ch++) {
+            out[s*out_channels + ch] = inbuf[s*in_channels + ch];
+        }
+    }
+}
+
+void remap_channels_f32(float *buf, int channels, int samples, const int *mapping, int mapping_count) {
+    float frame[UTIL_MAX_REMAP_CHANNELS];
+    int ch, s;
+
+    if (mapping_count > channels || mapping_count > UTIL_MAX_REMAP_CHANNELS)
+        return;
+
+    for (s = 0; s < samples; s++) {
+        float *in = buf + s*channels;
+        memcpy(frame, in, mapping_count*sizeof(float));
+        for (ch = 0; ch < mapping_count; ch++) {
+            in[ch] = frame[mapping[ch]];
+        }
+    }
+}
+
+void mask_channels_f32(float *buf, int channels, int samples, uint32_t channel_mask) {
+    int ch, s;
+
+    for (s = 0; s < samples; s++) {
+        for (ch = 0; ch < channels; ch++) {
+            if (ch < 32 && ((channel_mask >> ch) & 1))
+                continue;
+            buf[s*channels + ch] = 0.0f;
+        }
+    }
+}
+
+void select_channels(sample *outbuf, const sample *inbuf, int in_channels, const int *channel_list, int out_channels, int samples) {
+    int ch, s = 0;
+
+    if (out_channels == in_channels) {
+        for (ch = 0; ch < out_channels && channel_list[ch] == ch; ch++) {
+            ;
+        }
+        if (ch == out_channels) {
+            memcpy(outbuf, inbuf, samples*in_channels*sizeof(sample));
+            return;
+        }
+    }
+
+#if defined(UTIL_SSSE3)
+    /* one frame per vector, picking channels with a byte shuffle; stores are whole vectors (the excess
+     * is overwritten by the next frame) so stops while reads and writes fit the buffers */
+    if (in_channels <= 8 && out_channels <= 8) {
+        uint8_t control[16];
+        __m128i shuffle;
+        int i;
+
+        for (i = 0; i < 16; i++) {
+            control[i] = 0x80;
+        }
+        for (ch = 0; ch < out_channels; ch++) {
+            control[ch*2 + 0] = (uint8_t)(channel_list[ch]*2 + 0);
+            control[ch*2 + 1] = (uint8_t)(channel_list[ch]*2 + 1);
+        }
+        shuffle = _mm_loadu_si128((const __m128i*)control);
+
+        for (; s*in_channels + 8 <= samples*in_channels && s*out_channels + 8 <= samples*out_channels; s++) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(inbuf + s*in_channels));
+            _mm_storeu_si128((__m128i*)(outbuf + s*out_channels), _mm_shuffle_epi8(v, shuffle));
+        }
+    }
+#elif defined(UTIL_NEON)
+    /* same with a table lookup, that outputs half a vector */
+    if (in_channels <= 8 && out_channels <= 4) {
+        uint8_t control[8];
+        uint8x8_t lookup;
+        int i;
+
+        for (i = 0; i < 8; i++) {
+            control[i] = 0xFF;
+        }
+        for (ch = 0; ch < out_channels; ch++) {
+            control[ch*2 + 0] = (uint8_t)(channel_list[ch]*2 + 0);
+            control[ch*2 + 1] = (uint8_t)(channel_list[ch]*2 + 1);
+        }
+        lookup = vld1_u8(control);
+
+        for (; s*in_channels + 8 <= samples*in_channels && s*out_channels + 4 <= samples*out_channels; s++) {
+            const uint8_t *in = (const uint8_t*)(inbuf + s*in_channels);
+            uint8x8x2_t v;
+            v.val[0] = vld1_u8(in + 0);
+            v.val[1] = vld1_u8(in + 8);
+            vst1_u8((uint8_t*)(outbuf + s*out_channels), vtbl2_u8(v, lookup));
+        }
+    }
+#endif
+
+    if (out_channels == 2) {
+        int ch0 = channel_list[0], ch1 = channel_list[1];
+        for (; s < samples; s++) {
+            outbuf[s*2 + 0] = inbuf[s*in_channels + ch0];
+            outbuf[s*2 + 1] = inbuf[s*in_channels + ch1];
+        }
+        return;
+    }
+
+    for (; s < samples; s++) {
+        for (ch = 0; ch < out_channels; ch++) {
+            outbuf[s*out_channels + ch] = inbuf[s*in_channels + channel_list[ch]];
+        }
+    }
+}
+
+void select_channels_f32(float *outbuf, const float *inbuf, int in_channels, const int *channel_list, int out_channels, int samples) {
+    int ch, s;
+
+    if (out_channels == in_channels) {
+        for (ch = 0; ch < out_channels && channel_list[ch] == ch; ch++) {
+            ;
+        }
+        if (ch == out_channels) {
+            memcpy(outbuf, inbuf, samples*in_channels*sizeof(float));
+            return;
+        }
+    }
+
+    /* frames of floats are too big to shuffle in a SSE2/NEON vector, so plain copies */
+    for (s = 0; s < samples; s++) {
+        for (ch = 0; ch < out_channels; ch++) {
+            outbuf[s*out_channels + ch] = inbuf[s*in_channels + channel_list[ch]];
+        }
+    }
+}
+
+#define UTIL_FADE_BLOCK 1024 /* samples (must fit a frame of max channels) */
+
+/* per-sample gains for a block of frames (doubles only fit 2 per vector, and NEON on ARMv7 has none, so SSE2 only) */
+static void fade_gains(double *gains, int channels, int frames, int32_t fade_pos, int32_t fade_length) {
+    int f = 0, ch;
+
+#if defined(UTIL_SSE2)
+    if (channels <= 2) {
+        const __m128d length = _mm_set1_pd((double)fade_length);
+        const __m128d step = _mm_set1_pd(2.0);
+        __m128d left = _mm_set_pd((double)(fade_length - fade_pos - 1), (double)(fade_length - fade_pos));
+
+        for (; f + 2 <= frames; f += 2) {
+            __m128d g = _mm_div_pd(left, length);
+            if (channels == 1) {
+                _mm_storeu_pd(gains + f, g);
+            }
+            else {
+                _mm_storeu_pd(gains + f*2 + 0, _mm_unpacklo_pd(g, g));
+                _mm_storeu_pd(gains + f*2 + 2, _mm_unpackhi_pd(g, g));
+            }
+            left = _mm_sub_pd(left, step);
+        }
+    }
+#endif
+
+    for (; f < frames; f++) {
+        double gain = (double)(fade_length - (fade_pos + f)) / fade_length;
+        for (ch = 0; ch < channels; ch++) {
+            gains[f*channels + ch] = gain;
+        }
+    }
+}
+
+void fade_channels(sample *buf, int channels, int samples, int32_t fade_pos, int32_t fade_length) {
+    double gains[UTIL_FADE_BLOCK];
+    int frames_max = UTIL_FADE_BLOCK / channels;
+    int done = 0;
+
+    while (done < samples) {
+        int frames = samples - done > frames_max ? frames_max : samples - done;
+        sample *block = buf + done*channels;
+        int i = 0, total = frames*channels;
+
+        fade_gains(gains, channels, frames, fade_pos + done, fade_length);
+
+#if defined(UTIL_SSE2)
+        for (; i + 8 <= total; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(block + i));
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            __m128i r0, r1, r2, r3;
+
+            /* truncated like a (sample) cast */
+            r0 = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(lo), _mm_loadu_pd(gains + i + 0)));
+            r1 = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), _mm_loadu_pd(gains + i + 2)));
+            r2 = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(hi), _mm_loadu_pd(gains + i + 4)));
+            r3 = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), _mm_loadu_pd(gains + i + 6)));
+            lo = _mm_unpacklo_epi64(r0, r1);
+            hi = _mm_unpacklo_epi64(r2, r3);
+            _mm_storeu_si128((__m128i*)(block + i), _mm_packs_epi32(lo, hi));
+        }
+#endif
+
+        for (; i < total; i++) {
+            block[i] = (sample)(block[i] * gains[i]);
+        }
+
+        done += frames;
+    }
+}
+
+void fade_channels_f32(float *buf, int channels, int samples, int32_t fade_pos, int32_t fade_length) {
+    double gains[UTIL_FADE_BLOCK];
+    int frames_max = UTIL_FADE_BLOCK / channels;
+    int done = 0;
+
+    while (done < samples) {
+        int frames = samples - done > frames_max ? frames_max : samples - done;
+        float *block = buf + done*channels;
+        int i = 0, total = frames*channels;
+
+        fade_gains(gains, channels, frames, fade_pos + done, fade_length);
+
+#if defined(UTIL_SSE2)
+        for (; i + 4 <= total; i += 4) {
+            __m128 v = _mm_loadu_ps(block + i);
+            __m128d r0 = _mm_mul_pd(_mm_cvtps_pd(v), _mm_loadu_pd(gains + i + 0));
+            __m128d r1 = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), _mm_loadu_pd(gains + i + 2));
+            _mm_storeu_ps(block + i, _mm_movelh_ps(_mm_cvtpd_ps(r0), _mm_cvtpd_ps(r1)));
+        }
+#endif
+
+        for (; i < total; i++) {
+            block[i] = (float)(block[i] * gains[i]);
+        }
+
+        done += frames;
+    }
+}
+
+
+void vgm_once(vgm_once_t *once, void (*init_fn)(void)) {
+    /* states: 0=not done, 1=running, 2=done */
+    if (UTIL_ATOMIC_CAS(once, 0, 1) == 0) {
+        init_fn();
+        UTIL_ATOMIC_CAS(once, 1, 2);
+        return;
+    }
+
+    while (UTIL_ATOMIC_CAS(once, 2, 2) != 2) {
+        UTIL_YIELD();
+    }
+}
+
+int vgm_once_flag(vgm_once_t *flag) {
+    return UTIL_ATOMIC_CAS(flag, 0, 1) == 0;
+}
+
+void vgm_lock(vgm_lock_t *lock) {
+    while (UTIL_ATOMIC_CAS(lock, 0, 1) != 0) {
+        UTIL_YIELD();
+    }
+}
+
+void vgm_unlock(vgm_lock_t *lock) {
+    UTIL_ATOMIC_CAS(lock, 1, 0);
+}
+
+
+#if defined(VGM_NO_THREADS)
+/* no thread support: the mutex still works for callers' own threads, but nothing can wait or start */
+struct vgm_mutex { vgm_lock_t lock; };
+
+vgm_mutex * vgm_mutex_init(void) {
+    return calloc(1, sizeof(vgm_mutex));
+}
+void vgm_mutex_free(vgm_mutex *mutex) {
+    free(mutex);
+}
+void vgm_mutex_lock(vgm_mutex *mutex) {
+    vgm_lock(&mutex->lock);
+}
+void vgm_mutex_unlock(vgm_mutex *mutex) {
+    vgm_unlock(&mutex->lock);
+}
+
+vgm_cond * vgm_cond_init(void) {
+    return NULL;
+}
+void vgm_cond_free(vgm_cond *cond) {
+}
+void vgm_cond_wait(vgm_cond *cond, vgm_mutex *mutex) {
+}
+void vgm_cond_broadcast(vgm_cond *cond) {
+}
+
+vgm_thread * vgm_thread_start(void (*thread_fn)(void *), void *arg) {
+    return NULL;
+}
+void vgm_thread_join(vgm_thread *thread) {
+}
+#elif defined(_WIN32) || defined(WIN32)
+/* XP has no condition variables: waiters sleep on a semaphore, and broadcast (with the mutex held, so
+ * no new waiters can take the wakeups) releases all current waiters then waits until they are awake */
+struct vgm_mutex { CRITICAL_SECTION cs; };
+struct vgm_cond { CRITICAL_SECTION cs; HANDLE wait_sem; HANDLE done_sem; int waiting; int signals; };
+struct vgm_thread { HANDLE handle; void (*thread_fn)(void *); void *arg; };
+
+vgm_mutex * vgm_mutex_init(void) {
+    vgm_mutex *mutex = malloc(sizeof(vgm_mutex));
+    if (!mutex) return NULL;
+    InitializeCriticalSection(&mutex->cs);
+    return mutex;
+}
+void vgm_mutex_free(vgm_mutex *mutex) {
+    if (!mutex) return;
+    DeleteCriticalSection(&mutex->cs);
+    free(mutex);
+}
+void vgm_mutex_lock(vgm_mutex *mutex) {
+    EnterCriticalSection(&mutex->cs);
+}
+void vgm_mutex_unlock(vgm_mutex *mutex) {
+    LeaveCriticalSection(&mutex->cs);
+}
+
+vgm_cond * vgm_cond_init(void) {
+    vgm_cond *cond = calloc(1, sizeof(vgm_cond));
+    if (!cond) return NULL;
+    cond->wait_sem = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+    cond->done_sem = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+    if (!cond->wait_sem || !cond->done_sem) {
+        if (cond->wait_sem) CloseHandle(cond->wait_sem);
+        if (cond->done_sem) CloseHandle(cond->done_sem);
+        free(cond);
+        return NULL;
+    }
+    InitializeCriticalSection(&cond->cs);
+    return cond;
+}
+void vgm_cond_free(vgm_cond *cond) {
+    if (!cond) return;
+    CloseHandle(cond->wait_sem);
+    CloseHandle(cond->done_sem);
+    DeleteCriticalSection(&cond->cs);
+    free(cond);
+}
+void vgm_cond_wait(vgm_cond *cond, vgm_mutex *mutex) {
+    EnterCriticalSection(&cond->cs);
+    cond->waiting++;
+    LeaveCriticalSection(&cond->cs);
+
+    LeaveCriticalSection(&mutex->cs);
+    WaitForSingleObject(cond->wait_sem, INFINITE);
+
+    EnterCriticalSection(&cond->cs);
+    if (cond->signals > 0) {
+        cond->signals--;
+        ReleaseSemaphore(cond->done_sem, 1, NULL);
+    }
+    cond->waiting--;
+    LeaveCriticalSection(&cond->cs);
+
+    EnterCriticalSection(&mutex->cs);
+}
+void vgm_cond_broadcast(vgm_cond *cond) {
+    int i, count;
+
+    EnterCriticalSection(&cond->cs);
+    count = cond->waiting - cond->signals;
+    if (count > 0) {
+        cond->signals = cond->waiting;
+        ReleaseSemaphore(cond->wait_sem, count, NULL);
+    }
+    LeaveCriticalSection(&cond->cs);
+
+    for (i = 0; i < count; i++) {
+        WaitForSingleObject(cond->done_sem, INFINITE);
+    }
+}
+
+static DWORD WINAPI vgm_thread_main(LPVOID arg) {
+    vgm_thread *thread = arg;
+    thread->thread_fn(thread->arg);
+    return 0;
+}
+vgm_thread * vgm_thread_start(void (*thread_fn)(void *), void *arg) {
+    vgm_thread *thread = malloc(sizeof(vgm_thread));
+    if (!thread) return NULL;
+    thread->thread_fn = thread_fn;
+    thread->arg = arg;
+    thread->handle = CreateThread(NULL, 0, vgm_thread_main, thread, 0, NULL);
+    if (!thread->handle) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+void vgm_thread_join(vgm_thread *thread) {
+    if (!thread) return;
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+#else
+struct vgm_mutex { pthread_mutex_t m; };
+struct vgm_cond { pthread_cond_t c; };
+struct vgm_thread { pthread_t t; void (*thread_fn)(void *); void *arg; };
+
+vgm_mutex * vgm_mutex_init(void) {
+    vgm_mutex *mutex = malloc(sizeof(vgm_mutex));
+    if (!mutex) return NULL;
+    if (pthread_mutex_init(&mutex->m, NULL) != 0) {
+        free(mutex);
+        return NULL;
+    }
+    return mutex;
+}
+void vgm_mutex_free(vgm_mutex *mutex) {
+    if (!mutex) return;
+    pthread_mutex_destroy(&mutex->m);
+    free(mutex);
+}
+void vgm_mutex_lock(vgm_mutex *mutex) {
+    pthread_mutex_lock(&mutex->m);
+}
+void vgm_mutex_unlock(vgm_mutex *mutex) {
+    pthread_mutex_unlock(&mutex->m);
+}
+
+vgm_cond * vgm_cond_init(void) {
+    vgm_cond *cond = malloc(sizeof(vgm_cond));
+    if (!cond) return NULL;
+    if (pthread_cond_init(&cond->c, NULL) != 0) {
+        free(cond);
+        return NULL;
+    }
+    return cond;
+}
+void vgm_cond_free(vgm_cond *cond) {
+    if (!cond) return;
+    pthread_cond_destroy(&cond->c);
+    free(cond);
+}
+void vgm_cond_wait(vgm_cond *cond, vgm_mutex *mutex) {
+    pthread_cond_wait(&cond->c, &mutex->m);
+}
+void vgm_cond_broadcast(vgm_cond *cond) {
+    pthread_cond_broadcast(&cond->c);
+}
+
+static void * vgm_thread_main(void *arg) {
+    vgm_thread *thread = arg;
+    thread->thread_fn(thread->arg);
+    return NULL;
+}
+vgm_thread * vgm_thread_start(void (*thread_fn)(void *), void *arg) {
+    vgm_thread *thread = malloc(sizeof(vgm_thread));
+    if (!thread) return NULL;
+    thread->thread_fn = thread_fn;
+    thread->arg = arg;
+    if (pthread_create(&thread->t, NULL, vgm_thread_main, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+void vgm_thread_join(vgm_thread *thread) {
+    if (!thread) return;
+    pthread_join(thread->t, NULL);
+    free(thread);
+}
+#endif
+
+
+struct vgm_pool {
+    vgm_mutex *mutex;
+    vgm_cond *work_cond;    /* signaled on a new run or exit */
+    vgm_cond *done_cond;    /* signaled when a run's last item finishes */
+    vgm_thread **threads;
+    int thread_count;
+    int exit;
+
+    /* current run */
+    void (*item_fn)(void *, int);
+    void *arg;
+    int count;
+    int next;
+    int done;
+    int run_id;             /* so workers can tell a new run from a spurious wakeup */
+};
+
+/* takes items until none are left (mutex is locked on enter and exit) */
+static void vgm_pool_work(vgm_pool *pool) {
+    while (pool->next < pool->count) {
+        int item = pool->next++;
+
+        vgm_mutex_unlock(pool->mutex);
+        pool->item_fn(pool->arg, item);
+        vgm_mutex_lock(pool->mutex);
+
+        pool->done++;
+        if (pool->done == pool->count)
+            vgm_cond_broadcast(pool->done_cond);
+    }
+}
+
+static void vgm_pool_main(void *arg) {
+    vgm_pool *pool = arg;
+    int run_id = 0;
+
+    vgm_mutex_lock(pool->mutex);
+    while (1) {
+        while (!pool->exit && pool->run_id == run_id) {
+            vgm_cond_wait(pool->work_cond, pool->mutex);
+        }
+        if (pool->exit)
+            break;
+
+        run_id = pool->run_id;
+        vgm_pool_work(pool);
+    }
+    vgm_mutex_unlock(pool->mutex);
+}
+
+vgm_pool * vgm_pool_init(int threads) {
+    vgm_pool *pool = NULL;
+    int i;
+
+    if (threads < 2)
+        goto fail;
+
+    pool = calloc(1, sizeof(vgm_pool));
+    if (!pool) goto fail;
+
+    pool->mutex = vgm_mutex_init();
+    pool->work_cond = vgm_cond_init();
+    pool->done_cond = vgm_cond_init();
+    pool->threads = calloc(threads - 1, sizeof(vgm_thread*));
+    if (!pool->mutex || !pool->work_cond || !pool->done_cond || !pool->threads)
+        goto fail;
+
+    for (i = 0; i < threads - 1; i++) {
+        pool->threads[i] = vgm_thread_start(vgm_pool_main, pool);
+        if (!pool->threads[i]) goto fail;
+        pool->thread_count++;
+    }
+
+    return pool;
+fail:
+    vgm_pool_free(pool);
+    return NULL;
+}
+
+void vgm_pool_free(vgm_pool *pool) {
+    int i;
+
+    if (!pool)
+        return;
+
+    if (pool->mutex && pool->work_cond) {
+        vgm_mutex_lock(pool->mutex);
+        pool->exit = 1;
+        vgm_cond_broadcast(pool->work_cond);
+        vgm_mutex_unlock(pool->mutex);
+    }
+
+    for (i = 0; i < pool->thread_count; i++) {
+        vgm_thread_join(pool->threads[i]);
+    }
+
+    free(pool->threads);
+    vgm_cond_free(pool->done_cond);
+    vgm_cond_free(pool->work_cond);
+    vgm_mutex_free(pool->mutex);
+    free(pool);
+}
+
+void vgm_pool_run(vgm_pool *pool, void (*item_fn)(void *, int), void *arg, int count) {
+    vgm_mutex_lock(pool->mutex);
+    pool->item_fn = item_fn;
+    pool->arg = arg;
+    pool->count = count;
+    pool->next = 0;
+    pool->done = 0;
+    pool->run_id++;
+    vgm_cond_broadcast(pool->work_cond);
+
+    vgm_pool_work(pool); /* caller helps too */
+    while (pool->done < pool->count) {
+        vgm_cond_wait(pool->done_cond, pool->mutex);
+    }
+    vgm_mutex_unlock(pool->mutex);
+}
+
 /* length is maximum length of dst. dst will always be null-terminated if
  * length > 0 */
 void concatn(int length, char * dst, const char * src) {
@@ -39,12 +39,14 @@ void put_16bitLE(uint8_t * buf, int16_t i);
 
 void put_32bitLE(uint8_t * buf, int32_t i);
 
+void put_64bitLE(uint8_t * buf, int64_t i);
+
 void put_16bitBE(uint8_t * buf, int16_t i);
 
 void put_32bitBE(uint8_t * buf, int32_t i);
 
 /* signed nibbles come up a lot */
-static int nibble_to_int[16] = {0,1,2,3,4,5,6,7,-8,-7,-6,-5,-4,-3,-2,-1};
+static const int nibble_to_int[16] = {0,1,2,3,4,5,6,7,-8,-7,-6,-5,-4,-3,-2,-1};
 
 static inline int get_nibble_signed(uint8_t n, int upper) {
     /*return ((n&0x70)-(n&0x80))>>4;*/
@@ -79,10 +81,99 @@ static inline int round10(int val) {
  * extension in the original filename or the ending null byte if no extension */
 const char * filename_extension(const char * filename);
 
+/* converts samples to little endian in place (nothing to do on LE machines) */
 void swap_samples_le(sample *buf, int count);
+void swap_samples_le_f32(float *buf, int count);
+
+/* Sample kernels (vectorized when possible). Planar means all of channel 0, then all of channel 1, etc. */
+
+/* interleaves planar samples into outbuf */
+void interleave_samples(sample *outbuf, const sample *planar, int channels, int samples_per_channel);
+
+/* copies interleaved inbuf's channels into outbuf's channels starting at out_start (out_channels >= out_start + in_channels) */
+void copy_channels(sample *outbuf, int out_channels, int out_start, const sample *inbuf, int in_channels, int samples);
+
+/* reorders the first mapping_count channels of each frame, so that channel N gets channel mapping[N] */
+#define UTIL_MAX_REMAP_CHANNELS 64
+void remap_channels(sample *buf, int channels, int samples, const int *mapping, int mapping_count);
+
+/* silences channels not set in the mask (channels over 32 are always silenced) */
+void mask_channels(sample *buf, int channels, int samples, uint32_t channel_mask);
+
+/* splits interleaved inbuf into separate channel buffers, written starting at outbufs[ch][out_start] */
+void split_channels(sample **outbufs, int out_start, const sample *inbuf, int channels, int samples);
+
+/* converts 16-bit samples to float (-1.0..1.0) */
+void samples_to_f32(float *outbuf, const sample *inbuf, int count);
+
+/* converts float samples (-1.0..1.0) to 16-bit, saturating; results match the usual scalar formulas */
+typedef enum {
+    F32_TO_SAMPLES_TRUNC,   /* (int)(x * 32768) */
+    F32_TO_SAMPLES_ROUND    /* floor(x * 32767 + 0.5), as libvorbis */
+} f32_to_samples_t;
+void f32_to_samples(sample *outbuf, const float *inbuf, int count, f32_to_samples_t mode);
+
+/* converts and interleaves separate channel buffers (inbufs[ch][0..samples-1]) into outbuf */
+void f32_interleave_to_samples(sample *outbuf, const float * const *inbufs, int channels, int samples, f32_to_samples_t mode);
+
+/* float versions of the channel kernels above */
+void copy_channels_f32(float *outbuf, int out_channels, int out_start, const float *inbuf, int in_channels, int samples);
+void remap_channels_f32(float *buf, int channels, int samples, const int *mapping, int mapping_count);
+void mask_channels_f32(float *buf, int channels, int samples, uint32_t channel_mask);
+
+/* copies the channel_list channels of each inbuf frame, in that order, as outbuf frames of out_channels */
+void select_channels(sample *outbuf, const sample *inbuf, int in_channels, const int *channel_list, int out_channels, int samples);
+void select_channels_f32(float *outbuf, const float *inbuf, int in_channels, const int *channel_list, int out_channels, int samples);
+
+/* applies a fade-out gain ramp, (fade_length - pos) / fade_length for frames at fade_pos onwards (pos < fade_length),
+ * computed and applied as double so results match the usual scalar loop */
+void fade_channels(sample *buf, int channels, int samples, int32_t fade_pos, int32_t fade_length);
+void fade_channels_f32(float *buf, int channels, int samples, int32_t fade_pos, int32_t fade_length);
 
 void concatn(int length, char * dst, const char * src);
 
+/* Thread-safe one-time init: the first caller runs init_fn, while other callers wait until it's done.
+ * Must be zero-initialized (ex. static vgm_once_t my_once;). */
+typedef volatile long vgm_once_t;
+void vgm_once(vgm_once_t *once, void (*init_fn)(void));
+
+/* Returns 1 for the first caller only (atomic test-and-set), ex. to log something once. */
+int vgm_once_flag(vgm_once_t *flag);
+
+/* Minimal lock for short critical sections over shared caches (spins/yields while taken).
+ * Must be zero-initialized (ex. static vgm_lock_t my_lock;). */
+typedef volatile long vgm_lock_t;
+void vgm_lock(vgm_lock_t *lock);
+void vgm_unlock(vgm_lock_t *lock);
+
+/* Minimal threads (pthreads or Win32, XP+), for optional background work. Objects are opaque and allocated,
+ * init/start functions return NULL on failure (callers should then work without them).
+ * Builds with VGM_NO_THREADS don't need pthreads: mutexes spin, and conds/threads are never created. */
+typedef struct vgm_mutex vgm_mutex;
+typedef struct vgm_cond vgm_cond;
+typedef struct vgm_thread vgm_thread;
+
+vgm_mutex * vgm_mutex_init(void);
+void vgm_mutex_free(vgm_mutex *mutex);
+void vgm_mutex_lock(vgm_mutex *mutex);
+void vgm_mutex_unlock(vgm_mutex *mutex);
+
+vgm_cond * vgm_cond_init(void);
+void vgm_cond_free(vgm_cond *cond);
+void vgm_cond_wait(vgm_cond *cond, vgm_mutex *mutex); /* mutex must be locked */
+void vgm_cond_broadcast(vgm_cond *cond); /* mutex must be locked too */
+
+vgm_thread * vgm_thread_start(void (*thread_fn)(void *), void *arg);
+void vgm_thread_join(vgm_thread *thread); /* also frees it */
+
+/* Persistent worker pool: vgm_pool_run calls item_fn(arg, item) for items 0..count-1 spread over the
+ * workers plus the calling thread, returning once all are done. Workers sleep between runs. */
+typedef struct vgm_pool vgm_pool;
+
+vgm_pool * vgm_pool_init(int threads); /* total threads, including the caller's */
+void vgm_pool_free(vgm_pool *pool);
+void vgm_pool_run(vgm_pool *pool, void (*item_fn)(void *, int), void *arg, int count);
+
 
 /* Simple stdout logging for debugging and regression testing purposes.
  * Needs C99 variadic macros, uses do..while to force ";" as statement */
@@ -92,12 +183,12 @@ void concatn(int length, char * dst, const char * src);
 #define VGM_ASSERT(condition, ...) \
     do { if (condition) {printf(__VA_ARGS__);} } while (0)
 #define VGM_ASSERT_ONCE(condition, ...) \
-    do { static int written; if (!written) { if (condition) {printf(__VA_ARGS__); written = 1;} }  } while (0)
+    do { static vgm_once_t written; if (!written && (condition) && vgm_once_flag(&written)) {printf(__VA_ARGS__);} } while (0)
 /* equivalent to printf */
 #define VGM_LOG(...) \
     do { printf(__VA_ARGS__); } while (0)
 #define VGM_LOG_ONCE(...) \
-    do { static int written; if (!written) { printf(__VA_ARGS__); written = 1; } } while (0)
+    do { static vgm_once_t written; if (!written && vgm_once_flag(&written)) { printf(__VA_ARGS__); } } while (0)
 /* prints file/line/func */
 #define VGM_LOGF() \
     do { printf("%s:%i '%s'\n",  __FILE__, __LINE__, __func__); } while (0)
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <ctype.h>
 #include "vgmstream.h"
 #include "meta/meta.h"
 #include "layout/layout.h"
@@ -463,79 +464,320 @@ VGMSTREAM * (*init_vgmstream_functions[])(STREAMFILE *streamFile) = {
 };
 
 
-/* internal version with all parameters */
-static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile) {
-    int i, fcns_size;
-    
-    if (!streamFile)
-        return NULL;
+/* Format index: which init functions may accept each extension, built once by dry-running every
+ * init function over a probe STREAMFILE. Functions that need more than the extension to decide
+ * (or check nothing) are "wildcards" and are candidates for every extension. */
+#define FORMAT_INDEX_EXT_MAX 16
 
-    fcns_size = (sizeof(init_vgmstream_functions)/sizeof(init_vgmstream_functions[0]));
-    /* try a series of formats, see which works */
-    for (i=0; i < fcns_size; i++) {
-        /* call init function and see if valid VGMSTREAM was returned */
-        VGMSTREAM * vgmstream = (init_vgmstream_functions[i])(streamFile);
-        if (!vgmstream)
-            continue;
+typedef struct {
+    char ext[FORMAT_INDEX_EXT_MAX];     /* lowercase extension */
+    int *fcns;                          /* candidate init_vgmstream_functions indexes, in priority order */
+    int fcns_count;
+} format_index_entry;
+
+typedef struct {
+    int ok;                             /* index is usable */
+    format_index_entry *entries;        /* sorted by ext */
+    int entries_count;
+    int *wildcards;                     /* candidates for unindexed extensions */
+    int wildcards_count;
+} format_index_t;
+
+static format_index_t format_index;
+static vgm_once_t format_index_once; /* built on first use, once for all threads */
+static int format_index_enabled = 1;
 
-        /* fail if there is nothing to play (without this check vgmstream can generate empty files) */
-        if (vgmstream->num_samples <= 0) {
-            VGM_LOG("VGMSTREAM: wrong num_samples (ns=%i / 0x%08x)\n", vgmstream->num_samples, vgmstream->num_samples);
+static int format_index_compare(const void *a, const void *b) {
+    return strcmp(((const format_index_entry*)a)->ext, ((const format_index_entry*)b)->ext);
+}
+
+/* copies the lowercased extension, returns 0 if it doesn't fit */
+static int format_index_get_ext(char *dst, const char *src, size_t src_len) {
+    size_t i;
+
+    if (src_len + 1 > FORMAT_INDEX_EXT_MAX)
+        return 0;
+    for (i = 0; i < src_len; i++) {
+        dst[i] = tolower((unsigned char)src[i]);
+    }
+    dst[src_len] = '\0';
+    return 1;
+}
+
+/* checks if ext is in a comma-separated list of lowercase extensions */
+static int format_index_has_ext(const char *exts, const char *ext) {
+    size_t ext_len = strlen(ext);
+    const char *pos = exts;
+
+    while (pos) {
+        const char *next = strchr(pos, ',');
+        size_t len = next ? (size_t)(next - pos) : strlen(pos);
+        if (len == ext_len && strncmp(pos, ext, len) == 0)
+            return 1;
+        pos = next ? next + 1 : NULL;
+    }
+    return 0;
+}
+
+static void format_index_build(void) {
+    const int fcns_size = (sizeof(init_vgmstream_functions)/sizeof(init_vgmstream_functions[0]));
+    char **fcn_exts = NULL; /* lowercase extensions per function, NULL = wildcard */
+    int i, j;
+
+    fcn_exts = calloc(fcns_size, sizeof(char*));
+    if (!fcn_exts) goto fail;
+
+    /* find out extensions per function */
+    for (i = 0; i < fcns_size; i++) {
+        char exts[0x1000];
+        VGMSTREAM * vgmstream;
+        STREAMFILE * probeFile = open_probe_streamfile();
+        if (!probeFile) goto fail;
+
+        vgmstream = (init_vgmstream_functions[i])(probeFile);
+        if (vgmstream) { /* shouldn't happen with no data */
             close_vgmstream(vgmstream);
+            close_streamfile(probeFile);
             continue;
         }
 
-        /* everything should have a reasonable sample rate (300 is Wwise min) */
-        if (vgmstream->sample_rate < 300 || vgmstream->sample_rate > 96000) {
-            VGM_LOG("VGMSTREAM: wrong sample rate (sr=%i)\n", vgmstream->sample_rate);
-            close_vgmstream(vgmstream);
+        if (get_probe_streamfile_extensions(probeFile, exts, sizeof(exts))) {
+            for (j = 0; exts[j] != '\0'; j++) {
+                exts[j] = tolower((unsigned char)exts[j]);
+            }
+            fcn_exts[i] = malloc(strlen(exts) + 1);
+            if (!fcn_exts[i]) {
+                close_streamfile(probeFile);
+                goto fail;
+            }
+            strcpy(fcn_exts[i], exts);
+        }
+        close_streamfile(probeFile);
+    }
+
+    /* list unique extensions, and wildcards */
+    format_index.wildcards = calloc(fcns_size, sizeof(int));
+    if (!format_index.wildcards) goto fail;
+
+    for (i = 0; i < fcns_size; i++) {
+        const char *pos = fcn_exts[i];
+
+        if (!pos) {
+            format_index.wildcards[format_index.wildcards_count] = i;
+            format_index.wildcards_count++;
             continue;
         }
-            
-        /* Sanify loops! */
-        if (vgmstream->loop_flag) {
-            if ((vgmstream->loop_end_sample <= vgmstream->loop_start_sample)
-                    || (vgmstream->loop_end_sample > vgmstream->num_samples)
-                    || (vgmstream->loop_start_sample < 0) ) {
-                vgmstream->loop_flag = 0;
-                VGM_LOG("VGMSTREAM: wrong loops ignored (lss=%i, lse=%i, ns=%i)\n", vgmstream->loop_start_sample, vgmstream->loop_end_sample, vgmstream->num_samples);
+
+        while (pos) {
+            format_index_entry entry = {0};
+            const char *next = strchr(pos, ',');
+            size_t len = next ? (size_t)(next - pos) : strlen(pos);
+
+            if (!format_index_get_ext(entry.ext, pos, len)) {
+                /* can't be looked up, so make the function a wildcard */
+                free(fcn_exts[i]);
+                fcn_exts[i] = NULL;
+                format_index.wildcards[format_index.wildcards_count] = i;
+                format_index.wildcards_count++;
+                break;
+            }
+
+            for (j = 0; j < format_index.entries_count; j++) {
+                if (strcmp(format_index.entries[j].ext, entry.ext) == 0)
+                    break;
             }
+            if (j == format_index.entries_count) {
+                format_index_entry *entries = realloc(format_index.entries, (format_index.entries_count + 1) * sizeof(format_index_entry));
+                if (!entries) goto fail;
+                format_index.entries = entries;
+                format_index.entries[format_index.entries_count] = entry;
+                format_index.entries_count++;
+            }
+
+            pos = next ? next + 1 : NULL;
+        }
+    }
+
+    /* make candidates per extension (wildcards included, to keep the original priority) */
+    for (j = 0; j < format_index.entries_count; j++) {
+        format_index_entry *entry = &format_index.entries[j];
+
+        entry->fcns = calloc(fcns_size, sizeof(int));
+        if (!entry->fcns) goto fail;
+
+        for (i = 0; i < fcns_size; i++) {
+            if (fcn_exts[i] && !format_index_has_ext(fcn_exts[i], entry->ext))
+                continue;
+            entry->fcns[entry->fcns_count] = i;
+            entry->fcns_count++;
+        }
+    }
+
+    qsort(format_index.entries, format_index.entries_count, sizeof(format_index_entry), format_index_compare);
+
+    for (i = 0; i < fcns_size; i++) {
+        free(fcn_exts[i]);
+    }
+    free(fcn_exts);
+
+    format_index.ok = 1;
+    return;
+
+fail:
+    VGM_LOG("VGMSTREAM: format index build failed\n");
+    if (fcn_exts) {
+        for (i = 0; i < fcns_size; i++) {
+            free(fcn_exts[i]);
         }
+        free(fcn_exts);
+    }
+    if (format_index.entries) {
+        for (j = 0; j < format_index.entries_count; j++) {
+            free(format_index.entries[j].fcns);
+        }
+        free(format_index.entries);
+    }
+    free(format_index.wildcards);
+    format_index.entries = NULL;
+    format_index.entries_count = 0;
+    format_index.wildcards = NULL;
+    format_index.wildcards_count = 0;
+}
+
+/* get candidate init functions for a file's extension (or NULL if the extension isn't indexed) */
+static const int * format_index_get_candidates(STREAMFILE *streamFile, int *candidates_count) {
+    char filename[PATH_LIMIT];
+    format_index_entry key;
+    format_index_entry *entry;
+    const char *ext;
+
+    if (!format_index_enabled)
+        return NULL;
+
+    vgm_once(&format_index_once, format_index_build);
+    if (!format_index.ok)
+        return NULL;
+
+    streamFile->get_name(streamFile,filename,sizeof(filename));
+    ext = filename_extension(filename);
+    if (!format_index_get_ext(key.ext, ext, strlen(ext)))
+        return NULL;
+
+    entry = bsearch(&key, format_index.entries, format_index.entries_count, sizeof(format_index_entry), format_index_compare);
+    if (!entry)
+        return NULL;
 
-        /* test if candidate for dual stereo */
-        if (vgmstream->channels == 1 && vgmstream->allow_dual_stereo == 1) {
-            try_dual_file_stereo(vgmstream, streamFile, init_vgmstream_functions[i]);
+    *candidates_count = entry->fcns_count;
+    return entry->fcns;
+}
+
+
+void vgmstream_set_format_index(int enable) {
+    format_index_enabled = enable;
+}
+
+
+/* validates a VGMSTREAM returned by init function fcn, and finishes its setup */
+static VGMSTREAM * validate_vgmstream(STREAMFILE *streamFile, VGMSTREAM * vgmstream, int fcn) {
+    if (!vgmstream)
+        return NULL;
+
+    /* fail if there is nothing to play (without this check vgmstream can generate empty files) */
+    if (vgmstream->num_samples <= 0) {
+        VGM_LOG("VGMSTREAM: wrong num_samples (ns=%i / 0x%08x)\n", vgmstream->num_samples, vgmstream->num_samples);
+        close_vgmstream(vgmstream);
+        return NULL;
+    }
+
+    /* everything should have a reasonable sample rate (300 is Wwise min) */
+    if (vgmstream->sample_rate < 300 || vgmstream->sample_rate > 96000) {
+        VGM_LOG("VGMSTREAM: wrong sample rate (sr=%i)\n", vgmstream->sample_rate);
+        close_vgmstream(vgmstream);
+        return NULL;
+    }
+
+    /* Sanify loops! */
+    if (vgmstream->loop_flag) {
+        if ((vgmstream->loop_end_sample <= vgmstream->loop_start_sample)
+                || (vgmstream->loop_end_sample > vgmstream->num_samples)
+                || (vgmstream->loop_start_sample < 0) ) {
+            vgmstream->loop_flag = 0;
+            VGM_LOG("VGMSTREAM: wrong loops ignored (lss=%i, lse=%i, ns=%i)\n", vgmstream->loop_start_sample, vgmstream->loop_end_sample, vgmstream->num_samples);
         }
+    }
+
+    /* test if candidate for dual stereo */
+    if (vgmstream->channels == 1 && vgmstream->allow_dual_stereo == 1) {
+        try_dual_file_stereo(vgmstream, streamFile, init_vgmstream_functions[fcn]);
+    }
 
 
 #ifdef VGM_USE_FFMPEG
-        /* check FFmpeg streams here, for lack of a better place */
-        if (vgmstream->coding_type == coding_FFmpeg) {
-            ffmpeg_codec_data *data = (ffmpeg_codec_data *) vgmstream->codec_data;
-            if (data && data->streamCount && !vgmstream->num_streams) {
-                vgmstream->num_streams = data->streamCount;
-            }
+    /* check FFmpeg streams here, for lack of a better place */
+    if (vgmstream->coding_type == coding_FFmpeg) {
+        ffmpeg_codec_data *data = (ffmpeg_codec_data *) vgmstream->codec_data;
+        if (data && data->streamCount && !vgmstream->num_streams) {
+            vgmstream->num_streams = data->streamCount;
         }
+    }
 #endif
 
-        /* files can have thousands subsongs, but let's put a limit */
-        if (vgmstream->num_streams < 0 || vgmstream->num_streams > 65535) {
-            VGM_LOG("VGMSTREAM: wrong num_streams (ns=%i)\n", vgmstream->num_streams);
-            close_vgmstream(vgmstream);
-            continue;
-        }
+    /* files can have thousands subsongs, but let's put a limit */
+    if (vgmstream->num_streams < 0 || vgmstream->num_streams > 65535) {
+        VGM_LOG("VGMSTREAM: wrong num_streams (ns=%i)\n", vgmstream->num_streams);
+        close_vgmstream(vgmstream);
+        return NULL;
+    }
+
 
+    /* save info */
+    /* stream_index 0 may be used by plugins to signal "vgmstream default" (IOW don't force to 1) */
+    if (!vgmstream->stream_index)
+        vgmstream->stream_index = streamFile->stream_index;
 
-        /* save info */
-        /* stream_index 0 may be used by plugins to signal "vgmstream default" (IOW don't force to 1) */
-        if (!vgmstream->stream_index)
-            vgmstream->stream_index = streamFile->stream_index;
+    /* save start things so we can restart for seeking */
+    memcpy(vgmstream->start_ch,vgmstream->ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+    memcpy(vgmstream->start_vgmstream,vgmstream,sizeof(VGMSTREAM));
 
-        /* save start things so we can restart for seeking */
-        memcpy(vgmstream->start_ch,vgmstream->ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
-        memcpy(vgmstream->start_vgmstream,vgmstream,sizeof(VGMSTREAM));
+    return vgmstream;
+}
+
+/* calls an init function and validates the resulting VGMSTREAM */
+static VGMSTREAM * init_vgmstream_function(STREAMFILE *streamFile, int fcn) {
+    /* call init function and see if valid VGMSTREAM was returned */
+    return validate_vgmstream(streamFile, (init_vgmstream_functions[fcn])(streamFile), fcn);
+}
+
+/* internal version with all parameters, also returns the init function that worked (optional) */
+static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile, int *p_fcn) {
+    const int *candidates;
+    int i, fcns_size, candidates_count = 0;
+
+    if (!streamFile)
+        return NULL;
 
-        return vgmstream;
+    /* try only formats that may accept this extension (others would reject it the same way they did
+     * when indexing, as they only check the extension before failing) */
+    candidates = format_index_get_candidates(streamFile, &candidates_count);
+    if (candidates) {
+        for (i = 0; i < candidates_count; i++) {
+            VGMSTREAM * vgmstream = init_vgmstream_function(streamFile, candidates[i]);
+            if (vgmstream) {
+                if (p_fcn) *p_fcn = candidates[i];
+                return vgmstream;
+            }
+        }
+        return NULL;
+    }
+
+    /* unknown extension: try a series of formats, see which works */
+    fcns_size = (sizeof(init_vgmstream_functions)/sizeof(init_vgmstream_functions[0]));
+    for (i=0; i < fcns_size; i++) {
+        VGMSTREAM * vgmstream = init_vgmstream_function(streamFile, i);
+        if (vgmstream) {
+            if (p_fcn) *p_fcn = i;
+            return vgmstream;
+        }
     }
 
     /* not supported */
@@ -554,16 +796,147 @@ VGMSTREAM * init_vgmstream(const char * const filename) {
 }
 
 VGMSTREAM * init_vgmstream_from_STREAMFILE(STREAMFILE *streamFile) {
-    return init_vgmstream_internal(streamFile);
+    return init_vgmstream_internal(streamFile, NULL);
+}
+
+/* Metas that can parse all subsong headers at once: parse_bank fills the directory and returns data (freed with
+ * free) that init_vgmstream_bank uses to open the streamFile's subsong without parsing other headers again. */
+typedef struct {
+    VGMSTREAM * (*init_vgmstream)(STREAMFILE *streamFile);
+    void * (*parse_bank)(STREAMFILE *streamFile, VGMSTREAM_BANK_ENTRY *directory, int subsongs);
+    VGMSTREAM * (*init_vgmstream_bank)(STREAMFILE *streamFile, void *bank_data);
+} bank_meta;
+
+static const bank_meta bank_metas[] = {
+    {init_vgmstream_fsb5,   parse_fsb5_bank,    init_vgmstream_fsb5_bank},
+    {init_vgmstream_xwb,    parse_xwb_bank,     init_vgmstream_xwb_bank},
+};
+
+static void vgmstream_bank_set_entry(VGMSTREAM_BANK * bank, int subsong, VGMSTREAM * vgmstream) {
+    VGMSTREAM_BANK_ENTRY * entry = &bank->directory[subsong-1];
+
+    entry->num_samples = vgmstream->num_samples;
+    entry->sample_rate = vgmstream->sample_rate;
+    entry->channels = vgmstream->channels;
+    entry->loop_flag = vgmstream->loop_flag;
+    memcpy(entry->stream_name, vgmstream->stream_name, STREAM_NAME_SIZE);
+    entry->stream_name[STREAM_NAME_SIZE-1] = '\0';
+    entry->filled = 1;
+    entry->opened = 1;
+}
+
+/* Detects the format of a multi-subsong file once, so subsongs can be opened without probing
+ * every format again (the meta's init is called directly). Formats with a bank parser also read all
+ * subsong headers here, so the directory is filled and subsongs open without re-reading them. */
+VGMSTREAM_BANK * init_vgmstream_bank(STREAMFILE *streamFile) {
+    VGMSTREAM_BANK * bank = NULL;
+    VGMSTREAM * vgmstream = NULL;
+    int fcn = -1, stream_index, subsongs, i;
+
+    if (!streamFile)
+        return NULL;
+
+    /* first subsong is used for detection, as any subsong should be valid */
+    stream_index = streamFile->stream_index;
+    streamFile->stream_index = 1;
+    vgmstream = init_vgmstream_internal(streamFile, &fcn);
+    streamFile->stream_index = stream_index;
+    if (!vgmstream) goto fail;
+
+    subsongs = vgmstream->num_streams > 1 ? vgmstream->num_streams : 1;
+
+    bank = calloc(1, sizeof(VGMSTREAM_BANK));
+    if (!bank) goto fail;
+
+    bank->directory = calloc(subsongs, sizeof(VGMSTREAM_BANK_ENTRY));
+    if (!bank->directory) goto fail;
+
+    bank->init_fcn = fcn;
+    bank->subsongs = subsongs;
+    bank->bank_meta = -1;
+
+    for (i = 0; i < sizeof(bank_metas) / sizeof(bank_metas[0]); i++) {
+        if (bank_metas[i].init_vgmstream != init_vgmstream_functions[fcn])
+            continue;
+
+        bank->bank_data = bank_metas[i].parse_bank(streamFile, bank->directory, subsongs);
+        if (bank->bank_data) {
+            bank->bank_meta = i;
+        }
+        else { /* subsongs are opened with the meta's init instead */
+            memset(bank->directory, 0, subsongs * sizeof(VGMSTREAM_BANK_ENTRY));
+        }
+        break;
+    }
+
+    vgmstream_bank_set_entry(bank, 1, vgmstream);
+
+    close_vgmstream(vgmstream);
+    return bank;
+
+fail:
+    close_vgmstream(vgmstream);
+    close_vgmstream_bank(bank);
+    return NULL;
+}
+
+/* Opens a bank's subsong (1..N, 0=default) over the passed streamFile, which must be the same file the bank was
+ * made from (separate streamFiles allow opening subsongs from multiple threads). */
+VGMSTREAM * init_vgmstream_bank_subsong(VGMSTREAM_BANK * bank, STREAMFILE *streamFile, int subsong) {
+    VGMSTREAM * vgmstream;
+    int stream_index;
+
+    if (!bank || !streamFile || subsong < 0 || subsong > bank->subsongs)
+        return NULL;
+
+    stream_index = streamFile->stream_index;
+    streamFile->stream_index = subsong;
+    if (bank->bank_data)
+        vgmstream = validate_vgmstream(streamFile, bank_metas[bank->bank_meta].init_vgmstream_bank(streamFile, bank->bank_data), bank->init_fcn);
+    else
+        vgmstream = init_vgmstream_function(streamFile, bank->init_fcn);
+    streamFile->stream_index = stream_index;
+    if (!vgmstream)
+        return NULL;
+
+    /* each entry is only written by the opener of that subsong */
+    vgmstream_bank_set_entry(bank, subsong ? subsong : 1, vgmstream);
+    return vgmstream;
+}
+
+void close_vgmstream_bank(VGMSTREAM_BANK * bank) {
+    if (!bank)
+        return;
+    free(bank->bank_data);
+    free(bank->directory);
+    free(bank);
 }
 
 /* Reset a VGMSTREAM to its state at the start of playback
  * (when a plugin needs to seek back to zero, for instance).
  * Note that this does not reset the constituent STREAMFILES. */
 void reset_vgmstream(VGMSTREAM * vgmstream) {
+    void * resampler = vgmstream->resampler;
+    void * loop_cache = vgmstream->loop_cache;
+    void * fade = vgmstream->fade;
+
     /* copy the vgmstream back into itself */
     memcpy(vgmstream,vgmstream->start_vgmstream,sizeof(VGMSTREAM));
 
+    /* output config is kept, but starts from silence */
+    vgmstream->resampler = resampler;
+    if (vgmstream->resampler) {
+        reset_resampler(vgmstream->resampler);
+    }
+    vgmstream->loop_cache = loop_cache;
+    if (vgmstream->loop_cache) {
+        reset_loop_cache(vgmstream->loop_cache);
+    }
+    vgmstream->fade = fade;
+    if (vgmstream->fade) {
+        reset_fade(vgmstream->fade);
+    }
+
     /* copy the initial channels */
     memcpy(vgmstream->ch,vgmstream->start_ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
 
@@ -681,7 +1054,7 @@ VGMSTREAM * allocate_vgmstream(int channel_count, int looped) {
     VGMSTREAMCHANNEL * loop_channels;
 
     /* up to ~16 aren't too rare for multilayered files, more is probably a bug */
-    if (channel_count <= 0 || channel_count > 64) {
+    if (channel_count <= 0 || channel_count > VGMSTREAM_MAX_CHANNELS) {
         VGM_LOG("VGMSTREAM: error allocating %i channels\n", channel_count);
         return NULL;
     }
@@ -894,6 +1267,11 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
         }
     }
 
+    free_seek_index(vgmstream->seek_index);
+    free_resampler(vgmstream->resampler);
+    free_loop_cache(vgmstream->loop_cache);
+    free_fade(vgmstream->fade);
+
     if (vgmstream->loop_ch) free(vgmstream->loop_ch);
     if (vgmstream->start_ch) free(vgmstream->start_ch);
     if (vgmstream->ch) free(vgmstream->ch);
@@ -905,6 +1283,19 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
 
 /* calculate samples based on player's config */
 int32_t get_vgmstream_play_samples(double looptimes, double fadeseconds, double fadedelayseconds, VGMSTREAM * vgmstream) {
+    if (vgmstream->resampler) {
+        /* same duration at output rate */
+        int output_rate = vgmstream_get_output_rate(vgmstream);
+        void * resampler = vgmstream->resampler;
+        int32_t play_samples;
+
+        vgmstream->resampler = NULL;
+        play_samples = get_vgmstream_play_samples(looptimes, fadeseconds, fadedelayseconds, vgmstream);
+        vgmstream->resampler = resampler;
+
+        return (int32_t)((int64_t)play_samples * output_rate / vgmstream->sample_rate);
+    }
+
     if (vgmstream->loop_flag) {
         if (vgmstream->loop_target == (int)looptimes) { /* set externally, as this function is info-only */
             /* Continue playing the file normally after looping, instead of fading.
@@ -957,7 +1348,7 @@ void vgmstream_force_loop(VGMSTREAM* vgmstream, int loop_flag, int loop_start_sa
             vgmstream_force_loop(data->layers[i], loop_flag, loop_start_sample, loop_end_sample);
         }
     }
-    /* segmented layout only works (ATM) with exact/header loop, full loop or no loop */
+    /* segmented layout handles any loop points (loop start may fall in the middle of a segment) */
 }
 
 void vgmstream_set_loop_target(VGMSTREAM* vgmstream, int loop_target) {
@@ -976,8 +1367,396 @@ void vgmstream_set_loop_target(VGMSTREAM* vgmstream, int loop_target) {
 }
 
 
+/* seek helpers */
+
+/* looping may be disabled once loop_target is reached, but still counts as looped for seeking */
+static int seek_vgmstream_is_looped(VGMSTREAM * vgmstream) {
+    if (vgmstream->loop_end_sample - vgmstream->loop_start_sample <= 0)
+        return 0;
+    return vgmstream->loop_flag || (vgmstream->loop_target && vgmstream->loop_count >= vgmstream->loop_target);
+}
+
+/* reset_vgmstream restores the initial state, which would undo external loop config, so copy it there first */
+static void seek_vgmstream_keep_config(VGMSTREAM * vgmstream) {
+    VGMSTREAM * start_vgmstream = vgmstream->start_vgmstream;
+
+    start_vgmstream->loop_flag = seek_vgmstream_is_looped(vgmstream);
+    start_vgmstream->loop_start_sample = vgmstream->loop_start_sample;
+    start_vgmstream->loop_end_sample = vgmstream->loop_end_sample;
+    start_vgmstream->loop_target = vgmstream->loop_target;
+    start_vgmstream->loop_ch = vgmstream->loop_ch;
+
+    if (vgmstream->layout_type == layout_layered) {
+        int i;
+        layered_layout_data *data = vgmstream->layout_data;
+        for (i = 0; i < data->layer_count; i++) {
+            seek_vgmstream_keep_config(data->layers[i]);
+        }
+    }
+}
+
+/* codecs whose seek function can position them at any sample on their own */
+static int seek_vgmstream_is_codec_seekable(VGMSTREAM * vgmstream) {
+    if (vgmstream->layout_type != layout_none)
+        return 0;
+
+    switch (vgmstream->coding_type) {
+        case coding_CRI_HCA:
+#ifdef VGM_USE_VORBIS
+        case coding_OGG_VORBIS:
+#endif
+#ifdef VGM_USE_MPEG
+        case coding_MPEG_custom:
+        case coding_MPEG_ealayer3:
+        case coding_MPEG_layer1:
+        case coding_MPEG_layer2:
+        case coding_MPEG_layer3:
+#endif
+#ifdef VGM_USE_ATRAC9
+        case coding_ATRAC9:
+#endif
+#ifdef VGM_USE_FFMPEG
+        case coding_FFmpeg:
+#endif
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* codecs with fixed frames that don't carry state between frames, so offsets can be calculated */
+static int seek_vgmstream_is_frame_seekable(VGMSTREAM * vgmstream) {
+    if (vgmstream->layout_type == layout_interleave) {
+        /* would need to handle the offset/frame changes */
+        if (vgmstream->interleave_last_block_size && vgmstream->channels > 1)
+            return 0;
+    }
+    else if (vgmstream->layout_type != layout_none) {
+        return 0;
+    }
+
+    switch (vgmstream->coding_type) {
+        case coding_PCM16LE:
+        case coding_PCM16BE:
+        case coding_PCM16_int:
+        case coding_PCM8:
+        case coding_PCM8_int:
+        case coding_PCM8_U:
+        case coding_PCM8_U_int:
+        case coding_PCM8_SB:
+        case coding_ULAW:
+        case coding_ULAW_int:
+        case coding_ALAW:
+        case coding_PCMFLOAT:
+        case coding_MSADPCM:
+        case coding_XBOX_IMA:
+        case coding_XBOX_IMA_int:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* decodes and throws away samples */
+static void seek_vgmstream_discard(VGMSTREAM * vgmstream, int32_t samples) {
+    sample buf[0x2000];
+    int32_t max_samples = sizeof(buf) / sizeof(sample) / vgmstream->channels;
+
+    while (samples > 0) {
+        int32_t samples_to_do = samples > max_samples ? max_samples : samples;
+        render_vgmstream(buf, samples_to_do, vgmstream);
+        samples -= samples_to_do;
+    }
+}
+
+/* moves the stream to a sample (current loop state is kept), must not cross loop points */
+static void seek_vgmstream_jump(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    int32_t frame_sample;
+
+    memcpy(vgmstream->ch, vgmstream->start_ch, sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+
+    if (seek_vgmstream_is_codec_seekable(vgmstream)) {
+        /* codec seeks are meant to be used when looping, so they may set offsets in loop_ch */
+        VGMSTREAMCHANNEL * loop_ch = vgmstream->loop_ch;
+        vgmstream->loop_ch = vgmstream->ch;
+
+        if (vgmstream->coding_type == coding_CRI_HCA) {
+            seek_hca(vgmstream->codec_data, seek_sample);
+        }
+#ifdef VGM_USE_VORBIS
+        if (vgmstream->coding_type == coding_OGG_VORBIS) {
+            seek_ogg_vorbis(vgmstream, seek_sample);
+        }
+#endif
+#ifdef VGM_USE_MPEG
+        if (vgmstream->coding_type == coding_MPEG_custom ||
+            vgmstream->coding_type == coding_MPEG_ealayer3 ||
+            vgmstream->coding_type == coding_MPEG_layer1 ||
+            vgmstream->coding_type == coding_MPEG_layer2 ||
+            vgmstream->coding_type == coding_MPEG_layer3) {
+            seek_mpeg(vgmstream, seek_sample);
+        }
+#endif
+#ifdef VGM_USE_ATRAC9
+        if (vgmstream->coding_type == coding_ATRAC9) {
+            seek_atrac9(vgmstream, seek_sample);
+        }
+#endif
+#ifdef VGM_USE_FFMPEG
+        if (vgmstream->coding_type == coding_FFmpeg) {
+            seek_ffmpeg(vgmstream, seek_sample);
+        }
+#endif
+
+        vgmstream->loop_ch = loop_ch;
+        vgmstream->current_sample = seek_sample;
+        vgmstream->samples_into_block = seek_sample;
+        return;
+    }
+
+    /* restore closest saved state, then decode the rest */
+    if (!seek_vgmstream_is_frame_seekable(vgmstream)) {
+        int loop_pass = vgmstream->loop_flag && vgmstream->loop_count > 0 &&
+                seek_sample >= vgmstream->loop_start_sample && seek_sample < vgmstream->loop_end_sample;
+
+        frame_sample = seek_index_restore(vgmstream, seek_sample, loop_pass);
+        if (frame_sample >= 0) {
+            seek_vgmstream_discard(vgmstream, seek_sample - frame_sample);
+        }
+        else {
+            /* nothing saved in loops before this sample, and some formats keep history when looping,
+             * so decode the end of the previous loop and loop back normally */
+            frame_sample = seek_index_restore(vgmstream, vgmstream->loop_end_sample - 1, 0);
+            vgmstream->loop_count--;
+            seek_vgmstream_discard(vgmstream, vgmstream->loop_end_sample - frame_sample);
+            seek_vgmstream_discard(vgmstream, seek_sample - vgmstream->loop_start_sample);
+        }
+        return;
+    }
+
+    /* go to the frame start, then decode the rest of the frame (may need the frame header) */
+    {
+        int samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
+        int32_t block_samples = 0;
+
+        if (vgmstream->layout_type == layout_interleave) {
+            int frame_size = get_vgmstream_frame_size(vgmstream);
+            if (frame_size > 0)
+                block_samples = vgmstream->interleave_block_size / frame_size * samples_per_frame;
+        }
+
+        if (block_samples > 0) {
+            int32_t block = seek_sample / block_samples;
+            int ch;
+
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                vgmstream->ch[ch].offset += (off_t)block * vgmstream->interleave_block_size * vgmstream->channels;
+            }
+            vgmstream->samples_into_block = (seek_sample % block_samples) / samples_per_frame * samples_per_frame;
+            frame_sample = block * block_samples + vgmstream->samples_into_block;
+        }
+        else {
+            /* flat (or mono interleave without blocks): decoders find the frame from samples_into_block */
+            frame_sample = seek_sample / samples_per_frame * samples_per_frame;
+            vgmstream->samples_into_block = frame_sample;
+        }
+        vgmstream->current_sample = frame_sample;
+
+        seek_vgmstream_discard(vgmstream, seek_sample - frame_sample);
+    }
+}
+
+void seek_vgmstream(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    int is_looped, loop_count = 0;
+    int32_t loop_length, stream_sample;
+
+    if (!vgmstream) return;
+    if (seek_sample < 0)
+        seek_sample = 0;
+
+    if (vgmstream->fade) {
+        seek_vgmstream_faded(vgmstream, seek_sample);
+        return;
+    }
+    if (vgmstream->resampler) {
+        seek_vgmstream_resampled(vgmstream, seek_sample);
+        return;
+    }
+    if (vgmstream->loop_cache) {
+        sync_loop_cache(vgmstream);
+    }
+
+    is_looped = seek_vgmstream_is_looped(vgmstream);
+    loop_length = vgmstream->loop_end_sample - vgmstream->loop_start_sample;
+
+    /* map play position to stream position and loops done, as vgmstream_do_loop would */
+    stream_sample = seek_sample;
+    if (is_looped && seek_sample >= vgmstream->loop_end_sample) {
+        loop_count = (seek_sample - vgmstream->loop_start_sample) / loop_length;
+        stream_sample = vgmstream->loop_start_sample + (seek_sample - vgmstream->loop_start_sample) % loop_length;
+
+        /* past the last loop: continue to the stream end */
+        if (vgmstream->loop_target && loop_count >= vgmstream->loop_target) {
+            loop_count = vgmstream->loop_target;
+            stream_sample = vgmstream->loop_end_sample + (seek_sample - vgmstream->loop_start_sample - loop_length * loop_count);
+        }
+    }
+    if (stream_sample > vgmstream->num_samples) {
+        seek_sample -= stream_sample - vgmstream->num_samples;
+        stream_sample = vgmstream->num_samples;
+    }
+
+
+    if (seek_vgmstream_is_codec_seekable(vgmstream) || seek_vgmstream_is_frame_seekable(vgmstream) ||
+            seek_index_is_usable(vgmstream)) {
+        /* direct seek */
+        seek_vgmstream_keep_config(vgmstream);
+        reset_vgmstream(vgmstream);
+
+        if (is_looped && stream_sample >= vgmstream->loop_start_sample) {
+            /* save loop start state first, and mark loops already done */
+            seek_vgmstream_jump(vgmstream, vgmstream->loop_start_sample);
+            vgmstream_do_loop(vgmstream);
+
+            vgmstream->loop_count = loop_count;
+            if (vgmstream->loop_target && loop_count >= vgmstream->loop_target)
+                vgmstream->loop_flag = 0;
+        }
+
+        seek_vgmstream_jump(vgmstream, stream_sample);
+    }
+    else {
+        /* decode and discard from current position or stream start (whatever is closer) */
+        int can_skip_loops = is_looped && loop_count > 0 &&
+                vgmstream->layout_type != layout_aix &&
+                vgmstream->layout_type != layout_segmented &&
+                vgmstream->layout_type != layout_layered;
+        int is_tail = vgmstream->loop_target && loop_count >= vgmstream->loop_target;
+        int32_t loop_resume = is_tail ? vgmstream->loop_end_sample : vgmstream->loop_start_sample;
+        int32_t reset_samples = can_skip_loops ?
+                vgmstream->loop_end_sample + (stream_sample - loop_resume) :
+                seek_sample;
+
+        if (seek_sample >= vgmstream->play_sample && seek_sample - vgmstream->play_sample <= reset_samples) {
+            seek_vgmstream_discard(vgmstream, seek_sample - vgmstream->play_sample);
+        }
+        else {
+            seek_vgmstream_keep_config(vgmstream);
+            reset_vgmstream(vgmstream);
+
+            if (can_skip_loops) {
+                /* decode up to loop end once (to get loop state), then resume in the target loop */
+                vgmstream->loop_count = loop_count - 1;
+                seek_vgmstream_discard(vgmstream, vgmstream->loop_end_sample);
+                seek_vgmstream_discard(vgmstream, stream_sample - loop_resume);
+            }
+            else {
+                seek_vgmstream_discard(vgmstream, seek_sample);
+            }
+        }
+    }
+
+    vgmstream->play_sample = seek_sample;
+}
+
+/* Gets the final mapping of channel swaps (output channel N gets decoded channel mapping[N]), returns mapping count */
+static int render_vgmstream_get_mapping(VGMSTREAM * vgmstream, int * mapping) {
+    int mapping_count = vgmstream->channels > 33 ? 33 : vgmstream->channels;
+    int ch_from, ch_to, temp;
+
+    /* simulate the swaps in order to get the final mapping per frame */
+    for (ch_from = 0; ch_from < mapping_count; ch_from++) {
+        mapping[ch_from] = ch_from;
+    }
+    for (ch_from = 0; ch_from < mapping_count && ch_from < 32; ch_from++) {
+        ch_to = vgmstream->channel_mappings[ch_from];
+        if (ch_to < 1 || ch_to > 32 || ch_to > vgmstream->channels-1 || ch_from == ch_to)
+            continue;
+
+        temp = mapping[ch_from];
+        mapping[ch_from] = mapping[ch_to];
+        mapping[ch_to] = temp;
+    }
+
+    return mapping_count;
+}
+
+/* Codecs/layouts that fill f32_buffer by themselves when rendering to float */
+static int render_vgmstream_is_f32_native(VGMSTREAM * vgmstream) {
+    switch (vgmstream->layout_type) {
+        case layout_segmented:
+        case layout_layered:
+            return 1; /* each segment/layer handles it */
+        case layout_aix:
+            return 0;
+        default:
+            break;
+    }
+
+    switch (vgmstream->coding_type) {
+#ifdef VGM_USE_VORBIS
+        case coding_OGG_VORBIS:
+        case coding_VORBIS_custom:
+#endif
+#ifdef VGM_USE_FFMPEG
+        case coding_FFmpeg:
+#endif
+        case coding_CRI_HCA:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
 /* Decode data into sample buffer */
 void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    float * f32_buffer = vgmstream->f32_buffer;
+    sample ** planar_buffer = vgmstream->planar_buffer;
+    sample * planar_mapped[VGMSTREAM_MAX_CHANNELS];
+    int ch;
+
+    if (vgmstream->fade) {
+        render_vgmstream_faded(buffer, sample_count, vgmstream);
+        return;
+    }
+    if (vgmstream->resampler) {
+        render_vgmstream_resampled(buffer, sample_count, vgmstream);
+        return;
+    }
+    if (vgmstream->loop_cache) {
+        render_vgmstream_loop_cached(buffer, sample_count, vgmstream);
+        return;
+    }
+
+    /* layouts only silence the 16-bit buffer on errors, so float-native codecs start from silence too */
+    if (f32_buffer && render_vgmstream_is_f32_native(vgmstream)
+            && vgmstream->layout_type != layout_segmented && vgmstream->layout_type != layout_layered) {
+        memset(f32_buffer, 0, sample_count * vgmstream->channels * sizeof(float));
+    }
+
+    /* rendering to planar: every decode writes channel buffers (see decode_vgmstream), so same for errors */
+    if (planar_buffer) {
+        if (vgmstream->layout_type != layout_segmented && vgmstream->layout_type != layout_layered) {
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                memset(planar_buffer[ch], 0, sample_count * sizeof(sample));
+            }
+        }
+
+        /* channel swaps are free: each channel decodes into its final buffer */
+        if (vgmstream->channel_mappings_on) {
+            int mapping[33];
+            int mapping_count = render_vgmstream_get_mapping(vgmstream, mapping);
+
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                planar_mapped[ch] = planar_buffer[ch];
+            }
+            for (ch = 0; ch < mapping_count; ch++) {
+                planar_mapped[mapping[ch]] = planar_buffer[ch];
+            }
+            vgmstream->planar_buffer = planar_mapped;
+        }
+    }
+
     switch (vgmstream->layout_type) {
         case layout_interleave:
             render_vgmstream_interleave(buffer,sample_count,vgmstream);
@@ -1039,38 +1818,94 @@ void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstre
             break;
     }
 
+    if (planar_buffer) {
+        /* AIX renders its substreams to the 16-bit buffer */
+        if (vgmstream->layout_type == layout_aix)
+            split_channels(vgmstream->planar_buffer, 0, buffer, vgmstream->channels, sample_count);
+        vgmstream->planar_buffer = planar_buffer;
+    }
 
-    /* swap channels if set, to create custom channel mappings */
-    if (vgmstream->channel_mappings_on) {
-        int ch_from,ch_to,s;
-        sample temp;
-        for (s = 0; s < sample_count; s++) {
-            for (ch_from = 0; ch_from < vgmstream->channels; ch_from++) {
-                if (ch_from > 32)
-                    continue;
+    vgmstream->play_sample += sample_count;
 
-                ch_to = vgmstream->channel_mappings[ch_from];
-                if (ch_to < 1 || ch_to > 32 || ch_to > vgmstream->channels-1 || ch_from == ch_to)
-                    continue;
+    /* rendering to float: convert what was decoded as 16-bit, and do the rest over floats */
+    if (f32_buffer && !render_vgmstream_is_f32_native(vgmstream)) {
+        samples_to_f32(f32_buffer, buffer, sample_count * vgmstream->channels);
+    }
 
-                temp = buffer[s*vgmstream->channels + ch_from];
-                buffer[s*vgmstream->channels + ch_from] = buffer[s*vgmstream->channels + ch_to];
-                buffer[s*vgmstream->channels + ch_to] = temp;
-            }
-        }
+
+    /* swap channels if set, to create custom channel mappings */
+    if (vgmstream->channel_mappings_on && !planar_buffer) {
+        int mapping[33]; /* channels that may be swapped */
+        int mapping_count = render_vgmstream_get_mapping(vgmstream, mapping);
+
+        if (f32_buffer)
+            remap_channels_f32(f32_buffer, vgmstream->channels, sample_count, mapping, mapping_count);
+        else
+            remap_channels(buffer, vgmstream->channels, sample_count, mapping, mapping_count);
     }
 
     /* channel bitmask to silence non-set channels (up to 32)
      * can be used for 'crossfading subsongs' or layered channels, where a set of channels make a song section */
     if (vgmstream->channel_mask) {
-        int ch,s;
-        for (s = 0; s < sample_count; s++) {
+        if (planar_buffer) {
             for (ch = 0; ch < vgmstream->channels; ch++) {
-                if ((vgmstream->channel_mask >> ch) & 1)
+                if (ch < 32 && ((vgmstream->channel_mask >> ch) & 1))
                     continue;
-                buffer[s*vgmstream->channels + ch] = 0;
+                memset(planar_buffer[ch], 0, sample_count * sizeof(sample));
             }
         }
+        else if (f32_buffer)
+            mask_channels_f32(f32_buffer, vgmstream->channels, sample_count, vgmstream->channel_mask);
+        else
+            mask_channels(buffer, vgmstream->channels, sample_count, vgmstream->channel_mask);
+    }
+}
+
+#define RENDER_F32_BUF_SIZE 0x1000 /* samples, so 64 channels get 64 frames per call */
+
+/* Decode data into float buffer, rendering in chunks through a 16-bit buffer that float-native codecs ignore */
+void render_vgmstream_f32(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    sample tmpbuf[RENDER_F32_BUF_SIZE];
+    int32_t samples_written = 0;
+    int32_t samples_max = RENDER_F32_BUF_SIZE / vgmstream->channels;
+
+    while (samples_written < sample_count) {
+        int32_t samples_to_do = sample_count - samples_written;
+        if (samples_to_do > samples_max)
+            samples_to_do = samples_max;
+
+        vgmstream->f32_buffer = buffer + samples_written * vgmstream->channels;
+        render_vgmstream(tmpbuf, samples_to_do, vgmstream);
+        vgmstream->f32_buffer = NULL;
+
+        samples_written += samples_to_do;
+    }
+}
+
+#define RENDER_PLANAR_BUF_SIZE 0x1000
+
+/* Decode data into channel buffers, rendering in chunks through a 16-bit buffer for codecs that only decode interleaved */
+void render_vgmstream_planar(sample ** buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    sample tmpbuf[RENDER_PLANAR_BUF_SIZE];
+    sample * planar[VGMSTREAM_MAX_CHANNELS];
+    int32_t samples_written = 0;
+    int32_t samples_max = RENDER_PLANAR_BUF_SIZE / vgmstream->channels;
+    int ch;
+
+    while (samples_written < sample_count) {
+        int32_t samples_to_do = sample_count - samples_written;
+        if (samples_to_do > samples_max)
+            samples_to_do = samples_max;
+
+        for (ch = 0; ch < vgmstream->channels; ch++) {
+            planar[ch] = buffer[ch] + samples_written;
+        }
+
+        vgmstream->planar_buffer = planar;
+        render_vgmstream(tmpbuf, samples_to_do, vgmstream);
+        vgmstream->planar_buffer = NULL;
+
+        samples_written += samples_to_do;
     }
 }
 
@@ -1439,8 +2274,105 @@ int get_vgmstream_shortframe_size(VGMSTREAM * vgmstream) {
 
 /* Decode samples into the buffer. Assume that we have written samples_written into the
  * buffer already, and we have samples_to_do consecutive samples ahead of us. */
+/* Decode to vgmstream->planar_buffer. Codecs that decode one channel at a time write each channel contiguously,
+ * others decode interleaved into buffer as usual and get split. */
+static void decode_vgmstream_planar(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
+    sample ** planar = vgmstream->planar_buffer;
+    int ch;
+
+    switch (vgmstream->coding_type) {
+        case coding_CRI_ADX:
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                decode_adx(&vgmstream->ch[ch],planar[ch]+samples_written,
+                        1,vgmstream->samples_into_block,samples_to_do,
+                        vgmstream->interleave_block_size);
+            }
+            return;
+        case coding_CRI_ADX_exp:
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                decode_adx_exp(&vgmstream->ch[ch],planar[ch]+samples_written,
+                        1,vgmstream->samples_into_block,samples_to_do,
+                        vgmstream->interleave_block_size);
+            }
+            return;
+        case coding_CRI_ADX_fixed:
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                decode_adx_fixed(&vgmstream->ch[ch],planar[ch]+samples_written,
+                        1,vgmstream->samples_into_block,samples_to_do,
+                        vgmstream->interleave_block_size);
+            }
+            return;
+        case coding_CRI_ADX_enc_8:
+        case coding_CRI_ADX_enc_9:
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                decode_adx_enc(&vgmstream->ch[ch],planar[ch]+samples_written,
+                        1,vgmstream->samples_into_block,samples_to_do,
+                        vgmstream->interleave_block_size);
+            }
+            return;
+        case coding_NGC_DSP:
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                decode_ngc_dsp(&vgmstream->ch[ch],planar[ch]+samples_written,
+                        1,vgmstream->samples_into_block,samples_to_do);
+            }
+            return;
+        case coding_NGC_AFC:
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                decode_ngc_afc(&vgmstream->ch[ch],planar[ch]+samples_written,
+                        1,vgmstream->samples_into_block,samples_to_do);
+            }
+            return;
+        /* PCM16 is faster with the all-channels decoder and a split */
+        case coding_PCM8:
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                decode_pcm8(&vgmstream->ch[ch],planar[ch]+samples_written,
+                        1,vgmstream->samples_into_block,samples_to_do);
+            }
+            return;
+        case coding_PSX:
+        case coding_PSX_badflags:
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                decode_psx(&vgmstream->ch[ch],planar[ch]+samples_written,
+                        1,vgmstream->samples_into_block,samples_to_do, vgmstream->coding_type == coding_PSX_badflags);
+            }
+            return;
+        case coding_PSX_cfg:
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                decode_psx_configurable(&vgmstream->ch[ch],planar[ch]+samples_written,
+                        1,vgmstream->samples_into_block,samples_to_do, vgmstream->interleave_block_size);
+            }
+            return;
+#ifdef VGM_USE_VORBIS
+        case coding_VORBIS_custom: {
+            sample * outbufs[VGMSTREAM_MAX_CHANNELS];
+            for (ch = 0; ch < vgmstream->channels; ch++) {
+                outbufs[ch] = planar[ch]+samples_written;
+            }
+            decode_vorbis_custom_planar(vgmstream, outbufs, samples_to_do, vgmstream->channels);
+            return;
+        }
+#endif
+        default:
+            break;
+    }
+
+    /* other codecs only decode interleaved */
+    vgmstream->planar_buffer = NULL;
+    decode_vgmstream(vgmstream, samples_written, samples_to_do, buffer);
+    vgmstream->planar_buffer = planar;
+
+    split_channels(planar, samples_written, buffer + samples_written*vgmstream->channels, vgmstream->channels, samples_to_do);
+}
+
 void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to_do, sample * buffer) {
     int ch;
+    /* decode all channels at once with some codecs (faster, mainly with many channels) */
+    int use_mch = vgmstream->channels <= DECODE_MCH_MAX_CHANNELS;
+
+    if (vgmstream->planar_buffer) {
+        decode_vgmstream_planar(vgmstream, samples_written, samples_to_do, buffer);
+        return;
+    }
 
     switch (vgmstream->coding_type) {
         case coding_CRI_ADX:
@@ -1491,12 +2423,22 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             break;
 
         case coding_PCM16LE:
+            if (use_mch) {
+                decode_pcm16_mch(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do, 0);
+                break;
+            }
             for (ch = 0; ch < vgmstream->channels; ch++) {
                 decode_pcm16le(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
                         vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
             }
             break;
         case coding_PCM16BE:
+            if (use_mch) {
+                decode_pcm16_mch(vgmstream,buffer+samples_written*vgmstream->channels,
+                        vgmstream->samples_into_block,samples_to_do, 1);
+                break;
+            }
             for (ch = 0; ch < vgmstream->channels; ch++) {
                 decode_pcm16be(&vgmstream->ch[ch],buffer+samples_written*vgmstream->channels+ch,
                         vgmstream->channels,vgmstream->samples_into_block,samples_to_do);
@@ -1691,23 +2633,39 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
             break;
 #ifdef VGM_USE_VORBIS
         case coding_OGG_VORBIS:
-            decode_ogg_vorbis(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
-                    samples_to_do,vgmstream->channels);
+            if (vgmstream->f32_buffer)
+                decode_ogg_vorbis_f32(vgmstream->codec_data, vgmstream->f32_buffer+samples_written*vgmstream->channels,
+                        samples_to_do,vgmstream->channels);
+            else
+                decode_ogg_vorbis(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
+                        samples_to_do,vgmstream->channels);
             break;
 
         case coding_VORBIS_custom:
-            decode_vorbis_custom(vgmstream, buffer+samples_written*vgmstream->channels,
-                    samples_to_do,vgmstream->channels);
+            if (vgmstream->f32_buffer)
+                decode_vorbis_custom_f32(vgmstream, vgmstream->f32_buffer+samples_written*vgmstream->channels,
+                        samples_to_do,vgmstream->channels);
+            else
+                decode_vorbis_custom(vgmstream, buffer+samples_written*vgmstream->channels,
+                        samples_to_do,vgmstream->channels);
             break;
 #endif
         case coding_CRI_HCA:
-            decode_hca(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
-                    samples_to_do);
+            if (vgmstream->f32_buffer)
+                decode_hca_f32(vgmstream->codec_data, vgmstream->f32_buffer+samples_written*vgmstream->channels,
+                        samples_to_do);
+            else
+                decode_hca(vgmstream->codec_data, buffer+samples_written*vgmstream->channels,
+                        samples_to_do);
             break;
 #ifdef VGM_USE_FFMPEG
         case coding_FFmpeg:
-            decode_ffmpeg(vgmstream,
-                          buffer+samples_written*vgmstream->channels,samples_to_do,vgmstream->channels);
+            if (vgmstream->f32_buffer)
+                decode_ffmpeg_f32(vgmstream,
+                              vgmstream->f32_buffer+samples_written*vgmstream->channels,samples_to_do,vgmstream->channels);
+            else
+                decode_ffmpeg(vgmstream,
+                              buffer+samples_written*vgmstream->channels,samples_to_do,vgmstream->channels);
             break;
 #endif
 #if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
@@ -2704,6 +3662,20 @@ int vgmstream_open_stream(VGMSTREAM * vgmstream, STREAMFILE *streamFile, off_t s
             file = streamFile->open(streamFile,filename, STREAMFILE_DEFAULT_BUFFER_SIZE);
             if (!file) goto fail;
         }
+        else {
+            /* channels read through shared pages instead of a file and buffer each (less fds/memory,
+             * and blocks aren't read once per channel); each channel reopens it below.
+             * Pages are read straight into the cache (reads of buffer size or more skip the
+             * stdio buffer), so the base file gets a minimal buffer. */
+            STREAMFILE * base_file = streamFile->open(streamFile,filename, STREAMFILE_CACHE_BASE_BUFFER_SIZE);
+            if (!base_file) goto fail;
+
+            file = open_cache_streamfile(base_file, vgmstream->channels + 8);
+            if (!file) {
+                close_streamfile(base_file);
+                goto fail;
+            }
+        }
 
         for (ch=0; ch < vgmstream->channels; ch++) {
             off_t offset;
@@ -2717,9 +3689,9 @@ int vgmstream_open_stream(VGMSTREAM * vgmstream, STREAMFILE *streamFile, off_t s
                 offset = start_offset + vgmstream->interleave_block_size*ch;
             }
 
-            /* open new one if needed */
-            if (use_streamfile_per_channel) {
-                file = streamFile->open(streamFile,filename, STREAMFILE_DEFAULT_BUFFER_SIZE);
+            /* open new one if needed (first channel uses the original) */
+            if (use_streamfile_per_channel && ch > 0) {
+                file = file->open(file,filename, STREAMFILE_DEFAULT_BUFFER_SIZE);
                 if (!file) goto fail;
             }
 
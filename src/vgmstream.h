@@ -7,6 +7,7 @@
 
 enum { PATH_LIMIT = 32768 };
 enum { STREAM_NAME_SIZE = 255 }; /* reasonable max */
+enum { VGMSTREAM_MAX_CHANNELS = 64 };
 
 #include "streamfile.h"
 
@@ -709,6 +710,20 @@ typedef enum {
 
 } meta_t;
 
+/* resampler quality presets (longer filters cost more per sample) */
+typedef enum {
+    resample_fast,
+    resample_normal,
+    resample_best,
+} resample_t;
+
+/* loop cache policies (which pass of the loop is kept in memory) */
+typedef enum {
+    loop_cache_off,
+    loop_cache_first_pass,      /* saves the most, but codecs that carry state through the loop may sound slightly different on the first repeat */
+    loop_cache_first_repeat,    /* keeps the first looped pass, so repeats match decoding more closely */
+} loop_cache_policy_t;
+
 
 /* info for a single vgmstream channel */
 typedef struct {
@@ -823,6 +838,7 @@ typedef struct {
     int hit_loop;                   /* have we seen the loop yet? */
     int loop_count;                 /* counter of complete loops (1=looped once) */
     int loop_target;                /* max loops before continuing with the stream end (loops forever if not set) */
+    int32_t play_sample;            /* number of samples rendered so far (including loops, for seeking) */
 
     /* decoder specific */
     int codec_endian;               /* little/big endian marker; name is left vague but usually means big endian */
@@ -840,6 +856,25 @@ typedef struct {
     void * codec_data;
     /* Same, for special layouts. layout_data + codec_data may exist at the same time. */
     void * layout_data;
+
+    /* Decoder state saved while rendering, for faster seeking (see seek_index.c) */
+    void * seek_index;
+
+    /* Output sample rate conversion applied while rendering (see resampler.c), not reset with the VGMSTREAM */
+    void * resampler;
+
+    /* Decoded loop kept in memory to skip decoding later loops (see loop_cache.c), not reset with the VGMSTREAM */
+    void * loop_cache;
+
+    /* Fade out applied over the output after N loops (see fade.c), not reset with the VGMSTREAM */
+    void * fade;
+
+    /* Float output while inside render_vgmstream_f32 (NULL otherwise), same layout as the sample buffer.
+     * Codecs that decode to float write here directly, others are converted after rendering. */
+    float * f32_buffer;
+    /* Per-channel output while inside render_vgmstream_planar (NULL otherwise), pointing to the sample buffer's
+     * start. Codecs that decode one channel at a time write here directly, others are split after decoding. */
+    sample ** planar_buffer;
 } VGMSTREAM;
 
 #ifdef VGM_USE_VORBIS
@@ -921,6 +956,7 @@ typedef struct {
     uint8_t mode_blockflag[64+1];   /* max 6b+1; flags 'n stuff */
     int mode_bits;                  /* bits to store mode_number */
     uint8_t prev_blockflag;         /* blockflag in the last decoded packet */
+    int setup_external;             /* setup rebuilt with codebooks from an external .wvc (not cached) */
     /* Ogg-style Vorbis: packet within a page */
     int current_packet;
     /* reference for page/blocks */
@@ -1084,12 +1120,33 @@ typedef struct {
     int segment_count;
     VGMSTREAM **segments;
     int current_segment;
+
+    /* next segment, reset and decoded a bit before the change (see segmented.c) */
+    int next_ready;
+    int next_segment;
+    int32_t next_samples_skip;  /* when looping to the middle of a segment */
+    int32_t next_samples;
+    int next_is_f32;
+    sample *lookahead;
+    float *lookahead_f32;
+    int32_t lookahead_samples;  /* not yet played, after changing segment */
+    int32_t lookahead_offset;
 } segmented_layout_data;
 
 /* for files made of "horizontal" layers, one per group of channels (using a complete sub-VGMSTREAM) */
 typedef struct {
     int layer_count;
     VGMSTREAM **layers;
+    sample *buffer;         /* a layer's samples before mixing (allocated on setup, so rendering doesn't) */
+    float *buffer_f32;      /* same when rendering to float */
+
+    /* parallel mode (see vgmstream_set_layer_threads): each layer decodes a chunk into its own buffer at once */
+    vgm_pool *pool;
+    int32_t chunk_size;     /* max samples per chunk */
+    int32_t chunk_samples;  /* samples in the current chunk */
+    sample **layer_buffers;
+    float **layer_buffers_f32;
+    sample *chunk_planar[VGMSTREAM_MAX_CHANNELS]; /* current chunk's planar output */
 } layered_layout_data;
 
 /* for compressed NWA */
@@ -1103,6 +1160,9 @@ typedef struct {
     clHCA_stInfo info;
 
     signed short *sample_buffer;
+    float *sample_buffer_f32;
+    int sample_buffer_ready;        /* current block was extracted to sample_buffer */
+    int sample_buffer_f32_ready;    /* current block was extracted to sample_buffer_f32 */
     size_t samples_filled;
     size_t samples_consumed;
     size_t samples_to_discard;
@@ -1246,9 +1306,45 @@ VGMSTREAM * init_vgmstream(const char * const filename);
 /* init with custom IO via streamfile */
 VGMSTREAM * init_vgmstream_from_STREAMFILE(STREAMFILE *streamFile);
 
+/* info of a bank's subsong, filled from its header for formats with a bank parser (FSB5, XWB) or else once
+ * it's opened (values are then updated from the opened VGMSTREAM) */
+typedef struct {
+    int filled;
+    int opened;
+    int32_t num_samples;
+    int sample_rate;
+    int channels;
+    int loop_flag;
+    char stream_name[STREAM_NAME_SIZE];
+} VGMSTREAM_BANK_ENTRY;
+
+/* a detected multi-subsong file (bank), to open its subsongs without re-probing formats */
+typedef struct {
+    int init_fcn;                   /* init function that accepted the file */
+    int subsongs;                   /* total subsongs (1 if the file has none) */
+    VGMSTREAM_BANK_ENTRY *directory; /* per subsong (index 0 = subsong 1) */
+    int bank_meta;                  /* internal: bank parser used (-1 if none) */
+    void *bank_data;                /* internal: parsed subsong headers, if the format has a bank parser */
+} VGMSTREAM_BANK;
+
+/* detect a file's format once, for multiple calls to init_vgmstream_bank_subsong (for FSB5 and XWB, all
+ * subsong headers are also parsed once, rather than on each subsong open) */
+VGMSTREAM_BANK * init_vgmstream_bank(STREAMFILE *streamFile);
+
+/* open subsong N (1..subsongs, 0=default) of a bank from a streamFile of the same file; different threads can
+ * open subsongs at once as long as each uses its own streamFile */
+VGMSTREAM * init_vgmstream_bank_subsong(VGMSTREAM_BANK * bank, STREAMFILE *streamFile, int subsong);
+
+/* close a bank (VGMSTREAMs opened from it are independent and must be closed separately) */
+void close_vgmstream_bank(VGMSTREAM_BANK * bank);
+
 /* reset a VGMSTREAM to start of stream */
 void reset_vgmstream(VGMSTREAM * vgmstream);
 
+/* seek a VGMSTREAM to a sample position (as output by render_vgmstream, so loops are included).
+ * Keeps loop config set by vgmstream_force_loop/vgmstream_set_loop_target. */
+void seek_vgmstream(VGMSTREAM * vgmstream, int32_t seek_sample);
+
 /* close an open vgmstream */
 void close_vgmstream(VGMSTREAM * vgmstream);
 
@@ -1258,6 +1354,14 @@ int32_t get_vgmstream_play_samples(double looptimes, double fadeseconds, double
 /* Decode data into sample buffer */
 void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
 
+/* Decode data into a float buffer (interleaved, nominally -1.0..1.0 but unclipped).
+ * Codecs that decode to float internally skip the 16-bit conversion, others are converted once. */
+void render_vgmstream_f32(float * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+
+/* Decode data into per-channel sample buffers (buffer[0] gets all of channel 0 and so on).
+ * Codecs that decode one channel at a time write each buffer contiguously, others are split once. */
+void render_vgmstream_planar(sample ** buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+
 /* Write a description of the stream into array pointed by desc, which must be length bytes long.
  * Will always be null-terminated if length > 0 */
 void describe_vgmstream(VGMSTREAM * vgmstream, char * desc, int length);
@@ -1276,6 +1380,88 @@ void vgmstream_force_loop(VGMSTREAM* vgmstream, int loop_flag, int loop_start_sa
 /* Set number of max loops to do, then play up to stream end (for songs with proper endings) */
 void vgmstream_set_loop_target(VGMSTREAM* vgmstream, int loop_target);
 
+/* Enable a seek index, that saves decoder state every interval samples (0=default) while rendering.
+ * Seeks can then restore the closest point for codecs that can't seek directly (like most ADPCM). */
+int vgmstream_enable_seek_index(VGMSTREAM * vgmstream, int32_t interval);
+
+/* Fill the seek index by decoding the whole stream once (slow, but any seek is fast afterwards) */
+void vgmstream_build_seek_index(VGMSTREAM * vgmstream);
+
+/* Save the seek index to a file, or load it (also enabling it), so it doesn't need to be built again.
+ * Returns 0 on failure (no index, or a file that doesn't match the stream). */
+int vgmstream_save_seek_index(VGMSTREAM * vgmstream, const char * filename);
+int vgmstream_load_seek_index(VGMSTREAM * vgmstream, STREAMFILE *streamFile);
+
+/* Resample output to output_rate (0 or the stream's rate disables it). Sample counts and positions of
+ * render/seek/get_vgmstream_play_samples are then at output rate, while sample_rate, num_samples and loop
+ * points stay at the stream's rate. Returns 0 on failure. */
+int vgmstream_set_output_rate(VGMSTREAM * vgmstream, int output_rate, resample_t quality);
+
+/* Current output rate (the stream's sample_rate if not resampling) */
+int vgmstream_get_output_rate(VGMSTREAM * vgmstream);
+
+/* Keep one decoded pass of the loop in memory (up to max_size bytes, 0 for default), so later loops are copied
+ * rather than decoded. Loops that don't fit are decoded as usual. Returns 0 if the loop won't be cached. */
+int vgmstream_set_loop_cache(VGMSTREAM * vgmstream, loop_cache_policy_t policy, size_t max_size);
+
+typedef struct {
+    loop_cache_policy_t policy;
+    int active;                 /* loop fits and is being kept */
+    int complete;               /* whole loop kept, so later loops are served from memory */
+    size_t size;                /* bytes used */
+    int64_t samples_served;     /* rendered from memory */
+    int64_t samples_decoded;    /* rendered by decoding */
+} VGMSTREAM_LOOP_CACHE_STATS;
+
+void vgmstream_get_loop_cache_stats(VGMSTREAM * vgmstream, VGMSTREAM_LOOP_CACHE_STATS * stats);
+
+/* Fade out looped streams while rendering, after loop_count loops plus fade_delay_seconds, over fade_seconds
+ * (then renders silence), so output up to get_vgmstream_play_samples with the same values is the whole song.
+ * Non-looped streams, fade_seconds <= 0 or a loop target matching loop_count disable it. Should be set after
+ * other config (loops, output rate) and before rendering, but may be changed while playing (ex. when looping
+ * forever is toggled). Kept through resets. Returns 0 on failure. */
+int vgmstream_set_play_config(VGMSTREAM * vgmstream, double loop_count, double fade_seconds, double fade_delay_seconds);
+
+/* Decode the layers of a layered stream at once over threads (including the caller's), in chunks of
+ * buffer_samples (0 for default). Meant for files with many heavy layers (multi-stem music and such).
+ * threads <= 1 goes back to decoding layers one by one. Returns 0 if the stream isn't layered or on
+ * failure (layers are then decoded one by one). */
+int vgmstream_set_layer_threads(VGMSTREAM * vgmstream, int threads, int32_t buffer_samples);
+
+/* Encrypted formats without a keyfile (HCA, ADX, FSB) try known keys: test them over threads (including the
+ * caller's, 1 = one by one, the default), and if cache_filename is set remember found keys there per file and
+ * per folder, so later files from the same game get them in one attempt. Process-wide, set before opening. */
+void vgmstream_set_key_search(int threads, const char * cache_filename);
+
+/* Open files by trying only formats that may accept their extension (1, the default), or by trying every
+ * format in order (0). Process-wide, set before opening. */
+void vgmstream_set_format_index(int enable);
+
+/* Real-time rendering (for audio callbacks and such): after opening, render calls don't allocate or free
+ * memory and do at most max_samples of decoding work (plus one codec frame), using a scratch buffer of
+ * vgmstream_realtime_get_scratch_size bytes given by the caller for float/planar renders.
+ * is_safe is set when all codecs/layouts decode without allocating (external libs like Vorbis/FFmpeg/MPEG
+ * may allocate internally, so they are rendered but not considered safe). Reads still go through the
+ * STREAMFILE, so for non-blocking IO use a memory STREAMFILE or open_prefetch_streamfile. Seeking and
+ * resetting aren't real-time and should be done outside render calls.
+ * Segmented streams (ex. .txtp with segments) are the exception to the work bound: the call before a
+ * segment change also resets the next segment and decodes up to 0x200 of its samples, and a loop that
+ * starts inside a segment seeks it, decoding it from its start to the loop start on every loop. */
+typedef struct {
+    VGMSTREAM * vgmstream;
+    int32_t max_samples;    /* per render call */
+    int is_safe;
+    sample * scratch;       /* max_samples * channels */
+} VGMSTREAM_REALTIME;
+
+size_t vgmstream_realtime_get_scratch_size(VGMSTREAM * vgmstream, int32_t max_samples);
+/* Returns 0 on failure (bad max_samples or scratch too small). The VGMSTREAM is still owned by the caller. */
+int vgmstream_realtime_open(VGMSTREAM_REALTIME * rt, VGMSTREAM * vgmstream, int32_t max_samples, void * scratch, size_t scratch_size);
+/* Same as render_vgmstream/_f32/_planar, rendering up to max_samples and returning samples done */
+int32_t vgmstream_realtime_render(VGMSTREAM_REALTIME * rt, sample * buffer, int32_t sample_count);
+int32_t vgmstream_realtime_render_f32(VGMSTREAM_REALTIME * rt, float * buffer, int32_t sample_count);
+int32_t vgmstream_realtime_render_planar(VGMSTREAM_REALTIME * rt, sample ** buffer, int32_t sample_count);
+
 /* -------------------------------------------------------------------------*/
 /* vgmstream "private" API                                                  */
 /* -------------------------------------------------------------------------*/
@@ -1301,6 +1487,45 @@ int vgmstream_samples_to_do(int samples_this_block, int samples_per_frame, VGMST
 /* Detect loop start and save values, or detect loop end and restore (loop back). Returns 1 if loop was done. */
 int vgmstream_do_loop(VGMSTREAM * vgmstream);
 
+/* Seek index internals: stop layouts at interval boundaries and save the state there, restore closest
+ * state of a pass (returns its sample or -1) */
+int seek_index_is_usable(VGMSTREAM * vgmstream);
+int32_t seek_index_samples_to_do(VGMSTREAM * vgmstream, int32_t samples_to_do);
+void seek_index_record(VGMSTREAM * vgmstream);
+int32_t seek_index_restore(VGMSTREAM * vgmstream, int32_t seek_sample, int loop_pass);
+void free_seek_index(void * seek_index);
+
+/* Resampler internals: render/seek at output rate, clear filter state (after a reset) */
+void render_vgmstream_resampled(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+void seek_vgmstream_resampled(VGMSTREAM * vgmstream, int32_t seek_sample);
+void reset_resampler(void * resampler);
+void free_resampler(void * resampler);
+
+/* Loop cache internals: render from memory when possible, samples it can serve before the loop end (0 if none),
+ * return play position to the decoder's (before seeking), forget the current loop (after a reset) */
+void render_vgmstream_loop_cached(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+int32_t loop_cache_get_samples_left(VGMSTREAM * vgmstream);
+void sync_loop_cache(VGMSTREAM * vgmstream);
+void reset_loop_cache(void * loop_cache);
+void free_loop_cache(void * loop_cache);
+
+/* Fade internals: render/seek tracking output position, restart from the beginning (after a reset) */
+void render_vgmstream_faded(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+void seek_vgmstream_faded(VGMSTREAM * vgmstream, int32_t seek_sample);
+void reset_fade(void * fade);
+void free_fade(void * fade);
+
+/* Key search internals: workers to set up for a search (1 if threads are off), test keys 0..keys-1 calling
+ * test_key(arg, worker, key_id) for a score (<0: wrong), where keys after one with stop_score aren't tested
+ * (scores left as -1), so scores can be checked in order as if tested one by one */
+int key_search_get_workers(int keys);
+void key_search_run(int (*test_key)(void *, int, int), void * arg, int workers, int keys, int stop_score, int * scores);
+
+/* Key cache internals: get a key of some kind ("hca", "fsb", etc) found before for this file or its folder
+ * (returns size, 0 if none), or remember one found by searching */
+size_t key_cache_load(STREAMFILE * sf, const char * kind, uint8_t * key, size_t key_max);
+void key_cache_save(STREAMFILE * sf, const char * kind, const uint8_t * key, size_t key_size);
+
 /* Open the stream for reading at offset (standarized taking into account layouts, channels and so on).
  * returns 0 on failure */
 int vgmstream_open_stream(VGMSTREAM * vgmstream, STREAMFILE *streamFile, off_t start_offset);
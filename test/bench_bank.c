@@ -0,0 +1,121 @@
+/* Times opening every subsong of a file one by one (detecting the format each time) and from a bank, and checks
+ * both ways (and the bank's directory) give the same subsongs.
+ * Usage: bench_bank file [repeats] */
+#include "../src/vgmstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int compare_vgmstream(int subsong, VGMSTREAM * v1, VGMSTREAM * v2, const VGMSTREAM_BANK_ENTRY * entry) {
+    if (!v1 || !v2) {
+        printf("subsong %i: not opened (%s)\n", subsong, v1 ? "bank" : "single");
+        return 1;
+    }
+
+    if (v1->num_samples != v2->num_samples || v1->sample_rate != v2->sample_rate || v1->channels != v2->channels
+            || v1->loop_flag != v2->loop_flag || v1->loop_start_sample != v2->loop_start_sample
+            || v1->loop_end_sample != v2->loop_end_sample || v1->num_streams != v2->num_streams
+            || v1->stream_index != v2->stream_index || v1->stream_size != v2->stream_size
+            || v1->coding_type != v2->coding_type || v1->layout_type != v2->layout_type
+            || v1->meta_type != v2->meta_type || v1->ch[0].offset != v2->ch[0].offset
+            || strcmp(v1->stream_name, v2->stream_name) != 0) {
+        printf("subsong %i: different info\n", subsong);
+        return 1;
+    }
+
+    /* samples and loops may be refined when opened (ex. XMA), others should be the same */
+    if (!entry->filled || entry->sample_rate != v1->sample_rate || entry->channels != v1->channels
+            || strcmp(entry->stream_name, v1->stream_name) != 0) {
+        printf("subsong %i: different directory entry\n", subsong);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char ** argv) {
+    STREAMFILE * streamFile = NULL;
+    VGMSTREAM_BANK * bank = NULL;
+    int repeats, r, subsong, errors = 0;
+    double time_single = 0, time_bank = 0;
+    clock_t start;
+
+    if (argc < 2) {
+        printf("usage: %s file [repeats]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    repeats = argc > 2 ? atoi(argv[2]) : 3;
+    if (repeats < 1) repeats = 1;
+
+    streamFile = open_stdio_streamfile(argv[1]);
+    if (!streamFile) goto fail;
+
+    /* check first, with the bank's directory as it was before opening subsongs */
+    bank = init_vgmstream_bank(streamFile);
+    if (!bank) goto fail;
+
+    for (subsong = 1; subsong <= bank->subsongs; subsong++) {
+        VGMSTREAM_BANK_ENTRY entry = bank->directory[subsong-1];
+        VGMSTREAM * v1 = init_vgmstream_bank_subsong(bank, streamFile, subsong);
+        VGMSTREAM * v2;
+
+        streamFile->stream_index = subsong;
+        v2 = init_vgmstream_from_STREAMFILE(streamFile);
+        streamFile->stream_index = 0;
+
+        if (subsong == 1 || !entry.filled) /* not filled by a bank parser */
+            entry = bank->directory[subsong-1];
+        errors += compare_vgmstream(subsong, v1, v2, &entry);
+        close_vgmstream(v1);
+        close_vgmstream(v2);
+        if (errors > 5) break;
+    }
+    close_vgmstream_bank(bank);
+    bank = NULL;
+
+    start = clock();
+    for (r = 0; r < repeats; r++) {
+        int subsongs = 1;
+        for (subsong = 1; subsong <= subsongs; subsong++) {
+            VGMSTREAM * vgmstream;
+
+            streamFile->stream_index = subsong;
+            vgmstream = init_vgmstream_from_STREAMFILE(streamFile);
+            if (vgmstream && vgmstream->num_streams > 1)
+                subsongs = vgmstream->num_streams;
+            close_vgmstream(vgmstream);
+        }
+        streamFile->stream_index = 0;
+    }
+    time_single = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (r = 0; r < repeats; r++) {
+        bank = init_vgmstream_bank(streamFile);
+        if (!bank) goto fail;
+        for (subsong = 1; subsong <= bank->subsongs; subsong++) {
+            close_vgmstream(init_vgmstream_bank_subsong(bank, streamFile, subsong));
+        }
+        close_vgmstream_bank(bank);
+        bank = NULL;
+    }
+    time_bank = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    bank = init_vgmstream_bank(streamFile);
+    printf("%i subsongs, %i repeats, %s\n", bank ? bank->subsongs : 0, repeats,
+            bank && bank->bank_data ? "headers parsed once" : "no bank parser");
+    printf("single opens   %8.3f ms/file\n", time_single * 1000.0 / repeats);
+    printf("bank opens     %8.3f ms/file\n", time_bank * 1000.0 / repeats);
+    printf("subsongs %s\n", errors ? "FAILED" : "ok");
+
+    close_vgmstream_bank(bank);
+    close_streamfile(streamFile);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+
+fail:
+    printf("can't open %s\n", argv[1]);
+    close_vgmstream_bank(bank);
+    close_streamfile(streamFile);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,191 @@
+/* Times decoding a synthetic N-layer .txtp (stereo layers of random ADPCM/PCM) layer by layer and over 2..N
+ * threads, with a few chunk sizes, and checks all ways give the same samples.
+ * Usage: bench_layered [layers] [codec: PSX/IMA/PCM16LE] [seconds] */
+#define _POSIX_C_SOURCE 199309L
+#include "../src/vgmstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_PREFIX "bench_layered"
+#define BENCH_SAMPLE_RATE 48000
+#define BENCH_RENDER_SAMPLES 0x8000 /* per render call, as the CLI */
+#define BENCH_MAX_LAYERS 32
+
+static unsigned int rng_state = 1;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 8) & 0xFFFFFF;
+}
+
+static double get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/* stereo layers with a shared .txth, plus the .txtp joining them */
+static int write_files(int layers, const char * codec, int seconds) {
+    char filename[PATH_LIMIT];
+    size_t data_size, i;
+    uint8_t * data;
+    FILE * file;
+    int layer;
+
+    if (strcmp(codec, "PSX") == 0)
+        data_size = (size_t)seconds * BENCH_SAMPLE_RATE / 28 * 0x10 * 2;
+    else if (strcmp(codec, "IMA") == 0)
+        data_size = (size_t)seconds * BENCH_SAMPLE_RATE;
+    else
+        data_size = (size_t)seconds * BENCH_SAMPLE_RATE * 2 * 2;
+
+    data = malloc(data_size);
+    if (!data) return 0;
+
+    file = fopen(BENCH_PREFIX ".txtp", "w");
+    if (!file) goto fail;
+    for (layer = 0; layer < layers; layer++) {
+        fprintf(file, BENCH_PREFIX "_%i.layer\n", layer);
+    }
+    fprintf(file, "\nmode = layers\n");
+    fclose(file);
+
+    file = fopen(".layer.txth", "w");
+    if (!file) goto fail;
+    fprintf(file, "codec = %s\nchannels = 2\nsample_rate = %i\ninterleave = %s\nnum_samples = data_size\n",
+            codec, BENCH_SAMPLE_RATE, strcmp(codec, "PSX") == 0 ? "0x10" : "0x02");
+    fclose(file);
+
+    for (layer = 0; layer < layers; layer++) {
+        for (i = 0; i < data_size; i++) {
+            data[i] = rng() & 0xFF;
+        }
+        if (strcmp(codec, "PSX") == 0) {
+            for (i = 0; i < data_size; i += 0x10) {
+                data[i+0] = (rng() % 5) << 4 | (rng() % 13); /* valid filter and shift */
+                data[i+1] = 0; /* no flags */
+            }
+        }
+
+        snprintf(filename, sizeof(filename), BENCH_PREFIX "_%i.layer", layer);
+        file = fopen(filename, "wb");
+        if (!file) goto fail;
+        fwrite(data, 1, data_size, file);
+        fclose(file);
+    }
+
+    free(data);
+    return 1;
+fail:
+    free(data);
+    return 0;
+}
+
+static void remove_files(int layers) {
+    char filename[PATH_LIMIT];
+    int layer;
+
+    for (layer = 0; layer < layers; layer++) {
+        snprintf(filename, sizeof(filename), BENCH_PREFIX "_%i.layer", layer);
+        remove(filename);
+    }
+    remove(".layer.txth");
+    remove(BENCH_PREFIX ".txtp");
+}
+
+/* renders the whole stream, returning a checksum of the samples */
+static uint32_t render_all(VGMSTREAM * vgmstream, sample * buffer, double * p_seconds) {
+    uint32_t sum = 0;
+    int32_t pos, i;
+    double start;
+
+    reset_vgmstream(vgmstream);
+
+    start = get_time();
+    for (pos = 0; pos < vgmstream->num_samples; pos += BENCH_RENDER_SAMPLES) {
+        int32_t samples = vgmstream->num_samples - pos;
+        if (samples > BENCH_RENDER_SAMPLES)
+            samples = BENCH_RENDER_SAMPLES;
+
+        render_vgmstream(buffer, samples, vgmstream);
+        for (i = 0; i < samples * vgmstream->channels; i++) {
+            sum = sum * 31 + (uint16_t)buffer[i];
+        }
+    }
+    *p_seconds = get_time() - start;
+
+    return sum;
+}
+
+static int bench_config(VGMSTREAM * vgmstream, sample * buffer, int threads, int32_t chunk, uint32_t ref_sum, double ref_time) {
+    uint32_t sum;
+    double seconds;
+    char chunk_name[16];
+
+    if (chunk)
+        snprintf(chunk_name, sizeof(chunk_name), "0x%x", chunk);
+    else
+        snprintf(chunk_name, sizeof(chunk_name), "default");
+
+    if (!vgmstream_set_layer_threads(vgmstream, threads, chunk)) {
+        printf("threads %2i  chunk %-7s can't set up\n", threads, chunk_name);
+        return 1;
+    }
+
+    sum = render_all(vgmstream, buffer, &seconds);
+    printf("threads %2i  chunk %-7s %8.3f s  %6.2fx%s\n", threads, chunk_name, seconds, ref_time / seconds,
+            sum != ref_sum ? "  DIFFERENT SAMPLES" : "");
+    return sum != ref_sum;
+}
+
+int main(int argc, char ** argv) {
+    static const int32_t chunks[] = { 0x200, 0x400, 0x1000, 0x2000, 0x4000, 0x8000 };
+    int layers = argc > 1 ? atoi(argv[1]) : 8;
+    const char * codec = argc > 2 ? argv[2] : "PSX";
+    int seconds = argc > 3 ? atoi(argv[3]) : 20;
+    VGMSTREAM * vgmstream = NULL;
+    sample * buffer = NULL;
+    uint32_t ref_sum;
+    double ref_time;
+    int threads, i, errors = 0;
+
+    if (layers < 2 || layers > BENCH_MAX_LAYERS || seconds < 1
+            || (strcmp(codec, "PSX") != 0 && strcmp(codec, "IMA") != 0 && strcmp(codec, "PCM16LE") != 0)) {
+        printf("usage: %s [layers 2..%i] [codec: PSX/IMA/PCM16LE] [seconds]\n", argv[0], BENCH_MAX_LAYERS);
+        return EXIT_FAILURE;
+    }
+
+    if (!write_files(layers, codec, seconds))
+        goto fail;
+    vgmstream = init_vgmstream(BENCH_PREFIX ".txtp");
+    if (!vgmstream) goto fail;
+    buffer = malloc(BENCH_RENDER_SAMPLES * vgmstream->channels * sizeof(sample));
+    if (!buffer) goto fail;
+
+    printf("%i layers, %s, %i channels, %i samples\n", layers, codec, vgmstream->channels, vgmstream->num_samples);
+
+    vgmstream_set_layer_threads(vgmstream, 1, 0);
+    ref_sum = render_all(vgmstream, buffer, &ref_time);
+    printf("layer by layer               %8.3f s\n", ref_time);
+
+    for (threads = 2; threads <= layers; threads++) {
+        errors += bench_config(vgmstream, buffer, threads, 0, ref_sum, ref_time);
+    }
+    for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        errors += bench_config(vgmstream, buffer, layers, chunks[i], ref_sum, ref_time);
+    }
+    printf("samples %s\n", errors ? "FAILED" : "ok");
+
+    close_vgmstream(vgmstream);
+    free(buffer);
+    remove_files(layers);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+
+fail:
+    printf("can't set up the layered file\n");
+    close_vgmstream(vgmstream);
+    free(buffer);
+    remove_files(layers);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,116 @@
+/* Times opening every file in a directory with the format index off and on (the first pass with it on
+ * includes building the index), and checks both ways detect the same format.
+ * Usage: bench_probe dir [repeats] */
+#include "../src/vgmstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+typedef struct {
+    char filename[PATH_LIMIT];
+    int meta_type;              /* -1 = not opened */
+    int32_t num_samples;
+} probe_file;
+
+static probe_file * list_files(const char * dirname, int * p_count) {
+    probe_file * files = NULL;
+    int count = 0;
+    struct dirent * de;
+    DIR * dir;
+
+    dir = opendir(dirname);
+    if (!dir) return NULL;
+
+    while ((de = readdir(dir)) != NULL) {
+        probe_file * new_files;
+        struct stat st;
+        char filename[PATH_LIMIT];
+
+        snprintf(filename, sizeof(filename), "%s/%s", dirname, de->d_name);
+        if (stat(filename, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+
+        new_files = realloc(files, (count + 1) * sizeof(probe_file));
+        if (!new_files) break;
+        files = new_files;
+        strcpy(files[count].filename, filename);
+        count++;
+    }
+    closedir(dir);
+
+    *p_count = count;
+    return files;
+}
+
+/* opens all files, saving what was detected if first is set (or returns the mismatches otherwise) */
+static int probe_files(probe_file * files, int count, int first, double * p_seconds, int * p_opened) {
+    int i, errors = 0, opened = 0;
+    clock_t start = clock();
+
+    for (i = 0; i < count; i++) {
+        VGMSTREAM * vgmstream = init_vgmstream(files[i].filename);
+        int meta_type = vgmstream ? (int)vgmstream->meta_type : -1;
+        int32_t num_samples = vgmstream ? vgmstream->num_samples : 0;
+
+        if (first) {
+            files[i].meta_type = meta_type;
+            files[i].num_samples = num_samples;
+        }
+        else if (files[i].meta_type != meta_type || files[i].num_samples != num_samples) {
+            if (errors++ < 5)
+                printf("%s: meta %i/%i, samples %i/%i\n", files[i].filename, files[i].meta_type, meta_type, files[i].num_samples, num_samples);
+        }
+
+        if (vgmstream) opened++;
+        close_vgmstream(vgmstream);
+    }
+
+    *p_seconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+    *p_opened = opened;
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    probe_file * files;
+    int count = 0, repeats, r, opened = 0, errors = 0;
+    double time_off = 0, time_on = 0, time_build = 0;
+
+    if (argc < 2) {
+        printf("usage: %s dir [repeats]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    repeats = argc > 2 ? atoi(argv[2]) : 10;
+    if (repeats < 1) repeats = 1;
+
+    files = list_files(argv[1], &count);
+    if (!files || !count) {
+        printf("no files in %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    /* index off first, as it's what the index must match */
+    vgmstream_set_format_index(0);
+    errors += probe_files(files, count, 1, &time_off, &opened);
+    for (r = 1; r < repeats; r++) {
+        errors += probe_files(files, count, 0, &time_off, &opened);
+    }
+
+    vgmstream_set_format_index(1);
+    errors += probe_files(files, count, 0, &time_build, &opened);
+    for (r = 1; r < repeats; r++) {
+        errors += probe_files(files, count, 0, &time_on, &opened);
+    }
+
+    printf("%i files, %i opened, %i repeats\n", count, opened, repeats);
+    printf("index off         %8.3f ms/file\n", time_off * 1000.0 / ((double)count * repeats));
+    printf("index on, 1st     %8.3f ms (builds the index)\n", time_build * 1000.0);
+    if (repeats > 1)
+        printf("index on          %8.3f ms/file\n", time_on * 1000.0 / ((double)count * (repeats - 1)));
+    printf("detection %s\n", errors ? "FAILED" : "ok");
+
+    free(files);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,434 @@
+/* Checks the DSP and PS-ADPCM decoders against the original per-sample (read_8bit) versions,
+ * on random data with random decode calls and a truncated last frame. Use -b to time them. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../src/vgmstream.h"
+#include "../src/coding/coding.h"
+
+#define TEST_FILE "test_adpcm.tmp"
+#define TEST_DATA_SIZE 0x20000
+#define TEST_MAX_CHANNELS 4
+
+static unsigned int rng_state = 1;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 8) & 0xFFFFFF;
+}
+
+
+/* original decoders, reading sample by sample */
+
+static const double ref_coefs_f[5][2] = {
+        {   0.0        ,   0.0        },
+        {  60.0 / 64.0 ,   0.0        },
+        { 115.0 / 64.0 , -52.0 / 64.0 },
+        {  98.0 / 64.0 , -55.0 / 64.0 },
+        { 122.0 / 64.0 , -60.0 / 64.0 },
+};
+
+static const int ref_coefs_i[5][2] = {
+        {   0 ,   0 },
+        {  60 ,   0 },
+        { 115 , -52 },
+        {  98 , -55 },
+        { 122 , -60 },
+};
+
+static void ref_decode_ngc_dsp_mem(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, uint8_t * mem) {
+    int i;
+    int32_t sample_count;
+
+    int8_t header = mem[0];
+    int32_t scale = 1 << (header & 0xf);
+    int coef_index = (header >> 4) & 0xf;
+    int32_t hist1 = stream->adpcm_history1_16;
+    int32_t hist2 = stream->adpcm_history2_16;
+    int coef1 = stream->adpcm_coef[coef_index*2];
+    int coef2 = stream->adpcm_coef[coef_index*2+1];
+
+    first_sample = first_sample%14;
+
+    for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
+        int sample_byte = mem[1 + i/2];
+
+        outbuf[sample_count] = clamp16((
+                 (((i&1?
+                    get_low_nibble_signed(sample_byte):
+                    get_high_nibble_signed(sample_byte)
+                   ) * scale)<<11) + 1024 +
+                 (coef1 * hist1 + coef2 * hist2))>>11
+                );
+
+        hist2 = hist1;
+        hist1 = outbuf[sample_count];
+    }
+
+    stream->adpcm_history1_16 = hist1;
+    stream->adpcm_history2_16 = hist2;
+}
+
+static void ref_decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    uint8_t frame[0x08];
+    int framesin = first_sample/14;
+    int i;
+
+    for (i=0; i < 0x08; i++) {
+        frame[i] = read_8bit(framesin*8+stream->offset+i,stream->streamfile);
+    }
+
+    ref_decode_ngc_dsp_mem(stream, outbuf, channelspacing, first_sample, samples_to_do, frame);
+}
+
+static void ref_decode_ngc_dsp_subint(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel, int interleave) {
+    uint8_t sample_data[0x08];
+    int i;
+
+    int framesin = first_sample/14;
+
+    for (i=0; i < 0x08; i++) {
+        /* base + current frame + subint section + subint byte + channel adjust */
+        sample_data[i] = read_8bit(
+                stream->offset
+                + framesin*(0x08*channelspacing)
+                + i/interleave * interleave * channelspacing
+                + i%interleave
+                + interleave * channel, stream->streamfile);
+    }
+
+    ref_decode_ngc_dsp_mem(stream, outbuf, channelspacing, first_sample, samples_to_do, sample_data);
+}
+
+static void ref_decode_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int is_badflags) {
+    off_t frame_offset;
+    int i, frames_in, sample_count = 0;
+    size_t bytes_per_frame, samples_per_frame;
+    uint8_t coef_index, shift_factor, flag;
+    int32_t hist1 = stream->adpcm_history1_32;
+    int32_t hist2 = stream->adpcm_history2_32;
+
+    bytes_per_frame = 0x10;
+    samples_per_frame = (bytes_per_frame - 0x02) * 2;
+    frames_in = first_sample / samples_per_frame;
+    first_sample = first_sample % samples_per_frame;
+
+    frame_offset = stream->offset + bytes_per_frame*frames_in;
+    coef_index   = ((uint8_t)read_8bit(frame_offset+0x00,stream->streamfile) >> 4) & 0xf;
+    shift_factor = ((uint8_t)read_8bit(frame_offset+0x00,stream->streamfile) >> 0) & 0xf;
+    flag = (uint8_t)read_8bit(frame_offset+0x01,stream->streamfile);
+
+    if (coef_index > 5)
+        coef_index = 0;
+    if (shift_factor > 12)
+        shift_factor = 9;
+    if (is_badflags)
+        flag = 0;
+
+    for (i = first_sample; i < first_sample + samples_to_do; i++) {
+        int32_t new_sample = 0;
+
+        if (flag < 0x07) {
+            uint8_t nibbles = (uint8_t)read_8bit(frame_offset+0x02+i/2,stream->streamfile);
+
+            new_sample = i&1 ?
+                    (nibbles >> 4) & 0x0f :
+                    (nibbles >> 0) & 0x0f;
+            new_sample = (int16_t)((new_sample << 12) & 0xf000) >> shift_factor;
+            new_sample = (int)(new_sample + ref_coefs_f[coef_index][0]*hist1 + ref_coefs_f[coef_index][1]*hist2);
+            new_sample = clamp16(new_sample);
+        }
+
+        outbuf[sample_count] = new_sample;
+        sample_count += channelspacing;
+
+        hist2 = hist1;
+        hist1 = new_sample;
+    }
+
+    stream->adpcm_history1_32 = hist1;
+    stream->adpcm_history2_32 = hist2;
+}
+
+static void ref_decode_psx_configurable(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int frame_size) {
+    off_t frame_offset;
+    int i, frames_in, sample_count = 0;
+    size_t bytes_per_frame, samples_per_frame;
+    uint8_t coef_index, shift_factor;
+    int32_t hist1 = stream->adpcm_history1_32;
+    int32_t hist2 = stream->adpcm_history2_32;
+
+    bytes_per_frame = frame_size;
+    samples_per_frame = (bytes_per_frame - 0x01) * 2;
+    frames_in = first_sample / samples_per_frame;
+    first_sample = first_sample % samples_per_frame;
+
+    frame_offset = stream->offset + bytes_per_frame*frames_in;
+    coef_index   = ((uint8_t)read_8bit(frame_offset+0x00,stream->streamfile) >> 4) & 0xf;
+    shift_factor = ((uint8_t)read_8bit(frame_offset+0x00,stream->streamfile) >> 0) & 0xf;
+
+    if (coef_index > 5)
+        coef_index = 0;
+    if (shift_factor > 12)
+        shift_factor = 9;
+
+    for (i = first_sample; i < first_sample + samples_to_do; i++) {
+        int32_t new_sample = 0;
+        uint8_t nibbles = (uint8_t)read_8bit(frame_offset+0x01+i/2,stream->streamfile);
+
+        new_sample = i&1 ?
+                (nibbles >> 4) & 0x0f :
+                (nibbles >> 0) & 0x0f;
+        new_sample = (int16_t)((new_sample << 12) & 0xf000) >> shift_factor;
+        new_sample = new_sample + ((ref_coefs_i[coef_index][0]*hist1 + ref_coefs_i[coef_index][1]*hist2) >> 6);
+        new_sample = clamp16(new_sample);
+
+        outbuf[sample_count] = new_sample;
+        sample_count += channelspacing;
+
+        hist2 = hist1;
+        hist1 = new_sample;
+    }
+
+    stream->adpcm_history1_32 = hist1;
+    stream->adpcm_history2_32 = hist2;
+}
+
+
+/* test cases */
+
+typedef enum { DSP, DSP_SUBINT, PSX, PSX_BADFLAGS, PSX_CFG } codec_t;
+
+typedef struct {
+    const char * name;
+    codec_t codec;
+    int frame_size;     /* or subint interleave */
+} test_case_t;
+
+static const test_case_t test_cases[] = {
+        { "dsp",            DSP,            0x08 },
+        { "dsp-subint-1",   DSP_SUBINT,     0x01 },
+        { "dsp-subint-2",   DSP_SUBINT,     0x02 },
+        { "dsp-subint-4",   DSP_SUBINT,     0x04 },
+        { "psx",            PSX,            0x10 },
+        { "psx-badflags",   PSX_BADFLAGS,   0x10 },
+        { "psx-cfg-3",      PSX_CFG,        0x03 },
+        { "psx-cfg-4",      PSX_CFG,        0x04 },
+        { "psx-cfg-9",      PSX_CFG,        0x09 },
+        { "psx-cfg-33",     PSX_CFG,        0x21 },
+        { "psx-cfg-41",     PSX_CFG,        0x29 },
+};
+
+static int get_samples_per_frame(const test_case_t * tc) {
+    switch(tc->codec) {
+        case DSP:
+        case DSP_SUBINT:    return 14;
+        case PSX:
+        case PSX_BADFLAGS:  return 28;
+        default:            return (tc->frame_size - 0x01) * 2;
+    }
+}
+
+static int get_frame_size(const test_case_t * tc) {
+    return tc->codec == DSP_SUBINT ? 0x08 : tc->frame_size;
+}
+
+static void decode(const test_case_t * tc, int is_ref, VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
+    switch(tc->codec) {
+        case DSP:
+            if (is_ref) ref_decode_ngc_dsp(stream, outbuf, channelspacing, first_sample, samples_to_do);
+            else        decode_ngc_dsp(stream, outbuf, channelspacing, first_sample, samples_to_do);
+            break;
+        case DSP_SUBINT:
+            if (is_ref) ref_decode_ngc_dsp_subint(stream, outbuf, channelspacing, first_sample, samples_to_do, channel, tc->frame_size);
+            else        decode_ngc_dsp_subint(stream, outbuf, channelspacing, first_sample, samples_to_do, channel, tc->frame_size);
+            break;
+        case PSX:
+        case PSX_BADFLAGS:
+            if (is_ref) ref_decode_psx(stream, outbuf, channelspacing, first_sample, samples_to_do, tc->codec == PSX_BADFLAGS);
+            else        decode_psx(stream, outbuf, channelspacing, first_sample, samples_to_do, tc->codec == PSX_BADFLAGS);
+            break;
+        case PSX_CFG:
+            if (is_ref) ref_decode_psx_configurable(stream, outbuf, channelspacing, first_sample, samples_to_do, tc->frame_size);
+            else        decode_psx_configurable(stream, outbuf, channelspacing, first_sample, samples_to_do, tc->frame_size);
+            break;
+    }
+}
+
+/* random frames with valid-ish headers (DSP coef_index 0..7, PS-ADPCM filter 5 is skipped as the
+ * decoders read past the 5-entry coef table for it, so the result can't be compared) */
+static void make_data(uint8_t * buf, size_t size, const test_case_t * tc, int channels, size_t channel_size) {
+    int frame_size = get_frame_size(tc);
+    size_t i;
+    int c;
+
+    for (i = 0; i < size; i++) {
+        buf[i] = rng() & 0xFF;
+    }
+
+    if (tc->codec == DSP_SUBINT) {
+        /* each channel's header is the first byte of its first subint section */
+        for (i = 0; i + frame_size*channels <= size; i += frame_size*channels) {
+            for (c = 0; c < channels; c++) {
+                buf[i + tc->frame_size*c] &= 0x7F;
+            }
+        }
+        return;
+    }
+
+    for (c = 0; c < channels; c++) {
+        size_t start = c * channel_size;
+
+        for (i = start; i + frame_size <= size; i += frame_size) {
+            if (tc->codec == DSP) {
+                buf[i] &= 0x7F;
+            }
+            else {
+                while (((buf[i] >> 4) & 0xf) == 5)
+                    buf[i] = rng() & 0xFF;
+                if (tc->codec == PSX && (rng() % 4))
+                    buf[i+1] &= 0x07; /* mostly standard flags, some bad and 0x07 */
+            }
+        }
+    }
+}
+
+/* decodes the file as a set of channels, in random chunks, with the new and reference decoders */
+static int test_decode(const test_case_t * tc, STREAMFILE * sf, size_t data_size, int channels, size_t channel_size, sample * out_new, sample * out_ref) {
+    VGMSTREAMCHANNEL ch_new[TEST_MAX_CHANNELS], ch_ref[TEST_MAX_CHANNELS];
+    int samples_per_frame = get_samples_per_frame(tc);
+    int frame_size = get_frame_size(tc);
+    int32_t total_samples, pos = 0;
+    int c, i, errors = 0;
+
+    /* one frame past the last full one, so the truncated frame is decoded (missing bytes read as 0xFF) */
+    if (tc->codec == DSP_SUBINT)
+        total_samples = (data_size / (frame_size*channels) + 1) * samples_per_frame;
+    else /* the last channel has the remaining bytes and reaches EOF */
+        total_samples = ((data_size - (channels-1)*channel_size) / frame_size + 1) * samples_per_frame;
+
+    memset(ch_new, 0, sizeof(ch_new));
+    for (c = 0; c < channels; c++) {
+        ch_new[c].streamfile = sf;
+        ch_new[c].offset = tc->codec == DSP_SUBINT ? 0 : c * channel_size;
+        for (i = 0; i < 16; i++) {
+            ch_new[c].adpcm_coef[i] = (int16_t)(rng() & 0xFFFF);
+        }
+    }
+    memcpy(ch_ref, ch_new, sizeof(ch_ref));
+
+    while (pos < total_samples) {
+        int32_t samples_to_do = 1 + rng() % samples_per_frame;
+        int32_t samples_left_in_frame = samples_per_frame - pos % samples_per_frame;
+
+        if (samples_to_do > samples_left_in_frame)
+            samples_to_do = samples_left_in_frame;
+
+        for (c = 0; c < channels; c++) {
+            decode(tc, 0, &ch_new[c], out_new + pos*channels + c, channels, pos, samples_to_do, c);
+            decode(tc, 1, &ch_ref[c], out_ref + pos*channels + c, channels, pos, samples_to_do, c);
+
+            if (ch_new[c].adpcm_history1_32 != ch_ref[c].adpcm_history1_32 || ch_new[c].adpcm_history2_32 != ch_ref[c].adpcm_history2_32) {
+                if (errors++ < 5)
+                    printf("%s: history mismatch, channel %i at sample %i\n", tc->name, c, pos);
+            }
+        }
+
+        pos += samples_to_do;
+    }
+
+    for (i = 0; i < total_samples*channels; i++) {
+        if (out_new[i] != out_ref[i]) {
+            if (errors++ < 5)
+                printf("%s: sample %i (channels %i): %i != %i\n", tc->name, i, channels, out_new[i], out_ref[i]);
+        }
+    }
+
+    return errors;
+}
+
+static double bench_decode(const test_case_t * tc, int is_ref, STREAMFILE * sf, size_t data_size, sample * outbuf) {
+    VGMSTREAMCHANNEL stream;
+    int samples_per_frame = get_samples_per_frame(tc);
+    int32_t total_samples = (data_size / get_frame_size(tc)) * samples_per_frame;
+    int32_t pos;
+    int r, repeats = 20;
+    clock_t start;
+
+    memset(&stream, 0, sizeof(stream));
+    stream.streamfile = sf;
+
+    start = clock();
+    for (r = 0; r < repeats; r++) {
+        for (pos = 0; pos < total_samples; pos += samples_per_frame) {
+            decode(tc, is_ref, &stream, outbuf + pos, 1, pos, samples_per_frame, 0);
+        }
+    }
+
+    return (double)repeats * total_samples / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0;
+}
+
+int main(int argc, char ** argv) {
+    int do_bench = (argc > 1 && strcmp(argv[1], "-b") == 0);
+    uint8_t * data = NULL;
+    sample * out_new = NULL;
+    sample * out_ref = NULL;
+    STREAMFILE * sf = NULL;
+    int t, run, errors = 0;
+
+    data = malloc(TEST_DATA_SIZE);
+    out_new = malloc(TEST_DATA_SIZE * 4 * sizeof(sample)); /* worst case, 3-byte frames */
+    out_ref = malloc(TEST_DATA_SIZE * 4 * sizeof(sample));
+    if (!data || !out_new || !out_ref) goto fail;
+
+    for (t = 0; t < sizeof(test_cases) / sizeof(test_cases[0]); t++) {
+        const test_case_t * tc = &test_cases[t];
+        int case_errors = 0;
+
+        for (run = 0; run < 8; run++) {
+            /* odd sizes so the last frame is truncated */
+            size_t data_size = TEST_DATA_SIZE / 8 * (run + 1) - (rng() % 0x40);
+            int channels = 1 + rng() % TEST_MAX_CHANNELS;
+            size_t channel_size = data_size / channels / get_frame_size(tc) * get_frame_size(tc);
+            FILE * file;
+
+            make_data(data, data_size, tc, channels, channel_size);
+            file = fopen(TEST_FILE, "wb");
+            if (!file) goto fail;
+            fwrite(data, 1, data_size, file);
+            fclose(file);
+
+            sf = open_stdio_streamfile(TEST_FILE);
+            if (!sf) goto fail;
+            case_errors += test_decode(tc, sf, data_size, channels, channel_size, out_new, out_ref);
+
+            if (do_bench && run == 7) {
+                double speed_ref = bench_decode(tc, 1, sf, data_size, out_ref);
+                double speed_new = bench_decode(tc, 0, sf, data_size, out_new);
+                printf("%-14s  per-sample %7.1f  frame %7.1f Msamples/s\n", tc->name, speed_ref, speed_new);
+            }
+
+            close_streamfile(sf);
+            sf = NULL;
+        }
+
+        if (!do_bench)
+            printf("%-14s %s\n", tc->name, case_errors ? "FAILED" : "ok");
+        errors += case_errors;
+    }
+
+    remove(TEST_FILE);
+    free(data);
+    free(out_new);
+    free(out_ref);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+
+fail:
+    printf("setup failed\n");
+    if (sf) close_streamfile(sf);
+    remove(TEST_FILE);
+    free(data);
+    free(out_new);
+    free(out_ref);
+    return EXIT_FAILURE;
+}
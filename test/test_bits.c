@@ -0,0 +1,317 @@
+/* Checks r_bits/w_bits (Vorbis and MSF bit order) against the original bit by bit versions, on random
+ * offsets and sizes (including out of bounds), plus write/read round trips. Use -b to time them. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../src/vgmstream.h"
+#include "../src/coding/coding.h"
+
+#define TEST_BUF_SIZE 0x40
+#define BENCH_BUF_SIZE 0x10000
+
+static unsigned int rng_state = 1;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 8) & 0xFFFFFF;
+}
+
+static uint32_t rng32(void) {
+    return (rng() << 16) ^ rng();
+}
+
+
+/* original versions, handling a bit at a time */
+
+static int ref_r_bits_vorbis(vgm_bitstream * ib, int num_bits, uint32_t * value) {
+    off_t off, pos;
+    int i, bit_buf, bit_val;
+    if (num_bits == 0) return 1;
+    if (num_bits > 32 || num_bits < 0 || ib->b_off + num_bits > ib->bufsize*8) goto fail;
+
+    *value = 0; /* set all bits to 0 */
+    off = ib->b_off / 8; /* byte offset */
+    pos = ib->b_off % 8; /* bit sub-offset */
+    for (i = 0; i < num_bits; i++) {
+        bit_buf = (1U << pos) & 0xFF;   /* bit check for buf */
+        bit_val = (1U << i);            /* bit to set in value */
+
+        if (ib->buf[off] & bit_buf)     /* is bit in buf set? */
+            *value |= bit_val;          /* set bit */
+
+        pos++;                          /* new byte starts */
+        if (pos%8 == 0) {
+            pos = 0;
+            off++;
+        }
+    }
+
+    ib->b_off += num_bits;
+    return 1;
+fail:
+    return 0;
+}
+
+static int ref_w_bits_vorbis(vgm_bitstream * ob, int num_bits, uint32_t value) {
+    off_t off, pos;
+    int i, bit_val, bit_buf;
+    if (num_bits == 0) return 1;
+    if (num_bits > 32 || num_bits < 0 || ob->b_off + num_bits > ob->bufsize*8) goto fail;
+
+    off = ob->b_off / 8; /* byte offset */
+    pos = ob->b_off % 8; /* bit sub-offset */
+    for (i = 0; i < num_bits; i++) {
+        bit_val = (1U << i);            /* bit check for value */
+        bit_buf = (1U << pos) & 0xFF;   /* bit to set in buf */
+
+        if (value & bit_val)            /* is bit in val set? */
+            ob->buf[off] |= bit_buf;    /* set bit */
+        else
+            ob->buf[off] &= ~bit_buf;   /* unset bit */
+
+        pos++;                          /* new byte starts */
+        if (pos%8 == 0) {
+            pos = 0;
+            off++;
+        }
+    }
+
+    ob->b_off += num_bits;
+    return 1;
+fail:
+    return 0;
+}
+
+static int ref_r_bits_msf(vgm_bitstream * ib, int num_bits, uint32_t * value) {
+    off_t off, pos;
+    int i, bit_buf, bit_val;
+    if (num_bits == 0) return 1;
+    if (num_bits > 32 || num_bits < 0 || ib->b_off + num_bits > ib->bufsize*8) goto fail;
+
+    *value = 0; /* set all bits to 0 */
+    off = ib->b_off / 8; /* byte offset */
+    pos = ib->b_off % 8; /* bit sub-offset */
+    for (i = 0; i < num_bits; i++) {
+        bit_buf = (1U << (8-1-pos)) & 0xFF;   /* bit check for buf */
+        bit_val = (1U << (num_bits-1-i));     /* bit to set in value */
+
+        if (ib->buf[off] & bit_buf)         /* is bit in buf set? */
+            *value |= bit_val;              /* set bit */
+
+        pos++;
+        if (pos%8 == 0) {                   /* new byte starts */
+            pos = 0;
+            off++;
+        }
+    }
+
+    ib->b_off += num_bits;
+    return 1;
+fail:
+    return 0;
+}
+
+static int ref_w_bits_msf(vgm_bitstream * ob, int num_bits, uint32_t value) {
+    off_t off, pos;
+    int i, bit_val, bit_buf;
+    if (num_bits == 0) return 1;
+    if (num_bits > 32 || num_bits < 0 || ob->b_off + num_bits > ob->bufsize*8) goto fail;
+
+    off = ob->b_off / 8; /* byte offset */
+    pos = ob->b_off % 8; /* bit sub-offset */
+    for (i = 0; i < num_bits; i++) {
+        bit_val = (1U << (num_bits-1-i));     /* bit check for value */
+        bit_buf = (1U << (8-1-pos)) & 0xFF;   /* bit to set in buf */
+
+        if (value & bit_val)                /* is bit in val set? */
+            ob->buf[off] |= bit_buf;        /* set bit */
+        else
+            ob->buf[off] &= ~bit_buf;       /* unset bit */
+
+        pos++;
+        if (pos%8 == 0) {                   /* new byte starts */
+            pos = 0;
+            off++;
+        }
+    }
+
+    ob->b_off += num_bits;
+    return 1;
+fail:
+    return 0;
+}
+
+static int ref_r_bits(vgm_bitstream * ib, int num_bits, uint32_t * value) {
+    return ib->mode == BITSTREAM_VORBIS ? ref_r_bits_vorbis(ib, num_bits, value) : ref_r_bits_msf(ib, num_bits, value);
+}
+
+static int ref_w_bits(vgm_bitstream * ob, int num_bits, uint32_t value) {
+    return ob->mode == BITSTREAM_VORBIS ? ref_w_bits_vorbis(ob, num_bits, value) : ref_w_bits_msf(ob, num_bits, value);
+}
+
+
+static const char * mode_name(vgm_bitstream_t mode) {
+    return mode == BITSTREAM_VORBIS ? "vorbis" : "msf";
+}
+
+/* single calls at random positions (some past the end) and sizes (some invalid), same results as the originals */
+static int test_calls(vgm_bitstream_t mode) {
+    uint8_t buf_new[TEST_BUF_SIZE], buf_ref[TEST_BUF_SIZE];
+    int run, i, errors = 0;
+
+    for (i = 0; i < TEST_BUF_SIZE; i++) {
+        buf_ref[i] = buf_new[i] = rng() & 0xFF;
+    }
+
+    for (run = 0; run < 200000; run++) {
+        vgm_bitstream ib_new = {0}, ib_ref = {0};
+        int is_write = rng() & 1;
+        int num_bits = (int)(rng() % 36) - 1; /* -1..34 */
+        off_t b_off = rng() % (TEST_BUF_SIZE*8 + 40);
+        uint32_t value = rng32(), value_new = 0x55555555, value_ref = 0x55555555;
+        int ok_new, ok_ref;
+
+        ib_new.buf = buf_new;
+        ib_ref.buf = buf_ref;
+        ib_new.bufsize = ib_ref.bufsize = TEST_BUF_SIZE;
+        ib_new.b_off = ib_ref.b_off = b_off;
+        ib_new.mode = ib_ref.mode = mode;
+
+        if (is_write) {
+            ok_new = w_bits(&ib_new, num_bits, value);
+            ok_ref = ref_w_bits(&ib_ref, num_bits, value);
+        }
+        else {
+            ok_new = r_bits(&ib_new, num_bits, &value_new);
+            ok_ref = ref_r_bits(&ib_ref, num_bits, &value_ref);
+        }
+
+        if (ok_new != ok_ref || ib_new.b_off != ib_ref.b_off || value_new != value_ref
+                || memcmp(buf_new, buf_ref, TEST_BUF_SIZE) != 0) {
+            if (errors++ < 5)
+                printf("%s %s: b_off %i, bits %i: ok %i/%i, value %08x/%08x\n", mode_name(mode), is_write ? "write" : "read",
+                        (int)b_off, num_bits, ok_new, ok_ref, value_new, value_ref);
+            memcpy(buf_new, buf_ref, TEST_BUF_SIZE);
+        }
+    }
+
+    return errors;
+}
+
+/* writes a random sequence of values then reads them back, with the buffer also matching the original's */
+static int test_round_trip(vgm_bitstream_t mode) {
+    uint8_t buf_new[TEST_BUF_SIZE], buf_ref[TEST_BUF_SIZE];
+    int sizes[TEST_BUF_SIZE*8];
+    uint32_t values[TEST_BUF_SIZE*8];
+    int run, i, count, errors = 0;
+
+    for (run = 0; run < 2000; run++) {
+        vgm_bitstream ob_new = {0}, ob_ref = {0};
+        off_t start = rng() % 16;
+
+        for (i = 0; i < TEST_BUF_SIZE; i++) {
+            buf_ref[i] = buf_new[i] = rng() & 0xFF;
+        }
+        ob_new.buf = buf_new;
+        ob_ref.buf = buf_ref;
+        ob_new.bufsize = ob_ref.bufsize = TEST_BUF_SIZE;
+        ob_new.b_off = ob_ref.b_off = start;
+        ob_new.mode = ob_ref.mode = mode;
+
+        for (count = 0; count < TEST_BUF_SIZE*8; count++) {
+            int num_bits = rng() % 33;
+            uint32_t value = rng32() & (num_bits ? 0xFFFFFFFFU >> (32 - num_bits) : 0);
+
+            if (!w_bits(&ob_new, num_bits, value))
+                break;
+            ref_w_bits(&ob_ref, num_bits, value);
+            sizes[count] = num_bits;
+            values[count] = value;
+        }
+        if (memcmp(buf_new, buf_ref, TEST_BUF_SIZE) != 0) {
+            if (errors++ < 5)
+                printf("%s round trip: written buffers differ\n", mode_name(mode));
+            continue;
+        }
+
+        ob_new.b_off = start;
+        for (i = 0; i < count; i++) {
+            uint32_t value = 0;
+            if (!r_bits(&ob_new, sizes[i], &value) || (sizes[i] && value != values[i])) {
+                if (errors++ < 5)
+                    printf("%s round trip: value %i (%i bits) %08x != %08x\n", mode_name(mode), i, sizes[i], value, values[i]);
+                break;
+            }
+        }
+    }
+
+    return errors;
+}
+
+
+static double bench_bits(int is_ref, vgm_bitstream_t mode, uint8_t * buf, int num_bits) {
+    vgm_bitstream ob = {0};
+    uint32_t value = 0, sum = 0;
+    int r, repeats = 20;
+    clock_t start;
+
+    ob.buf = buf;
+    ob.bufsize = BENCH_BUF_SIZE;
+    ob.mode = mode;
+
+    start = clock();
+    for (r = 0; r < repeats; r++) {
+        ob.b_off = 0;
+        if (is_ref) {
+            while (ref_w_bits(&ob, num_bits, (uint32_t)r)) { }
+            ob.b_off = 0;
+            while (ref_r_bits(&ob, num_bits, &value)) { sum += value; }
+        }
+        else {
+            while (w_bits(&ob, num_bits, (uint32_t)r)) { }
+            ob.b_off = 0;
+            while (r_bits(&ob, num_bits, &value)) { sum += value; }
+        }
+    }
+    if (sum == 1) printf(" "); /* keep reads */
+
+    /* written then read */
+    return (double)repeats * BENCH_BUF_SIZE * 2 / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0;
+}
+
+static void bench(uint8_t * buf) {
+    static const int bench_bits_sizes[] = { 1, 4, 13, 32 };
+    vgm_bitstream_t mode;
+    int i;
+
+    for (mode = BITSTREAM_MSF; mode <= BITSTREAM_VORBIS; mode++) {
+        for (i = 0; i < sizeof(bench_bits_sizes) / sizeof(bench_bits_sizes[0]); i++) {
+            int num_bits = bench_bits_sizes[i];
+            double speed_ref = bench_bits(1, mode, buf, num_bits);
+            double speed_new = bench_bits(0, mode, buf, num_bits);
+            printf("%-6s %2i bits  bit by bit %7.1f  word %7.1f MB/s\n", mode_name(mode), num_bits, speed_ref, speed_new);
+        }
+    }
+}
+
+int main(int argc, char ** argv) {
+    vgm_bitstream_t mode;
+    int errors = 0;
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        uint8_t * buf = calloc(1, BENCH_BUF_SIZE);
+        if (!buf) return EXIT_FAILURE;
+        bench(buf);
+        free(buf);
+        return EXIT_SUCCESS;
+    }
+
+    for (mode = BITSTREAM_MSF; mode <= BITSTREAM_VORBIS; mode++) {
+        int e1 = test_calls(mode);
+        int e2 = test_round_trip(mode);
+        printf("bits %-6s %s\n", mode_name(mode), e1 + e2 ? "FAILED" : "ok");
+        errors += e1 + e2;
+    }
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
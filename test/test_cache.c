@@ -0,0 +1,247 @@
+/* Checks open_cache_streamfile: reads (spanning pages, past EOF, from several handles) against the data,
+ * LRU eviction and refcounted close (over a counting memory STREAMFILE), and the same reads over stdio. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/vgmstream.h"
+
+#define TEST_FILE "test_cache.tmp"
+#define TEST_DATA_SIZE (STREAMFILE_CACHE_PAGE_SIZE * 8 + 0x123) /* last page is partial */
+#define PAGE STREAMFILE_CACHE_PAGE_SIZE
+
+static unsigned int rng_state = 1;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 8) & 0xFFFFFF;
+}
+
+static uint8_t * test_data;
+
+
+/* memory STREAMFILE counting calls (static, so closes can be counted) */
+typedef struct {
+    STREAMFILE sf;
+    int reads;
+    int opens;
+    int closes;
+} MEM_STREAMFILE;
+
+static MEM_STREAMFILE mem_sf;
+
+static size_t mem_read(MEM_STREAMFILE * sf, uint8_t * dest, off_t offset, size_t length) {
+    sf->reads++;
+    if (offset < 0 || offset >= TEST_DATA_SIZE)
+        return 0;
+    if (offset + length > TEST_DATA_SIZE)
+        length = TEST_DATA_SIZE - offset;
+    memcpy(dest, test_data + offset, length);
+    return length;
+}
+static size_t mem_get_size(MEM_STREAMFILE * sf) {
+    return TEST_DATA_SIZE;
+}
+static off_t mem_get_offset(MEM_STREAMFILE * sf) {
+    return 0;
+}
+static void mem_get_name(MEM_STREAMFILE * sf, char * buffer, size_t length) {
+    snprintf(buffer, length, "%s", TEST_FILE);
+}
+static STREAMFILE * mem_open(MEM_STREAMFILE * sf, const char * const filename, size_t buffersize) {
+    sf->opens++;
+    return NULL;
+}
+static void mem_close(MEM_STREAMFILE * sf) {
+    sf->closes++;
+}
+
+static STREAMFILE * open_mem_streamfile(void) {
+    memset(&mem_sf, 0, sizeof(mem_sf));
+    mem_sf.sf.read = (void*)mem_read;
+    mem_sf.sf.get_size = (void*)mem_get_size;
+    mem_sf.sf.get_offset = (void*)mem_get_offset;
+    mem_sf.sf.get_name = (void*)mem_get_name;
+    mem_sf.sf.open = (void*)mem_open;
+    mem_sf.sf.close = (void*)mem_close;
+    return &mem_sf.sf;
+}
+
+
+/* random reads from a few handles over the same pages, some spanning pages or past EOF */
+static int test_reads(STREAMFILE * inner, int pages_count, const char * name) {
+    STREAMFILE * sf[3] = {0};
+    uint8_t buf[PAGE * 3];
+    int i, run, errors = 0;
+
+    sf[0] = open_cache_streamfile(inner, pages_count);
+    if (!sf[0]) {
+        close_streamfile(inner);
+        return 1;
+    }
+    for (i = 1; i < 3; i++) {
+        sf[i] = sf[0]->open(sf[0], TEST_FILE, STREAMFILE_DEFAULT_BUFFER_SIZE);
+        if (!sf[i]) errors++;
+    }
+
+    for (run = 0; run < 20000 && !errors; run++) {
+        STREAMFILE * h = sf[rng() % 3];
+        off_t offset = rng() % (TEST_DATA_SIZE + 0x100);
+        size_t length = rng() % (run & 1 ? sizeof(buf) : 0x40);
+        size_t expected = offset >= TEST_DATA_SIZE ? 0 : (offset + length > TEST_DATA_SIZE ? TEST_DATA_SIZE - offset : length);
+        size_t bytes;
+
+        if ((run % 7) == 0) { /* ends right at a page boundary */
+            length = 1 + rng() % PAGE;
+            offset = (1 + rng() % 7) * PAGE - length;
+            expected = length;
+        }
+
+        memset(buf, 0x55, sizeof(buf));
+        bytes = read_streamfile(buf, offset, length, h);
+        if (bytes != expected || memcmp(buf, test_data + offset, expected) != 0) {
+            if (errors++ < 5)
+                printf("%s: read 0x%x + 0x%x: got 0x%x, expected 0x%x\n", name, (int)offset, (int)length, (int)bytes, (int)expected);
+        }
+
+        if (h->borrow && length > 0) {
+            const uint8_t * ptr = h->borrow(h, offset, length);
+            int in_page = (offset % PAGE) + length <= PAGE && offset + length <= TEST_DATA_SIZE;
+            if ((ptr && (!in_page || memcmp(ptr, test_data + offset, length) != 0)) || (!ptr && in_page)) {
+                if (errors++ < 5)
+                    printf("%s: borrow 0x%x + 0x%x: %s\n", name, (int)offset, (int)length, ptr ? "wrong data" : "failed");
+            }
+        }
+    }
+
+    for (i = 0; i < 3; i++) {
+        close_streamfile(sf[i]);
+    }
+    return errors;
+}
+
+static int read_page(STREAMFILE * sf, int page) {
+    uint8_t buf[0x10];
+    return read_streamfile(buf, page * PAGE + 0x10, sizeof(buf), sf) == sizeof(buf) && memcmp(buf, test_data + page * PAGE + 0x10, sizeof(buf)) == 0;
+}
+
+/* with 2 pages, the least recently used one is replaced, and only missing pages are read */
+static int test_lru(void) {
+    static const struct { int page; int reads; } steps[] = {
+            { 0, 1 }, { 1, 2 }, { 0, 2 }, /* hit */
+            { 2, 3 }, /* evicts 1 */
+            { 0, 3 }, { 1, 4 }, /* evicts 2 */
+            { 0, 4 }, { 2, 5 }, /* evicts 1 */
+            { 1, 6 }, /* evicts 0 */
+            { 2, 6 },
+    };
+    STREAMFILE * sf;
+    int i, errors = 0;
+
+    sf = open_cache_streamfile(open_mem_streamfile(), 2);
+    if (!sf) return 1;
+
+    for (i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        if (!read_page(sf, steps[i].page) || mem_sf.reads != steps[i].reads) {
+            if (errors++ < 5)
+                printf("lru: step %i (page %i): %i inner reads, expected %i\n", i, steps[i].page, mem_sf.reads, steps[i].reads);
+        }
+    }
+
+    close_streamfile(sf);
+    return errors;
+}
+
+/* handles share the pages, and the inner STREAMFILE is closed once with the last handle */
+static int test_close(void) {
+    STREAMFILE * sf1, * sf2, * sf3;
+    int errors = 0;
+
+    sf1 = open_cache_streamfile(open_mem_streamfile(), 4);
+    if (!sf1) return 1;
+    sf2 = sf1->open(sf1, TEST_FILE, STREAMFILE_DEFAULT_BUFFER_SIZE);
+    sf3 = sf2 ? sf2->open(sf2, TEST_FILE, STREAMFILE_DEFAULT_BUFFER_SIZE) : NULL;
+    if (!sf2 || !sf3) {
+        printf("close: can't reopen\n");
+        close_streamfile(sf2);
+        close_streamfile(sf1);
+        return 1;
+    }
+
+    /* other files go to the inner STREAMFILE */
+    if (sf1->open(sf1, "other.tmp", STREAMFILE_DEFAULT_BUFFER_SIZE) != NULL || mem_sf.opens != 1) {
+        printf("close: other file not opened by the inner streamfile\n");
+        errors++;
+    }
+
+    if (!read_page(sf1, 3) || !read_page(sf2, 3) || mem_sf.reads != 1) {
+        printf("close: pages not shared (%i inner reads)\n", mem_sf.reads);
+        errors++;
+    }
+
+    close_streamfile(sf1);
+    if (mem_sf.closes != 0 || !read_page(sf2, 3) || !read_page(sf3, 4)) {
+        printf("close: handles not usable after closing the first\n");
+        errors++;
+    }
+    close_streamfile(sf3);
+    if (mem_sf.closes != 0) {
+        printf("close: inner closed before the last handle\n");
+        errors++;
+    }
+    close_streamfile(sf2);
+    if (mem_sf.closes != 1) {
+        printf("close: inner closed %i times\n", mem_sf.closes);
+        errors++;
+    }
+
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    STREAMFILE * sf;
+    FILE * file;
+    int i, e, errors = 0;
+
+    test_data = malloc(TEST_DATA_SIZE);
+    if (!test_data) return EXIT_FAILURE;
+    for (i = 0; i < TEST_DATA_SIZE; i++) {
+        test_data[i] = rng() & 0xFF;
+    }
+    file = fopen(TEST_FILE, "wb");
+    if (!file) goto fail;
+    fwrite(test_data, 1, TEST_DATA_SIZE, file);
+    fclose(file);
+
+    e = test_reads(open_mem_streamfile(), 3, "memory");
+    e += mem_sf.closes != 1;
+    printf("cache reads  %s\n", e ? "FAILED" : "ok");
+    errors += e;
+
+    e = test_lru();
+    printf("cache lru    %s\n", e ? "FAILED" : "ok");
+    errors += e;
+
+    e = test_close();
+    printf("cache close  %s\n", e ? "FAILED" : "ok");
+    errors += e;
+
+    /* as opened by vgmstream, so page reads bypass the small stdio buffer */
+    e = 1;
+    sf = open_stdio_streamfile(TEST_FILE);
+    if (sf) {
+        STREAMFILE * base = sf->open(sf, TEST_FILE, STREAMFILE_CACHE_BASE_BUFFER_SIZE);
+        close_streamfile(sf);
+        if (base)
+            e = test_reads(base, 3, "stdio");
+    }
+    printf("cache stdio  %s\n", e ? "FAILED" : "ok");
+    errors += e;
+
+    remove(TEST_FILE);
+    free(test_data);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+
+fail:
+    printf("test setup failed\n");
+    free(test_data);
+    return EXIT_FAILURE;
+}
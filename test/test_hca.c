@@ -0,0 +1,218 @@
+/* Checks clHCA's vectorized 16-bit conversion against the scalar formula, and prints a hash of the
+ * IMDCT output for random spectra (-h) so SIMD and scalar builds can be compared.
+ * Use -b to time them, or -b file.hca [key] to time decoding a file. */
+#include "../ext_libs/clHCA.c"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static unsigned int rng_state = 1;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 8) & 0xFFFFFF;
+}
+
+static float rng_float(float range) {
+    return ((float)rng() / 0xFFFFFF * 2.0f - 1.0f) * range;
+}
+
+static unsigned int hash_data(unsigned int hash, const void * data, size_t size) {
+    const unsigned char * buf = data;
+    size_t i;
+
+    for (i = 0; i < size; i++) { /* FNV-1a */
+        hash = (hash ^ buf[i]) * 16777619;
+    }
+    return hash;
+}
+
+static signed short ref_sample16(float f) {
+    signed int s;
+
+    if (f > 1.0f)
+        f = 1.0f;
+    else if (f < -1.0f)
+        f = -1.0f;
+    s = (signed int)(f * 32768.0f);
+    if (s > 32767)
+        s = 32767;
+    return (signed short)s;
+}
+
+/* edge values plus the usual range (decoded waves go a bit over 1.0) */
+static float random_wave_sample(void) {
+    static const float edges[] = {
+            1.0f, -1.0f, 0.0f, -0.0f, 1.0000001f, -1.0000001f, 0.99999994f, -0.99999994f,
+            1e9f, -1e9f, 1.0f / 32768.0f, -1.0f / 32768.0f, 1.0f / 0.0f, -1.0f / 0.0f,
+    };
+
+    if (rng() % 8 == 0)
+        return edges[rng() % (sizeof(edges) / sizeof(edges[0]))];
+    return rng_float(1.2f);
+}
+
+static int test_read_samples16(clHCA * hca) {
+    static signed short samples[HCA_MAX_CHANNELS * HCA_SAMPLES_PER_FRAME];
+    unsigned int channels, k, i, j;
+    int run, errors = 0;
+
+    for (channels = 1; channels <= HCA_MAX_CHANNELS; channels++) {
+        hca->channels = channels;
+
+        for (run = 0; run < 16; run++) {
+            for (k = 0; k < channels; k++) {
+                for (i = 0; i < HCA_SUBFRAMES_PER_FRAME; i++) {
+                    for (j = 0; j < HCA_SAMPLES_PER_SUBFRAME; j++) {
+                        hca->channel[k].wave[i][j] = random_wave_sample();
+                    }
+                }
+            }
+
+            clHCA_ReadSamples16(hca, samples);
+
+            for (i = 0; i < HCA_SUBFRAMES_PER_FRAME; i++) {
+                for (j = 0; j < HCA_SAMPLES_PER_SUBFRAME; j++) {
+                    for (k = 0; k < channels; k++) {
+                        float f = hca->channel[k].wave[i][j];
+                        signed short s = samples[(i*HCA_SAMPLES_PER_SUBFRAME + j)*channels + k];
+                        if (s != ref_sample16(f) && errors++ < 5)
+                            printf("ReadSamples16: channels %u, %.9g: %i != %i\n", channels, f, s, ref_sample16(f));
+                    }
+                }
+            }
+        }
+    }
+
+    printf("ReadSamples16 %s\n", errors ? "FAILED" : "ok");
+    return errors;
+}
+
+/* runs the IMDCT over random spectra of varying scale, returning a hash of all results */
+static unsigned int hash_imdct(stChannel * ch, int frames) {
+    static const float ranges[] = { 1.0f, 0.001f, 16.0f, 1e-30f, 1e30f };
+    unsigned int hash = 2166136261u;
+    int frame, subframe, i;
+
+    memset(ch, 0, sizeof(stChannel));
+
+    for (frame = 0; frame < frames; frame++) {
+        for (subframe = 0; subframe < HCA_SUBFRAMES_PER_FRAME; subframe++) {
+            float range = ranges[(frame / 16) % (sizeof(ranges) / sizeof(ranges[0]))];
+
+            for (i = 0; i < HCA_SAMPLES_PER_SUBFRAME; i++) {
+                /* sparse like real spectra, with some zeroed high bands */
+                ch->spectra[i] = (rng() % 4 == 0 || i > 100 + (int)(rng() % 28)) ? 0.0f : rng_float(range);
+            }
+
+            decoder5_run_imdct(ch, subframe);
+        }
+
+        hash = hash_data(hash, ch->wave, sizeof(ch->wave));
+        hash = hash_data(hash, ch->imdct_previous, sizeof(ch->imdct_previous));
+    }
+
+    return hash;
+}
+
+static double get_speed(clock_t start, double samples) {
+    return samples / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0;
+}
+
+static void bench_kernels(clHCA * hca) {
+    static signed short samples[2 * HCA_SAMPLES_PER_FRAME];
+    int frames = 20000, frame, subframe, i;
+    clock_t start;
+
+    for (i = 0; i < HCA_SAMPLES_PER_SUBFRAME; i++) {
+        hca->channel[0].spectra[i] = rng_float(1.0f);
+    }
+
+    start = clock();
+    for (frame = 0; frame < frames; frame++) {
+        for (subframe = 0; subframe < HCA_SUBFRAMES_PER_FRAME; subframe++) {
+            decoder5_run_imdct(&hca->channel[0], subframe);
+        }
+    }
+    printf("IMDCT          %7.1f Msamples/s\n", get_speed(start, (double)frames * HCA_SAMPLES_PER_FRAME));
+
+    hca->channels = 2;
+    start = clock();
+    for (frame = 0; frame < frames * 4; frame++) {
+        clHCA_ReadSamples16(hca, samples);
+    }
+    printf("ReadSamples16  %7.1f Msamples/s (stereo)\n", get_speed(start, (double)frames * 4 * HCA_SAMPLES_PER_FRAME * 2));
+}
+
+static int bench_file(const char * filename, unsigned long long keycode) {
+    static signed short samples[HCA_MAX_CHANNELS * HCA_SAMPLES_PER_FRAME];
+    static unsigned char block[0x10000];
+    unsigned char * buf = NULL;
+    clHCA * hca = NULL;
+    clHCA_stInfo info;
+    unsigned int hash = 2166136261u;
+    long size;
+    int header_size, repeats = 10, r, b = 0;
+    FILE * file;
+    clock_t start;
+
+    file = fopen(filename, "rb");
+    if (!file) goto fail;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    buf = malloc(size);
+    if (!buf || fread(buf, 1, size, file) != (size_t)size) {
+        fclose(file);
+        goto fail;
+    }
+    fclose(file);
+
+    hca = clHCA_new();
+    if (!hca) goto fail;
+    header_size = clHCA_isOurFile(buf, size);
+    if (header_size < 0 || clHCA_DecodeHeader(hca, buf, header_size) < 0) goto fail;
+    if (clHCA_getInfo(hca, &info) < 0 || info.blockSize > sizeof(block)) goto fail;
+    clHCA_SetKey(hca, keycode);
+
+    start = clock();
+    for (r = 0; r < repeats; r++) {
+        clHCA_DecodeReset(hca);
+        for (b = 0; b < (int)info.blockCount && header_size + (b+1) * info.blockSize <= size; b++) {
+            /* blocks are decrypted in place */
+            memcpy(block, buf + header_size + b * info.blockSize, info.blockSize);
+            if (clHCA_DecodeBlock(hca, block, info.blockSize) < 0)
+                goto fail;
+            clHCA_ReadSamples16(hca, samples);
+            if (r == 0)
+                hash = hash_data(hash, samples, HCA_SAMPLES_PER_FRAME * info.channelCount * sizeof(signed short));
+        }
+    }
+    printf("decode %08x   %7.1f Msamples/s\n", hash, get_speed(start, (double)repeats * b * HCA_SAMPLES_PER_FRAME));
+
+    clHCA_delete(hca);
+    free(buf);
+    return 0;
+fail:
+    printf("can't decode %s (block %i)\n", filename, b);
+    clHCA_delete(hca);
+    free(buf);
+    return 1;
+}
+
+int main(int argc, char ** argv) {
+    static clHCA hca;
+
+    if (argc > 1 && strcmp(argv[1], "-h") == 0) {
+        printf("IMDCT hash %08x\n", hash_imdct(&hca.channel[0], 256));
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        if (argc > 2)
+            return bench_file(argv[2], argc > 3 ? strtoull(argv[3], NULL, 0) : 0);
+        bench_kernels(&hca);
+        return 0;
+    }
+
+    return test_read_samples16(&hca) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
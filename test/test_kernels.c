@@ -0,0 +1,375 @@
+/* Checks the sample kernels in util.c against plain scalar versions (results must be bit-exact),
+ * at all alignments and channel counts. Use -b to time them. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "../src/util.h"
+
+#define TEST_SAMPLES 0x10000
+#define TEST_MAX_CHANNELS 12
+
+static int errors = 0;
+#define CHECK(cond, ...) \
+    do { if (!(cond) && errors++ < 10) { printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+static unsigned int rng_state = 1;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 8) & 0xFFFFFF;
+}
+
+static float rng_float(float range) {
+    return ((float)rng() / 0xFFFFFF * 2.0f - 1.0f) * range;
+}
+
+/* edge values, exact 16-bit steps, and the usual range (decoders go a bit over 1.0) */
+static float random_f32_sample(void) {
+    static const float edges[] = {
+            1.0f, -1.0f, 0.0f, -0.0f, 1.0000001f, -1.0000001f, 0.99999994f, -0.99999994f,
+            1e9f, -1e9f, 0.5f / 32767.0f, -0.5f / 32767.0f, 1.5f / 32767.0f, -1.5f / 32767.0f,
+    };
+
+    switch(rng() % 8) {
+        case 0: return edges[rng() % (sizeof(edges) / sizeof(edges[0]))];
+        case 1: return (float)((int)(rng() % 65536) - 32768) / 32768.0f;
+        case 2: return ((float)((int)(rng() % 65536) - 32768) + 0.5f) / 32767.0f;
+        case 3: return rng() % 2 ? HUGE_VALF : (rng() % 2 ? -HUGE_VALF : NAN);
+        default: return rng_float(1.2f);
+    }
+}
+
+static sample random_sample(void) {
+    return (sample)(rng() & 0xFFFF);
+}
+
+
+/* reference versions */
+
+static sample ref_f32_to_sample(float f, f32_to_samples_t mode) {
+    double v;
+
+    if (f != f) /* NaN, as x86 conversions */
+        return -32768;
+
+    if (mode == F32_TO_SAMPLES_ROUND)
+        v = floor(f * 32767.0f + 0.5f);
+    else if (f >= 1.0f || f <= -1.0f)
+        v = f * 32768.0;
+    else
+        v = (int)(f * 32768.0f);
+
+    if (v > 32767.0) return 32767;
+    if (v < -32768.0) return -32768;
+    return (sample)v;
+}
+
+
+static void test_f32_to_samples(sample * outbuf, float * inbuf) {
+    int i, offset, mode;
+
+    for (i = 0; i < TEST_SAMPLES; i++) {
+        inbuf[i] = random_f32_sample();
+    }
+
+    for (mode = 0; mode < 2; mode++) {
+        for (offset = 0; offset < 9; offset++) {
+            int count = TEST_SAMPLES - offset - (rng() % 16);
+
+            outbuf[count] = 0x1234;
+            f32_to_samples(outbuf, inbuf + offset, count, mode);
+
+            for (i = 0; i < count; i++) {
+                sample ref = ref_f32_to_sample(inbuf[offset + i], mode);
+                CHECK(outbuf[i] == ref, "f32_to_samples: mode %i, offset %i, %.9g: %i != %i", mode, offset, inbuf[offset + i], outbuf[i], ref);
+            }
+            CHECK(outbuf[count] == 0x1234, "f32_to_samples: wrote past count");
+        }
+    }
+}
+
+static void test_f32_interleave_to_samples(sample * outbuf, float * inbuf) {
+    const float * inbufs[TEST_MAX_CHANNELS];
+    int i, ch, channels, mode;
+
+    for (i = 0; i < TEST_SAMPLES; i++) {
+        inbuf[i] = random_f32_sample();
+    }
+
+    for (channels = 1; channels <= TEST_MAX_CHANNELS; channels++) {
+        int samples = TEST_SAMPLES / channels - (rng() % 16);
+
+        for (ch = 0; ch < channels; ch++) { /* unaligned starts */
+            inbufs[ch] = inbuf + ch * samples + (ch % 2);
+        }
+        if (inbufs[channels-1] + samples > inbuf + TEST_SAMPLES)
+            samples--;
+
+        for (mode = 0; mode < 2; mode++) {
+            f32_interleave_to_samples(outbuf, inbufs, channels, samples, mode);
+
+            for (i = 0; i < samples; i++) {
+                for (ch = 0; ch < channels; ch++) {
+                    sample ref = ref_f32_to_sample(inbufs[ch][i], mode);
+                    CHECK(outbuf[i*channels + ch] == ref, "f32_interleave_to_samples: channels %i, mode %i, %.9g: %i != %i",
+                            channels, mode, inbufs[ch][i], outbuf[i*channels + ch], ref);
+                }
+            }
+        }
+    }
+}
+
+static void test_samples_to_f32(float * outbuf, sample * inbuf) {
+    int i, offset;
+
+    for (i = 0; i < TEST_SAMPLES; i++) {
+        inbuf[i] = random_sample();
+    }
+
+    for (offset = 0; offset < 9; offset++) {
+        int count = TEST_SAMPLES - offset;
+
+        samples_to_f32(outbuf, inbuf + offset, count);
+        for (i = 0; i < count; i++) {
+            float ref = inbuf[offset + i] / 32768.0f;
+            CHECK(outbuf[i] == ref, "samples_to_f32: %i: %.9g != %.9g", inbuf[offset + i], outbuf[i], ref);
+        }
+    }
+}
+
+static void test_channel_kernels(sample * outbuf, sample * inbuf, sample * tmpbuf) {
+    int mapping[UTIL_MAX_REMAP_CHANNELS];
+    sample * outbufs[TEST_MAX_CHANNELS];
+    int i, ch, channels;
+
+    for (channels = 1; channels <= TEST_MAX_CHANNELS; channels++) {
+        int samples = TEST_SAMPLES / channels / 2 - (rng() % 16);
+
+        for (i = 0; i < TEST_SAMPLES; i++) {
+            inbuf[i] = random_sample();
+        }
+
+        /* planar to interleaved */
+        interleave_samples(outbuf, inbuf, channels, samples);
+        for (i = 0; i < samples; i++) {
+            for (ch = 0; ch < channels; ch++) {
+                CHECK(outbuf[i*channels + ch] == inbuf[ch*samples + i], "interleave_samples: channels %i", channels);
+            }
+        }
+
+        /* interleaved to separate buffers */
+        for (ch = 0; ch < channels; ch++) {
+            outbufs[ch] = outbuf + ch * (samples + 8);
+        }
+        split_channels(outbufs, 3, inbuf, channels, samples - 3);
+        for (i = 0; i < samples - 3; i++) {
+            for (ch = 0; ch < channels; ch++) {
+                CHECK(outbufs[ch][3 + i] == inbuf[i*channels + ch], "split_channels: channels %i", channels);
+            }
+        }
+
+        /* into a bigger frame */
+        {
+            int out_channels = channels + 3;
+            int out_start = rng() % 4;
+
+            memset(outbuf, 0, samples * out_channels * sizeof(sample));
+            copy_channels(outbuf, out_channels, out_start, inbuf, channels, samples);
+            for (i = 0; i < samples; i++) {
+                for (ch = 0; ch < out_channels; ch++) {
+                    sample ref = (ch >= out_start && ch < out_start + channels) ? inbuf[i*channels + ch - out_start] : 0;
+                    CHECK(outbuf[i*out_channels + ch] == ref, "copy_channels: channels %i, start %i", channels, out_start);
+                }
+            }
+        }
+
+        /* reordered frames, full or partial mapping */
+        {
+            int mapping_count = rng() % 2 ? channels : 1 + rng() % channels;
+
+            for (ch = 0; ch < mapping_count; ch++) {
+                mapping[ch] = rng() % mapping_count;
+            }
+            memcpy(outbuf, inbuf, samples * channels * sizeof(sample));
+            remap_channels(outbuf, channels, samples, mapping, mapping_count);
+            for (i = 0; i < samples; i++) {
+                for (ch = 0; ch < channels; ch++) {
+                    sample ref = ch < mapping_count ? inbuf[i*channels + mapping[ch]] : inbuf[i*channels + ch];
+                    CHECK(outbuf[i*channels + ch] == ref, "remap_channels: channels %i, mapping %i", channels, mapping_count);
+                }
+            }
+        }
+
+        /* silenced channels */
+        {
+            uint32_t channel_mask = rng() | (rng() << 24);
+
+            memcpy(outbuf, inbuf, samples * channels * sizeof(sample));
+            mask_channels(outbuf, channels, samples, channel_mask);
+            for (i = 0; i < samples; i++) {
+                for (ch = 0; ch < channels; ch++) {
+                    sample ref = ((channel_mask >> ch) & 1) ? inbuf[i*channels + ch] : 0;
+                    CHECK(outbuf[i*channels + ch] == ref, "mask_channels: channels %i", channels);
+                }
+            }
+        }
+
+        /* subset of channels, in any order */
+        {
+            int out_channels = 1 + rng() % channels;
+
+            for (ch = 0; ch < out_channels; ch++) {
+                mapping[ch] = rng() % channels;
+            }
+            select_channels(outbuf, inbuf, channels, mapping, out_channels, samples);
+            for (i = 0; i < samples; i++) {
+                for (ch = 0; ch < out_channels; ch++) {
+                    CHECK(outbuf[i*out_channels + ch] == inbuf[i*channels + mapping[ch]], "select_channels: channels %i to %i", channels, out_channels);
+                }
+            }
+        }
+
+        /* fade ramp, both formats */
+        {
+            int32_t fade_length = samples + rng() % 1000;
+            int32_t fade_pos = rng() % (fade_length - samples + 1);
+            float * f32buf = (float *)tmpbuf;
+
+            for (i = 0; i < samples * channels; i++) {
+                f32buf[i] = rng_float(1.0f);
+            }
+
+            memcpy(outbuf, inbuf, samples * channels * sizeof(sample));
+            fade_channels(outbuf, channels, samples, fade_pos, fade_length);
+            for (i = 0; i < samples; i++) {
+                double gain = (double)(fade_length - (fade_pos + i)) / fade_length;
+                for (ch = 0; ch < channels; ch++) {
+                    sample ref = (sample)(inbuf[i*channels + ch] * gain);
+                    CHECK(outbuf[i*channels + ch] == ref, "fade_channels: channels %i", channels);
+                }
+            }
+
+            memcpy(outbuf, f32buf, samples * channels * sizeof(float)); /* outbuf is big enough */
+            fade_channels_f32((float *)outbuf, channels, samples, fade_pos, fade_length);
+            for (i = 0; i < samples; i++) {
+                double gain = (double)(fade_length - (fade_pos + i)) / fade_length;
+                for (ch = 0; ch < channels; ch++) {
+                    float ref = (float)(f32buf[i*channels + ch] * gain);
+                    CHECK(((float *)outbuf)[i*channels + ch] == ref, "fade_channels_f32: channels %i", channels);
+                }
+            }
+        }
+    }
+}
+
+
+/* benchmarks, each kernel against a plain loop */
+
+static double get_speed(clock_t start, double samples) {
+    return samples / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0;
+}
+
+/* buffers are touched on each repeat, or compilers may skip the (otherwise identical) scalar passes */
+#define BENCH_REPEATS 200
+#define BENCH_TOUCH() \
+    do { f32buf[r] = -f32buf[r]; inbuf[r] = ~inbuf[r]; outbuf[r] = ~outbuf[r]; } while (0)
+#define BENCH(name, scalar_code, kernel_code) \
+    do { \
+        double speed_scalar, speed_kernel; \
+        clock_t start = clock(); \
+        for (r = 0; r < BENCH_REPEATS; r++) { BENCH_TOUCH(); scalar_code; } \
+        speed_scalar = get_speed(start, (double)BENCH_REPEATS * TEST_SAMPLES); \
+        start = clock(); \
+        for (r = 0; r < BENCH_REPEATS; r++) { BENCH_TOUCH(); kernel_code; } \
+        speed_kernel = get_speed(start, (double)BENCH_REPEATS * TEST_SAMPLES); \
+        printf("%-28s  scalar %8.1f  kernel %8.1f Msamples/s\n", name, speed_scalar, speed_kernel); \
+    } while (0)
+
+static void bench_kernels(sample * outbuf, float * f32buf, sample * inbuf) {
+    const float * inbufs[2];
+    int i, r, ch;
+
+    for (i = 0; i < TEST_SAMPLES; i++) {
+        f32buf[i] = rng_float(1.1f);
+        inbuf[i] = random_sample();
+    }
+    inbufs[0] = f32buf;
+    inbufs[1] = f32buf + TEST_SAMPLES / 2;
+
+    BENCH("f32_to_samples (trunc)",
+        for (i = 0; i < TEST_SAMPLES; i++) {
+            float f = f32buf[i];
+            int v;
+            if (f > 1.0f) f = 1.0f; else if (f < -1.0f) f = -1.0f;
+            v = (int)(f * 32768.0f);
+            outbuf[i] = v > 32767 ? 32767 : v;
+        },
+        f32_to_samples(outbuf, f32buf, TEST_SAMPLES, F32_TO_SAMPLES_TRUNC));
+
+    BENCH("f32_interleave (round, 2ch)",
+        for (ch = 0; ch < 2; ch++) {
+            const float * in = inbufs[ch];
+            for (i = 0; i < TEST_SAMPLES / 2; i++) {
+                int v = (int)floor(in[i] * 32767.0f + 0.5f);
+                if (v > 32767) v = 32767; else if (v < -32768) v = -32768;
+                outbuf[i*2 + ch] = v;
+            }
+        },
+        f32_interleave_to_samples(outbuf, inbufs, 2, TEST_SAMPLES / 2, F32_TO_SAMPLES_ROUND));
+
+    BENCH("samples_to_f32",
+        for (i = 0; i < TEST_SAMPLES; i++) {
+            f32buf[i] = inbuf[i] / 32768.0f;
+        },
+        samples_to_f32(f32buf, inbuf, TEST_SAMPLES));
+
+    BENCH("interleave_samples (2ch)",
+        for (i = 0; i < TEST_SAMPLES / 2; i++) {
+            outbuf[i*2 + 0] = inbuf[i];
+            outbuf[i*2 + 1] = inbuf[TEST_SAMPLES / 2 + i];
+        },
+        interleave_samples(outbuf, inbuf, 2, TEST_SAMPLES / 2));
+
+    BENCH("mask_channels (6ch)",
+        for (i = 0; i < TEST_SAMPLES / 6 * 6; i++) {
+            if (!((0x15 >> (i % 6)) & 1))
+                outbuf[i] = 0;
+        },
+        mask_channels(outbuf, 6, TEST_SAMPLES / 6, 0x15));
+
+    BENCH("fade_channels (2ch)",
+        for (i = 0; i < TEST_SAMPLES; i++) {
+            double gain = (double)(TEST_SAMPLES - i / 2) / TEST_SAMPLES;
+            outbuf[i] = (sample)(inbuf[i] * gain);
+        },
+        fade_channels(outbuf, 2, TEST_SAMPLES / 2, 0, TEST_SAMPLES));
+}
+
+int main(int argc, char ** argv) {
+    int do_bench = (argc > 1 && strcmp(argv[1], "-b") == 0);
+    sample * sbuf1 = malloc(TEST_SAMPLES * 2 * sizeof(sample));
+    sample * sbuf2 = malloc(TEST_SAMPLES * 2 * sizeof(sample));
+    float * fbuf = malloc(TEST_SAMPLES * sizeof(float));
+
+    if (!sbuf1 || !sbuf2 || !fbuf) {
+        printf("setup failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if (do_bench) {
+        bench_kernels(sbuf1, fbuf, sbuf2);
+    }
+    else {
+        test_f32_to_samples(sbuf1, fbuf);
+        test_f32_interleave_to_samples(sbuf1, fbuf);
+        test_samples_to_f32(fbuf, sbuf1);
+        test_channel_kernels(sbuf1, sbuf2, (sample *)fbuf);
+        printf("kernels %s\n", errors ? "FAILED" : "ok");
+    }
+
+    free(sbuf1);
+    free(sbuf2);
+    free(fbuf);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
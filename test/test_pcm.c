@@ -0,0 +1,209 @@
+/* Checks decode_pcm16_mch (all channels at once) against decode_pcm16le/be per channel, for 1 to 16
+ * channels, random positions and odd sample counts, with and without borrowed reads. Use -b to time them. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../src/vgmstream.h"
+#include "../src/coding/coding.h"
+
+#define TEST_FILE "test_pcm.tmp"
+#define TEST_DATA_SIZE 0x40000
+#define TEST_MAX_CHANNELS 16
+#define TEST_MAX_SAMPLES (DECODE_MCH_SAMPLES * 3) /* so decodes span a few mch chunks */
+
+static unsigned int rng_state = 1;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 8) & 0xFFFFFF;
+}
+
+typedef enum { SF_STDIO, SF_STDIO_NO_BORROW, SF_MMAP } sf_type_t;
+static const char * sf_names[] = { "stdio", "stdio-no-borrow", "mmap" };
+
+static STREAMFILE * open_test_streamfile(sf_type_t type) {
+    STREAMFILE * sf = type == SF_MMAP ? open_mmap_streamfile(TEST_FILE) : open_stdio_streamfile(TEST_FILE);
+    if (sf && type == SF_STDIO_NO_BORROW)
+        sf->borrow = NULL;
+    return sf;
+}
+
+/* interleaved PCM16: each channel starts at its block, and decoders read samples from there
+ * (only the channels are set up, so the test doesn't need to link every format) */
+static VGMSTREAM * open_test_vgmstream(STREAMFILE * sf, int channels, size_t block_size) {
+    VGMSTREAM * vgmstream;
+    int ch;
+
+    vgmstream = calloc(1, sizeof(VGMSTREAM));
+    if (!vgmstream) return NULL;
+    vgmstream->ch = calloc(channels, sizeof(VGMSTREAMCHANNEL));
+    if (!vgmstream->ch) {
+        free(vgmstream);
+        return NULL;
+    }
+    vgmstream->channels = channels;
+
+    for (ch = 0; ch < channels; ch++) {
+        vgmstream->ch[ch].streamfile = sf;
+        vgmstream->ch[ch].offset = ch * block_size;
+    }
+    return vgmstream;
+}
+
+static void close_test_vgmstream(VGMSTREAM * vgmstream) {
+    if (!vgmstream) return;
+    free(vgmstream->ch);
+    free(vgmstream);
+}
+
+static void decode_ref(VGMSTREAM * vgmstream, sample * outbuf, int32_t first_sample, int32_t samples_to_do, int big_endian) {
+    int ch;
+
+    for (ch = 0; ch < vgmstream->channels; ch++) {
+        if (big_endian)
+            decode_pcm16be(&vgmstream->ch[ch], outbuf + ch, vgmstream->channels, first_sample, samples_to_do);
+        else
+            decode_pcm16le(&vgmstream->ch[ch], outbuf + ch, vgmstream->channels, first_sample, samples_to_do);
+    }
+}
+
+static int test_decode(sf_type_t type, sample * out_new, sample * out_ref) {
+    int channels, run, errors = 0;
+
+    for (channels = 1; channels <= TEST_MAX_CHANNELS; channels++) {
+        VGMSTREAM * vgmstream;
+        STREAMFILE * sf;
+        size_t block_size = TEST_DATA_SIZE / channels & ~1;
+
+        sf = open_test_streamfile(type);
+        if (!sf) return 1;
+        vgmstream = open_test_vgmstream(sf, channels, block_size);
+        if (!vgmstream) {
+            close_streamfile(sf);
+            return 1;
+        }
+
+        for (run = 0; run < 32; run++) {
+            int big_endian = rng() & 1;
+            /* odd counts, some reading past the last channel's end (EOF reads are 0xFF) */
+            int32_t samples_to_do = 1 + rng() % TEST_MAX_SAMPLES;
+            int32_t first_sample = rng() % (block_size / 2);
+            int i;
+
+            if (run == 0)
+                first_sample = 0;
+            if (run == 1 && samples_to_do < (int32_t)(block_size / 2)) /* ends right at the block end */
+                first_sample = (int32_t)(block_size / 2) - samples_to_do;
+
+            memset(out_new, 0x55, samples_to_do * channels * sizeof(sample));
+            memset(out_ref, 0xAA, samples_to_do * channels * sizeof(sample));
+            decode_pcm16_mch(vgmstream, out_new, first_sample, samples_to_do, big_endian);
+            decode_ref(vgmstream, out_ref, first_sample, samples_to_do, big_endian);
+
+            for (i = 0; i < samples_to_do * channels; i++) {
+                if (out_new[i] != out_ref[i]) {
+                    if (errors++ < 5)
+                        printf("%s: channels %i, first %i, samples %i, %s, at %i: %i != %i\n", sf_names[type], channels,
+                                first_sample, samples_to_do, big_endian ? "BE" : "LE", i, out_new[i], out_ref[i]);
+                    break;
+                }
+            }
+        }
+
+        close_test_vgmstream(vgmstream);
+        close_streamfile(sf);
+    }
+
+    return errors;
+}
+
+static double bench_decode(int is_ref, VGMSTREAM * vgmstream, sample * outbuf, int32_t samples_per_call) {
+    int32_t total_samples = TEST_DATA_SIZE / vgmstream->channels / 2;
+    int32_t pos;
+    int r, repeats = 20;
+    clock_t start;
+
+    start = clock();
+    for (r = 0; r < repeats; r++) {
+        for (pos = 0; pos + samples_per_call <= total_samples; pos += samples_per_call) {
+            if (is_ref)
+                decode_ref(vgmstream, outbuf, pos, samples_per_call, 0);
+            else
+                decode_pcm16_mch(vgmstream, outbuf, pos, samples_per_call, 0);
+        }
+    }
+
+    return (double)repeats * (total_samples / samples_per_call * samples_per_call) * vgmstream->channels
+            / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1000000.0;
+}
+
+static void bench(sf_type_t type, sample * out_new, sample * out_ref) {
+    static const int bench_channels[] = { 1, 2, 6, 8, 16 };
+    int i;
+
+    for (i = 0; i < sizeof(bench_channels) / sizeof(bench_channels[0]); i++) {
+        int channels = bench_channels[i];
+        STREAMFILE * sf = open_test_streamfile(type);
+        VGMSTREAM * vgmstream = sf ? open_test_vgmstream(sf, channels, TEST_DATA_SIZE / channels & ~1) : NULL;
+        double speed_ref, speed_new;
+
+        if (!vgmstream) {
+            close_streamfile(sf);
+            return;
+        }
+
+        speed_ref = bench_decode(1, vgmstream, out_ref, 0x400);
+        speed_new = bench_decode(0, vgmstream, out_new, 0x400);
+        printf("%-16s %2ich  per-channel %7.1f  mch %7.1f Msamples/s\n", sf_names[type], channels, speed_ref, speed_new);
+
+        close_test_vgmstream(vgmstream);
+        close_streamfile(sf);
+    }
+}
+
+int main(int argc, char ** argv) {
+    int do_bench = (argc > 1 && strcmp(argv[1], "-b") == 0);
+    uint8_t * data = NULL;
+    sample * out_new = NULL;
+    sample * out_ref = NULL;
+    FILE * file;
+    int type, i, errors = 0;
+
+    data = malloc(TEST_DATA_SIZE);
+    out_new = malloc(TEST_MAX_SAMPLES * TEST_MAX_CHANNELS * sizeof(sample));
+    out_ref = malloc(TEST_MAX_SAMPLES * TEST_MAX_CHANNELS * sizeof(sample));
+    if (!data || !out_new || !out_ref) goto fail;
+
+    for (i = 0; i < TEST_DATA_SIZE; i++) {
+        data[i] = rng() & 0xFF;
+    }
+    file = fopen(TEST_FILE, "wb");
+    if (!file) goto fail;
+    fwrite(data, 1, TEST_DATA_SIZE, file);
+    fclose(file);
+
+    for (type = SF_STDIO; type <= SF_MMAP; type++) {
+        if (do_bench) {
+            bench(type, out_new, out_ref);
+            continue;
+        }
+
+        i = test_decode(type, out_new, out_ref);
+        printf("pcm16-mch %-16s %s\n", sf_names[type], i ? "FAILED" : "ok");
+        errors += i;
+    }
+
+    remove(TEST_FILE);
+    free(data);
+    free(out_new);
+    free(out_ref);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+
+fail:
+    printf("test setup failed\n");
+    remove(TEST_FILE);
+    free(data);
+    free(out_new);
+    free(out_ref);
+    return EXIT_FAILURE;
+}
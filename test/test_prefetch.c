@@ -0,0 +1,211 @@
+/* Checks open_prefetch_streamfile: sequential, random and borrowed reads against the data (over a memory
+ * STREAMFILE that also checks the reader and the prefetch thread never use it at the same time), and that
+ * sequential reads get their buffers from the thread (when the library has threads). */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/vgmstream.h"
+#include "../src/util.h"
+
+#define TEST_DATA_SIZE (0x40000 + 0x321)
+#define TEST_BUFFER_SIZE 0x1000
+
+static unsigned int rng_state = 1;
+static unsigned int rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 8) & 0xFFFFFF;
+}
+
+static uint8_t * test_data;
+
+
+typedef struct {
+    STREAMFILE sf;
+    vgm_lock_t busy;
+    int overlaps;
+    int closes;
+} MEM_STREAMFILE;
+
+static MEM_STREAMFILE mem_sf;
+
+static size_t mem_read(MEM_STREAMFILE * sf, uint8_t * dest, off_t offset, size_t length) {
+    volatile int i, spin = 0;
+
+    if (sf->busy)
+        sf->overlaps++;
+    vgm_lock(&sf->busy);
+    for (i = 0; i < 1000; i++) { spin += i; } /* so overlaps have a chance to show */
+
+    if (offset < 0 || offset >= TEST_DATA_SIZE) {
+        length = 0;
+    }
+    else {
+        if (offset + length > TEST_DATA_SIZE)
+            length = TEST_DATA_SIZE - offset;
+        memcpy(dest, test_data + offset, length);
+    }
+
+    vgm_unlock(&sf->busy);
+    return length;
+}
+static size_t mem_get_size(MEM_STREAMFILE * sf) {
+    return TEST_DATA_SIZE;
+}
+static off_t mem_get_offset(MEM_STREAMFILE * sf) {
+    return 0;
+}
+static void mem_get_name(MEM_STREAMFILE * sf, char * buffer, size_t length) {
+    snprintf(buffer, length, "test_prefetch.tmp");
+}
+static STREAMFILE * mem_open(MEM_STREAMFILE * sf, const char * const filename, size_t buffersize) {
+    return NULL;
+}
+static void mem_close(MEM_STREAMFILE * sf) {
+    sf->closes++;
+}
+
+static STREAMFILE * open_test_streamfile(void) {
+    memset(&mem_sf, 0, sizeof(mem_sf));
+    mem_sf.sf.read = (void*)mem_read;
+    mem_sf.sf.get_size = (void*)mem_get_size;
+    mem_sf.sf.get_offset = (void*)mem_get_offset;
+    mem_sf.sf.get_name = (void*)mem_get_name;
+    mem_sf.sf.open = (void*)mem_open;
+    mem_sf.sf.close = (void*)mem_close;
+    return open_prefetch_streamfile(&mem_sf.sf, TEST_BUFFER_SIZE);
+}
+
+static int check_read(STREAMFILE * sf, off_t offset, size_t length, const char * name) {
+    uint8_t buf[TEST_BUFFER_SIZE * 3];
+    size_t expected = offset >= TEST_DATA_SIZE ? 0 : (offset + length > TEST_DATA_SIZE ? TEST_DATA_SIZE - offset : length);
+    size_t bytes;
+
+    memset(buf, 0x55, sizeof(buf));
+    bytes = read_streamfile(buf, offset, length, sf);
+    if (bytes != expected || memcmp(buf, test_data + offset, expected) != 0) {
+        printf("%s: read 0x%x + 0x%x: got 0x%x, expected 0x%x\n", name, (int)offset, (int)length, (int)bytes, (int)expected);
+        return 1;
+    }
+    return 0;
+}
+
+static int check_borrow(STREAMFILE * sf, off_t offset, size_t length, const char * name) {
+    const uint8_t * ptr = sf->borrow(sf, offset, length);
+    int possible = length <= TEST_BUFFER_SIZE && offset + length <= TEST_DATA_SIZE;
+
+    if ((ptr && (!possible || memcmp(ptr, test_data + offset, length) != 0)) || (!ptr && possible)) {
+        printf("%s: borrow 0x%x + 0x%x: %s\n", name, (int)offset, (int)length, ptr ? "wrong data" : "failed");
+        return 1;
+    }
+    return 0;
+}
+
+/* reads going forward in random sizes (also borrowed), that should mostly come from the thread */
+static int test_sequential(int has_threads) {
+    prefetch_streamfile_stats stats = {0};
+    STREAMFILE * sf;
+    off_t offset = 0;
+    int errors = 0;
+
+    sf = open_test_streamfile();
+    if (!sf) return 1;
+
+    while (offset < TEST_DATA_SIZE && errors < 5) {
+        size_t length = 1 + rng() % 0x300;
+        if (rng() % 4 == 0)
+            errors += check_borrow(sf, offset, length, "sequential");
+        else
+            errors += check_read(sf, offset, length, "sequential");
+        offset += length;
+    }
+    errors += check_read(sf, TEST_DATA_SIZE - 0x10, 0x100, "sequential"); /* partial at EOF */
+
+    if (!get_prefetch_streamfile_stats(sf, &stats)) {
+        printf("sequential: no stats\n");
+        errors++;
+    }
+    else if (has_threads && (stats.prefetches == 0 || stats.hits <= stats.misses)) {
+        printf("sequential: not prefetched (%i hits, %i misses, %i prefetches)\n", (int)stats.hits, (int)stats.misses, (int)stats.prefetches);
+        errors++;
+    }
+
+    close_streamfile(sf);
+    if (mem_sf.closes != 1) {
+        printf("sequential: inner closed %i times\n", mem_sf.closes);
+        errors++;
+    }
+    if (mem_sf.overlaps) {
+        printf("sequential: inner read by two threads at once\n");
+        errors++;
+    }
+    return errors;
+}
+
+/* forward runs mixed with jumps (including right into a pending prefetch and past EOF) */
+static int test_random(void) {
+    STREAMFILE * sf;
+    off_t offset = 0;
+    int run, errors = 0;
+
+    sf = open_test_streamfile();
+    if (!sf) return 1;
+
+    for (run = 0; run < 20000 && errors < 5; run++) {
+        size_t length = 1 + rng() % (run & 1 ? TEST_BUFFER_SIZE * 3 : 0x80);
+
+        switch (rng() % 8) {
+            case 0: offset = rng() % (TEST_DATA_SIZE + 0x100); break;  /* anywhere */
+            case 1: offset = offset - offset % TEST_BUFFER_SIZE + TEST_BUFFER_SIZE; break; /* next window */
+            case 2: offset = offset > 0x800 ? offset - 0x800 : 0; break; /* back a bit */
+            default: break; /* forward */
+        }
+
+        if (rng() % 3 == 0)
+            errors += check_borrow(sf, offset, length, "random");
+        else
+            errors += check_read(sf, offset, length, "random");
+        offset += length;
+        if (offset >= TEST_DATA_SIZE)
+            offset = 0;
+    }
+
+    close_streamfile(sf);
+    if (mem_sf.overlaps) {
+        printf("random: inner read by two threads at once\n");
+        errors++;
+    }
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    prefetch_streamfile_stats stats;
+    vgm_cond * cond;
+    int i, e, has_threads, errors = 0;
+
+    test_data = malloc(TEST_DATA_SIZE);
+    if (!test_data) return EXIT_FAILURE;
+    for (i = 0; i < TEST_DATA_SIZE; i++) {
+        test_data[i] = rng() & 0xFF;
+    }
+
+    /* builds without threads work as a plain buffer */
+    cond = vgm_cond_init();
+    has_threads = cond != NULL;
+    vgm_cond_free(cond);
+
+    e = test_sequential(has_threads);
+    printf("prefetch sequential %s\n", e ? "FAILED" : "ok");
+    errors += e;
+
+    e = test_random();
+    printf("prefetch random     %s\n", e ? "FAILED" : "ok");
+    errors += e;
+
+    if (get_prefetch_streamfile_stats(&mem_sf.sf, &stats)) {
+        printf("prefetch stats of a non-prefetch streamfile\n");
+        errors++;
+    }
+
+    free(test_data);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -90,7 +90,6 @@ int seek_needed_samples = -1;
 int decode_pos_ms = 0;
 int decode_pos_samples = 0;
 int stream_length_samples = 0;
-int fade_samples = 0;
 int output_channels = 0;
 
 const char* tagfile_name = "!tags.m3u"; //todo make configurable
@@ -206,6 +205,10 @@ static size_t wasf_read(WINAMP_STREAMFILE *streamfile, uint8_t *dest, off_t offs
     return streamfile->stdiosf->read(streamfile->stdiosf,dest,offset,length);
 }
 
+static const uint8_t * wasf_borrow(WINAMP_STREAMFILE *streamfile, off_t offset, size_t length) {
+    return streamfile->stdiosf->borrow(streamfile->stdiosf,offset,length);
+}
+
 static off_t wasf_get_size(WINAMP_STREAMFILE *streamfile) {
     return streamfile->stdiosf->get_size(streamfile->stdiosf);
 }
@@ -270,6 +273,7 @@ static STREAMFILE *open_winamp_streamfile_by_file(FILE *infile, const char * pat
     this_sf->sf.get_name = (void*)wasf_get_name;
     this_sf->sf.open = (void*)wasf_open;
     this_sf->sf.close = (void*)wasf_close;
+    this_sf->sf.borrow = stdiosf->borrow ? (void*)wasf_borrow : NULL;
 
     this_sf->stdiosf = stdiosf;
     this_sf->infile_ref = infile;
@@ -1065,7 +1069,11 @@ int winamp_Play(const in_char *fn) {
     decode_pos_samples = 0;
     paused = 0;
     stream_length_samples = get_vgmstream_play_samples(config.song_loop_count,config.song_fade_time,config.song_fade_delay,vgmstream);
-    fade_samples = (int)(config.song_fade_time * vgmstream->sample_rate);
+
+    /* fade near the end (applied while rendering) */
+    if (!settings.loop_forever) {
+        vgmstream_set_play_config(vgmstream, config.song_loop_count, config.song_fade_time, config.song_fade_delay);
+    }
 
     /* start */
     decode_thread_handle = CreateThread(
@@ -1264,35 +1272,23 @@ DWORD WINAPI __stdcall decode(void *arg) {
         else
             samples_to_do = max_buffer_samples;
 
-        /* seek setup (max samples to skip if still seeking, mark done) */
+        /* seek setup */
         if (seek_needed_samples != -1) {
-            /* reset if we need to seek backwards */
-            if (seek_needed_samples < decode_pos_samples) {
-                reset_vgmstream(vgmstream);
-                apply_config(vgmstream, &config); /* config is undone by reset */
-
-                decode_pos_samples = 0;
-                decode_pos_ms = 0;
-            }
-
             /* adjust seeking past file, can happen using the right (->) key
              * (should be done here and not in SetOutputTime due to threads/race conditions) */
             if (seek_needed_samples > max_samples) {
                 seek_needed_samples = max_samples;
             }
 
-            /* adjust max samples to seek */
-            if (decode_pos_samples < seek_needed_samples) {
-                samples_to_do = seek_needed_samples - decode_pos_samples;
-                if (samples_to_do > max_buffer_samples)
-                    samples_to_do = max_buffer_samples;
-            }
-            else {
-                seek_needed_samples = -1;
-            }
+            seek_vgmstream(vgmstream, seek_needed_samples);
+
+            decode_pos_samples = seek_needed_samples;
+            decode_pos_ms = decode_pos_samples * 1000LL / vgmstream->sample_rate;
+            seek_needed_samples = -1;
 
             /* flush Winamp buffers */
             input_module.outMod->Flush((int)decode_pos_ms);
+            continue;
         }
 
         output_bytes = (samples_to_do * output_channels * sizeof(short));
@@ -1307,33 +1303,9 @@ DWORD WINAPI __stdcall decode(void *arg) {
             }
             Sleep(10);
         }
-        else if (seek_needed_samples != -1) { /* seek */
-            render_vgmstream(sample_buffer,samples_to_do,vgmstream);
-
-            /* discard decoded samples and keep seeking */
-            decode_pos_samples += samples_to_do;
-            decode_pos_ms = decode_pos_samples * 1000LL / vgmstream->sample_rate;
-        }
         else if (input_module.outMod->CanWrite() >= output_bytes) { /* decode */
             render_vgmstream(sample_buffer,samples_to_do,vgmstream);
 
-            /* fade near the end */
-            if (vgmstream->loop_flag && fade_samples > 0 && !settings.loop_forever) {
-                int samples_into_fade = decode_pos_samples - (stream_length_samples - fade_samples);
-                if (samples_into_fade + samples_to_do > 0) {
-                    int j, k;
-                    for (j = 0; j < samples_to_do; j++, samples_into_fade++) {
-                        if (samples_into_fade > 0) {
-                            const double fadedness = (double)(fade_samples-samples_into_fade)/fade_samples;
-                            for (k = 0; k < vgmstream->channels; k++) {
-                                sample_buffer[j*vgmstream->channels+k] =
-                                    (short)(sample_buffer[j*vgmstream->channels+k]*fadedness);
-                            }
-                        }
-                    }
-                }
-            }
-
             /* downmix enabled (useful when the stream's channels are too much for Winamp's output) */
             if (settings.downmix_channels > 0 && settings.downmix_channels < vgmstream->channels) {
                 short temp_buffer[(576*2) * 2];
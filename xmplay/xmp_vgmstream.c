@@ -44,9 +44,9 @@ int disable_subsongs = 1;
 
 /* plugin state */
 VGMSTREAM * vgmstream = NULL;
-int framesDone, framesLength;
+int framesDone;
 int stream_length_samples = 0;
-int fade_samples = 0;
+BOOL fadeLooping = FALSE; /* fade disabled as XMPlay is looping */
 
 int current_subsong = 0;
 //XMPFILE current_file = NULL;
@@ -293,8 +293,8 @@ DWORD WINAPI xmplay_Open(const char *filename, XMPFILE file) {
 
     framesDone = 0;
     stream_length_samples = get_vgmstream_play_samples(loop_count, fade_seconds, fade_delay_seconds, vgmstream);
-    fade_samples = (int)(fade_seconds * vgmstream->sample_rate);
-    framesLength = stream_length_samples - fade_samples;
+    vgmstream_set_play_config(vgmstream, loop_count, fade_seconds, fade_delay_seconds);
+    fadeLooping = FALSE;
 
     //strncpy(current_fn,filename,XMPLAY_MAX_PATH);
     //current_file = file;
@@ -419,88 +419,36 @@ double WINAPI xmplay_SetPosition(DWORD pos) {
     }
 #endif
 
-    if (time < cpos) {
-        reset_vgmstream(vgmstream);
-        cpos = 0.0;
-    }
-
-    while (cpos < time) {
-        INT16 buffer[1024];
-        long max_sample_count = 1024 / vgmstream->channels;
-        long samples_to_skip = (long)((time - cpos) * vgmstream->sample_rate);
-        if (samples_to_skip > max_sample_count)
-            samples_to_skip = max_sample_count;
-        if (!samples_to_skip)
-            break;
-        render_vgmstream(buffer, (int)samples_to_skip, vgmstream);
-        cpos += (double)samples_to_skip / (double)vgmstream->sample_rate;
-    }
-
-    framesDone = (int32_t)(cpos * vgmstream->sample_rate);
+    framesDone = (int32_t)(time * vgmstream->sample_rate);
+    seek_vgmstream(vgmstream, framesDone);
+    cpos = (double)framesDone / (double)vgmstream->sample_rate;
 
     return cpos;
 }
 
 /* decode some sample data */
 DWORD WINAPI xmplay_Process(float* buf, DWORD bufsize) {
-    INT16 sample_buffer[1024];
-    UINT32 i, j, todo, done;
-
     BOOL doLoop = xmpfin->GetLooping();
-    float *sbuf = buf;
     UINT32 samplesTodo;
 
     bufsize /= vgmstream->channels;
 
+    /* fade is applied while rendering, unless looping (which may be toggled while playing) */
+    if (doLoop != fadeLooping) {
+        vgmstream_set_play_config(vgmstream, loop_count, doLoop ? 0.0 : fade_seconds, fade_delay_seconds);
+        fadeLooping = doLoop;
+    }
+
     samplesTodo = doLoop ? bufsize : stream_length_samples - framesDone;
     if (samplesTodo > bufsize)
         samplesTodo = bufsize;
 
     /* decode */
-    done = 0;
-    while (done < samplesTodo) {
-        todo = 1024 / vgmstream->channels;
-        if (todo > samplesTodo - done)
-            todo = samplesTodo - done;
-
-        render_vgmstream(sample_buffer, todo, vgmstream);
-
-        for (i = 0, j = todo * vgmstream->channels; i < j; ++i) {
-            *sbuf++ = sample_buffer[i] * 1.0f / 32768.0f;
-        }
-        done += todo;
-    }
-
-    sbuf = buf;
-
-    /* fade */
-    if (!doLoop && framesDone + done > framesLength) {
-        long fadeStart = (framesLength > framesDone) ? framesLength : framesDone;
-        long fadeEnd = (framesDone + done) > stream_length_samples ? stream_length_samples : (framesDone + done);
-        long fadePos;
-
-        float fadeScale = (float)(stream_length_samples - fadeStart) / fade_samples;
-        float fadeStep = 1.0f / fade_samples;
-
-        sbuf += (fadeStart - framesDone) * vgmstream->channels;
-        j = vgmstream->channels;
-
-        for (fadePos = fadeStart; fadePos < fadeEnd; ++fadePos) {
-            for (i = 0; i < j; ++i) {
-                sbuf[i] = sbuf[i] * fadeScale;
-            }
-            sbuf += j;
-
-            fadeScale -= fadeStep;
-            if (fadeScale <= 0.0f)
-                break;
-        }
-        done = (int)(fadePos - framesDone);
-    }
+    render_vgmstream_f32(buf, samplesTodo, vgmstream);
 
-    framesDone += done;
+    framesDone += samplesTodo;
 
-    return done * vgmstream->channels;
+    return samplesTodo * vgmstream->channels;
 }
 
 static DWORD WINAPI xmplay_GetSubSongs(float *length) {